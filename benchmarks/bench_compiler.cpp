@@ -0,0 +1,25 @@
+#include "benchmark/benchmark.h"
+#include "corpus.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "compiler.hpp"
+
+static void BM_CompilerCompile(benchmark::State& state)
+{
+    auto source = bench::make_expr_corpus(state.range(0));
+    auto tokens = Lexer { source }.scan();
+
+    std::size_t bytes {};
+    for (auto _ : state) {
+        state.PauseTiming();
+        Compiler compiler { Parser { tokens }.parse().value() };
+        state.ResumeTiming();
+
+        auto code_segment = std::move(compiler).compile();
+        bytes += code_segment.first.code().size();
+        benchmark::DoNotOptimize(code_segment);
+    }
+
+    state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_CompilerCompile)->RangeMultiplier(4)->Range(bench::min_corpus_size, bench::max_corpus_size);
@@ -0,0 +1,19 @@
+#include "benchmark/benchmark.h"
+#include "corpus.hpp"
+#include "lexer.hpp"
+
+static void BM_LexerScan(benchmark::State& state)
+{
+    auto source = bench::make_lexer_corpus(state.range(0));
+
+    std::size_t tokens {};
+    for (auto _ : state) {
+        auto result = Lexer { source }.scan();
+        tokens += result.size();
+        benchmark::DoNotOptimize(result.data());
+    }
+
+    state.SetBytesProcessed(state.iterations() * source.size());
+    state.counters["tokens/s"] = benchmark::Counter(tokens, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_LexerScan)->RangeMultiplier(4)->Range(bench::min_corpus_size, bench::max_corpus_size);
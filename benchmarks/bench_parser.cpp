@@ -0,0 +1,23 @@
+#include "benchmark/benchmark.h"
+#include "corpus.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+
+static void BM_ParserParse(benchmark::State& state)
+{
+    auto source = bench::make_expr_corpus(state.range(0));
+    auto tokens = Lexer { source }.scan();
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        Parser parser { tokens };
+        state.ResumeTiming();
+
+        auto ast = parser.parse();
+        benchmark::DoNotOptimize(ast);
+    }
+
+    state.counters["nodes/s"] = benchmark::Counter(state.iterations() * bench::expr_corpus_nodes(state.range(0)),
+                                                   benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_ParserParse)->RangeMultiplier(4)->Range(bench::min_corpus_size, bench::max_corpus_size);
@@ -0,0 +1,56 @@
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "corpus.hpp"
+#include "string.hpp"
+
+static void BM_LineTableReadLineNumber(benchmark::State& state)
+{
+    std::size_t lines = state.range(0);
+
+    // every line gets a run of 1 to 16 bytes just like a compiled script would
+    util::LineTable table;
+    std::mt19937_64 rng { 42 };
+    std::size_t offset {};
+    for (std::size_t line { 1 }; line <= lines; line++) {
+        table.write(offset, line);
+        offset += rng() % 16 + 1;
+    }
+
+    std::vector<std::size_t> queries(1'024);
+    for (auto& query : queries) {
+        query = rng() % offset;
+    }
+
+    for (auto _ : state) {
+        for (auto query : queries) {
+            benchmark::DoNotOptimize(table.read_line_number(query));
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * queries.size());
+}
+BENCHMARK(BM_LineTableReadLineNumber)->RangeMultiplier(4)->Range(bench::min_corpus_size, bench::max_corpus_size);
+
+static void BM_StringTableIntern(benchmark::State& state)
+{
+    std::size_t count = state.range(0);
+
+    // roughly half of the interned strings are duplicates of an earlier one
+    std::vector<std::string> strings;
+    strings.reserve(count);
+    for (std::size_t i {}; i < count; i++) {
+        strings.emplace_back(std::format("identifier_{}", i % (count / 2 + 1)));
+    }
+
+    for (auto _ : state) {
+        StringTable pool;
+        for (auto const& string : strings) {
+            benchmark::DoNotOptimize(pool.emplace(string));
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_StringTableIntern)->RangeMultiplier(4)->Range(bench::min_corpus_size, bench::max_corpus_size);
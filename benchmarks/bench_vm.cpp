@@ -0,0 +1,286 @@
+#include <memory>
+
+#include "benchmark/benchmark.h"
+#include "corpus.hpp"
+#include "register_vm.hpp"
+#include "sampler.hpp"
+#include "vm.hpp"
+#include "word_vm.hpp"
+
+namespace {
+/**
+ * Builds `LOAD lhs` followed by `count` pairs of `LOAD rhs; <opcode>` and `RETURN`.
+ * The operand stack stays at a depth of one so any corpus size fits.
+ */
+template <typename T>
+auto make_binary_program(Opcode opcode, T lhs, T rhs, std::size_t count) -> ByteCode
+{
+    ByteCode bc;
+    bench::emit_load(bc, lhs);
+    for (std::size_t i {}; i < count; i++) {
+        bench::emit_load(bc, rhs);
+        bc.write_byte(std::to_underlying(opcode), 1);
+    }
+    bc.write_byte(std::to_underlying(Opcode::RETURN), 1);
+    return bc;
+}
+
+// Superinstruction form of `make_binary_program`: `LOAD lhs` followed by `count` times `<opcode>K rhs`
+template <typename T>
+auto make_fused_program(Opcode opcode, T lhs, T rhs, std::size_t count) -> ByteCode
+{
+    ByteCode bc;
+    bench::emit_load(bc, lhs);
+    for (std::size_t i {}; i < count; i++) {
+        auto offset = bc.code().size();
+        bench::emit_load(bc, rhs);
+        bc.patch_byte(offset, std::to_underlying(util::opcode::fused(opcode).value()));
+    }
+    bc.write_byte(std::to_underlying(Opcode::RETURN), 1);
+    return bc;
+}
+
+// Builds `LOAD value` followed by `count` unary `<opcode>` instructions and `RETURN`
+template <typename T>
+auto make_unary_program(Opcode opcode, T value, std::size_t count) -> ByteCode
+{
+    ByteCode bc;
+    bench::emit_load(bc, value);
+    for (std::size_t i {}; i < count; i++) {
+        bc.write_byte(std::to_underlying(opcode), 1);
+    }
+    bc.write_byte(std::to_underlying(Opcode::RETURN), 1);
+    return bc;
+}
+
+void run_program(benchmark::State& state, ByteCode const& bc, std::size_t instructions)
+{
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto vm = std::make_unique<VM>(CodeSegment { bc, {} });
+        state.ResumeTiming();
+
+        vm->execute();
+    }
+
+    state.counters["instrs/s"] = benchmark::Counter(state.iterations() * instructions, benchmark::Counter::kIsRate);
+}
+
+// Same as `run_program` but dispatches through `execute_next`, which keeps every value in memory
+void run_program_uncached(benchmark::State& state, ByteCode const& bc, std::size_t instructions)
+{
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto vm = std::make_unique<VM>(CodeSegment { bc, {} });
+        state.ResumeTiming();
+
+        while (vm->instruction_pointer() != bc.code().size()) {
+            vm->execute_next();
+        }
+    }
+
+    state.counters["instrs/s"] = benchmark::Counter(state.iterations() * instructions, benchmark::Counter::kIsRate);
+}
+
+// Same as `run_program` while a `Sampler` interrupts the process at its default frequency
+void run_program_sampled(benchmark::State& state, ByteCode const& bc, std::size_t instructions)
+{
+    // one vm and one sampler for every iteration, the profiling timer only fires after a millisecond of cpu time
+    auto vm = std::make_unique<VM>(CodeSegment { bc, {} });
+    Sampler sampler;
+    sampler.start(vm->bytecode(), vm->sampled_instruction_pointer());
+    for (auto _ : state) {
+        state.PauseTiming();
+        vm->reset();
+        state.ResumeTiming();
+
+        vm->execute();
+    }
+    sampler.stop();
+
+    state.counters["instrs/s"] = benchmark::Counter(state.iterations() * instructions, benchmark::Counter::kIsRate);
+    state.counters["samples"]  = static_cast<double>(sampler.samples());
+}
+
+// Same as `run_program` on the fixed width encoding of `bc`
+void run_word_program(benchmark::State& state, ByteCode const& bc, std::size_t instructions)
+{
+    auto wc = util::wordcode::encode(bc).value();
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto vm = std::make_unique<WordVM>(WordSegment { wc, {} });
+        state.ResumeTiming();
+
+        vm->execute();
+    }
+
+    state.counters["instrs/s"] = benchmark::Counter(state.iterations() * instructions, benchmark::Counter::kIsRate);
+}
+
+// Register engine counterpart of `make_binary_program`: `r0 = lhs; r1 = rhs` followed by `count` times `r0 = r0 <opcode> r1`
+auto make_register_program(RegOpcode opcode, Register lhs, Register rhs, std::size_t count) -> RegisterCode
+{
+    RegisterCode rc;
+    rc.write_instr({ RegOpcode::LOADK, 0, static_cast<uint8_t>(rc.add_constant(lhs)), 0 }, 1);
+    rc.write_instr({ RegOpcode::LOADK, 1, static_cast<uint8_t>(rc.add_constant(rhs)), 0 }, 1);
+    for (std::size_t i {}; i < count; i++) {
+        rc.write_instr({ opcode, 0, 0, 1 }, 1);
+    }
+    rc.write_instr({ RegOpcode::RETURN, 0, 0, 0 }, 1);
+    rc.set_registers(2);
+    return rc;
+}
+
+void run_register_program(benchmark::State& state, RegisterCode const& rc, std::size_t instructions)
+{
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto vm = std::make_unique<RegisterVM>(RegisterSegment { rc, {} });
+        state.ResumeTiming();
+
+        vm->execute();
+    }
+
+    state.counters["instrs/s"] = benchmark::Counter(state.iterations() * instructions, benchmark::Counter::kIsRate);
+}
+}
+
+// operands which keep the accumulated value stable for any number of iterations
+template <Opcode opcode, typename T>
+constexpr auto binary_operands() -> std::pair<T, T>
+{
+    switch (opcode) {
+        case Opcode::MUL: return { static_cast<T>(3), static_cast<T>(1) };
+        case Opcode::DIV: return { static_cast<T>(12'345), static_cast<T>(1) };
+        case Opcode::MOD: return { static_cast<T>(12'345), static_cast<T>(100'000) };
+        case Opcode::CMPE: return { static_cast<T>(1), static_cast<T>(0) };
+        default: return { static_cast<T>(1), static_cast<T>(2) };
+    }
+}
+
+template <Opcode opcode, typename T>
+static void BM_VMBinary(benchmark::State& state)
+{
+    std::size_t count = state.range(0);
+    auto [lhs, rhs]   = binary_operands<opcode, T>();
+    run_program(state, make_binary_program(opcode, lhs, rhs, count), 1 + 2 * count);
+}
+
+template <Opcode opcode, typename T>
+static void BM_VMUnary(benchmark::State& state)
+{
+    std::size_t count = state.range(0);
+    run_program(state, make_unary_program(opcode, static_cast<T>(1), count), 1 + count);
+}
+
+// `instrs/s` counts the unfused instructions so the rate compares directly with `BM_VMBinary`
+template <Opcode opcode, typename T>
+static void BM_VMBinaryFused(benchmark::State& state)
+{
+    std::size_t count = state.range(0);
+    auto [lhs, rhs]   = binary_operands<opcode, T>();
+    run_program(state, make_fused_program(opcode, lhs, rhs, count), 1 + 2 * count);
+}
+
+template <Opcode opcode, typename T>
+static void BM_VMBinaryUncached(benchmark::State& state)
+{
+    std::size_t count = state.range(0);
+    auto [lhs, rhs]   = binary_operands<opcode, T>();
+    run_program_uncached(state, make_binary_program(opcode, lhs, rhs, count), 1 + 2 * count);
+}
+
+// `BM_VMBinary` while being profiled, the difference in `instrs/s` is what sampling costs
+template <Opcode opcode, typename T>
+static void BM_VMBinarySampled(benchmark::State& state)
+{
+    std::size_t count = state.range(0);
+    auto [lhs, rhs]   = binary_operands<opcode, T>();
+    run_program_sampled(state, make_binary_program(opcode, lhs, rhs, count), 1 + 2 * count);
+}
+
+template <Opcode opcode, typename T>
+static void BM_WordVMBinary(benchmark::State& state)
+{
+    std::size_t count = state.range(0);
+    auto [lhs, rhs]   = binary_operands<opcode, T>();
+    run_word_program(state, make_binary_program(opcode, lhs, rhs, count), 1 + 2 * count);
+}
+
+// Same workload as `BM_VMBinary` on the register engine, `instrs/s` counts the equivalent stack instructions
+template <Opcode opcode, typename T>
+static void BM_RegisterVMBinary(benchmark::State& state)
+{
+    constexpr auto reg_opcode = [] {
+        constexpr auto index = std::is_floating_point_v<T> ? 2 : std::is_unsigned_v<T> ? 1 : 0;
+        switch (opcode) {
+            case Opcode::ADD: return std::array { RegOpcode::ADD_I64, RegOpcode::ADD_U64, RegOpcode::ADD_F64 }[index];
+            case Opcode::SUB: return std::array { RegOpcode::SUB_I64, RegOpcode::SUB_U64, RegOpcode::SUB_F64 }[index];
+            case Opcode::MUL: return std::array { RegOpcode::MUL_I64, RegOpcode::MUL_U64, RegOpcode::MUL_F64 }[index];
+            case Opcode::DIV: return std::array { RegOpcode::DIV_I64, RegOpcode::DIV_U64, RegOpcode::DIV_F64 }[index];
+            default: return std::array { RegOpcode::MOD_I64, RegOpcode::MOD_U64, RegOpcode::MOD_F64 }[index];
+        }
+    }();
+    auto to_register = [](T value) {
+        if constexpr (std::is_floating_point_v<T>) {
+            return Register { .f = value };
+        } else if constexpr (std::is_unsigned_v<T>) {
+            return Register { .u = value };
+        } else {
+            return Register { .i = value };
+        }
+    };
+
+    std::size_t count = state.range(0);
+    auto [lhs, rhs]   = binary_operands<opcode, T>();
+    run_register_program(state, make_register_program(reg_opcode, to_register(lhs), to_register(rhs), count), 1 + 2 * count);
+}
+
+#define VM_BENCH_RANGE RangeMultiplier(4)->Range(bench::min_corpus_size, bench::max_corpus_size)
+
+BENCHMARK_TEMPLATE(BM_VMBinary, Opcode::ADD, int64_t)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_VMBinary, Opcode::ADD, uint64_t)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_VMBinary, Opcode::ADD, double)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_VMBinary, Opcode::SUB, int64_t)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_VMBinary, Opcode::SUB, double)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_VMBinary, Opcode::MUL, int64_t)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_VMBinary, Opcode::MUL, double)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_VMBinary, Opcode::DIV, int64_t)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_VMBinary, Opcode::DIV, uint64_t)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_VMBinary, Opcode::DIV, double)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_VMBinary, Opcode::MOD, int64_t)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_VMBinary, Opcode::MOD, double)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_VMBinary, Opcode::CMP, int64_t)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_VMBinary, Opcode::CMPE, bool)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_VMUnary, Opcode::NEGATE, int64_t)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_VMUnary, Opcode::NEGATE, double)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_VMUnary, Opcode::NOT, bool)->VM_BENCH_RANGE;
+
+BENCHMARK_TEMPLATE(BM_VMBinaryFused, Opcode::ADD, int64_t)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_VMBinaryFused, Opcode::ADD, double)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_VMBinaryFused, Opcode::MUL, int64_t)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_VMBinaryFused, Opcode::DIV, uint64_t)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_VMBinaryFused, Opcode::MOD, int64_t)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_VMBinaryFused, Opcode::CMPE, bool)->VM_BENCH_RANGE;
+
+BENCHMARK_TEMPLATE(BM_VMBinaryUncached, Opcode::ADD, int64_t)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_VMBinaryUncached, Opcode::ADD, double)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_VMBinaryUncached, Opcode::MUL, int64_t)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_VMBinaryUncached, Opcode::DIV, uint64_t)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_VMBinaryUncached, Opcode::MOD, int64_t)->VM_BENCH_RANGE;
+
+BENCHMARK_TEMPLATE(BM_VMBinarySampled, Opcode::ADD, int64_t)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_VMBinarySampled, Opcode::ADD, double)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_VMBinarySampled, Opcode::MOD, int64_t)->VM_BENCH_RANGE;
+
+BENCHMARK_TEMPLATE(BM_WordVMBinary, Opcode::ADD, int64_t)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_WordVMBinary, Opcode::ADD, double)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_WordVMBinary, Opcode::MUL, int64_t)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_WordVMBinary, Opcode::DIV, uint64_t)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_WordVMBinary, Opcode::MOD, int64_t)->VM_BENCH_RANGE;
+
+BENCHMARK_TEMPLATE(BM_RegisterVMBinary, Opcode::ADD, int64_t)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_RegisterVMBinary, Opcode::ADD, double)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_RegisterVMBinary, Opcode::MUL, int64_t)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_RegisterVMBinary, Opcode::DIV, uint64_t)->VM_BENCH_RANGE;
+BENCHMARK_TEMPLATE(BM_RegisterVMBinary, Opcode::MOD, int64_t)->VM_BENCH_RANGE;
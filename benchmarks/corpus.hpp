@@ -0,0 +1,91 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <string>
+#include <format>
+#include <utility>
+
+#include "bytecode.hpp"
+#include "instr.hpp"
+#include "types.hpp"
+
+// Largest corpus size swept by every benchmark. Configure through the
+// `CPPLOX_BENCH_CORPUS_SIZE` cache variable when configuring cmake.
+#ifndef CPPLOX_BENCH_CORPUS_SIZE
+#define CPPLOX_BENCH_CORPUS_SIZE 4096
+#endif
+
+namespace bench {
+inline constexpr std::size_t min_corpus_size = 8;
+inline constexpr std::size_t max_corpus_size = CPPLOX_BENCH_CORPUS_SIZE;
+
+/**
+ * Generates a token heavy source of `lines` lines which touches every
+ * lexer path: numbers, floats, strings, interpolations, keywords,
+ * identifiers, operators and comments.
+ */
+inline auto make_lexer_corpus(std::size_t lines) -> std::string
+{
+    static constexpr std::array snippets {
+        R"(log(1 + 2 * 3 - 4 / 5);)",
+        R"(let value = 3.1415 * radius * radius; // area)",
+        R"(log("Hello " + "${name} has ${count + 1} items");)",
+        R"(if (a <= b and c >= d or !e) { return a != b; })",
+        R"(while (i < 100) { i = i + 1.5f; })",
+    };
+
+    std::string source;
+    for (std::size_t line {}; line < lines; line++) {
+        source += snippets[line % snippets.size()];
+        source += '\n';
+    }
+    return source;
+}
+
+/**
+ * Generates a single `log(...)` statement whose expression has `terms`
+ * integer literals chained with `+`, `-` and `*`.
+ *
+ * The resulting ast has exactly `2 * terms` nodes: `terms` literals,
+ * `terms - 1` binary expressions and the enclosing log statement.
+ */
+inline auto make_expr_corpus(std::size_t terms) -> std::string
+{
+    static constexpr std::array ops { " + ", " - ", " * " };
+
+    std::string source { "log(1" };
+    for (std::size_t term { 1 }; term < terms; term++) {
+        source += ops[term % ops.size()];
+        source += std::format("{}", term % 97 + 1);
+    }
+    source += ");";
+    return source;
+}
+
+inline constexpr auto expr_corpus_nodes(std::size_t terms) noexcept -> std::size_t
+{
+    return 2 * terms;
+}
+
+/**
+ * Writes a `LOAD` instruction for `value` straight into `bc` the same way
+ * the compiler lays it out: opcode, type index and the raw value bytes.
+ */
+template <typename T>
+void emit_load(ByteCode& bc, T value, std::size_t line_nr = 1)
+{
+    auto type_index = [] {
+        using enum TypeIndex;
+        if constexpr (std::is_same_v<T, bool>) return BOOL;
+        else if constexpr (std::is_same_v<T, int64_t>) return INT64;
+        else if constexpr (std::is_same_v<T, uint64_t>) return UINT64;
+        else if constexpr (std::is_same_v<T, double>) return FLOAT64;
+    }();
+
+    bc.write_byte(std::to_underlying(Opcode::LOAD), line_nr);
+    bc.write_byte(std::to_underlying(type_index), line_nr);
+    for (auto byte : std::bit_cast<std::array<uint8_t, sizeof(T)>>(value)) {
+        bc.write_byte(byte, line_nr);
+    }
+}
+}
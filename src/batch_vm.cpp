@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <iostream>
+#include <limits>
+#include <print>
+
+#include "batch_vm.hpp"
+
+namespace {
+// position in `BatchVM::Column` of the column a parameter of `type` is read from
+auto column_of(TypeIndex type) -> std::size_t
+{
+    switch (type) {
+        using enum TypeIndex;
+        case BOOL: return 0;
+        case INT8:
+        case INT16:
+        case INT32:
+        case INT64: return 1;
+        case UINT8:
+        case UINT16:
+        case UINT32:
+        case UINT64: return 2;
+        case FLOAT32:
+        case FLOAT64: return 3;
+        case STRING: return 4;
+        case FUNCTION:
+        case INSTANCE:
+        case ARRAY: break;   // the register compiler never reads parameters of these
+    }
+    std::unreachable();
+}
+
+template <typename T>
+auto to_register(T value) -> Register
+{
+    if constexpr (std::is_same_v<T, bool>) {
+        return Register { .b = value };
+    } else if constexpr (std::is_same_v<T, int64_t>) {
+        return Register { .i = value };
+    } else if constexpr (std::is_same_v<T, uint64_t>) {
+        return Register { .u = value };
+    } else if constexpr (std::is_same_v<T, double>) {
+        return Register { .f = value };
+    } else {
+        return Register { .s = value };
+    }
+}
+
+// the whole batch in one loop the compiler can vectorize, `row` is the index inside the batch
+template <typename Row>
+void for_rows(std::size_t count, Row row)
+{
+    for (std::size_t index {}; index < count; index++) {
+        row(index);
+    }
+}
+}
+
+auto BatchVM::compile(RegisterSegment seg) -> std::optional<BatchVM>
+{
+    if (!seg.first.result().has_value()) {
+        return {};
+    }
+    auto logs = std::ranges::any_of(seg.first.code(), [](RegInstr instr) {
+        using enum RegOpcode;
+        return instr.op == LOG_BOOL || instr.op == LOG_I64 || instr.op == LOG_U64 || instr.op == LOG_F64 || instr.op == LOG_STR;
+    });
+    if (logs) {
+        return {};
+    }
+    return BatchVM { std::move(seg) };
+}
+
+auto BatchVM::intern(std::string_view value) -> std::string const*
+{
+    return &*m_pool.emplace(value).first;
+}
+
+auto BatchVM::evaluate(std::span<Column const> inputs, std::size_t rows) -> std::expected<std::vector<Register>, Error>
+{
+    if (auto error = m_check(inputs, rows); error.has_value()) {
+        return std::unexpected(std::move(*error));
+    }
+    std::vector<Register> result(rows);
+    for (std::size_t first {}; first < rows; first += batch_size) {
+        if (auto error = m_run(inputs, first, std::min(batch_size, rows - first), result.data() + first); error.has_value()) {
+            return std::unexpected(std::move(*error));
+        }
+    }
+    return result;
+}
+
+auto BatchVM::m_check(std::span<Column const> inputs, std::size_t rows) const -> std::optional<Error>
+{
+    auto const& types = m_rc.inputs();
+    for (std::size_t index {}; index < types.size(); index++) {
+        if (!types[index].has_value()) {
+            continue;   // parameter the code never reads
+        }
+        if (index >= inputs.size()) {
+            return Error { 0, std::format("missing input {}", index) };
+        }
+        if (inputs[index].index() != column_of(*types[index])) {
+            return Error { 0, std::format("input {} is not a column of {}", index, util::type::to_string(*types[index])) };
+        }
+        auto size = std::visit([](auto column) { return column.size(); }, inputs[index]);
+        if (size < rows) {
+            return Error { size, std::format("input {} has only {} rows", index, size) };
+        }
+    }
+    return {};
+}
+
+auto BatchVM::m_run(std::span<Column const> inputs, std::size_t first, std::size_t count, Register* out) -> std::optional<Error>
+{
+    auto const* code      = m_rc.code().data();
+    auto const* constants = m_rc.constants().data();
+
+    // the first row of the batch whose divisor `b` can't divide `a`, checked before any of them divides
+    auto division_error = [first, count](Register const* a, Register const* b, bool is_signed) -> std::optional<Error> {
+        auto min = std::numeric_limits<int64_t>::min();
+        bool bad {};
+        for_rows(count, [&](std::size_t row) { bad |= b[row].u == 0 || (is_signed && a[row].i == min && b[row].i == -1); });
+        if (!bad) {
+            return {};
+        }
+        for (std::size_t row {};; row++) {
+            if (b[row].u == 0) {
+                return Error { first + row, "integer division by zero" };
+            }
+            if (is_signed && a[row].i == min && b[row].i == -1) {
+                return Error { first + row, "integer division overflows" };
+            }
+        }
+    };
+
+    for (std::size_t pc {};; pc++) {
+        auto [op, a, b, c] = code[pc];
+        auto* ra           = m_regs[a].data();
+        auto const* rb     = m_regs[b].data();
+        auto const* rc     = m_regs[c].data();
+
+        switch (op) {
+            using enum RegOpcode;
+            case LOADK: std::fill_n(ra, count, constants[b | (c << 8)]); break;
+            case INPUT:
+                std::visit([&](auto column) { for_rows(count, [&](std::size_t row) { ra[row] = to_register(column[first + row]); }); },
+                           inputs[b | (c << 8)]);
+                break;
+
+            case ADD_I64: for_rows(count, [&](std::size_t row) { ra[row].i = rb[row].i + rc[row].i; }); break;
+            case ADD_U64: for_rows(count, [&](std::size_t row) { ra[row].u = rb[row].u + rc[row].u; }); break;
+            case ADD_F64: for_rows(count, [&](std::size_t row) { ra[row].f = rb[row].f + rc[row].f; }); break;
+            case ADD_STR: for_rows(count, [&](std::size_t row) { ra[row].s = intern(*rb[row].s + *rc[row].s); }); break;
+            case SUB_I64: for_rows(count, [&](std::size_t row) { ra[row].i = rb[row].i - rc[row].i; }); break;
+            case SUB_U64: for_rows(count, [&](std::size_t row) { ra[row].u = rb[row].u - rc[row].u; }); break;
+            case SUB_F64: for_rows(count, [&](std::size_t row) { ra[row].f = rb[row].f - rc[row].f; }); break;
+            case MUL_I64: for_rows(count, [&](std::size_t row) { ra[row].i = rb[row].i * rc[row].i; }); break;
+            case MUL_U64: for_rows(count, [&](std::size_t row) { ra[row].u = rb[row].u * rc[row].u; }); break;
+            case MUL_F64: for_rows(count, [&](std::size_t row) { ra[row].f = rb[row].f * rc[row].f; }); break;
+            case DIV_I64:
+                if (auto error = division_error(rb, rc, true); error.has_value()) {
+                    return error;
+                }
+                for_rows(count, [&](std::size_t row) { ra[row].i = rb[row].i / rc[row].i; });
+                break;
+            case DIV_U64:
+                if (auto error = division_error(rb, rc, false); error.has_value()) {
+                    return error;
+                }
+                for_rows(count, [&](std::size_t row) { ra[row].u = rb[row].u / rc[row].u; });
+                break;
+            case DIV_F64: for_rows(count, [&](std::size_t row) { ra[row].f = rb[row].f / rc[row].f; }); break;
+            case MOD_I64:
+                if (auto error = division_error(rb, rc, true); error.has_value()) {
+                    return error;
+                }
+                for_rows(count, [&](std::size_t row) { ra[row].i = rb[row].i % rc[row].i; });
+                break;
+            case MOD_U64:
+                if (auto error = division_error(rb, rc, false); error.has_value()) {
+                    return error;
+                }
+                for_rows(count, [&](std::size_t row) { ra[row].u = rb[row].u % rc[row].u; });
+                break;
+            case MOD_F64: for_rows(count, [&](std::size_t row) { ra[row].f = std::fmod(rb[row].f, rc[row].f); }); break;
+
+            case LT_I64: for_rows(count, [&](std::size_t row) { ra[row].b = rb[row].i < rc[row].i; }); break;
+            case LT_U64: for_rows(count, [&](std::size_t row) { ra[row].b = rb[row].u < rc[row].u; }); break;
+            case LT_F64: for_rows(count, [&](std::size_t row) { ra[row].b = rb[row].f < rc[row].f; }); break;
+            case GT_I64: for_rows(count, [&](std::size_t row) { ra[row].b = rb[row].i > rc[row].i; }); break;
+            case GT_U64: for_rows(count, [&](std::size_t row) { ra[row].b = rb[row].u > rc[row].u; }); break;
+            case GT_F64: for_rows(count, [&](std::size_t row) { ra[row].b = rb[row].f > rc[row].f; }); break;
+            case EQ_BOOL: for_rows(count, [&](std::size_t row) { ra[row].b = rb[row].b == rc[row].b; }); break;
+            case EQ_I64: for_rows(count, [&](std::size_t row) { ra[row].b = rb[row].i == rc[row].i; }); break;
+            case EQ_F64: for_rows(count, [&](std::size_t row) { ra[row].b = rb[row].f == rc[row].f; }); break;
+
+            case NEG_I64: for_rows(count, [&](std::size_t row) { ra[row].i = -rb[row].i; }); break;
+            case NEG_F64: for_rows(count, [&](std::size_t row) { ra[row].f = -rb[row].f; }); break;
+            case NOT_BOOL: for_rows(count, [&](std::size_t row) { ra[row].b = !rb[row].b; }); break;
+            case NOT_I64: for_rows(count, [&](std::size_t row) { ra[row].b = rb[row].i == 0; }); break;
+            case NOT_F64: for_rows(count, [&](std::size_t row) { ra[row].b = !rb[row].f; }); break;
+            case NOT_STR: for_rows(count, [&](std::size_t row) { ra[row].b = !rb[row].s->empty(); }); break;
+
+            case TOSTR_BOOL: for_rows(count, [&](std::size_t row) { ra[row].s = intern(std::format("{}", rb[row].b)); }); break;
+            case TOSTR_I64: for_rows(count, [&](std::size_t row) { ra[row].s = intern(std::format("{}", rb[row].i)); }); break;
+            case TOSTR_U64: for_rows(count, [&](std::size_t row) { ra[row].s = intern(std::format("{}", rb[row].u)); }); break;
+            case TOSTR_F64: for_rows(count, [&](std::size_t row) { ra[row].s = intern(std::format("{}", rb[row].f)); }); break;
+
+            case LOG_BOOL:
+            case LOG_I64:
+            case LOG_U64:
+            case LOG_F64:
+            case LOG_STR:
+#ifndef NDEBUG
+                std::println(std::cerr, "[DEBUG] Log in batch code, which compile declines");
+#else
+                std::unreachable();
+#endif
+                return {};
+
+            case RETURN: std::copy_n(ra, count, out); return {};
+        }
+    }
+}
@@ -0,0 +1,1210 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <limits>
+#include <set>
+#include <utility>
+
+#include "c_backend.hpp"
+
+namespace {
+// Runtime every translation unit starts with
+constexpr std::string_view runtime = R"runtime(/* generated by CppLox */
+#include <inttypes.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    char const* data;
+    size_t size;
+} lox_str;
+
+/* every function value, its code is cast back to its signature at the call, a closure's captures follow it */
+struct lox_closure {
+    void (*code)(void);
+};
+typedef struct lox_closure const* lox_fn;
+
+/* every instance starts with its class's method table, its fields follow those of its superclass */
+struct lox_object {
+    void (*const* methods)(void);
+};
+typedef struct lox_object* lox_obj;
+
+/* every array, its elements are stored at their own width like the vm's */
+struct lox_array {
+    int64_t length;
+    void* data;
+};
+typedef struct lox_array* lox_arr;
+
+/* boxes and closures live until the program ends like the vm's do */
+static void* lox_alloc(size_t size)
+{
+    void* data = malloc(size);
+    if (data == NULL) {
+        abort();
+    }
+    return data;
+}
+
+/* reading a field before its first assignment stops the program like it stops the vm */
+static void lox_undefined(char const* name, int line, int column)
+{
+    fprintf(stderr, "[line %d:%d] Runtime error: undefined property '%s'\n", line, column, name);
+    exit(1);
+}
+
+/* misusing an array or an integer division that would trap stops the program like it stops the vm */
+static void lox_halt(char const* message, int line, int column)
+{
+    fprintf(stderr, "[line %d:%d] Runtime error: %s\n", line, column, message);
+    exit(1);
+}
+
+static int64_t lox_div_i64(int64_t lhs, int64_t rhs, bool is_remainder, int line, int column)
+{
+    if (rhs == 0) {
+        lox_halt("integer division by zero", line, column);
+    }
+    if (lhs == INT64_MIN && rhs == -1) {
+        lox_halt("integer division overflows", line, column);
+    }
+    return is_remainder ? lhs % rhs : lhs / rhs;
+}
+
+static uint64_t lox_div_u64(uint64_t lhs, uint64_t rhs, bool is_remainder, int line, int column)
+{
+    if (rhs == 0) {
+        lox_halt("integer division by zero", line, column);
+    }
+    return is_remainder ? lhs % rhs : lhs / rhs;
+}
+
+static lox_arr lox_arr_new(int64_t length, size_t size)
+{
+    lox_arr array = lox_alloc(sizeof *array);
+    array->length = length;
+    array->data   = lox_alloc((size_t)length * size + 1);   /* malloc(0) may return NULL */
+    return array;
+}
+
+/* `[a, b, c]`, the elements are already converted */
+static lox_arr lox_arr_of(void const* elements, int64_t length, size_t size)
+{
+    lox_arr array = lox_arr_new(length, size);
+    memcpy(array->data, elements, (size_t)length * size);
+    return array;
+}
+
+/* `[value; length]`, `value` points to a single converted element */
+static lox_arr lox_arr_fill(void const* value, int64_t length, size_t size, int line, int column)
+{
+    if (length < 0) {
+        char message[64];
+        snprintf(message, sizeof message, "negative array length %" PRId64, length);
+        lox_halt(message, line, column);
+    }
+    /* the vm's `Array::max_bytes` */
+    if ((uint64_t)length > ((uint64_t)1 << 32) / size) {
+        char message[64];
+        snprintf(message, sizeof message, "array length %" PRId64 " is too large", length);
+        lox_halt(message, line, column);
+    }
+    lox_arr array = lox_arr_new(length, size);
+    for (int64_t index = 0; index < length; index++) {
+        memcpy((char*)array->data + index * size, value, size);
+    }
+    return array;
+}
+
+/* address of the element at `index`, a negative index wraps around to one no array reaches */
+static void* lox_arr_at(lox_arr array, int64_t index, bool is_signed, size_t size, int line, int column)
+{
+    if ((uint64_t)index >= (uint64_t)array->length) {
+        char message[128];
+        if (is_signed) {
+            snprintf(message, sizeof message, "index %" PRId64 " is out of bounds of an array of length %" PRId64, index, array->length);
+        } else {
+            snprintf(message, sizeof message, "index %" PRIu64 " is out of bounds of an array of length %" PRId64, (uint64_t)index, array->length);
+        }
+        lox_halt(message, line, column);
+    }
+    return (char*)array->data + (uint64_t)index * size;
+}
+
+static void lox_arr_match(lox_arr lhs, lox_arr rhs, char const* op, int line, int column)
+{
+    if (lhs->length != rhs->length) {
+        char message[128];
+        snprintf(message, sizeof message, "element-wise '%s' of arrays of length %" PRId64 " and %" PRId64, op, lhs->length, rhs->length);
+        lox_halt(message, line, column);
+    }
+}
+
+static lox_str lox_str_lit(char const* data, size_t size)
+{
+    lox_str str = { data, size };
+    return str;
+}
+
+static lox_str lox_str_concat(lox_str lhs, lox_str rhs)
+{
+    char* data = lox_alloc(lhs.size + rhs.size + 1);
+    memcpy(data, lhs.data, lhs.size);
+    memcpy(data + lhs.size, rhs.data, rhs.size);
+    data[lhs.size + rhs.size] = '\0';
+    return lox_str_lit(data, lhs.size + rhs.size);
+}
+
+/* lexicographic like std::string's operator<=>, -1, 0 or 1 */
+static int lox_str_cmp(lox_str lhs, lox_str rhs)
+{
+    size_t size = lhs.size < rhs.size ? lhs.size : rhs.size;
+    int cmp     = size == 0 ? 0 : memcmp(lhs.data, rhs.data, size);
+    if (cmp != 0) {
+        return cmp < 0 ? -1 : 1;
+    }
+    return lhs.size < rhs.size ? -1 : (lhs.size > rhs.size ? 1 : 0);
+}
+
+static lox_str lox_str_dup(char const* text)
+{
+    return lox_str_concat(lox_str_lit(text, strlen(text)), lox_str_lit("", 0));
+}
+
+static double lox_f64(uint64_t bits)
+{
+    double value;
+    memcpy(&value, &bits, sizeof value);
+    return value;
+}
+
+/* shortest representation which reads back as `value`, fixed or scientific whichever is shorter like C++ std::to_chars */
+static void lox_format_f64(double value, char* out)
+{
+    if (isnan(value)) {
+        strcpy(out, signbit(value) ? "-nan" : "nan");
+        return;
+    }
+    if (isinf(value)) {
+        strcpy(out, value < 0 ? "-inf" : "inf");
+        return;
+    }
+
+    char sci[32];
+    for (int precision = 0; precision <= 17; precision++) {
+        snprintf(sci, sizeof sci, "%.*e", precision, value);
+        if (strtod(sci, NULL) == value) {
+            break;
+        }
+    }
+
+    /* split "[-]d.ddde[+-]xx" into sign, significant digits and decimal exponent */
+    char const* p   = sci;
+    bool negative   = *p == '-';
+    p += negative;
+    char digits[20];
+    int count = 0;
+    for (; *p != 'e'; p++) {
+        if (*p != '.') {
+            digits[count++] = *p;
+        }
+    }
+    int exponent = atoi(p + 1);
+
+    char fixed[400];
+    char* f = fixed;
+    if (negative) {
+        *f++ = '-';
+    }
+    if (exponent >= 0) {
+        for (int i = 0; i <= exponent || i < count; i++) {
+            if (i == exponent + 1) {
+                *f++ = '.';
+            }
+            *f++ = i < count ? digits[i] : '0';
+        }
+    } else {
+        *f++ = '0';
+        *f++ = '.';
+        for (int i = -1; i > exponent; i--) {
+            *f++ = '0';
+        }
+        for (int i = 0; i < count; i++) {
+            *f++ = digits[i];
+        }
+    }
+    *f = '\0';
+
+    char scientific[40];
+    char* s = scientific;
+    if (negative) {
+        *s++ = '-';
+    }
+    *s++ = digits[0];
+    if (count > 1) {
+        *s++ = '.';
+        memcpy(s, digits + 1, count - 1);
+        s += count - 1;
+    }
+    sprintf(s, "e%c%02d", exponent < 0 ? '-' : '+', exponent < 0 ? -exponent : exponent);
+
+    if (strlen(scientific) < strlen(fixed)) {
+        strcpy(out, scientific);
+    } else if (exponent >= count) {
+        /* an integer too long for the significant digits, printed exactly instead of padded with zeros */
+        sprintf(out, "%.0f", value);
+    } else {
+        strcpy(out, fixed);
+    }
+}
+
+/* string interpolation, formatted like std::format("{}", value) */
+static lox_str lox_str_from_bool(bool value)
+{
+    return lox_str_dup(value ? "true" : "false");
+}
+
+static lox_str lox_str_from_i64(int64_t value)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof buffer, "%" PRId64, value);
+    return lox_str_dup(buffer);
+}
+
+static lox_str lox_str_from_u64(uint64_t value)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof buffer, "%" PRIu64, value);
+    return lox_str_dup(buffer);
+}
+
+static lox_str lox_str_from_f64(double value)
+{
+    char buffer[400];
+    lox_format_f64(value, buffer);
+    return lox_str_dup(buffer);
+}
+
+static void lox_log_bool(bool value)
+{
+    puts(value ? "true" : "false");
+}
+
+static void lox_log_i64(int64_t value)
+{
+    printf("%" PRId64 "\n", value);
+}
+
+static void lox_log_u64(uint64_t value)
+{
+    printf("%" PRIu64 "\n", value);
+}
+
+static void lox_log_f64(double value)
+{
+    char buffer[400];
+    lox_format_f64(value, buffer);
+    puts(buffer);
+}
+
+static void lox_log_str(lox_str value)
+{
+    fwrite(value.data, 1, value.size, stdout);
+    putchar('\n');
+}
+)runtime";
+
+// representation the vm holds a value of this type in
+enum class Rep : uint8_t {
+    BOOL,
+    I64,
+    U64,
+    F64,
+    STR,
+    FUN,
+    OBJ,
+    ARR,
+};
+
+auto rep_of(TypeIndex type) -> Rep
+{
+    switch (type) {
+        using enum TypeIndex;
+        case BOOL: return Rep::BOOL;
+        case INT8:
+        case INT16:
+        case INT32:
+        case INT64: return Rep::I64;
+        case UINT8:
+        case UINT16:
+        case UINT32:
+        case UINT64: return Rep::U64;
+        case FLOAT32:
+        case FLOAT64: return Rep::F64;
+        case STRING: return Rep::STR;
+        case FUNCTION: return Rep::FUN;
+        case INSTANCE: return Rep::OBJ;
+        case ARRAY: return Rep::ARR;
+    }
+    std::unreachable();
+}
+
+// suffix of the runtime function handling a representation
+auto suffix(Rep rep) -> std::string_view
+{
+    switch (rep) {
+        case Rep::BOOL: return "bool";
+        case Rep::I64: return "i64";
+        case Rep::U64: return "u64";
+        case Rep::F64: return "f64";
+        case Rep::STR: return "str";
+        case Rep::FUN: return "fn";   // functions, instances and arrays are never logged nor interpolated, only passed to helpers
+        case Rep::OBJ: return "obj";
+        case Rep::ARR: return "arr";
+    }
+    std::unreachable();
+}
+
+// C type holding a representation
+auto c_type(Rep rep) -> std::string_view
+{
+    switch (rep) {
+        case Rep::BOOL: return "bool";
+        case Rep::I64: return "int64_t";
+        case Rep::U64: return "uint64_t";
+        case Rep::F64: return "double";
+        case Rep::STR: return "lox_str";
+        case Rep::FUN: return "lox_fn";
+        case Rep::OBJ: return "lox_obj";
+        case Rep::ARR: return "lox_arr";
+    }
+    std::unreachable();
+}
+
+// C type an array stores its elements as
+auto element_type(TypeIndex element) -> std::string_view
+{
+    switch (element) {
+        using enum TypeIndex;
+        case BOOL: return "bool";
+        case INT8: return "int8_t";
+        case INT16: return "int16_t";
+        case INT32: return "int32_t";
+        case INT64: return "int64_t";
+        case UINT8: return "uint8_t";
+        case UINT16: return "uint16_t";
+        case UINT32: return "uint32_t";
+        case UINT64: return "uint64_t";
+        case FLOAT32: return "float";
+        case FLOAT64: return "double";
+        default: break;
+    }
+    std::unreachable();
+}
+
+// where a `fun` is declared, which names everything made for it since names can be shadowed
+auto site(Fun const& fun) -> std::string
+{
+    return std::format("{}_{}", fun.line, fun.column);
+}
+
+// C function a `fun` declaration becomes
+auto function_name(Fun const& fun) -> std::string
+{
+    return std::format("lox_fun_{}", site(fun));
+}
+
+// C type of a variable, a pointer to its box when closures share it
+auto variable_type(Type const& type, bool boxed) -> std::string
+{
+    return std::format("{}{}", c_type(rep_of(type.index)), boxed ? "*" : "");
+}
+
+// `R name(lox_fn lox_self, P0 lox_l0, ...)`, the parameters are the first locals of the body, boxed ones are copied into
+// their box first
+auto prototype(Fun const& fun) -> std::string
+{
+    std::string parameters { "lox_fn lox_self" };
+    for (std::size_t index {}; index < fun.parameters.size(); index++) {
+        auto const& binding = fun.parameters[index].binding;
+        parameters += std::format(", {} lox_{}{}", c_type(rep_of(fun.signature->parameters[index].index)), binding.boxed ? "p" : "l", binding.index);
+    }
+    return std::format("static {} {}({})", c_type(rep_of(fun.signature->result.index)), function_name(fun), parameters);
+}
+
+// helper calling a function value of this signature, which evaluates the callee once to pass it along as `lox_self`
+auto call_name(FunctionType const& signature) -> std::string
+{
+    auto name = std::format("lox_call_{}", suffix(rep_of(signature.result.index)));
+    for (auto const& parameter : signature.parameters) {
+        name += std::format("_{}", suffix(rep_of(parameter.index)));
+    }
+    return name;
+}
+
+auto call_helper(FunctionType const& signature) -> std::string
+{
+    std::string types { "lox_fn" };
+    std::string parameters { "lox_fn lox_callee" };
+    std::string arguments { "lox_callee" };
+    for (std::size_t index {}; index < signature.parameters.size(); index++) {
+        auto type = c_type(rep_of(signature.parameters[index].index));
+        types += std::format(", {}", type);
+        parameters += std::format(", {} lox_a{}", type, index);
+        arguments += std::format(", lox_a{}", index);
+    }
+    auto result = c_type(rep_of(signature.result.index));
+    return std::format("static {0} {1}({2})\n{{\n    return (({0} (*)({3}))lox_callee->code)({4});\n}}\n",
+                       result, call_name(signature), parameters, types, arguments);
+}
+
+// helper calling a method through the instance's method table, methods have no captures and take the instance first
+auto invoke_name(FunctionType const& signature) -> std::string
+{
+    return std::format("lox_invoke{}", call_name(signature).substr(std::string_view { "lox_call" }.size()));
+}
+
+auto invoke_helper(FunctionType const& signature) -> std::string
+{
+    std::string types { "lox_fn" };
+    std::string parameters { "lox_obj lox_object, size_t lox_slot" };
+    std::string arguments { "NULL, lox_object" };
+    for (std::size_t index {}; index < signature.parameters.size(); index++) {
+        auto type = c_type(rep_of(signature.parameters[index].index));
+        types += std::format(", {}", type);
+        if (index > 0) {
+            parameters += std::format(", {} lox_a{}", type, index);
+            arguments += std::format(", lox_a{}", index);
+        }
+    }
+    auto result = c_type(rep_of(signature.result.index));
+    return std::format("static {0} {1}({2})\n{{\n    return (({0} (*)({3}))lox_object->methods[lox_slot])({4});\n}}\n",
+                       result, invoke_name(signature), parameters, types, arguments);
+}
+
+// class declaring the field `name` an instance of `klass` has
+auto owner(ClassType const& klass, std::string_view name) -> ClassType const&
+{
+    auto const* owner = &klass;
+    while (std::ranges::none_of(owner->fields, [name](auto const& field) { return field.name == name; })) {
+        owner = owner->superclass;
+    }
+    return *owner;
+}
+
+// the method table's slots, the superclass's first so an override takes the slot of the method it overrides
+auto slots(ClassType const& klass) -> std::vector<std::string_view>
+{
+    auto names = klass.superclass != nullptr ? slots(*klass.superclass) : std::vector<std::string_view> {};
+    for (auto const& method : klass.methods) {
+        // `init` is only ever called by the constructor
+        if (method.name != "init" && std::ranges::find(names, method.name) == names.end()) {
+            names.push_back(method.name);
+        }
+    }
+    return names;
+}
+
+auto slot(ClassType const& klass, std::string_view name) -> std::size_t
+{
+    auto names = slots(klass);
+    return static_cast<std::size_t>(std::ranges::find(names, name) - names.begin());
+}
+
+// an instance's layout, the superclass's in front so a pointer to the instance points to an instance of the superclass,
+// every field has a flag telling whether it was assigned, and the accessors checking it
+auto instance(ClassType const& klass) -> std::string
+{
+    auto base = klass.superclass != nullptr ? std::format("struct lox_class_{} super;   /* {} */", klass.superclass->index, klass.superclass->name)
+                                            : std::string { "struct lox_object object;" };
+    std::string members;
+    std::string accessors;
+    for (auto const& field : klass.fields) {
+        auto type = c_type(rep_of(field.type.index));
+        members += std::format("    bool lox_has_{0};\n    {1} lox_f_{0};\n", field.name, type);
+        accessors += std::format("\n"
+                                 "static {0} lox_get_{1}_{2}(lox_obj lox_object, int line, int column)\n{{\n"
+                                 "    struct lox_class_{1}* instance = (struct lox_class_{1}*)lox_object;\n"
+                                 "    if (!instance->lox_has_{2}) {{\n"
+                                 "        lox_undefined(\"{2}\", line, column);\n"
+                                 "    }}\n"
+                                 "    return instance->lox_f_{2};\n}}\n"
+                                 "\n"
+                                 "static {0} lox_set_{1}_{2}(lox_obj lox_object, {0} value)\n{{\n"
+                                 "    struct lox_class_{1}* instance = (struct lox_class_{1}*)lox_object;\n"
+                                 "    instance->lox_has_{2} = true;\n"
+                                 "    return instance->lox_f_{2} = value;\n}}\n",
+                                 type, klass.index, field.name);
+    }
+    return std::format("struct lox_class_{} {{   /* {} */\n    {}\n{}}};\n{}", klass.index, klass.name, base, members, accessors);
+}
+
+// the class's method table and its constructor, which makes a zeroed instance without fields and passes it to `init`
+auto constructor(Class const& node) -> std::string
+{
+    auto const& klass = *node.type;
+    std::string methods;
+    for (auto name : slots(klass)) {
+        methods += std::format("    (void (*)(void)){},\n", function_name(*klass.method(name)->declaration));
+    }
+    std::string parameters { "lox_fn lox_self" };
+    std::string arguments { "NULL, (lox_obj)instance" };
+    for (std::size_t index {}; index < node.constructor->parameters.size(); index++) {
+        parameters += std::format(", {} lox_a{}", c_type(rep_of(node.constructor->parameters[index].index)), index);
+        arguments += std::format(", lox_a{}", index);
+    }
+    // an inherited `init` hands the instance back as one of the superclass, which is the same pointer
+    auto const* init = klass.method("init");
+    auto result      = init != nullptr ? std::format("{}({})", function_name(*init->declaration), arguments) : std::string { "(lox_obj)instance" };
+    // C has no empty arrays, a class without methods never has one looked up
+    auto table = methods.empty() ? std::string {} : std::format("static void (*const lox_methods_{}[])(void) = {{\n{}}};\n\n", klass.index, methods);
+    return std::format("{0}"
+                       "static lox_obj lox_construct_{1}({2})\n{{\n"
+                       "    struct lox_class_{1}* instance = lox_alloc(sizeof *instance);\n"
+                       "    memset(instance, 0, sizeof *instance);\n"
+                       "    ((struct lox_object*)instance)->methods = {3};\n"
+                       "    return {4};\n}}\n"
+                       "static struct lox_closure const lox_closure_class_{1} = {{ (void (*)(void))lox_construct_{1} }};\n",
+                       table, klass.index, parameters, methods.empty() ? "NULL" : std::format("lox_methods_{}", klass.index), result);
+}
+
+// where a closure keeps its captures, after the `struct lox_closure` every function value starts with
+auto environment(Fun const& fun) -> std::string
+{
+    auto name = site(fun);
+    std::string members;
+    std::string parameters;
+    std::string stores;
+    for (std::size_t index {}; index < fun.captures.size(); index++) {
+        auto const& capture = fun.captures[index];
+        auto type           = variable_type(capture.type, capture.source.boxed);
+        members += std::format("    {} lox_c{};   /* {} */\n", type, index, capture.name);
+        parameters += std::format("{}{} lox_c{}", index == 0 ? "" : ", ", type, index);
+        stores += std::format("    env->lox_c{0} = lox_c{0};\n", index);
+    }
+    return std::format("struct lox_env_{0} {{\n    struct lox_closure closure;\n{1}}};\n"
+                       "\n"
+                       "static lox_fn lox_new_{0}({2})\n{{\n"
+                       "    struct lox_env_{0}* env = lox_alloc(sizeof *env);\n"
+                       "    env->closure.code = (void (*)(void))lox_fun_{0};\n{3}"
+                       "    return &env->closure;\n}}\n",
+                       name, members, parameters, stores);
+}
+
+// a binding as the C variable it names, without going through its box
+auto raw_variable(Binding binding) -> std::string
+{
+    switch (binding.scope) {
+        using enum Binding::Scope;
+        case GLOBAL: return std::format("lox_g{}", binding.index);
+        case LOCAL: return std::format("lox_l{}", binding.index);
+        case CAPTURE: return std::format("lox_env->lox_c{}", binding.index);
+        case SELF: return "lox_self";
+    }
+    std::unreachable();
+}
+
+// every local becomes a C local named after what the parser resolved it to, C scoping does the rest,
+// globals are file scope so every function sees them and captures are read from the running closure
+auto variable(Binding binding) -> std::string
+{
+    auto name = raw_variable(binding);
+    return binding.boxed ? std::format("(*{})", name) : name;
+}
+
+// value of a `fun` declaration, capture-less functions share one static closure
+auto closure(Fun const& fun) -> std::string
+{
+    auto name = site(fun);
+    if (fun.captures.empty()) {
+        return std::format("&lox_closure_{}", name);
+    }
+    std::string sources;
+    for (auto const& capture : fun.captures) {
+        sources += std::format("{}{}", sources.empty() ? "" : ", ", raw_variable(capture.source));
+    }
+    return std::format("lox_new_{}({})", name, sources);
+}
+
+// a boxed local, allocated and then initialized
+auto box(Type const& type, std::string const& name, std::string const& value) -> std::string
+{
+    return std::format("    {} {} = lox_alloc(sizeof *{});\n    *{} = {};\n", variable_type(type, true), name, name, name, value);
+}
+
+// C string literal, escaped byte by byte so any source string survives
+auto quote(std::string const& value) -> std::string
+{
+    std::string quoted { "\"" };
+    for (unsigned char c : value) {
+        if (c == '"' || c == '\\' || c < 0x20 || c >= 0x7F) {
+            quoted += std::format("\\{:03o}", c);   // three octal digits never swallow a following digit
+        } else {
+            quoted += static_cast<char>(c);
+        }
+    }
+    return quoted + "\"";
+}
+
+auto literal(Literal const& node) -> std::string
+{
+    return std::visit(util::Visitor {
+                          [](bool v) -> std::string { return v ? "true" : "false"; },
+                          []<std::signed_integral T>(T v) -> std::string {
+                              return v == std::numeric_limits<int64_t>::min() ? "INT64_MIN" : std::format("INT64_C({})", v);
+                          },
+                          []<std::unsigned_integral T>(T v) -> std::string { return std::format("UINT64_C({})", v); },
+                          // through the bit pattern, so every value including f32 ones widened to double is exact
+                          []<std::floating_point T>(T v) -> std::string {
+                              return std::format("lox_f64(UINT64_C({:#x}))", std::bit_cast<uint64_t>(static_cast<double>(v)));
+                          },
+                          [](std::string const& v) -> std::string { return std::format("lox_str_lit({}, {})", quote(v), v.size()); },
+                      },
+                      node.value);
+}
+
+auto expression(ExprType const& expr) -> std::string;
+
+// signed arithmetic goes through uint64_t so overflow wraps instead of being undefined in C
+auto arithmetic(Rep rep, char op, std::string const& lhs, std::string const& rhs) -> std::string
+{
+    if (rep == Rep::I64 && op != '/' && op != '%') {
+        return std::format("((int64_t)((uint64_t)({}) {} (uint64_t)({})))", lhs, op, rhs);
+    }
+    if (rep == Rep::F64 && op == '%') {
+        return std::format("fmod({}, {})", lhs, rhs);
+    }
+    return std::format("(({}) {} ({}))", lhs, op, rhs);
+}
+
+// `/` or `%` of `node`, integer divisions halt at its location where the vm would trap
+auto division(Rep rep, char op, std::string const& lhs, std::string const& rhs, Expr const& node) -> std::string
+{
+    if (rep != Rep::I64 && rep != Rep::U64) {
+        return arithmetic(rep, op, lhs, rhs);
+    }
+    return std::format("lox_div_{}({}, {}, {}, {}, {})", suffix(rep), lhs, rhs, op == '%', node.line, node.column);
+}
+
+auto comparison(Rep rep, std::string_view op, std::string const& lhs, std::string const& rhs) -> std::string
+{
+    if (rep == Rep::STR) {
+        return std::format("(lox_str_cmp({}, {}) {} 0)", lhs, rhs, op);
+    }
+    return std::format("(({}) {} ({}))", lhs, op, rhs);
+}
+
+// suffix of the array helpers of an element type, the element's C type without `_t`
+auto element_suffix(TypeIndex element) -> std::string
+{
+    auto type = element_type(element);
+    return std::string { type.substr(0, type.find("_t")) };
+}
+
+// an element read out of an array, widened to the representation the vm pushes it as
+auto read_element(TypeIndex element, std::string const& array, std::string const& index, bool is_signed, Expr const& node) -> std::string
+{
+    return std::format("(({})*({} const*)lox_arr_at({}, (int64_t)({}), {}, sizeof({}), {}, {}))",
+                       c_type(rep_of(element)), element_type(element), array, index, is_signed, element_type(element), node.line, node.column);
+}
+
+// helper storing an element, which gives back the assigned value as the vm does rather than the stored one
+auto set_name(TypeIndex element) -> std::string
+{
+    return std::format("lox_arr_set_{}", element_suffix(element));
+}
+
+auto set_helper(TypeIndex element) -> std::string
+{
+    return std::format("static {0} {1}(lox_arr array, int64_t index, bool is_signed, {0} value, int line, int column)\n{{\n"
+                       "    *({2}*)lox_arr_at(array, index, is_signed, sizeof({2}), line, column) = ({2})value;\n"
+                       "    return value;\n}}\n",
+                       c_type(rep_of(element)), set_name(element), element_type(element));
+}
+
+auto kernel_name(ArrayOp op, TypeIndex element) -> std::string
+{
+    static constexpr std::array names { "add", "sub", "mul", "div", "lt", "le", "gt", "ge", "eq", "ne", "sum", "min", "max" };
+    return std::format("lox_arr_{}_{}", names[std::to_underlying(op)], element_suffix(element));
+}
+
+// an element-wise operation or a reduction, one element at a time in order, integers wrap at the width of the elements
+// like the vm's kernels do and divisions check every divisor before dividing anything
+auto kernel_helper(ArrayOp op, TypeIndex element) -> std::string
+{
+    auto type       = element_type(element);
+    auto name       = kernel_name(op, element);
+    bool is_integer = element < TypeIndex::FLOAT32;
+    if (op >= ArrayOp::SUM) {
+        auto step = op == ArrayOp::SUM ? (is_integer ? std::format("result = ({})((uint64_t)result + (uint64_t)data[index]);", type)
+                                                     : std::string { "result += data[index];" })
+                  : op == ArrayOp::MIN ? std::string { "result = data[index] < result ? data[index] : result;" }
+                                       : std::string { "result = result < data[index] ? data[index] : result;" };
+        auto empty = op == ArrayOp::SUM ? std::format("    {} result = 0;\n    int64_t index = 0;\n", type)
+                                        : std::format("    if (array->length == 0) {{\n        lox_halt(\"{} of an empty array\", line, column);\n    }}\n"
+                                                      "    {} result = data[0];\n    int64_t index = 1;\n",
+                                                      util::type::to_string(op), type);
+        return std::format("static {0} {1}(lox_arr array, int line, int column)\n{{\n"
+                           "    {2} const* data = array->data;\n{3}"
+                           "    for (; index < array->length; index++) {{\n        {4}\n    }}\n"
+                           "    return result;\n}}\n",
+                           c_type(rep_of(element)), name, type, empty, step);
+    }
+
+    auto symbol = util::type::to_string(op);
+    std::string checks;
+    std::string value;
+    if (op >= ArrayOp::LT) {
+        value = std::format("lhs[index] {} rhs[index]", symbol);
+    } else if (op == ArrayOp::DIV && is_integer) {
+        checks = "        if (rhs[index] == 0) {\n            lox_halt(\"integer division by zero\", line, column);\n        }\n";
+        if (element <= TypeIndex::INT64) {
+            // the least signed element divided by -1 is one past the greatest
+            checks += std::format("        if (lhs[index] == ({0})((uint64_t)1 << (sizeof({0}) * 8 - 1)) && rhs[index] == -1) {{\n"
+                                  "            lox_halt(\"integer division overflows\", line, column);\n        }}\n",
+                                  type);
+        }
+        checks = std::format("    for (int64_t index = 0; index < left->length; index++) {{\n{}    }}\n", checks);
+        value  = std::format("({})(lhs[index] / rhs[index])", type);
+    } else if (is_integer) {
+        value = std::format("({})((uint64_t)lhs[index] {} (uint64_t)rhs[index])", type, symbol);
+    } else {
+        value = std::format("lhs[index] {} rhs[index]", symbol);
+    }
+    auto result = op >= ArrayOp::LT ? std::string_view { "bool" } : type;
+    return std::format("static lox_arr {0}(lox_arr left, lox_arr right, int line, int column)\n{{\n"
+                       "    {1} const* lhs = left->data;\n"
+                       "    {1} const* rhs = right->data;\n"
+                       "    lox_arr_match(left, right, \"{2}\", line, column);\n{3}"
+                       "    lox_arr array = lox_arr_new(left->length, sizeof({4}));\n"
+                       "    {4}* out      = array->data;\n"
+                       "    for (int64_t index = 0; index < left->length; index++) {{\n        out[index] = {5};\n    }}\n"
+                       "    return array;\n}}\n",
+                       name, type, symbol, checks, result, value);
+}
+
+auto expression(ExprType const& expr) -> std::string
+{
+    return std::visit(util::Visitor {
+                          []<typename Node>(std::unique_ptr<Node> const& node) -> std::string
+                              requires std::is_base_of_v<Binary, Node>
+                          {
+                              auto lhs_rep = rep_of(util::type::get_type(node->left));
+                              auto rhs_rep = rep_of(util::type::get_type(node->right));
+                              auto lhs     = expression(node->left);
+                              auto rhs     = expression(node->right);
+
+                              if constexpr (std::is_same_v<Node, Add>) {
+                                  if (lhs_rep == Rep::STR || rhs_rep == Rep::STR) {
+                                      // interpolation is the only place where a string meets another type
+                                      auto to_str = [](Rep rep, std::string const& value) {
+                                          return rep == Rep::STR ? value : std::format("lox_str_from_{}({})", suffix(rep), value);
+                                      };
+                                      return std::format("lox_str_concat({}, {})", to_str(lhs_rep, lhs), to_str(rhs_rep, rhs));
+                                  }
+                                  return arithmetic(lhs_rep, '+', lhs, rhs);
+                              } else if constexpr (std::is_same_v<Node, Subtract>) {
+                                  return arithmetic(lhs_rep, '-', lhs, rhs);
+                              } else if constexpr (std::is_same_v<Node, Multiply>) {
+                                  return arithmetic(lhs_rep, '*', lhs, rhs);
+                              } else if constexpr (std::is_same_v<Node, Divide>) {
+                                  return division(lhs_rep, '/', lhs, rhs, *node);
+                              } else if constexpr (std::is_same_v<Node, Modulus>) {
+                                  return division(lhs_rep, '%', lhs, rhs, *node);
+                              } else if constexpr (std::is_same_v<Node, Compare<Order::LESS>>) {
+                                  return comparison(lhs_rep, "<", lhs, rhs);
+                              } else if constexpr (std::is_same_v<Node, Compare<Order::GREATER>>) {
+                                  return comparison(lhs_rep, ">", lhs, rhs);
+                              } else if constexpr (std::is_same_v<Node, And>) {
+                                  return std::format("((bool)(({}) && ({})))", lhs, rhs);
+                              } else if constexpr (std::is_same_v<Node, Or>) {
+                                  return std::format("((bool)(({}) || ({})))", lhs, rhs);
+                              } else {
+                                  return comparison(lhs_rep, "==", lhs, rhs);
+                              }
+                          },
+                          []<typename Node>(std::unique_ptr<Node> const& node) -> std::string
+                              requires std::is_base_of_v<Unary, Node>
+                          {
+                              auto rep   = rep_of(util::type::get_type(node->right));
+                              auto right = expression(node->right);
+
+                              if constexpr (std::is_same_v<Node, Negate>) {
+                                  return rep == Rep::I64 ? std::format("((int64_t)(0u - (uint64_t)({})))", right)
+                                                         : std::format("(-({}))", right);
+                              } else {
+                                  // the vm treats a non empty string as falsy
+                                  return rep == Rep::STR ? std::format("(({}).size != 0)", right)
+                                                         : std::format("((bool)!({}))", right);
+                              }
+                          },
+                          [](std::unique_ptr<Literal> const& node) -> std::string {
+                              return literal(*node);
+                          },
+                          [](std::unique_ptr<Variable> const& node) -> std::string {
+                              return variable(node->binding);
+                          },
+                          [](std::unique_ptr<Assign> const& node) -> std::string {
+                              return std::format("({} = {})", variable(node->binding), expression(node->value));
+                          },
+                          [](std::unique_ptr<Call> const& node) -> std::string {
+                              auto signature = util::type::get_static_type(node->callee).signature;
+                              auto arguments = expression(node->callee);
+                              for (auto const& argument : node->arguments) {
+                                  arguments += std::format(", {}", expression(argument));
+                              }
+                              return std::format("{}({})", call_name(*signature), arguments);
+                          },
+                          [](std::unique_ptr<Get> const& node) -> std::string {
+                              auto const& klass = owner(*util::type::get_static_type(node->object).klass, node->name);
+                              return std::format("lox_get_{}_{}({}, {}, {})", klass.index, node->name, expression(node->object), node->line, node->column);
+                          },
+                          [](std::unique_ptr<Set> const& node) -> std::string {
+                              auto const& klass = owner(*util::type::get_static_type(node->object).klass, node->name);
+                              return std::format("lox_set_{}_{}({}, {})", klass.index, node->name, expression(node->object), expression(node->value));
+                          },
+                          [](std::unique_ptr<Invoke> const& node) -> std::string {
+                              std::string arguments;
+                              for (auto const& argument : node->arguments) {
+                                  arguments += std::format(", {}", expression(argument));
+                              }
+                              // `super` knows its method, everything else looks it up in the instance's table
+                              if (node->method != nullptr) {
+                                  return std::format("{}(NULL, {}{})", function_name(*node->method), expression(node->object), arguments);
+                              }
+                              auto const& klass = *util::type::get_static_type(node->object).klass;
+                              return std::format("{}({}, {}{})", invoke_name(*klass.method(node->name)->signature), expression(node->object), slot(klass, node->name), arguments);
+                          },
+                          // the elements are converted to their type right away, the parser never lets a literal be empty
+                          [](std::unique_ptr<ArrayLiteral> const& node) -> std::string {
+                              std::string elements;
+                              for (auto const& element : node->elements) {
+                                  elements += std::format("{}({})({})", elements.empty() ? "" : ", ", element_type(node->element), expression(element));
+                              }
+                              return std::format("lox_arr_of(({}[]){{ {} }}, {}, sizeof({}))", element_type(node->element), elements, node->elements.size(), element_type(node->element));
+                          },
+                          [](std::unique_ptr<ArrayFill> const& node) -> std::string {
+                              return std::format("lox_arr_fill(&({0}){{ ({0})({1}) }}, (int64_t)({2}), sizeof({0}), {3}, {4})",
+                                                 element_type(node->element), expression(node->value), expression(node->length), node->line, node->column);
+                          },
+                          [](std::unique_ptr<Index> const& node) -> std::string {
+                              auto element = util::type::get_static_type(node->array).element;
+                              return read_element(element, expression(node->array), expression(node->index), util::type::get_type(node->index) <= TypeIndex::INT64, *node);
+                          },
+                          [](std::unique_ptr<SetIndex> const& node) -> std::string {
+                              auto element = util::type::get_static_type(node->array).element;
+                              return std::format("{}({}, (int64_t)({}), {}, {}, {}, {})", set_name(element), expression(node->array), expression(node->index),
+                                                 util::type::get_type(node->index) <= TypeIndex::INT64, expression(node->value), node->line, node->column);
+                          },
+                          [](std::unique_ptr<Elementwise> const& node) -> std::string {
+                              auto element = util::type::get_static_type(node->left).element;
+                              return std::format("{}({}, {}, {}, {})", kernel_name(node->op, element), expression(node->left), expression(node->right), node->line, node->column);
+                          },
+                          [](std::unique_ptr<Reduce> const& node) -> std::string {
+                              auto element = util::type::get_static_type(node->array).element;
+                              return std::format("{}({}, {}, {})", kernel_name(node->op, element), expression(node->array), node->line, node->column);
+                          },
+                          [](std::unique_ptr<Length> const& node) -> std::string {
+                              return std::format("(({})->length)", expression(node->array));
+                          },
+                      },
+                      expr);
+}
+
+auto statement(StmtType const& stmt) -> std::string
+{
+    return std::visit(util::Visitor {
+                          [](std::unique_ptr<Log> const& log) {
+                              auto rep = rep_of(util::type::get_type(log->expr));
+                              return std::format("    lox_log_{}({});   /* line {} */\n", suffix(rep), expression(log->expr), log->line);
+                          },
+                          [](std::unique_ptr<Let> const& let) {
+                              if (let->binding.scope == Binding::Scope::GLOBAL) {
+                                  return std::format("    {} = {};   /* {} */\n", variable(let->binding), expression(let->initializer), let->name);
+                              }
+                              auto type = util::type::get_static_type(let->initializer);
+                              if (let->binding.boxed) {
+                                  return std::format("    /* {} */\n{}", let->name, box(type, raw_variable(let->binding), expression(let->initializer)));
+                              }
+                              return std::format("    {} {} = {};   /* {} */\n", variable_type(type, false), variable(let->binding), expression(let->initializer), let->name);
+                          },
+                          [](std::unique_ptr<Block> const& block) {
+                              std::string body;
+                              for (auto const& inner : block->stmts) {
+                                  body += statement(inner);
+                              }
+                              return std::format("    {{\n{}    }}\n", body);
+                          },
+                          [](std::unique_ptr<Expression> const& expression_stmt) {
+                              return std::format("    (void)({});\n", expression(expression_stmt->expr));
+                          },
+                          [](std::unique_ptr<If> const& if_stmt) {
+                              auto code = std::format("    if ({}) {{\n{}    }}\n", expression(if_stmt->condition), statement(if_stmt->then_branch));
+                              if (if_stmt->else_branch.has_value()) {
+                                  code.insert(code.size() - 1, std::format(" else {{\n{}    }}", statement(if_stmt->else_branch.value())));
+                              }
+                              return code;
+                          },
+                          [](std::unique_ptr<While> const& while_stmt) {
+                              return std::format("    while ({}) {{\n{}    }}\n", expression(while_stmt->condition), statement(while_stmt->body));
+                          },
+                          [](std::unique_ptr<Fun> const& fun) {
+                              // the body is defined at file scope, the declaration only binds a closure over it
+                              auto value = closure(*fun);
+                              if (fun->binding.scope == Binding::Scope::GLOBAL) {
+                                  return std::format("    {} = {};   /* {} */\n", variable(fun->binding), value, fun->name);
+                              }
+                              return std::format("    lox_fn {} = {};   /* {} */\n", variable(fun->binding), value, fun->name);
+                          },
+                          [](std::unique_ptr<Return> const& return_stmt) {
+                              return std::format("    return {};\n", expression(return_stmt->value));
+                          },
+                          [](std::unique_ptr<Class> const& class_stmt) {
+                              auto value = std::format("&lox_closure_class_{}", class_stmt->type->index);
+                              if (class_stmt->binding.scope == Binding::Scope::GLOBAL) {
+                                  return std::format("    {} = {};   /* {} */\n", variable(class_stmt->binding), value, class_stmt->name);
+                              }
+                              return std::format("    lox_fn {} = {};   /* {} */\n", variable(class_stmt->binding), value, class_stmt->name);
+                          },
+                      },
+                      stmt);
+}
+
+// file scope declarations the program needs: its globals, every function however deeply nested and a helper for every
+// signature something is called or invoked with
+struct Declarations {
+    std::string globals;
+    std::vector<Fun const*> functions;
+    std::vector<Class const*> classes;
+    std::set<Fun const*> methods;   // never values, so they need no closure
+    std::set<std::string> calls;
+
+    void function(Fun const& fun)
+    {
+        functions.push_back(&fun);
+        for (auto const& inner : fun.body) {
+            collect(inner);
+        }
+    }
+
+    void collect(ExprType const& expr)
+    {
+        std::visit(util::Visitor {
+                       [this]<typename Node>(std::unique_ptr<Node> const& node)
+                           requires std::is_base_of_v<Binary, Node>
+                       {
+                           collect(node->left);
+                           collect(node->right);
+                       },
+                       [this]<typename Node>(std::unique_ptr<Node> const& node)
+                           requires std::is_base_of_v<Unary, Node>
+                       {
+                           collect(node->right);
+                       },
+                       [this](std::unique_ptr<Assign> const& node) {
+                           collect(node->value);
+                       },
+                       [this](std::unique_ptr<Call> const& node) {
+                           calls.insert(call_helper(*util::type::get_static_type(node->callee).signature));
+                           collect(node->callee);
+                           for (auto const& argument : node->arguments) {
+                               collect(argument);
+                           }
+                       },
+                       [this](std::unique_ptr<Get> const& node) {
+                           collect(node->object);
+                       },
+                       [this](std::unique_ptr<Set> const& node) {
+                           collect(node->object);
+                           collect(node->value);
+                       },
+                       [this](std::unique_ptr<Invoke> const& node) {
+                           if (node->method == nullptr) {
+                               calls.insert(invoke_helper(*util::type::get_static_type(node->object).klass->method(node->name)->signature));
+                           }
+                           collect(node->object);
+                           for (auto const& argument : node->arguments) {
+                               collect(argument);
+                           }
+                       },
+                       [this](std::unique_ptr<ArrayLiteral> const& node) {
+                           for (auto const& element : node->elements) {
+                               collect(element);
+                           }
+                       },
+                       [this](std::unique_ptr<ArrayFill> const& node) {
+                           collect(node->value);
+                           collect(node->length);
+                       },
+                       [this](std::unique_ptr<Index> const& node) {
+                           collect(node->array);
+                           collect(node->index);
+                       },
+                       [this](std::unique_ptr<SetIndex> const& node) {
+                           calls.insert(set_helper(util::type::get_static_type(node->array).element));
+                           collect(node->array);
+                           collect(node->index);
+                           collect(node->value);
+                       },
+                       [this](std::unique_ptr<Elementwise> const& node) {
+                           calls.insert(kernel_helper(node->op, util::type::get_static_type(node->left).element));
+                           collect(node->left);
+                           collect(node->right);
+                       },
+                       [this](std::unique_ptr<Reduce> const& node) {
+                           calls.insert(kernel_helper(node->op, util::type::get_static_type(node->array).element));
+                           collect(node->array);
+                       },
+                       [this](std::unique_ptr<Length> const& node) {
+                           collect(node->array);
+                       },
+                       [](auto const&) {},
+                   },
+                   expr);
+    }
+
+    void collect(StmtType const& stmt)
+    {
+        std::visit(util::Visitor {
+                       [this](std::unique_ptr<Log> const& log) {
+                           collect(log->expr);
+                       },
+                       [this](std::unique_ptr<Let> const& let) {
+                           if (let->binding.scope == Binding::Scope::GLOBAL) {
+                               globals += std::format("static {} {};\n", c_type(rep_of(util::type::get_type(let->initializer))), variable(let->binding));
+                           }
+                           collect(let->initializer);
+                       },
+                       [this](std::unique_ptr<Expression> const& expression_stmt) {
+                           collect(expression_stmt->expr);
+                       },
+                       [this](std::unique_ptr<Return> const& return_stmt) {
+                           collect(return_stmt->value);
+                       },
+                       [this](std::unique_ptr<Block> const& block) {
+                           for (auto const& inner : block->stmts) {
+                               collect(inner);
+                           }
+                       },
+                       [this](std::unique_ptr<If> const& if_stmt) {
+                           collect(if_stmt->condition);
+                           collect(if_stmt->then_branch);
+                           if (if_stmt->else_branch.has_value()) {
+                               collect(if_stmt->else_branch.value());
+                           }
+                       },
+                       [this](std::unique_ptr<While> const& while_stmt) {
+                           collect(while_stmt->condition);
+                           collect(while_stmt->body);
+                       },
+                       [this](std::unique_ptr<Fun> const& fun) {
+                           if (fun->binding.scope == Binding::Scope::GLOBAL) {
+                               globals += std::format("static lox_fn {};\n", variable(fun->binding));
+                           }
+                           function(*fun);
+                       },
+                       [this](std::unique_ptr<Class> const& class_stmt) {
+                           if (class_stmt->binding.scope == Binding::Scope::GLOBAL) {
+                               globals += std::format("static lox_fn {};\n", variable(class_stmt->binding));
+                           }
+                           classes.push_back(class_stmt.get());
+                           for (auto const& method : class_stmt->methods) {
+                               methods.insert(method.get());
+                               function(*method);
+                           }
+                       },
+                   },
+                   stmt);
+    }
+};
+}
+
+auto CBackend::translate() const -> std::string
+{
+    std::string source { runtime };
+    Declarations declarations;
+    declarations.collect(m_ast);
+    source += "\n" + declarations.globals;
+    for (auto const& call : declarations.calls) {
+        source += "\n" + call;
+    }
+    // declared in order, so a superclass is complete before its subclasses embed it
+    for (auto const* class_stmt : declarations.classes) {
+        source += "\n" + instance(*class_stmt->type);
+    }
+    // prototypes first, a function can call any other including itself
+    source += "\n";
+    for (auto const* fun : declarations.functions) {
+        source += std::format("{};\n", prototype(*fun));
+    }
+    for (auto const* fun : declarations.functions) {
+        if (declarations.methods.contains(fun)) {
+            continue;
+        }
+        if (fun->captures.empty()) {
+            source += std::format("static struct lox_closure const lox_closure_{} = {{ (void (*)(void)){} }};\n", site(*fun), function_name(*fun));
+        } else {
+            source += "\n" + environment(*fun);
+        }
+    }
+    for (auto const* class_stmt : declarations.classes) {
+        source += "\n" + constructor(*class_stmt);
+    }
+    for (auto const* fun : declarations.functions) {
+        std::string body;
+        if (!fun->captures.empty()) {
+            body += std::format("    struct lox_env_{0} const* lox_env = (struct lox_env_{0} const*)lox_self;\n", site(*fun));
+        }
+        for (std::size_t index {}; index < fun->parameters.size(); index++) {
+            auto const& binding = fun->parameters[index].binding;
+            if (binding.boxed) {
+                body += box(fun->signature->parameters[index], raw_variable(binding), std::format("lox_p{}", binding.index));
+            }
+        }
+        for (auto const& inner : fun->body) {
+            body += statement(inner);
+        }
+        source += std::format("\n{}\n{{\n{}}}\n", prototype(*fun), body);
+    }
+    source += "\nvoid cpplox_run(void)\n{\n";
+    source += statement(m_ast);
+    source += "}\n"
+              "\n"
+              "#ifndef CPPLOX_NO_MAIN\n"
+              "int main(void)\n"
+              "{\n"
+              "    cpplox_run();\n"
+              "    return 0;\n"
+              "}\n"
+              "#endif\n";
+    return source;
+}
+
+auto CBackend::build(std::filesystem::path const& output, bool shared) const -> bool
+{
+    auto source_path = std::filesystem::path { output }.concat(".c");
+    {
+        std::ofstream source { source_path };
+        if (!(source << translate())) {
+            return false;
+        }
+    }
+
+    char const* cc = std::getenv("CC");
+    auto command   = std::format("{} -std=c99 -O2 {} -o '{}' '{}' -lm",
+                                 cc != nullptr ? cc : "cc",
+                                 shared ? "-shared -fPIC -DCPPLOX_NO_MAIN" : "",
+                                 output.string(),
+                                 source_path.string());
+    return std::system(command.c_str()) == 0;
+}
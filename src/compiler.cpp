@@ -1,30 +1,294 @@
+#include <algorithm>
+#include <format>
+#include <iostream>
+#include <limits>
+#include <optional>
+#ifndef NDEBUG
+#include <print>
+#endif
+#include <ranges>
 #include <utility>
 
 #include "compiler.hpp"
 #include "instr.hpp"
 
+namespace {
+// a jump with its offset left open, visiting it returns where it was emitted
+struct Jump {
+    Opcode opcode;
+    Location location;
+};
+// points the jump emitted at `jump` to the next instruction
+struct Target {
+    std::size_t jump;
+};
+// start of a loop, visiting it returns the offset a `Loop` jumps back to
+struct Label { };
+struct Loop {
+    std::size_t label;
+    Location location;
+};
+// `CALL` or `TAIL_CALL` of the function pushed below `arguments` values
+struct CallOp {
+    Opcode opcode;
+    uint8_t arguments;
+    Location location;
+};
+// `GET_PROP`, `SET_PROP` or, with the arguments after the instance, `INVOKE` of the property `name`
+struct Property {
+    Opcode opcode;
+    std::string_view name;
+    Location location;
+    uint8_t arguments {};
+};
+// `NEW_ARRAY` of the `count` elements on top of the stack, `FILL_ARRAY` of the value and length there without one
+struct MakeArray {
+    TypeIndex element;
+    std::optional<uint16_t> count;
+    Location location;
+};
+// `ELEMENTWISE` or `REDUCE` running the kernel of `op`
+struct ArrayKernel {
+    Opcode opcode;
+    ArrayOp op;
+    Location location;
+};
+// pushes the function a method is compiled to
+struct Method {
+    Fun const* declaration;
+    Location location;
+};
+// pushes what a closure captures from the variable `binding` resolved to, the box itself for a boxed one
+struct Captured {
+    Binding binding;
+    Location location;
+};
+// moves the local `binding` resolved to into a box, which closures share with the frame
+struct BoxLocal {
+    Binding binding;
+    Location location;
+};
+
+auto signature_of(Emitter& emitter, FunctionType const& type) -> uint16_t;
+
+// what a value of `type` looks like to the verifier, interning the signatures of function types
+auto slot_type(Emitter& emitter, Type const& type) -> SlotType
+{
+    if (type.signature != nullptr) {
+        return util::slot::function(signature_of(emitter, *type.signature));
+    }
+    if (type.klass != nullptr) {
+        return util::slot::instance(type.klass->index);
+    }
+    if (type.index == TypeIndex::ARRAY) {
+        return util::slot::array(type.element);
+    }
+    switch (type.index) {
+        using enum TypeIndex;
+        case BOOL: return SlotType::BOOL;
+        case INT8:
+        case INT16:
+        case INT32:
+        case INT64: return SlotType::INT;
+        case UINT8:
+        case UINT16:
+        case UINT32:
+        case UINT64: return SlotType::UINT;
+        case FLOAT32:
+        case FLOAT64: return SlotType::FLOAT;
+        case STRING: return SlotType::STRING;
+        case FUNCTION:
+        case INSTANCE:
+        case ARRAY: break;
+    }
+#ifndef NDEBUG
+    std::println(std::cerr, "[DEBUG] Function type without a signature or instance type without a class");
+    return {};
+#else
+    std::unreachable();
+#endif
+}
+
+auto signature_of(Emitter& emitter, FunctionType const& type) -> uint16_t
+{
+    Signature signature { .parameters = {}, .result = slot_type(emitter, type.result) };
+    for (auto const& parameter : type.parameters) {
+        signature.parameters.push_back(slot_type(emitter, parameter));
+    }
+    return emitter.signature(std::move(signature));
+}
+
+// what a closure holds of `capture`, a box when the variable changes after being captured
+auto capture_type(Emitter& emitter, Capture const& capture) -> SlotType
+{
+    auto type = slot_type(emitter, capture.type);
+    return capture.source.boxed ? util::slot::boxed(type) : type;
+}
+
+/**
+ * Whether calls of `fun` pass its captures after the arguments instead of
+ * it getting a closure. Only a function which is never used but called by
+ * name where it is declared can tell every call site apart this way, and
+ * its locals, which move up behind the captures, have to stay within the
+ * slot operand byte. Unlike a closure it costs no allocation, the
+ * captures live in the callee's frame.
+ */
+auto is_lifted(Fun const& fun) -> bool
+{
+    return !fun.escapes && !fun.captures.empty() && fun.locals + fun.captures.size() <= std::numeric_limits<uint8_t>::max();
+}
+
+auto location_of(ExprType const& expr) -> Location
+{
+    return std::visit([](auto const& node) { return Location { node->line, node->column }; }, expr);
+}
+
+/**
+ * Emits `condition` and a jump taken when it is false, returning the jump.
+ *
+ * A comparison, negated or not, becomes a single compare and branch
+ * instead of computing a bool only to test it right away.
+ */
+template <typename Derived>
+auto jump_if_false(Derived const& self, ExprType const& condition) -> std::size_t
+{
+    auto compare_jump = [&self]<typename Node>(std::unique_ptr<Node> const& node, Opcode opcode) {
+        std::visit(self, node->left);
+        std::visit(self, node->right);
+        return self(Jump { opcode, Location { node->line, node->column } });
+    };
+    using enum Opcode;
+    if (auto const* less = std::get_if<std::unique_ptr<Compare<Order::LESS>>>(&condition)) {
+        return compare_jump(*less, JGE);
+    }
+    if (auto const* greater = std::get_if<std::unique_ptr<Compare<Order::GREATER>>>(&condition)) {
+        return compare_jump(*greater, JLE);
+    }
+    if (auto const* equal = std::get_if<std::unique_ptr<Compare<Order::EQUAL>>>(&condition)) {
+        return compare_jump(*equal, JNE);
+    }
+    // `<=`, `>=` and `!=` are parsed as the negated comparison
+    if (auto const* negated = std::get_if<std::unique_ptr<Not>>(&condition)) {
+        auto const& right = (*negated)->right;
+        if (auto const* less = std::get_if<std::unique_ptr<Compare<Order::LESS>>>(&right)) {
+            return compare_jump(*less, JLT);
+        }
+        if (auto const* greater = std::get_if<std::unique_ptr<Compare<Order::GREATER>>>(&right)) {
+            return compare_jump(*greater, JGT);
+        }
+        if (auto const* equal = std::get_if<std::unique_ptr<Compare<Order::EQUAL>>>(&right)) {
+            return compare_jump(*equal, JEQ);
+        }
+    }
+    std::visit(self, condition);
+    return self(Jump { JUMP_IF_FALSE, location_of(condition) });
+}
+
+// pushes the callee and then its arguments, which the call turns into the callee's frame
+template <typename Derived>
+void emit_call(Derived const& self, Call const& call, Opcode opcode)
+{
+    std::visit(self, call.callee);
+    for (auto const& argument : call.arguments) {
+        std::visit(self, argument);
+    }
+    Location location { call.line, call.column };
+    auto arguments = call.arguments.size();
+    // a lifted function takes its captures next, from where it is declared or, calling itself, from its own frame
+    if (auto const* callee = std::get_if<std::unique_ptr<Variable>>(&call.callee);
+        callee != nullptr && (*callee)->declaration != nullptr && is_lifted(*(*callee)->declaration)) {
+        auto const& captures = (*callee)->declaration->captures;
+        for (std::size_t index {}; index < captures.size(); index++) {
+            auto source = captures[index].source;
+            if ((*callee)->binding.scope == Binding::Scope::SELF) {
+                source = Binding { Binding::Scope::CAPTURE, static_cast<uint16_t>(index), source.boxed };
+            }
+            self(Captured { source, location });
+        }
+        arguments += captures.size();
+    }
+    self(CallOp { opcode, static_cast<uint8_t>(arguments), location });
+}
+
+// pushes the instance and then the arguments, a `super` call knows its method and calls it like a function
+template <typename Derived>
+void emit_invoke(Derived const& self, Invoke const& invoke, Opcode opcode)
+{
+    Location location { invoke.line, invoke.column };
+    if (invoke.method != nullptr) {
+        self(Method { invoke.method, location });
+    }
+    std::visit(self, invoke.object);
+    for (auto const& argument : invoke.arguments) {
+        std::visit(self, argument);
+    }
+    auto arguments = static_cast<uint8_t>(invoke.arguments.size());
+    if (invoke.method != nullptr) {
+        self(CallOp { opcode, static_cast<uint8_t>(arguments + 1), location });
+    } else {
+        self(Property { Opcode::INVOKE, invoke.name, location, arguments });
+    }
+}
+}
+
 template <typename Statement, Opcode opcode>
 struct StmtOpcodeVisitor {
     template <typename Derived>
     void operator()(this Derived const& self, std::unique_ptr<Statement> const& stmt);
 };
 
+// statements which only move values around the stack and variables
+template <typename Statement>
+struct StmtVisitor {
+    template <typename Derived>
+    void operator()(this Derived const& self, std::unique_ptr<Statement> const& stmt);
+};
+
 template <typename Expression, Opcode opcode>
 struct BinaryExprOpcodeVisitor {
     template <typename Derived>
     void operator()(this Derived const& self, std::unique_ptr<Expression> const& expr);
 };
 
+// short circuiting `and`, `or`, the jump skips the right operand when the left one decides the result
+template <typename Expression, Opcode opcode>
+struct LogicalExprVisitor {
+    template <typename Derived>
+    void operator()(this Derived const& self, std::unique_ptr<Expression> const& expr);
+};
+
 template <typename Expression, Opcode opcode>
 struct UnaryExprOpcodeVisitor {
     template <typename Derived>
     void operator()(this Derived const& self, std::unique_ptr<Expression> const& expr);
 };
 
+auto Compiler::m_bind(Binding binding) const -> Binding
+{
+    if (m_fun == nullptr || !is_lifted(*m_fun)) {
+        return binding;
+    }
+    // the frame of a lifted function holds its parameters, its captures and then its locals
+    auto parameters = m_fun->parameters.size();
+    if (binding.scope == Binding::Scope::CAPTURE) {
+        return Binding { Binding::Scope::LOCAL, static_cast<uint16_t>(parameters + binding.index), binding.boxed };
+    }
+    if (binding.scope == Binding::Scope::LOCAL && binding.index >= parameters) {
+        return Binding { Binding::Scope::LOCAL, static_cast<uint16_t>(binding.index + m_fun->captures.size()), binding.boxed };
+    }
+    return binding;
+}
+
 auto Compiler::compile() && -> std::pair<ByteCode, std::unordered_set<std::string>>
 {
     auto opcode_emitter = util::Visitor {
         StmtOpcodeVisitor<Log, Opcode::LOG> {},
+        StmtVisitor<Let> {},
+        StmtVisitor<Block> {},
+        StmtVisitor<Expression> {},
+        StmtVisitor<If> {},
+        StmtVisitor<While> {},
+        StmtVisitor<Return> {},
         BinaryExprOpcodeVisitor<Add, Opcode::ADD> {},
         BinaryExprOpcodeVisitor<Subtract, Opcode::SUB> {},
         BinaryExprOpcodeVisitor<Multiply, Opcode::MUL> {},
@@ -33,69 +297,309 @@ auto Compiler::compile() && -> std::pair<ByteCode, std::unordered_set<std::strin
         BinaryExprOpcodeVisitor<Compare<Order::LESS>, Opcode::CMP> {},
         BinaryExprOpcodeVisitor<Compare<Order::EQUAL>, Opcode::CMPE> {},
         BinaryExprOpcodeVisitor<Compare<Order::GREATER>, Opcode::CMP> {},
+        LogicalExprVisitor<And, Opcode::JUMP_IF_FALSE_OR_POP> {},
+        LogicalExprVisitor<Or, Opcode::JUMP_IF_TRUE_OR_POP> {},
         UnaryExprOpcodeVisitor<Negate, Opcode::NEGATE> {},
         UnaryExprOpcodeVisitor<Not, Opcode::NOT> {},
-        [this](std::unique_ptr<Literal> const& expr) { m_add_constant(expr); },                                  // for literal expression we simply pass the hardwork on to m_add_constant
-        [this](Opcode opcode, std::size_t line_nr) { m_emit_bytes({ std::to_underlying(opcode) }, line_nr); },   // adding an opcode overload to simply call the visitor and emit an opcode after visiting all child nodes
+        [this](std::unique_ptr<Literal> const& expr) { m_emitter.constant(expr->type, std::move(expr->value), m_pool, { expr->line, expr->column }); },   // for literal expression we simply pass the hardwork on to the emitter
+        [this](Opcode opcode, Location location) { m_emitter.opcode(opcode, location); },                                                                  // adding an opcode overload to simply call the visitor and emit an opcode after visiting all child nodes
+        [this](int8_t value, Location location) { m_emitter.load(TypeIndex::INT8, value, location); },                                                   // constant the comparison opcodes test `CMP`'s result against
+        [this](uint8_t count, Location location) { m_emitter.pop(count, location); },                                                                     // drops values statements leave behind
+        [this](std::unique_ptr<Variable> const& expr) { m_emitter.get(m_bind(expr->binding), { expr->line, expr->column }); },
+        [](this auto const& self, std::unique_ptr<Assign> const& expr) {
+            std::visit(self, expr->value);
+            self(expr->binding, Location { expr->line, expr->column });
+        },
+        [this](Binding binding, Location location) { m_emitter.set(m_bind(binding), location); },   // assigns the top of stack, which stays there
+        [](this auto const& self, std::unique_ptr<Call> const& expr) { emit_call(self, *expr, Opcode::CALL); },
+        [this](CallOp call) { m_emitter.instruction(call.opcode, call.location, call.arguments); },
+        [](this auto const& self, std::unique_ptr<Get> const& expr) {
+            std::visit(self, expr->object);
+            self(Property { Opcode::GET_PROP, expr->name, Location { expr->line, expr->column } });
+        },
+        [](this auto const& self, std::unique_ptr<Set> const& expr) {
+            std::visit(self, expr->object);
+            std::visit(self, expr->value);
+            self(Property { Opcode::SET_PROP, expr->name, Location { expr->line, expr->column } });
+        },
+        [](this auto const& self, std::unique_ptr<Invoke> const& expr) { emit_invoke(self, *expr, Opcode::CALL); },
+        [](this auto const& self, std::unique_ptr<ArrayLiteral> const& expr) {
+            for (auto const& element : expr->elements) {
+                std::visit(self, element);
+            }
+            self(MakeArray { expr->element, static_cast<uint16_t>(expr->elements.size()), Location { expr->line, expr->column } });
+        },
+        [](this auto const& self, std::unique_ptr<ArrayFill> const& expr) {
+            std::visit(self, expr->value);
+            std::visit(self, expr->length);
+            self(MakeArray { expr->element, {}, Location { expr->line, expr->column } });
+        },
+        [](this auto const& self, std::unique_ptr<Index> const& expr) {
+            std::visit(self, expr->array);
+            std::visit(self, expr->index);
+            self(Opcode::GET_INDEX, Location { expr->line, expr->column });
+        },
+        [](this auto const& self, std::unique_ptr<SetIndex> const& expr) {
+            std::visit(self, expr->array);
+            std::visit(self, expr->index);
+            std::visit(self, expr->value);
+            self(Opcode::SET_INDEX, Location { expr->line, expr->column });
+        },
+        [](this auto const& self, std::unique_ptr<Elementwise> const& expr) {
+            std::visit(self, expr->left);
+            std::visit(self, expr->right);
+            self(ArrayKernel { Opcode::ELEMENTWISE, expr->op, Location { expr->line, expr->column } });
+        },
+        [](this auto const& self, std::unique_ptr<Reduce> const& expr) {
+            std::visit(self, expr->array);
+            self(ArrayKernel { Opcode::REDUCE, expr->op, Location { expr->line, expr->column } });
+        },
+        [](this auto const& self, std::unique_ptr<Length> const& expr) {
+            std::visit(self, expr->array);
+            self(Opcode::LENGTH, Location { expr->line, expr->column });
+        },
+        [this](MakeArray array) {
+            auto element = static_cast<uint8_t>(array.element);
+            if (array.count.has_value()) {
+                m_emitter.instruction(Opcode::NEW_ARRAY, array.location, element, array.count.value());
+            } else {
+                m_emitter.instruction(Opcode::FILL_ARRAY, array.location, element);
+            }
+        },
+        [this](ArrayKernel kernel) { m_emitter.instruction(kernel.opcode, kernel.location, static_cast<uint8_t>(kernel.op)); },
+        [this](Property property) {
+            if (property.opcode == Opcode::INVOKE) {
+                m_emitter.invoke(property.name, property.arguments, property.location);
+            } else {
+                m_emitter.property(property.opcode, property.name, property.location);
+            }
+        },
+        [this](Method method) { m_emitter.load(TypeIndex::FUNCTION, m_methods.at(method.declaration), method.location); },
+        [this](Captured captured) {
+            auto binding  = m_bind(captured.binding);
+            binding.boxed = false;
+            m_emitter.get(binding, captured.location);
+        },
+        [this](BoxLocal box) { m_emitter.instruction(Opcode::BOX, box.location, static_cast<uint8_t>(m_bind(box.binding).index)); },
+        [this](std::unique_ptr<Fun> const& stmt) {
+            // declared like a `Let` of the function value, the body is emitted once the top level code is done
+            Location location { stmt->line, stmt->column };
+            if (stmt->captures.empty()) {
+                auto function = m_emitter.function(stmt->name, signature_of(m_emitter, *stmt->signature));
+                m_bodies.emplace_back(function, stmt.get());
+                m_emitter.load(TypeIndex::FUNCTION, function, location);
+            } else if (is_lifted(*stmt)) {
+                // the captures follow the parameters, so the body finds them in its frame
+                auto signature = Signature { .parameters = {}, .result = slot_type(m_emitter, stmt->signature->result) };
+                for (auto const& parameter : stmt->signature->parameters) {
+                    signature.parameters.push_back(slot_type(m_emitter, parameter));
+                }
+                for (auto const& capture : stmt->captures) {
+                    signature.parameters.push_back(capture_type(m_emitter, capture));
+                }
+                auto function = m_emitter.function(stmt->name, m_emitter.signature(std::move(signature)));
+                m_bodies.emplace_back(function, stmt.get());
+                m_emitter.load(TypeIndex::FUNCTION, function, location);
+            } else {
+                std::vector<SlotType> captures;
+                for (auto const& capture : stmt->captures) {
+                    captures.push_back(capture_type(m_emitter, capture));
+                    m_emitter.get(m_bind(Binding { capture.source.scope, capture.source.index }), location);
+                }
+                auto function = m_emitter.function(stmt->name, signature_of(m_emitter, *stmt->signature), std::move(captures));
+                m_bodies.emplace_back(function, stmt.get());
+                m_emitter.instruction(Opcode::CLOSURE, location, function);
+            }
+            if (stmt->binding.scope == Binding::Scope::GLOBAL) {
+                m_emitter.set(stmt->binding, location);
+                m_emitter.pop(1, location);
+            }
+        },
+        [this](std::unique_ptr<Class> const& stmt) {
+            // declared like a `Let` of the constructor, the methods' bodies are emitted once the top level code is done
+            Location location { stmt->line, stmt->column };
+            auto const& type = *stmt->type;
+            ClassInfo info { .name = type.name, .superclass = {} };
+            if (type.superclass != nullptr) {
+                info.superclass = type.superclass->index;
+            }
+            for (auto const& field : type.fields) {
+                info.fields.emplace_back(m_emitter.name(field.name), slot_type(m_emitter, field.type));
+            }
+            for (auto const& method : stmt->methods) {
+                auto function = m_emitter.function(std::format("{}.{}", type.name, method->name), signature_of(m_emitter, *method->signature));
+                m_bodies.emplace_back(function, method.get());
+                m_methods.emplace(method.get(), function);
+                // only ever called by the constructor, never looked up on an instance
+                if (method->name != "init") {
+                    info.methods.emplace_back(m_emitter.name(method->name), function);
+                }
+            }
+            [[maybe_unused]] auto klass = m_emitter.klass(std::move(info));   // numbered in declaration order, like the parser does
+
+            auto constructor = m_emitter.function(type.name, signature_of(m_emitter, *stmt->constructor));
+            m_constructors.emplace_back(constructor, stmt.get());
+            m_emitter.load(TypeIndex::FUNCTION, constructor, location);
+            m_emitter.set(stmt->binding, location);
+            m_emitter.pop(1, location);
+        },
+        [this](Jump jump) { return m_emitter.jump(jump.opcode, jump.location); },
+        [this](Target target) { m_emitter.patch(target.jump); },
+        [this](Label) { return m_emitter.label(); },
+        [this](Loop loop) { m_emitter.loop(loop.label, loop.location); },
     };
 
-    std::visit(opcode_emitter, m_ast);
-    m_emit_bytes({ std::to_underlying(Opcode::RETURN) }, m_bc.lines().rbegin()->second);   // use the last byte's line number as return code's line number
+    // the last statement of the top level code leaves its value on the stack for whoever runs the program, when it is
+    // an expression statement
+    auto const* program = std::get_if<std::unique_ptr<Block>>(&m_ast);
+    auto const* result  = program != nullptr && !(*program)->stmts.empty() ? std::get_if<std::unique_ptr<Expression>>(&(*program)->stmts.back()) : nullptr;
+    if (result == nullptr) {
+        std::visit(opcode_emitter, m_ast);
+    } else {
+        for (auto const& stmt : (*program)->stmts | std::views::take((*program)->stmts.size() - 1)) {
+            std::visit(opcode_emitter, stmt);
+        }
+        std::visit(opcode_emitter, (*result)->expr);
+    }
+    m_emitter.halt();
+    // a body may declare functions of its own, which queue up behind it
+    for (std::size_t index {}; index < m_bodies.size(); index++) {
+        auto [function, fun] = m_bodies[index];
+        m_fun                = fun;
+        m_emitter.begin(function);
+        // the caller passed plain values, a parameter closures share moves into a box first
+        for (auto const& parameter : fun->parameters) {
+            if (parameter.binding.boxed) {
+                opcode_emitter(BoxLocal { parameter.binding, Location { fun->line, fun->column } });
+            }
+        }
+        for (auto const& stmt : fun->body) {
+            std::visit(opcode_emitter, stmt);
+        }
+    }
+    // NEW, then `init` in tail position with the instance in front of the arguments, it returns the instance
+    m_fun = nullptr;
+    for (auto [function, stmt] : m_constructors) {
+        Location location { stmt->line, stmt->column };
+        m_emitter.begin(function);
+        m_emitter.instruction(Opcode::NEW, location, stmt->type->index);
+        auto const* init = stmt->type->method("init");
+        if (init == nullptr) {
+            m_emitter.instruction(Opcode::RETURN, location);
+            continue;
+        }
+        auto arguments = static_cast<uint8_t>(stmt->constructor->parameters.size());
+        m_emitter.load(TypeIndex::FUNCTION, m_methods.at(init->declaration), location);
+        m_emitter.get(Binding { Binding::Scope::LOCAL, arguments }, location);
+        for (uint8_t argument {}; argument < arguments; argument++) {
+            m_emitter.get(Binding { Binding::Scope::LOCAL, argument }, location);
+        }
+        // an inherited `init` hands the instance back as one of the superclass, so the constructor returns its own
+        if (std::ranges::any_of(stmt->methods, [init](auto const& method) { return method.get() == init->declaration; })) {
+            m_emitter.instruction(Opcode::TAIL_CALL, location, static_cast<uint8_t>(arguments + 1));
+            continue;
+        }
+        m_emitter.instruction(Opcode::CALL, location, static_cast<uint8_t>(arguments + 1));
+        m_emitter.pop(1, location);
+        m_emitter.instruction(Opcode::RETURN, location);
+    }
 
-    return std::pair { std::move(m_bc), std::move(m_pool) };
+    return std::pair { std::move(m_emitter).finish(), std::move(m_pool) };
 }
 
-void Compiler::m_add_constant(std::unique_ptr<Literal> const& expr)
+/* Implementation of above template declarations */
+template <>
+template <typename Derived>
+void StmtVisitor<Let>::operator()(this Derived const& self, std::unique_ptr<Let> const& stmt)
 {
-    auto type_index = expr->type;
-    m_emit_bytes({
-                     std::to_underlying(Opcode::LOAD),
-                     static_cast<uint8_t>(type_index),
-                 },
-                 expr->line);
+    std::visit(self, stmt->initializer);   // a local simply stays in the slot its initializer was pushed to
 
-    auto emit_val = [this, line_nr = expr->line]<typename T>(T value) {
-        for (auto byte : std::bit_cast<std::array<uint8_t, sizeof(T)>>(value)) {
-            m_bc.write_byte(byte, line_nr);
-        }
-    };
+    Location location { stmt->line, stmt->column };
+    if (stmt->binding.boxed) {
+        self(BoxLocal { stmt->binding, location });
+    }
+    if (stmt->binding.scope == Binding::Scope::GLOBAL) {
+        self(stmt->binding, location);
+        self(uint8_t { 1 }, location);
+    }
+}
 
-    switch (type_index) {
-        using enum TypeIndex;
-        case BOOL: emit_val(std::get<bool>(expr->value)); break;
-        case INT8: emit_val(std::get<int8_t>(expr->value)); break;
-        case INT16: emit_val(std::get<int16_t>(expr->value)); break;
-        case INT32: emit_val(std::get<int32_t>(expr->value)); break;
-        case INT64: emit_val(std::get<int64_t>(expr->value)); break;
-        case UINT8: emit_val(std::get<uint8_t>(expr->value)); break;
-        case UINT16: emit_val(std::get<uint16_t>(expr->value)); break;
-        case UINT32: emit_val(std::get<uint32_t>(expr->value)); break;
-        case UINT64: emit_val(std::get<uint64_t>(expr->value)); break;
-        case FLOAT32: emit_val(std::get<float>(expr->value)); break;
-        case FLOAT64: emit_val(std::get<double>(expr->value)); break;
-        case STRING:
-            emit_val(m_pool.emplace(
-                               std::move(std::get<std::string>(expr->value)))
-                         .first);
-            break;
+template <>
+template <typename Derived>
+void StmtVisitor<Block>::operator()(this Derived const& self, std::unique_ptr<Block> const& stmt)
+{
+    for (auto const& inner : stmt->stmts) {
+        std::visit(self, inner);
     }
+
+    if (stmt->locals > 0) {
+        self(stmt->locals, Location { stmt->line, stmt->column });   // the block's locals go out of scope
+    }
+}
+
+template <>
+template <typename Derived>
+void StmtVisitor<Expression>::operator()(this Derived const& self, std::unique_ptr<Expression> const& stmt)
+{
+    std::visit(self, stmt->expr);
+
+    self(uint8_t { 1 }, Location { stmt->line, stmt->column });
 }
 
-void Compiler::m_emit_bytes(std::initializer_list<uint8_t> opcodes, std::size_t line_nr)
+template <>
+template <typename Derived>
+void StmtVisitor<If>::operator()(this Derived const& self, std::unique_ptr<If> const& stmt)
 {
-    for (uint8_t opcode : opcodes) {
-        m_bc.write_byte(opcode, line_nr);
+    auto to_else = jump_if_false(self, stmt->condition);
+    std::visit(self, stmt->then_branch);
+
+    if (!stmt->else_branch.has_value()) {
+        self(Target { to_else });
+        return;
     }
+    auto to_end = self(Jump { Opcode::JUMP, Location { stmt->line, stmt->column } });
+    self(Target { to_else });
+    std::visit(self, stmt->else_branch.value());
+    self(Target { to_end });
+}
+
+template <>
+template <typename Derived>
+void StmtVisitor<While>::operator()(this Derived const& self, std::unique_ptr<While> const& stmt)
+{
+    auto start = self(Label {});
+    auto exit  = jump_if_false(self, stmt->condition);
+    std::visit(self, stmt->body);
+
+    self(Loop { start, Location { stmt->line, stmt->column } });
+    self(Target { exit });
+}
+
+template <>
+template <typename Derived>
+void StmtVisitor<Return>::operator()(this Derived const& self, std::unique_ptr<Return> const& stmt)
+{
+    // the caller's frame is all a call in tail position needs, recursing through it runs in constant stack space
+    if (auto const* call = std::get_if<std::unique_ptr<Call>>(&stmt->value)) {
+        emit_call(self, **call, Opcode::TAIL_CALL);
+        return;
+    }
+    if (auto const* invoke = std::get_if<std::unique_ptr<Invoke>>(&stmt->value); invoke != nullptr && (*invoke)->method != nullptr) {
+        emit_invoke(self, **invoke, Opcode::TAIL_CALL);
+        return;
+    }
+    std::visit(self, stmt->value);
+
+    self(Opcode::RETURN, Location { stmt->line, stmt->column });
 }
 
-/* Implementation of above template declarations */
 template <>
 template <typename Derived>
 void StmtOpcodeVisitor<Log, Opcode::LOG>::operator()(this Derived const& self, std::unique_ptr<Log> const& stmt)
 {
     std::visit(self, stmt->expr);
 
-    self(Opcode::LOG, stmt->line);
+    self(Opcode::LOG, Location { stmt->line, stmt->column });
 }
 
 template <typename Expression, Opcode opcode>
@@ -105,7 +609,7 @@ void BinaryExprOpcodeVisitor<Expression, opcode>::operator()(this Derived const&
     std::visit(self, expr->left);    // traverse left child
     std::visit(self, expr->right);   // traverse right child
 
-    self(opcode, expr->line);        // emit the current binary expr opcode
+    self(opcode, Location { expr->line, expr->column });   // emit the current binary expr opcode
 }
 
 template <>
@@ -115,11 +619,10 @@ void BinaryExprOpcodeVisitor<Compare<Order::LESS>, Opcode::CMP>::operator()(this
     std::visit(self, expr->left);    // traverse left child
     std::visit(self, expr->right);   // traverse right child
 
-    self(Opcode::CMP, expr->line);   // emit `cmp` instruction
-    self(Opcode::LOAD, expr->line);
-    self(static_cast<Opcode>(TypeIndex::INT8), expr->line);
-    self(static_cast<Opcode>(-1), expr->line);   // LOAD -1 and compare whether its true
-    self(Opcode::CMPE, expr->line);
+    Location location { expr->line, expr->column };
+    self(Opcode::CMP, location);      // emit `cmp` instruction
+    self(int8_t { -1 }, location);    // LOAD -1 and compare whether its true
+    self(Opcode::CMPE, location);
 }
 
 template <>
@@ -129,11 +632,20 @@ void BinaryExprOpcodeVisitor<Compare<Order::GREATER>, Opcode::CMP>::operator()(t
     std::visit(self, expr->left);    // traverse left child
     std::visit(self, expr->right);   // traverse right child
 
-    self(Opcode::CMP, expr->line);   // emit `cmp` instruction
-    self(Opcode::LOAD, expr->line);
-    self(static_cast<Opcode>(TypeIndex::INT8), expr->line);
-    self(static_cast<Opcode>(1), expr->line);   // LOAD -1 and compare whether its true
-    self(Opcode::CMPE, expr->line);
+    Location location { expr->line, expr->column };
+    self(Opcode::CMP, location);     // emit `cmp` instruction
+    self(int8_t { 1 }, location);    // LOAD 1 and compare whether its true
+    self(Opcode::CMPE, location);
+}
+
+template <typename Expression, Opcode opcode>
+template <typename Derived>
+void LogicalExprVisitor<Expression, opcode>::operator()(this Derived const& self, std::unique_ptr<Expression> const& expr)
+{
+    std::visit(self, expr->left);
+    auto skip = self(Jump { opcode, Location { expr->line, expr->column } });
+    std::visit(self, expr->right);
+    self(Target { skip });
 }
 
 template <typename Expression, Opcode opcode>
@@ -142,5 +654,5 @@ void UnaryExprOpcodeVisitor<Expression, opcode>::operator()(this Derived const&
 {
     std::visit(self, expr->right);   // traverse only child
 
-    self(opcode, expr->line);        // emit the current unary expr opcode
+    self(opcode, Location { expr->line, expr->column });   // emit the current unary expr opcode
 }
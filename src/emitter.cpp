@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#ifndef NDEBUG
+#include <print>
+#endif
+#include <utility>
+
+#include "emitter.hpp"
+
+void Emitter::constant(TypeIndex type_index, TypeVariant value, StringTable& pool, Location location)
+{
+    switch (type_index) {
+        using enum TypeIndex;
+        case BOOL: load(type_index, std::get<bool>(value), location); break;
+        case INT8: load(type_index, std::get<int8_t>(value), location); break;
+        case INT16: load(type_index, std::get<int16_t>(value), location); break;
+        case INT32: load(type_index, std::get<int32_t>(value), location); break;
+        case INT64: load(type_index, std::get<int64_t>(value), location); break;
+        case UINT8: load(type_index, std::get<uint8_t>(value), location); break;
+        case UINT16: load(type_index, std::get<uint16_t>(value), location); break;
+        case UINT32: load(type_index, std::get<uint32_t>(value), location); break;
+        case UINT64: load(type_index, std::get<uint64_t>(value), location); break;
+        case FLOAT32: load(type_index, std::get<float>(value), location); break;
+        case FLOAT64: load(type_index, std::get<double>(value), location); break;
+        case STRING:
+            load(type_index,
+                 pool.emplace(
+                         std::move(std::get<std::string>(value)))
+                     .first,
+                 location);
+            break;
+        case FUNCTION:
+        case INSTANCE:
+        case ARRAY:
+            // declarations load their function by index, only `NEW` makes instances and array literals are no constants
+#ifndef NDEBUG
+            std::println(std::cerr, "[DEBUG] Function, instance or array literal");
+#else
+            std::unreachable();
+#endif
+            break;
+    }
+}
+
+void Emitter::opcode(Opcode opcode, Location location)
+{
+    // peephole: rewrite a directly preceding `LOAD` on the same line into the superinstruction
+    auto last_load = std::exchange(m_last_load, std::nullopt);
+    if (auto fused = util::opcode::fused(opcode);
+        fused.has_value() && m_fusions.fuses(opcode) && last_load.has_value() && m_bc.read_line_number(*last_load) == location.line) {
+        m_bc.patch_byte(*last_load, std::to_underlying(*fused));
+        return;
+    }
+    m_emit_bytes({ std::to_underlying(opcode) }, location);
+}
+
+void Emitter::get(Binding binding, Location location)
+{
+    switch (binding.scope) {
+        using enum Binding::Scope;
+        case LOCAL: instruction(binding.boxed ? Opcode::GET_BOXED : Opcode::GET_LOCAL, location, static_cast<uint8_t>(binding.index)); return;
+        case CAPTURE: instruction(binding.boxed ? Opcode::GET_BOXED_CAPTURE : Opcode::GET_CAPTURE, location, static_cast<uint8_t>(binding.index)); return;
+        case SELF: instruction(Opcode::GET_CALLEE, location); return;
+        case GLOBAL: break;
+    }
+    m_globals = std::max(m_globals, binding.index + std::size_t { 1 });
+    instruction(Opcode::GET_GLOBAL, location, binding.index);
+}
+
+void Emitter::set(Binding binding, Location location)
+{
+    switch (binding.scope) {
+        using enum Binding::Scope;
+        case LOCAL: instruction(binding.boxed ? Opcode::SET_BOXED : Opcode::SET_LOCAL, location, static_cast<uint8_t>(binding.index)); return;
+        // a closure only assigns captures which are boxed, a copy would not change the variable
+        case CAPTURE: instruction(Opcode::SET_BOXED_CAPTURE, location, static_cast<uint8_t>(binding.index)); return;
+        case SELF:
+#ifndef NDEBUG
+            std::println(std::cerr, "[DEBUG] Assignment to a function declaration");
+#else
+            std::unreachable();
+#endif
+            return;
+        case GLOBAL: break;
+    }
+    m_globals = std::max(m_globals, binding.index + std::size_t { 1 });
+    instruction(Opcode::SET_GLOBAL, location, binding.index);
+}
+
+void Emitter::patch(std::size_t jump)
+{
+    auto offset = m_offset(jump, label());
+    auto bytes  = std::bit_cast<std::array<uint8_t, sizeof(int16_t)>>(offset);
+    for (std::size_t index {}; index < bytes.size(); index++) {
+        m_bc.patch_byte(jump + 1 + index, bytes[index]);
+    }
+}
+
+void Emitter::loop(std::size_t label, Location location)
+{
+    // the offset counts from the end of the `JUMP` which is not written yet
+    instruction(Opcode::JUMP, location, m_offset(m_bc.code().size(), label));
+}
+
+auto Emitter::signature(Signature signature) -> uint16_t
+{
+    auto index = m_bc.add_signature(std::move(signature));
+    // a function's slot type is `SlotType::FUNCTION` offset by its signature, below the instance types
+    if (index >= std::size_t { std::to_underlying(SlotType::INSTANCE) } - std::to_underlying(SlotType::FUNCTION)) {
+        std::cerr << "Too many function signatures" << std::endl;
+    }
+    return static_cast<uint16_t>(index);
+}
+
+auto Emitter::function(std::string name, uint16_t signature, std::vector<SlotType> captures) -> uint16_t
+{
+    auto index = m_bc.add_function(Function { .entry = 0, .signature = signature, .name = std::move(name), .captures = std::move(captures) });
+    if (!std::in_range<uint16_t>(index)) {
+        std::cerr << "Too many functions" << std::endl;
+    }
+    return static_cast<uint16_t>(index);
+}
+
+auto Emitter::klass(ClassInfo info) -> uint16_t
+{
+    auto index = m_bc.add_class(std::move(info));
+    // an instance's slot type is `SlotType::INSTANCE` offset by its class, below the array types
+    if (index >= std::size_t { std::to_underlying(SlotType::ARRAY) } - std::to_underlying(SlotType::INSTANCE)) {
+        std::cerr << "Too many classes" << std::endl;
+    }
+    return static_cast<uint16_t>(index);
+}
+
+auto Emitter::name(std::string_view name) -> uint16_t
+{
+    auto index = m_bc.add_name(name);
+    if (!std::in_range<uint16_t>(index)) {
+        std::cerr << "Too many property names" << std::endl;
+    }
+    return static_cast<uint16_t>(index);
+}
+
+void Emitter::property(Opcode opcode, std::string_view name, Location location)
+{
+    auto index = this->name(name);
+    auto cache = m_bc.add_cache();
+    if (!std::in_range<uint16_t>(cache)) {
+        std::cerr << "Too many property accesses" << std::endl;
+    }
+    instruction(opcode, location, index, static_cast<uint16_t>(cache));
+}
+
+void Emitter::invoke(std::string_view name, uint8_t arguments, Location location)
+{
+    auto index = this->name(name);
+    auto cache = m_bc.add_cache();
+    if (!std::in_range<uint16_t>(cache)) {
+        std::cerr << "Too many property accesses" << std::endl;
+    }
+    instruction(Opcode::INVOKE, location, index, arguments, static_cast<uint16_t>(cache));
+}
+
+void Emitter::halt()
+{
+    instruction(Opcode::RETURN, m_bc.line_table().last());   // use the last byte's location as return code's location
+    m_is_halted = true;
+}
+
+void Emitter::begin(uint16_t function)
+{
+    m_bc.set_entry(function, label());
+}
+
+auto Emitter::finish() && -> ByteCode
+{
+    m_bc.set_globals(m_globals);
+    if (!m_is_halted) {
+        halt();
+    }
+    return std::move(m_bc);
+}
+
+void Emitter::m_emit_bytes(std::initializer_list<uint8_t> bytes, Location location)
+{
+    for (uint8_t byte : bytes) {
+        m_bc.write_byte(byte, location);
+    }
+}
+
+auto Emitter::m_offset(std::size_t jump, std::size_t target) const -> int16_t
+{
+    auto offset = static_cast<std::ptrdiff_t>(target) - static_cast<std::ptrdiff_t>(jump + 1 + sizeof(int16_t));
+    if (!std::in_range<int16_t>(offset)) {
+        // lands inside the jump itself, which the verifier and checked mode reject instead of running off somewhere
+        std::cerr << "Too much code to jump over" << std::endl;
+        return -2;
+    }
+    return static_cast<int16_t>(offset);
+}
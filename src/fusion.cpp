@@ -0,0 +1,50 @@
+#include <string>
+#include <vector>
+
+#include "fusion.hpp"
+
+auto Fusions::all() noexcept -> Fusions
+{
+    Fusions fusions;
+    for (std::size_t opcode {}; opcode < util::opcode::count; opcode++) {
+        fusions.enable(static_cast<Opcode>(opcode));
+    }
+    return fusions;
+}
+
+auto Fusions::none() noexcept -> Fusions
+{
+    return {};
+}
+
+auto Fusions::from_profile(std::istream& profile, double min_share) -> std::optional<Fusions>
+{
+    std::vector<std::pair<Opcode, std::size_t>> after_load;
+    std::size_t total {};
+
+    std::string first;
+    std::string second;
+    std::size_t count {};
+    while (profile >> first >> second >> count) {
+        auto first_op  = util::opcode::from_string(first);
+        auto second_op = util::opcode::from_string(second);
+        if (!first_op.has_value() || !second_op.has_value()) {
+            return {};
+        }
+        total += count;
+        if (*first_op == Opcode::LOAD) {
+            after_load.emplace_back(*second_op, count);
+        }
+    }
+    if (!profile.eof()) {
+        return {};   // stopped on a malformed line rather than the end of the file
+    }
+
+    Fusions fusions;
+    for (auto [opcode, pairs] : after_load) {
+        if (static_cast<double>(pairs) >= min_share * static_cast<double>(total)) {
+            fusions.enable(opcode);
+        }
+    }
+    return fusions;
+}
@@ -0,0 +1,403 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "common.hpp"
+#include "heap.hpp"
+
+namespace {
+// every nursery cell starts where any object can, so walking the nursery only needs the size of each
+template <typename T>
+constexpr std::size_t cell_size = (sizeof(T) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+constexpr std::size_t largest_cell = std::max({ cell_size<Closure>, cell_size<Box>, cell_size<Instance>, cell_size<Array> });
+}
+
+void PauseHistogram::record(std::chrono::nanoseconds pause) noexcept
+{
+    m_buckets[std::bit_width(static_cast<uint64_t>(pause.count()))]++;
+    m_count++;
+    m_total += pause;
+    m_max = std::max(m_max, pause);
+}
+
+auto PauseHistogram::percentile(double fraction) const noexcept -> std::chrono::nanoseconds
+{
+    auto rank = static_cast<std::size_t>(std::ceil(fraction * static_cast<double>(m_count)));
+    std::size_t seen {};
+    for (std::size_t bucket {}; bucket < m_buckets.size(); bucket++) {
+        seen += m_buckets[bucket];
+        if (seen >= rank && seen > 0) {
+            // every pause in the bucket is below its next power of two
+            auto bound = bucket == 0 ? 0 : (bucket >= 63 ? std::numeric_limits<int64_t>::max() : (int64_t { 1 } << bucket) - 1);
+            return std::min(std::chrono::nanoseconds { bound }, m_max);
+        }
+    }
+    return {};
+}
+
+Heap::Heap(StringTable& pool)
+    : m_pool { pool }
+    , m_nursery { new std::byte[nursery_size] }
+{
+}
+
+Heap::~Heap()
+{
+    m_free();
+}
+
+void Heap::clear()
+{
+    m_free();
+    for (auto const& [address, string] : m_strings) {
+        m_pool.erase(string.string);
+    }
+    m_strings.clear();
+    m_young_strings.clear();
+    m_old_strings.clear();
+    m_top             = 0;
+    m_nursery_objects = 0;
+    m_old.clear();
+    m_remembered.clear();
+    m_promoted.clear();
+    m_gray.clear();
+    m_phase            = Phase::IDLE;
+    m_swept_objects    = 0;
+    m_swept_strings    = 0;
+    m_next_major       = major_threshold;
+    m_young_bytes      = 0;
+    m_old_bytes        = 0;
+    m_next_major_bytes = major_bytes;
+    m_is_due           = false;
+}
+
+void Heap::m_free()
+{
+    for (std::size_t offset {}; offset < m_top;) {
+        offset += m_destroy(*std::launder(reinterpret_cast<Object*>(m_nursery.get() + offset)));
+    }
+    for (auto* object : m_old) {
+        m_destroy(*object);
+        ::operator delete(object);
+    }
+}
+
+auto Heap::make_closure(uint16_t function, std::vector<Stack::value_type> captures) -> Closure*
+{
+    return m_allocate(Closure { { .kind = Object::Kind::CLOSURE }, function, std::move(captures) });
+}
+
+auto Heap::make_box(Stack::value_type value) -> Box*
+{
+    return m_allocate(Box { { .kind = Object::Kind::BOX }, value });
+}
+
+auto Heap::make_instance(Shape* shape) -> Instance*
+{
+    return m_allocate(Instance { { .kind = Object::Kind::INSTANCE }, shape });
+}
+
+auto Heap::make_array(TypeIndex element, std::size_t length) -> Array*
+{
+    auto bytes = length * util::type::size_of(element);
+    std::unique_ptr<std::byte[], Array::Free> data { static_cast<std::byte*>(::operator new[](bytes, std::align_val_t { Array::alignment })) };
+    auto* array = m_allocate(Array { { .kind = Object::Kind::ARRAY }, element, length, std::move(data) });
+    (array->is_old ? m_old_bytes : m_young_bytes) += bytes;
+    m_is_due = m_is_due || m_is_nursery_full();
+    return array;
+}
+
+void Heap::track(StringPtr string)
+{
+    m_strings.emplace(&*string, String { .string = string });
+    m_young_strings.push_back(&*string);
+    m_is_due = m_is_due || m_phase != Phase::IDLE || m_is_nursery_full();
+}
+
+template <typename T>
+auto Heap::m_allocate(T object) -> T*
+{
+    T* allocated = nullptr;
+    if (m_top + cell_size<T> <= nursery_size) {
+        allocated = ::new (m_nursery.get() + m_top) T(std::move(object));
+        m_top += cell_size<T>;
+        m_nursery_objects++;
+    } else {
+        // only reached when nobody collected in time, an object born old may point into the nursery right away
+        allocated         = ::new (::operator new(sizeof(T))) T(std::move(object));
+        allocated->is_old = true;
+        m_old.push_back(allocated);
+        m_enter_old(*allocated);
+        write(*allocated);
+    }
+    // every allocation pays for a step of a running major collection
+    m_is_due = m_is_due || m_phase != Phase::IDLE || m_is_nursery_full();
+    return allocated;
+}
+
+auto Heap::m_is_nursery_full() const noexcept -> bool
+{
+    // collect while the next allocation still fits, the vm allocates at most one object between safepoints
+    return m_top + largest_cell > nursery_size || m_young_strings.size() >= nursery_strings || m_young_bytes >= nursery_bytes;
+}
+
+void Heap::m_write(Object& object)
+{
+    if (!object.is_remembered) {
+        object.is_remembered = true;
+        m_remembered.push_back(&object);
+    }
+    // marking may have scanned the object before the store, scanning it again finds what it holds now
+    if (m_phase == Phase::MARKING && object.is_marked) {
+        m_gray.push_back(&object);
+    }
+}
+
+void Heap::m_enter_old(Object& object)
+{
+    if (m_phase != Phase::IDLE) {
+        object.is_marked = true;
+    }
+    if (m_phase == Phase::MARKING) {
+        m_gray.push_back(&object);
+    }
+}
+
+void Heap::collect(std::initializer_list<std::span<Stack::value_type>> roots)
+{
+    auto start = std::chrono::steady_clock::now();
+    // a major collection in progress makes every allocation call this, which only collects the nursery when needed
+    if (m_phase == Phase::IDLE || m_is_nursery_full()) {
+        m_minor(roots);
+    }
+    switch (m_phase) {
+        case Phase::IDLE:
+            if (m_old.size() + m_old_strings.size() >= m_next_major || m_old_bytes >= m_next_major_bytes) {
+                m_start_marking(roots);
+            }
+            break;
+        case Phase::MARKING: m_mark_step(roots); break;
+        case Phase::SWEEPING: m_sweep_step(); break;
+    }
+    m_is_due = false;
+    m_pauses.record(std::chrono::steady_clock::now() - start);
+}
+
+void Heap::m_minor(std::initializer_list<std::span<Stack::value_type>> roots)
+{
+    m_minor_collections++;
+    for (auto root : roots) {
+        for (auto& value : root) {
+            m_evacuate(value);
+        }
+    }
+    for (auto* object : m_remembered) {
+        object->is_remembered = false;
+        for (auto& value : m_slots(*object)) {
+            m_evacuate(value);
+        }
+    }
+    m_remembered.clear();
+    // what got promoted may still point into the nursery, which promotes more until nothing is left to scan
+    while (!m_promoted.empty()) {
+        auto* object = m_promoted.back();
+        m_promoted.pop_back();
+        for (auto& value : m_slots(*object)) {
+            m_evacuate(value);
+        }
+    }
+
+    for (auto const* node : m_young_strings) {
+        auto string = m_strings.find(node);
+        if (string->second.is_old) {
+            string->second.is_marked = m_phase != Phase::IDLE;
+            m_old_strings.push_back(node);
+        } else {
+            m_pool.erase(string->second.string);
+            m_strings.erase(string);
+        }
+    }
+    m_young_strings.clear();
+    // whatever is left in the nursery is either dead or the moved from husk of a promoted object
+    for (std::size_t offset {}; offset < m_top;) {
+        offset += m_destroy(*std::launder(reinterpret_cast<Object*>(m_nursery.get() + offset)));
+    }
+    m_top             = 0;
+    m_nursery_objects = 0;
+    m_young_bytes     = 0;
+}
+
+void Heap::m_start_marking(std::initializer_list<std::span<Stack::value_type>> roots)
+{
+    m_major_collections++;
+    m_phase = Phase::MARKING;
+    for (auto root : roots) {
+        for (auto const& value : root) {
+            m_mark(value);
+        }
+    }
+}
+
+void Heap::m_mark_step(std::initializer_list<std::span<Stack::value_type>> roots)
+{
+    for (std::size_t scanned {}; scanned < mark_budget && !m_gray.empty(); scanned++) {
+        auto* object = m_gray.back();
+        m_gray.pop_back();
+        for (auto const& value : m_slots(*object)) {
+            m_mark(value);
+        }
+    }
+    if (!m_gray.empty()) {
+        return;
+    }
+    // the roots and the nursery changed since marking started without any barrier, the minor collection marks what
+    // the nursery held on to as it promotes it
+    m_minor(roots);
+    for (auto root : roots) {
+        for (auto const& value : root) {
+            m_mark(value);
+        }
+    }
+    while (!m_gray.empty()) {
+        auto* object = m_gray.back();
+        m_gray.pop_back();
+        for (auto const& value : m_slots(*object)) {
+            m_mark(value);
+        }
+    }
+    m_phase         = Phase::SWEEPING;
+    m_swept_objects = 0;
+    m_swept_strings = 0;
+}
+
+void Heap::m_sweep_step()
+{
+    // a dead entry is replaced by the last one, which gets looked at next, so what gets promoted meanwhile, marked
+    // and appended, is swept as well
+    for (std::size_t swept {}; swept < sweep_budget && m_swept_objects < m_old.size(); swept++) {
+        auto* object = m_old[m_swept_objects];
+        if (object->is_marked) {
+            object->is_marked = false;
+            m_swept_objects++;
+            continue;
+        }
+        if (object->kind == Object::Kind::ARRAY) {
+            m_old_bytes -= static_cast<Array*>(object)->bytes();
+        }
+        m_destroy(*object);
+        ::operator delete(object);
+        m_old[m_swept_objects] = m_old.back();
+        m_old.pop_back();
+    }
+    for (std::size_t swept {}; swept < sweep_budget && m_swept_strings < m_old_strings.size(); swept++) {
+        auto string = m_strings.find(m_old_strings[m_swept_strings]);
+        if (string->second.is_marked) {
+            string->second.is_marked = false;
+            m_swept_strings++;
+            continue;
+        }
+        m_pool.erase(string->second.string);
+        m_strings.erase(string);
+        m_old_strings[m_swept_strings] = m_old_strings.back();
+        m_old_strings.pop_back();
+    }
+    if (m_swept_objects == m_old.size() && m_swept_strings == m_old_strings.size()) {
+        m_phase            = Phase::IDLE;
+        m_next_major       = std::max(major_threshold, 2 * (m_old.size() + m_old_strings.size()));
+        m_next_major_bytes = std::max(major_bytes, 2 * m_old_bytes);
+    }
+}
+
+void Heap::m_evacuate(Stack::value_type& value)
+{
+    auto promote = [this]<typename T>(T* object) -> T* {
+        if (object->is_old) {
+            return object;
+        }
+        if (object->forward == nullptr) {
+            auto* promoted   = ::new (::operator new(sizeof(T))) T(std::move(*object));
+            promoted->is_old = true;
+            object->forward  = promoted;
+            m_old.push_back(promoted);
+            m_promoted.push_back(promoted);
+            m_enter_old(*promoted);
+            if constexpr (std::is_same_v<T, Array>) {
+                m_old_bytes += promoted->bytes();
+            }
+        }
+        return static_cast<T*>(object->forward);
+    };
+    std::visit(util::Visitor {
+                   [&](StringPtr string) {
+                       if (auto found = m_strings.find(&*string); found != m_strings.end()) {
+                           found->second.is_old = true;
+                       }
+                   },
+                   // the vm never writes through a closure, the copy just has to start out as the same closure
+                   [&](Closure const* closure) { value = promote(const_cast<Closure*>(closure)); },
+                   [&](Box* box) { value = promote(box); },
+                   [&](Instance* instance) { value = promote(instance); },
+                   [&](Array* array) { value = promote(array); },
+                   []<typename T>(T) {},
+               },
+               value);
+}
+
+void Heap::m_mark(Stack::value_type const& value)
+{
+    auto mark = [this](Object* object) {
+        if (object->is_old && !object->is_marked) {
+            object->is_marked = true;
+            m_gray.push_back(object);
+        }
+    };
+    std::visit(util::Visitor {
+                   [&](StringPtr string) {
+                       if (auto found = m_strings.find(&*string); found != m_strings.end() && found->second.is_old) {
+                           found->second.is_marked = true;
+                       }
+                   },
+                   [&](Closure const* closure) { mark(const_cast<Closure*>(closure)); },
+                   [&](Box* box) { mark(box); },
+                   [&](Instance* instance) { mark(instance); },
+                   [&](Array* array) { mark(array); },
+                   []<typename T>(T) {},
+               },
+               value);
+}
+
+auto Heap::m_slots(Object& object) -> std::span<Stack::value_type>
+{
+    switch (object.kind) {
+        case Object::Kind::CLOSURE: return static_cast<Closure&>(object).captures;
+        case Object::Kind::BOX: return { &static_cast<Box&>(object).value, 1 };
+        case Object::Kind::INSTANCE: return static_cast<Instance&>(object).fields;
+        case Object::Kind::ARRAY: return {};   // elements are never references
+    }
+    std::unreachable();
+}
+
+auto Heap::m_destroy(Object& object) -> std::size_t
+{
+    switch (object.kind) {
+        case Object::Kind::CLOSURE:
+            static_cast<Closure&>(object).~Closure();
+            return cell_size<Closure>;
+        case Object::Kind::BOX:
+            static_cast<Box&>(object).~Box();
+            return cell_size<Box>;
+        case Object::Kind::INSTANCE:
+            static_cast<Instance&>(object).~Instance();
+            return cell_size<Instance>;
+        case Object::Kind::ARRAY:
+            static_cast<Array&>(object).~Array();
+            return cell_size<Array>;
+    }
+    std::unreachable();
+}
@@ -1,5 +1,11 @@
 #pragma once
+#include <array>
 #include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 #include "types.hpp"
 #include "common.hpp"
 
@@ -16,10 +22,29 @@ enum class Order : uint8_t {
 };
 template <Order>
 struct Compare;
+/* logical expr types, the right operand only runs when the left does not decide the result */
+struct And;
+struct Or;
 /* unary expr types */
 struct Negate;
 struct Not;
 struct Literal;
+/* variable expr types */
+struct Variable;
+struct Assign;
+struct Call;
+/* property expr types */
+struct Get;
+struct Set;
+struct Invoke;
+/* array expr types */
+struct ArrayLiteral;
+struct ArrayFill;
+struct Index;
+struct SetIndex;
+struct Elementwise;
+struct Reduce;
+struct Length;
 
 using ExprType = std::variant<std::unique_ptr<Add>,
                               std::unique_ptr<Subtract>,
@@ -29,13 +54,124 @@ using ExprType = std::variant<std::unique_ptr<Add>,
                               std::unique_ptr<Compare<Order::LESS>>,
                               std::unique_ptr<Compare<Order::EQUAL>>,
                               std::unique_ptr<Compare<Order::GREATER>>,
+                              std::unique_ptr<And>,
+                              std::unique_ptr<Or>,
                               std::unique_ptr<Negate>,
                               std::unique_ptr<Not>,
-                              std::unique_ptr<Literal>>;
+                              std::unique_ptr<Literal>,
+                              std::unique_ptr<Variable>,
+                              std::unique_ptr<Assign>,
+                              std::unique_ptr<Call>,
+                              std::unique_ptr<Get>,
+                              std::unique_ptr<Set>,
+                              std::unique_ptr<Invoke>,
+                              std::unique_ptr<ArrayLiteral>,
+                              std::unique_ptr<ArrayFill>,
+                              std::unique_ptr<Index>,
+                              std::unique_ptr<SetIndex>,
+                              std::unique_ptr<Elementwise>,
+                              std::unique_ptr<Reduce>,
+                              std::unique_ptr<Length>>;
+
+struct FunctionType;
+struct ClassType;
+
+// static type of a value, two function types are the same when their signatures are, two instance types when their
+// classes are and two array types when their elements are
+struct Type {
+    TypeIndex index {};
+    std::shared_ptr<FunctionType const> signature {};   // only set for `FUNCTION`
+    ClassType const* klass {};                          // only set for `INSTANCE`
+    TypeIndex element {};                               // only set for `ARRAY`
+
+    auto operator==(Type const& other) const -> bool;
+};
+
+struct FunctionType {
+    std::vector<Type> parameters;
+    Type result;
+
+    auto operator==(FunctionType const&) const -> bool = default;
+};
+
+inline auto Type::operator==(Type const& other) const -> bool
+{
+    if (index != other.index || klass != other.klass || element != other.element) {
+        return false;
+    }
+    return signature == other.signature || (signature != nullptr && other.signature != nullptr && *signature == *other.signature);
+}
+
+struct Fun;
+
+/**
+ * A `class` declaration, which only the parser looks anything up in.
+ *
+ * Fields are declared with their type but an instance only gets one once
+ * it is assigned, so instances of a class differ in which fields they
+ * have. A subclass lists what it adds, methods of the same name override
+ * the superclass's with the same signature but for the instance.
+ */
+struct ClassType {
+    struct Field {
+        std::string name;
+        Type type;
+    };
+    struct Method {
+        std::string name;
+        std::shared_ptr<FunctionType const> signature;   // takes the instance first, as `this`
+        Fun const* declaration {};
+    };
+
+    std::string name;
+    ClassType const* superclass {};
+    std::vector<Field> fields {};
+    std::vector<Method> methods {};   // `init` among them when the class has one
+    uint16_t index {};                // classes are numbered in the order they are declared
+
+    // field called `name` of this class or its closest superclass declaring one, null when there is none
+    [[nodiscard]] auto field(std::string_view name) const -> Field const*
+    {
+        for (auto const* klass = this; klass != nullptr; klass = klass->superclass) {
+            for (auto const& field : klass->fields) {
+                if (field.name == name) {
+                    return &field;
+                }
+            }
+        }
+        return nullptr;
+    }
+    // method an instance of this class calls by `name`, null when there is none
+    [[nodiscard]] auto method(std::string_view name) const -> Method const*
+    {
+        for (auto const* klass = this; klass != nullptr; klass = klass->superclass) {
+            for (auto const& method : klass->methods) {
+                if (method.name == name) {
+                    return &method;
+                }
+            }
+        }
+        return nullptr;
+    }
+    // whether every instance of this class is one of `other`
+    [[nodiscard]] auto is_subclass_of(ClassType const* other) const -> bool
+    {
+        for (auto const* klass = this; klass != nullptr; klass = klass->superclass) {
+            if (klass == other) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
 
 struct Expr {
-    std::size_t line;   // store line in source code
-    TypeIndex type;     // store the type information
+    std::size_t line;        // store line in source code
+    TypeIndex type;          // store the type information
+    std::size_t column {};   // column of the token the node comes from
+    std::shared_ptr<FunctionType const> signature {};   // what calling the value takes and gives when `type` is `FUNCTION`
+    ClassType const* klass {};                          // class of the value when `type` is `INSTANCE`
+    TypeIndex element {};                               // type of the elements when `type` is `ARRAY`
 };
 
 struct Literal : Expr {
@@ -59,23 +195,208 @@ struct Divide : Binary { };
 struct Modulus : Binary { };
 template <Order>
 struct Compare : Binary { };
+struct And : Binary { };
+struct Or : Binary { };
 /* Unary */
 struct Negate : Unary { };
 struct Not : Unary { };
 
+// where the parser resolved a variable to, names never reach the compiled code
+struct Binding {
+    enum class Scope : uint8_t {
+        GLOBAL,   // `index` into the program's flat globals array
+        LOCAL,    // `index` is the operand stack slot, counted from the bottom of the running function's frame
+        CAPTURE,  // `index` into the running closure's captures, a variable of an enclosing function
+        SELF,     // the running function naming itself, which it cannot capture before its closure exists
+    };
+
+    Scope scope;
+    uint16_t index;
+    bool boxed {};   // closures share the variable through a box, since it changes after they captured it
+};
+
+struct Variable : Expr {
+    std::string name;
+    Binding binding;
+    Fun const* declaration {};   // the `fun` statement declaring a local function, calls by name may skip its closure
+};
+
+struct Assign : Expr {
+    std::string name;
+    Binding binding;
+    ExprType value;
+};
+
+// the arguments become the first locals of the callee's frame
+struct Call : Expr {
+    ExprType callee;
+    std::vector<ExprType> arguments;
+};
+
+// reads a field, which the instance only has once something assigned it
+struct Get : Expr {
+    ExprType object;
+    std::string name;
+};
+
+// assigns a field, adding it to the instance the first time
+struct Set : Expr {
+    ExprType object;
+    std::string name;
+    ExprType value;
+};
+
+// calls the method `name` of the instance's class with the instance as the first argument, methods are never values
+struct Invoke : Expr {
+    ExprType object;
+    std::string name;
+    std::vector<ExprType> arguments;
+    Fun const* method {};   // the superclass method `super.name(...)` calls, instead of looking `name` up in the instance's class
+};
+
+// `[a, b, c]`, every element has the type of the first
+struct ArrayLiteral : Expr {
+    std::vector<ExprType> elements;
+};
+
+// `[value; length]`, an array of `length` copies of `value`
+struct ArrayFill : Expr {
+    ExprType value;
+    ExprType length;
+};
+
+// `array[index]`, the index is checked against the length when it runs
+struct Index : Expr {
+    ExprType array;
+    ExprType index;
+};
+
+// `array[index] = value`
+struct SetIndex : Expr {
+    ExprType array;
+    ExprType index;
+    ExprType value;
+};
+
+// arithmetic or a comparison between the elements at the same index of two arrays of the same length
+struct Elementwise : Expr {
+    ArrayOp op;
+    ExprType left;
+    ExprType right;
+};
+
+// `array.sum()`, `array.min()` or `array.max()`, computed in the type of the elements
+struct Reduce : Expr {
+    ArrayOp op;
+    ExprType array;
+};
+
+// `array.len()`
+struct Length : Expr {
+    ExprType array;
+};
+
+// nodes making, reading or computing with arrays, which only the stack vm runs
+template <typename Node>
+concept ArrayNode = std::is_same_v<Node, ArrayLiteral> || std::is_same_v<Node, ArrayFill> || std::is_same_v<Node, Index>
+                 || std::is_same_v<Node, SetIndex> || std::is_same_v<Node, Elementwise> || std::is_same_v<Node, Reduce>
+                 || std::is_same_v<Node, Length>;
+
 /* stmt types */
 struct Log;
+struct Let;
+struct Block;
+struct Expression;
+struct If;
+struct While;
+struct Return;
+struct Class;
 
-using StmtType = std::variant<std::unique_ptr<Log>>;
+using StmtType = std::variant<std::unique_ptr<Log>,
+                              std::unique_ptr<Let>,
+                              std::unique_ptr<Block>,
+                              std::unique_ptr<Expression>,
+                              std::unique_ptr<If>,
+                              std::unique_ptr<While>,
+                              std::unique_ptr<Fun>,
+                              std::unique_ptr<Return>,
+                              std::unique_ptr<Class>>;
 
 struct Stmt {
     std::size_t line;
+    std::size_t column {};
 };
 
 struct Log : Stmt {
     ExprType expr;
 };
 
+struct Let : Stmt {
+    std::string name;
+    Binding binding;
+    ExprType initializer;
+};
+
+// the whole program is the outermost block, whose declarations are the globals
+struct Block : Stmt {
+    std::vector<StmtType> stmts;
+    uint8_t locals;   // locals declared directly inside, dropped off the stack when the block ends
+};
+
+// expression evaluated for its side effects, its value is discarded
+struct Expression : Stmt {
+    ExprType expr;
+};
+
+struct If : Stmt {
+    ExprType condition;
+    StmtType then_branch;
+    std::optional<StmtType> else_branch;
+};
+
+// `for` loops are desugared into a block holding the initializer and a `While`
+struct While : Stmt {
+    ExprType condition;
+    StmtType body;
+};
+
+struct Parameter {
+    std::string name;
+    Binding binding;   // a local of the body, boxed when a closure shares it
+};
+
+// a variable of an enclosing function the body uses, copied into the closure when the `fun` statement runs
+struct Capture {
+    std::string name;
+    Type type;
+    Binding source;   // where the function running the `fun` statement finds it
+};
+
+// declares `name` like a `Let` of the function value, the body runs in a frame whose first locals are the parameters
+struct Fun : Stmt {
+    std::string name;
+    Binding binding;
+    std::shared_ptr<FunctionType const> signature;
+    std::vector<Parameter> parameters;
+    std::vector<StmtType> body;         // every path through it ends in a `Return`
+    std::vector<Capture> captures {};   // flat, in the order the body first mentions them
+    std::size_t locals {};              // most slots its parameters and locals take at once
+    bool escapes {};                    // whether the function is used other than called by name where it is declared
+};
+
+struct Return : Stmt {
+    ExprType value;
+};
+
+// declares `name` like a `Let` of the class's constructor, which takes what `init` does and returns a new instance
+struct Class : Stmt {
+    std::string name;
+    Binding binding;
+    std::shared_ptr<ClassType const> type;   // shared with the parser, which resolves types naming the class by it
+    std::shared_ptr<FunctionType const> constructor;
+    std::vector<std::unique_ptr<Fun>> methods;   // their first parameter is `this`, `init` returns it
+};
+
 namespace util {
 namespace literal {
     namespace {
@@ -116,6 +437,21 @@ namespace ast {
             auto operator()(std::unique_ptr<Literal> const& expr) const -> std::string;
         };
 
+        // variables print with where they were resolved to, `g0:x` is global 0, `l1:y` local slot 1, `c0:z` capture 0,
+        // `s0:f` the running function itself and a trailing `*` marks a boxed variable
+        inline auto binding_to_string(std::string_view name, Binding binding) -> std::string
+        {
+            constexpr std::array<std::string_view, 4> scopes { "g", "l", "c", "s" };
+            return std::format("{}{}{}:{}", scopes[std::to_underlying(binding.scope)], binding.index, binding.boxed ? "*" : "", name);
+        }
+
+        struct VariableExprToStrVisitor {
+            auto operator()(std::unique_ptr<Variable> const& expr) const -> std::string
+            {
+                return binding_to_string(expr->name, expr->binding);
+            }
+        };
+
         template <>
         template <typename Derived>
         auto StmtToStrVisitor<Log>::operator()(this Derived const& self, std::unique_ptr<Log> const& stmt) -> std::string
@@ -124,6 +460,173 @@ namespace ast {
             return std::format("[[Log]]\v>{}", std::move(expr));
         }
 
+        template <>
+        template <typename Derived>
+        auto StmtToStrVisitor<Let>::operator()(this Derived const& self, std::unique_ptr<Let> const& stmt) -> std::string
+        {
+            std::string initializer = std::visit(self, stmt->initializer);
+            return std::format("[[Let {}]]\v>{}", binding_to_string(stmt->name, stmt->binding), std::move(initializer));
+        }
+
+        template <>
+        template <typename Derived>
+        auto StmtToStrVisitor<Block>::operator()(this Derived const& self, std::unique_ptr<Block> const& stmt) -> std::string
+        {
+            std::string stmts;
+            for (auto const& inner : stmt->stmts) {
+                stmts += std::format("\v>{}", std::visit(self, inner));
+            }
+            return std::format("[[Block]]{}", std::move(stmts));
+        }
+
+        template <>
+        template <typename Derived>
+        auto StmtToStrVisitor<Expression>::operator()(this Derived const& self, std::unique_ptr<Expression> const& stmt) -> std::string
+        {
+            std::string expr = std::visit(self, stmt->expr);
+            return std::format("[[Expression]]\v>{}", std::move(expr));
+        }
+
+        template <>
+        template <typename Derived>
+        auto StmtToStrVisitor<If>::operator()(this Derived const& self, std::unique_ptr<If> const& stmt) -> std::string
+        {
+            std::string condition   = std::visit(self, stmt->condition);
+            std::string then_branch = std::visit(self, stmt->then_branch);
+            if (!stmt->else_branch.has_value()) {
+                return std::format("[[If]]\v>{}\v>{}", std::move(condition), std::move(then_branch));
+            }
+            std::string else_branch = std::visit(self, stmt->else_branch.value());
+            return std::format("[[If]]\v>{}\v>{}\v>{}", std::move(condition), std::move(then_branch), std::move(else_branch));
+        }
+
+        template <>
+        template <typename Derived>
+        auto StmtToStrVisitor<While>::operator()(this Derived const& self, std::unique_ptr<While> const& stmt) -> std::string
+        {
+            std::string condition = std::visit(self, stmt->condition);
+            std::string body      = std::visit(self, stmt->body);
+            return std::format("[[While]]\v>{}\v>{}", std::move(condition), std::move(body));
+        }
+
+        template <>
+        template <typename Derived>
+        auto StmtToStrVisitor<Fun>::operator()(this Derived const& self, std::unique_ptr<Fun> const& stmt) -> std::string
+        {
+            std::string body;
+            for (auto const& inner : stmt->body) {
+                body += std::format("\v>{}", std::visit(self, inner));
+            }
+            return std::format("[[Fun {}({})]]{}", binding_to_string(stmt->name, stmt->binding), stmt->parameters.size(), std::move(body));
+        }
+
+        template <>
+        template <typename Derived>
+        auto StmtToStrVisitor<Return>::operator()(this Derived const& self, std::unique_ptr<Return> const& stmt) -> std::string
+        {
+            std::string value = std::visit(self, stmt->value);
+            return std::format("[[Return]]\v>{}", std::move(value));
+        }
+
+        template <>
+        template <typename Derived>
+        auto StmtToStrVisitor<Class>::operator()(this Derived const& self, std::unique_ptr<Class> const& stmt) -> std::string
+        {
+            std::string methods;
+            for (auto const& method : stmt->methods) {
+                methods += std::format("\v>{}", self(method));
+            }
+            auto superclass = stmt->type->superclass != nullptr ? std::format(" < {}", stmt->type->superclass->name) : std::string {};
+            return std::format("[[Class {}{}]]{}", binding_to_string(stmt->name, stmt->binding), superclass, std::move(methods));
+        }
+
+        // `super` calls print as `super.name` since they do not look the method up
+        struct PropertyExprToStrVisitor {
+            template <typename Derived>
+            auto operator()(this Derived const& self, std::unique_ptr<Get> const& expr) -> std::string
+            {
+                return std::format("[.{}]\v>{}", expr->name, std::visit(self, expr->object));
+            }
+            template <typename Derived>
+            auto operator()(this Derived const& self, std::unique_ptr<Set> const& expr) -> std::string
+            {
+                return std::format("[.{} =]\v>{} {}", expr->name, std::visit(self, expr->object), std::visit(self, expr->value));
+            }
+            template <typename Derived>
+            auto operator()(this Derived const& self, std::unique_ptr<Invoke> const& expr) -> std::string
+            {
+                std::string invoke = std::format("[{}.{}()]\v>{}", expr->method != nullptr ? "super" : "", expr->name, std::visit(self, expr->object));
+                for (auto const& argument : expr->arguments) {
+                    invoke += std::format(" {}", std::visit(self, argument));
+                }
+                return invoke;
+            }
+        };
+
+        // element-wise operations print their operator after `each`, reductions and the length like a method call
+        struct ArrayExprToStrVisitor {
+            template <typename Derived>
+            auto operator()(this Derived const& self, std::unique_ptr<ArrayLiteral> const& expr) -> std::string
+            {
+                std::string array = "[array]";
+                for (std::size_t index {}; index < expr->elements.size(); index++) {
+                    array += std::format("{}{}", index == 0 ? "\v>" : " ", std::visit(self, expr->elements[index]));
+                }
+                return array;
+            }
+            template <typename Derived>
+            auto operator()(this Derived const& self, std::unique_ptr<ArrayFill> const& expr) -> std::string
+            {
+                return std::format("[fill]\v>{} {}", std::visit(self, expr->value), std::visit(self, expr->length));
+            }
+            template <typename Derived>
+            auto operator()(this Derived const& self, std::unique_ptr<Index> const& expr) -> std::string
+            {
+                return std::format("[index]\v>{} {}", std::visit(self, expr->array), std::visit(self, expr->index));
+            }
+            template <typename Derived>
+            auto operator()(this Derived const& self, std::unique_ptr<SetIndex> const& expr) -> std::string
+            {
+                return std::format("[index =]\v>{} {} {}", std::visit(self, expr->array), std::visit(self, expr->index), std::visit(self, expr->value));
+            }
+            template <typename Derived>
+            auto operator()(this Derived const& self, std::unique_ptr<Elementwise> const& expr) -> std::string
+            {
+                return std::format("[each {}]\v>{} {}", type::to_string(expr->op), std::visit(self, expr->left), std::visit(self, expr->right));
+            }
+            template <typename Derived>
+            auto operator()(this Derived const& self, std::unique_ptr<Reduce> const& expr) -> std::string
+            {
+                return std::format("[.{}()]\v>{}", type::to_string(expr->op), std::visit(self, expr->array));
+            }
+            template <typename Derived>
+            auto operator()(this Derived const& self, std::unique_ptr<Length> const& expr) -> std::string
+            {
+                return std::format("[.len()]\v>{}", std::visit(self, expr->array));
+            }
+        };
+
+        struct CallExprToStrVisitor {
+            template <typename Derived>
+            auto operator()(this Derived const& self, std::unique_ptr<Call> const& expr) -> std::string
+            {
+                std::string call = std::format("[call]\v>{}", std::visit(self, expr->callee));
+                for (auto const& argument : expr->arguments) {
+                    call += std::format(" {}", std::visit(self, argument));
+                }
+                return call;
+            }
+        };
+
+        struct AssignExprToStrVisitor {
+            template <typename Derived>
+            auto operator()(this Derived const& self, std::unique_ptr<Assign> const& expr) -> std::string
+            {
+                std::string value = std::visit(self, expr->value);
+                return std::format("[= {}]\v>{}", binding_to_string(expr->name, expr->binding), std::move(value));
+            }
+        };
+
         template <typename Expression>
         template <typename Derived>
         auto BinaryExprToStrVisitor<Expression>::operator()(this Derived const& self, std::unique_ptr<Expression> const& expr) -> std::string
@@ -151,6 +654,14 @@ namespace ast {
 
     inline constexpr Visitor to_string {
         StmtToStrVisitor<Log> {},
+        StmtToStrVisitor<Let> {},
+        StmtToStrVisitor<Block> {},
+        StmtToStrVisitor<Expression> {},
+        StmtToStrVisitor<If> {},
+        StmtToStrVisitor<While> {},
+        StmtToStrVisitor<Fun> {},
+        StmtToStrVisitor<Return> {},
+        StmtToStrVisitor<Class> {},
         BinaryExprToStrVisitor<Add> { .op = "+" },
         BinaryExprToStrVisitor<Subtract> { .op = "-" },
         BinaryExprToStrVisitor<Multiply> { .op = "*" },
@@ -159,21 +670,134 @@ namespace ast {
         BinaryExprToStrVisitor<Compare<Order::LESS>> { .op = "<" },
         BinaryExprToStrVisitor<Compare<Order::EQUAL>> { .op = "==" },
         BinaryExprToStrVisitor<Compare<Order::GREATER>> { .op = ">" },
+        BinaryExprToStrVisitor<And> { .op = "and" },
+        BinaryExprToStrVisitor<Or> { .op = "or" },
         UnaryExprToStrVisitor<Negate> { .op = "-" },
         UnaryExprToStrVisitor<Not> { .op = "!" },
         LiteralExprToStrVisitor {},
+        VariableExprToStrVisitor {},
+        AssignExprToStrVisitor {},
+        CallExprToStrVisitor {},
+        PropertyExprToStrVisitor {},
+        ArrayExprToStrVisitor {},
     };
+
+    namespace {
+        struct NodeCountVisitor {
+            template <typename Derived, typename Node>
+            auto operator()(this Derived const& self, std::unique_ptr<Node> const& node) -> std::size_t
+            {
+                if constexpr (std::is_base_of_v<Binary, Node>) {
+                    return 1 + std::visit(self, node->left) + std::visit(self, node->right);
+                } else if constexpr (std::is_base_of_v<Unary, Node>) {
+                    return 1 + std::visit(self, node->right);
+                } else if constexpr (std::is_same_v<Log, Node> || std::is_same_v<Expression, Node>) {
+                    return 1 + std::visit(self, node->expr);
+                } else if constexpr (std::is_same_v<Let, Node>) {
+                    return 1 + std::visit(self, node->initializer);
+                } else if constexpr (std::is_same_v<Return, Node>) {
+                    return 1 + std::visit(self, node->value);
+                } else if constexpr (std::is_same_v<Call, Node>) {
+                    auto count = 1 + std::visit(self, node->callee);
+                    for (auto const& argument : node->arguments) {
+                        count += std::visit(self, argument);
+                    }
+                    return count;
+                } else if constexpr (std::is_same_v<Assign, Node>) {
+                    return 1 + std::visit(self, node->value);
+                } else if constexpr (std::is_same_v<Get, Node>) {
+                    return 1 + std::visit(self, node->object);
+                } else if constexpr (std::is_same_v<Set, Node>) {
+                    return 1 + std::visit(self, node->object) + std::visit(self, node->value);
+                } else if constexpr (std::is_same_v<Invoke, Node>) {
+                    auto count = 1 + std::visit(self, node->object);
+                    for (auto const& argument : node->arguments) {
+                        count += std::visit(self, argument);
+                    }
+                    return count;
+                } else if constexpr (std::is_same_v<ArrayLiteral, Node>) {
+                    std::size_t count { 1 };
+                    for (auto const& element : node->elements) {
+                        count += std::visit(self, element);
+                    }
+                    return count;
+                } else if constexpr (std::is_same_v<ArrayFill, Node>) {
+                    return 1 + std::visit(self, node->value) + std::visit(self, node->length);
+                } else if constexpr (std::is_same_v<Index, Node>) {
+                    return 1 + std::visit(self, node->array) + std::visit(self, node->index);
+                } else if constexpr (std::is_same_v<SetIndex, Node>) {
+                    return 1 + std::visit(self, node->array) + std::visit(self, node->index) + std::visit(self, node->value);
+                } else if constexpr (std::is_same_v<Elementwise, Node>) {
+                    return 1 + std::visit(self, node->left) + std::visit(self, node->right);
+                } else if constexpr (std::is_same_v<Reduce, Node> || std::is_same_v<Length, Node>) {
+                    return 1 + std::visit(self, node->array);
+                } else if constexpr (std::is_same_v<If, Node>) {
+                    auto count = 1 + std::visit(self, node->condition) + std::visit(self, node->then_branch);
+                    return count + (node->else_branch.has_value() ? std::visit(self, node->else_branch.value()) : 0);
+                } else if constexpr (std::is_same_v<While, Node>) {
+                    return 1 + std::visit(self, node->condition) + std::visit(self, node->body);
+                } else if constexpr (std::is_same_v<Block, Node>) {
+                    std::size_t count { 1 };
+                    for (auto const& stmt : node->stmts) {
+                        count += std::visit(self, stmt);
+                    }
+                    return count;
+                } else if constexpr (std::is_same_v<Fun, Node>) {
+                    std::size_t count { 1 };
+                    for (auto const& stmt : node->body) {
+                        count += std::visit(self, stmt);
+                    }
+                    return count;
+                } else if constexpr (std::is_same_v<Class, Node>) {
+                    std::size_t count { 1 };
+                    for (auto const& method : node->methods) {
+                        count += self(method);
+                    }
+                    return count;
+                } else {
+                    return 1;
+                }
+            }
+        };
+    }
+
+    // counts every statement and expression node reachable from the visited node
+    inline constexpr NodeCountVisitor node_count {};
 }
 namespace type {
-    auto get_type(ExprType const& expr_type) -> TypeIndex
+    inline auto get_type(ExprType const& expr_type) -> TypeIndex
     {
         return std::visit(util::Visitor {
                               []<typename T>(std::unique_ptr<T> const& expr) { return expr->type; } },
                           expr_type);
     }
-    auto get_type(Expr const& expr) -> TypeIndex
+    inline auto get_type(Expr const& expr) -> TypeIndex
     {
         return expr.type;
     }
+    // full static type, with the signature of a function
+    inline auto get_static_type(ExprType const& expr_type) -> Type
+    {
+        return std::visit(util::Visitor {
+                              []<typename T>(std::unique_ptr<T> const& expr) { return Type { expr->type, expr->signature, expr->klass, expr->element }; } },
+                          expr_type);
+    }
+    inline auto to_string(Type const& type) -> std::string
+    {
+        if (type.klass != nullptr) {
+            return type.klass->name;
+        }
+        if (type.index == TypeIndex::ARRAY) {
+            return std::format("[{}]", to_string(type.element));
+        }
+        if (type.signature == nullptr) {
+            return std::string { to_string(type.index) };
+        }
+        std::string parameters;
+        for (auto const& parameter : type.signature->parameters) {
+            parameters += std::format("{}{}", parameters.empty() ? "" : ", ", to_string(parameter));
+        }
+        return std::format("fun({}): {}", parameters, to_string(type.signature->result));
+    }
 }
 }
@@ -0,0 +1,79 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "register_code.hpp"
+
+/**
+ * Evaluates register code over columns of inputs, a row at a time in
+ * meaning but a batch of rows at a time in execution.
+ *
+ * Every register holds a whole batch of values, one per row, and every
+ * instruction is dispatched once per batch, running a tight loop over the
+ * rows of its operands that the compiler can vectorize. Parameters the
+ * host declared to the parser are read from the column bound to their
+ * index, and the value of the program's last statement comes back as a
+ * column of one value per row.
+ *
+ * Only code that has a result and never logs is taken. String inputs are
+ * `StringTable` entries of this vm, so the host interns them through
+ * `intern` and equality stays a pointer compare. Integer division checks a
+ * whole batch of divisors before dividing and reports the first row that
+ * divides by zero or overflows, with the messages of the stack vm.
+ */
+class BatchVM {
+public:
+    static constexpr std::size_t batch_size = 1'024;
+
+    // the values of one parameter for every row, in the representation the register vm gives its type
+    using Column = std::variant<std::span<bool const>,
+                                std::span<int64_t const>,
+                                std::span<uint64_t const>,
+                                std::span<double const>,
+                                std::span<std::string const* const>>;
+
+    // first row the expression could not be evaluated for
+    struct Error {
+        std::size_t row;
+        std::string message;
+    };
+
+    // empty when the code logs or leaves no result
+    [[nodiscard]] static auto compile(RegisterSegment seg) -> std::optional<BatchVM>;
+
+    // the string id string columns have to hold for `value`
+    auto intern(std::string_view value) -> std::string const*;
+
+    // one value per row, `inputs` holds a column of at least `rows` values for every parameter the code reads
+    [[nodiscard]] auto evaluate(std::span<Column const> inputs, std::size_t rows) -> std::expected<std::vector<Register>, Error>;
+
+    [[nodiscard]] auto result_type() const noexcept -> TypeIndex
+    {
+        return m_rc.result().value();
+    }
+
+private:
+    using Batch = std::array<Register, batch_size>;
+
+    BatchVM(RegisterSegment seg)
+        : m_pool { std::move(seg.second) }
+        , m_rc { std::move(seg.first) }
+        , m_regs(m_rc.registers())
+    {
+    }
+
+    [[nodiscard]] auto m_check(std::span<Column const> inputs, std::size_t rows) const -> std::optional<Error>;
+    // evaluates rows `first` to `first + count` into `out`
+    [[nodiscard]] auto m_run(std::span<Column const> inputs, std::size_t first, std::size_t count, Register* out) -> std::optional<Error>;
+
+    StringTable m_pool;
+    RegisterCode m_rc;
+    std::vector<Batch> m_regs;
+};
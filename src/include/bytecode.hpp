@@ -2,74 +2,255 @@
 #include <vector>
 #include <cstdint>
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
 
-namespace util {
-class RLE {
-public:
-    /**
-     * Writes each instruction's corresponding source line number.
-     *
-     * Uses RLE(run-length encoding to write line info) into a seperate line array;
-     *
-     * If any runtime error occurs. This line information can be
-     * used to extract where the error occured in source.
-     */
-    [[nodiscard]] auto lines() const noexcept -> std::vector<std::pair<std::size_t, std::size_t>> const&
-    {
-        return m_lines;
+#include "line_table.hpp"
+#include "types.hpp"
+
+// what a stack slot holds, in the order of `Stack::value_type`'s alternatives
+enum class SlotType : uint16_t {
+    BOOL,
+    STRING,
+    INT,
+    UINT,
+    FLOAT,
+    FUNCTION,   // offset by the index of the function's signature, see `util::slot`
+    INSTANCE = 0x4000,   // offset by the index of the instance's class, see `util::slot`
+    ARRAY = 0x7FF0,      // offset by the `TypeIndex` of the array's elements, see `util::slot`
+    BOX = 0x8000,        // flag on the type of the value a box holds, see `util::slot`
+};
+
+namespace util::slot {
+// type of a value of the scalar `type`, every integer is held in 64 bits of its signedness
+inline constexpr auto scalar(TypeIndex type) noexcept -> SlotType
+{
+    if (util::type::is_signed_integer(type)) {
+        return SlotType::INT;
+    }
+    if (util::type::is_unsigned_integer(type)) {
+        return SlotType::UINT;
     }
+    if (type == TypeIndex::FLOAT32 || type == TypeIndex::FLOAT64) {
+        return SlotType::FLOAT;
+    }
+    return type == TypeIndex::STRING ? SlotType::STRING : SlotType::BOOL;
+}
 
-    void write_line_number(std::size_t offset, std::size_t line_nr) noexcept
-    {
-        if (m_lines.empty() || m_lines.back().second != line_nr) {
-            m_lines.emplace_back(offset, line_nr);
-        }
+// type of a function value whose signature is `ByteCode::signatures()[signature]`
+inline constexpr auto function(std::size_t signature) noexcept -> SlotType
+{
+    return static_cast<SlotType>(static_cast<std::size_t>(SlotType::FUNCTION) + signature);
+}
+
+// index of the signature a function type stands for, empty for every other type
+inline constexpr auto signature(SlotType type) noexcept -> std::optional<std::size_t>
+{
+    if (type < SlotType::FUNCTION || type >= SlotType::INSTANCE) {
+        return {};
     }
-    /**
-     * .first => byte offset
-     * .second => line number
-     * Uses binary search over .first to calculate where the offset lies
-     */
-    [[nodiscard]] auto read_line_number(std::size_t byte_offset) const noexcept -> std::size_t
-    {
-        /**
-         * We do a binary search over the encoding, .first represents byte offset till the current or less offset.
-         * Using these we find out the current line where the byte offset possibly might be.
-         * Then we simply return
-         */
-        auto it = std::ranges::upper_bound(m_lines.begin(), m_lines.end(),
-                                           byte_offset, {},
-                                           [](auto const& encoding) { return encoding.first; });
+    return static_cast<std::size_t>(type) - static_cast<std::size_t>(SlotType::FUNCTION);
+}
 
-        return std::prev(it)->second;
+// type of an instance of `ByteCode::classes()[klass]`
+inline constexpr auto instance(std::size_t klass) noexcept -> SlotType
+{
+    return static_cast<SlotType>(static_cast<std::size_t>(SlotType::INSTANCE) + klass);
+}
+
+// index of the class an instance type stands for, empty for every other type
+inline constexpr auto class_of(SlotType type) noexcept -> std::optional<std::size_t>
+{
+    if (type < SlotType::INSTANCE || type >= SlotType::ARRAY) {
+        return {};
     }
+    return static_cast<std::size_t>(type) - static_cast<std::size_t>(SlotType::INSTANCE);
+}
 
-private:
-    std::vector<std::pair<std::size_t, std::size_t>> m_lines;
-};
+// type of an array whose elements are of `element`
+inline constexpr auto array(TypeIndex element) noexcept -> SlotType
+{
+    return static_cast<SlotType>(std::to_underlying(SlotType::ARRAY) + std::to_underlying(element));
+}
+
+// type of the elements an array type stands for, empty for every other type
+inline constexpr auto element(SlotType type) noexcept -> std::optional<TypeIndex>
+{
+    if (type < SlotType::ARRAY || type >= SlotType::BOX) {
+        return {};
+    }
+    return static_cast<TypeIndex>(std::to_underlying(type) - std::to_underlying(SlotType::ARRAY));
+}
+
+// type of a box holding values of `type`, which itself is no box
+inline constexpr auto boxed(SlotType type) noexcept -> SlotType
+{
+    return static_cast<SlotType>(std::to_underlying(type) | std::to_underlying(SlotType::BOX));
 }
 
+// type of the value a box of `type` holds, empty when `type` is no box
+inline constexpr auto unboxed(SlotType type) noexcept -> std::optional<SlotType>
+{
+    if (type < SlotType::BOX) {
+        return {};
+    }
+    return static_cast<SlotType>(std::to_underlying(type) & ~std::to_underlying(SlotType::BOX));
+}
+}
+
+// what calling a function takes and gives, every function value of one signature shares the entry
+struct Signature {
+    std::vector<SlotType> parameters;
+    SlotType result;
+
+    auto operator==(Signature const&) const -> bool = default;
+};
+
+// a function the code can load and call, `LOAD FUNCTION` and `CLOSURE` refer to it by its index
+struct Function {
+    std::size_t entry;    // byte offset of the first instruction of its body
+    uint16_t signature;   // index into `ByteCode::signatures`
+    std::string name;
+    std::vector<SlotType> captures {};   // what `CLOSURE` copies into it, only a function without any is loaded
+};
+
+/**
+ * A class `NEW` makes instances of, fields and methods are named by their
+ * index into `ByteCode::names`. The layout of an instance is not fixed
+ * here: it gets its fields in the order they are first assigned, the vm
+ * tracks that order as the instance's shape.
+ */
+struct ClassInfo {
+    std::string name;
+    std::optional<uint16_t> superclass;                      // declared before the class
+    std::vector<std::pair<uint16_t, SlotType>> fields {};    // the ones it adds to its superclass's, with their types
+    std::vector<std::pair<uint16_t, uint16_t>> methods {};   // the index into `functions` of each method it defines or overrides
+};
+
 class ByteCode {
 public:
     [[nodiscard]] auto code() const noexcept -> std::vector<uint8_t> const&
     {
         return m_code;
     }
-    [[nodiscard]] auto lines() const noexcept -> decltype(auto)
+    // debug information lives apart from `m_code`, only errors and tools decode it
+    [[nodiscard]] auto line_table() const noexcept -> util::LineTable const&
     {
-        return m_line_info.lines();
+        return m_line_info;
     }
-    void write_byte(uint8_t b, std::size_t line_nr) /* Used to write a single byte `opcode` `operand` `line information` etc. */
+    void write_byte(uint8_t b, Location location) /* Used to write a single byte `opcode` `operand` `line information` etc. */
     {
-        m_line_info.write_line_number(m_code.size(), line_nr);
+        m_line_info.write(m_code.size(), location);
         m_code.push_back(b);
     }
+    // overwrites an already written byte, keeping its line information
+    void patch_byte(std::size_t offset, uint8_t b) noexcept
+    {
+        m_code[offset] = b;
+    }
     [[nodiscard]] auto read_line_number(std::size_t offset) const noexcept -> std::size_t
     {
         return m_line_info.read_line_number(offset);
     }
+    [[nodiscard]] auto read_location(std::size_t offset) const noexcept -> Location
+    {
+        return m_line_info.read(offset);
+    }
+    // size of the flat globals array `GET_GLOBAL` and `SET_GLOBAL` index
+    [[nodiscard]] auto globals() const noexcept -> std::size_t
+    {
+        return m_globals;
+    }
+    void set_globals(std::size_t globals) noexcept
+    {
+        m_globals = globals;
+    }
+    // bodies follow the top level code, in the order of their entries
+    [[nodiscard]] auto functions() const noexcept -> std::vector<Function> const&
+    {
+        return m_functions;
+    }
+    [[nodiscard]] auto signatures() const noexcept -> std::vector<Signature> const&
+    {
+        return m_signatures;
+    }
+    auto add_function(Function function) -> std::size_t
+    {
+        m_functions.push_back(std::move(function));
+        return m_functions.size() - 1;
+    }
+    void set_entry(std::size_t function, std::size_t entry) noexcept
+    {
+        m_functions[function].entry = entry;
+    }
+    // index of `signature`, equal signatures share one
+    auto add_signature(Signature signature) -> std::size_t
+    {
+        auto found = std::ranges::find(m_signatures, signature);
+        if (found != m_signatures.end()) {
+            return static_cast<std::size_t>(found - m_signatures.begin());
+        }
+        m_signatures.push_back(std::move(signature));
+        return m_signatures.size() - 1;
+    }
+    [[nodiscard]] auto classes() const noexcept -> std::vector<ClassInfo> const&
+    {
+        return m_classes;
+    }
+    auto add_class(ClassInfo klass) -> std::size_t
+    {
+        m_classes.push_back(std::move(klass));
+        return m_classes.size() - 1;
+    }
+    // names of the fields and methods `GET_PROP`, `SET_PROP` and `INVOKE` access
+    [[nodiscard]] auto names() const noexcept -> std::vector<std::string> const&
+    {
+        return m_names;
+    }
+    // index of `name`, every access of one name shares it
+    auto add_name(std::string_view name) -> std::size_t
+    {
+        auto found = std::ranges::find(m_names, name);
+        if (found != m_names.end()) {
+            return static_cast<std::size_t>(found - m_names.begin());
+        }
+        m_names.emplace_back(name);
+        return m_names.size() - 1;
+    }
+    // number of inline caches the property instructions index, each of them has its own which the vm keeps apart
+    [[nodiscard]] auto caches() const noexcept -> std::size_t
+    {
+        return m_caches;
+    }
+    auto add_cache() noexcept -> std::size_t
+    {
+        return m_caches++;
+    }
+    /**
+     * Reads an operand of type `T` starting at `offset`.
+     *
+     * Operands follow their opcode byte so they are almost never aligned,
+     * the bytes are copied out instead of dereferencing a cast pointer.
+     */
+    template <typename T>
+    [[nodiscard]] auto read_value(std::size_t offset) const noexcept -> T
+    {
+        std::array<uint8_t, sizeof(T)> bytes;
+        std::copy_n(std::next(m_code.begin(), offset), sizeof(T), bytes.begin());
+        return std::bit_cast<T>(bytes);
+    }
 
 private:
     std::vector<uint8_t> m_code;
-    util::RLE m_line_info {};
+    util::LineTable m_line_info {};
+    std::size_t m_globals {};
+    std::vector<Function> m_functions;
+    std::vector<Signature> m_signatures;
+    std::vector<ClassInfo> m_classes;
+    std::vector<std::string> m_names;
+    std::size_t m_caches {};
 };
\ No newline at end of file
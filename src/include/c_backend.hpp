@@ -0,0 +1,54 @@
+#pragma once
+#include <filesystem>
+#include <string>
+
+#include "ast.hpp"
+
+/**
+ * Ahead of time backend translating the typed ast into portable C.
+ *
+ * Every expression becomes a C expression over the representation the vm
+ * would hold it in (int64_t, uint64_t, double, bool, a string slice or a pointer),
+ * so arithmetic, comparisons and formatting match `VM::execute` exactly.
+ * The output is a single translation unit carrying its own small runtime
+ * for strings and `log`, and only needs a C99 compiler and libm.
+ *
+ * Every `fun` becomes a static C function taking the called function
+ * value before its parameters, which are the first locals. A function
+ * value points to a `struct lox_closure` holding the code, cast back to
+ * its signature when called, followed by the function's captures, and
+ * variables closures share live in boxes on the heap. Globals live at file
+ * scope.
+ *
+ * An instance is a `struct lox_class_<index>` embedding its superclass's
+ * in front, with a flag per field for whether it was assigned yet. It
+ * starts with the class's method table, `INVOKE`s index it by a slot
+ * overrides share, while `super` calls name the method's C function.
+ *
+ * An array is a `struct lox_array` pointing to its elements at their own
+ * width. Element-wise operations and reductions get a helper per element
+ * type going through the elements in order, which matches the vm's scalar
+ * kernels, float sums of its vector kernels may round differently.
+ *
+ * The program is exported as `void cpplox_run(void)`, a `main` calling it
+ * is emitted unless `CPPLOX_NO_MAIN` is defined when building a shared object.
+ */
+class CBackend {
+public:
+    CBackend(StmtType const& ast)
+        : m_ast { ast }
+    {
+    }
+
+    [[nodiscard]] auto translate() const -> std::string;
+
+    /**
+     * Writes `translate()` next to `output` as `<output>.c` and builds it
+     * with `$CC`, `cc` when unset, into an executable or a shared object.
+     * Returns whether the C compiler succeeded.
+     */
+    [[nodiscard]] auto build(std::filesystem::path const& output, bool shared = false) const -> bool;
+
+private:
+    StmtType const& m_ast;
+};
@@ -1,22 +1,37 @@
 #pragma once
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "ast.hpp"
 #include "code_segment.hpp"
+#include "emitter.hpp"
+#include "fusion.hpp"
 
 class Compiler {
 public:
-    Compiler(StmtType ast)
+    Compiler(StmtType ast, Fusions fusions = Fusions::all())
         : m_ast { std::move(ast) }
+        , m_emitter { fusions }
     {
     }
 
     [[nodiscard]] auto compile() && -> CodeSegment;
 
 private:
-    void m_add_constant(std::unique_ptr<Literal> const& expr);
-    void m_emit_bytes(std::initializer_list<uint8_t> opcodes, std::size_t line_nr);
+    // where the body being emitted finds the variable `binding` resolved to, a lifted function gets its captures passed
+    // in the slots right after the parameters
+    [[nodiscard]] auto m_bind(Binding binding) const -> Binding;
 
     StringTable m_pool;
-    ByteCode m_bc;
     StmtType m_ast;
+    Emitter m_emitter;
+    // functions declared so far with the index `LOAD FUNCTION` refers to them by, their bodies go after the top level code
+    std::vector<std::pair<uint16_t, Fun const*>> m_bodies;
+    // function index of every method, `super` calls and constructors call them directly
+    std::unordered_map<Fun const*, uint16_t> m_methods;
+    // function each class is called through, its body makes the instance and runs `init` on it
+    std::vector<std::pair<uint16_t, Class const*>> m_constructors;
+    // function whose body is being emitted, null in the top level code
+    Fun const* m_fun {};
 };
\ No newline at end of file
@@ -0,0 +1,146 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+
+/**
+ * Division by a constant without a divide instruction.
+ *
+ * A divisor is turned once into a `Divider`, after which every quotient
+ * costs a multiply-high, an add and shifts (or just shifts for powers of
+ * two). Quotients round towards zero and remainders take the dividend's
+ * sign, exactly like the built in operators on 64 bit integers, which is
+ * what the vm computes every integer width in.
+ *
+ * The construction follows Granlund and Montgomery, "Division by
+ * Invariant Integers using Multiplication", in the form libdivide uses.
+ */
+namespace util::divide {
+inline constexpr uint8_t shift_mask      = 0x3F;
+inline constexpr uint8_t add_marker      = 0x40;   // magic needs 65 bits, its top bit is added back separately
+inline constexpr uint8_t negative_marker = 0x80;   // signed divisor is negative
+
+struct Divider {
+    uint64_t magic {};   // zero for powers of two, which only shift
+    uint8_t more {};     // shift plus the markers above
+
+    [[nodiscard]] constexpr auto shift() const noexcept -> uint8_t
+    {
+        return more & shift_mask;
+    }
+    [[nodiscard]] constexpr auto is_power_of_two() const noexcept -> bool
+    {
+        return magic == 0;
+    }
+
+    auto operator==(Divider const&) const -> bool = default;
+};
+
+inline constexpr auto mul_high(uint64_t lhs, uint64_t rhs) noexcept -> uint64_t
+{
+    return static_cast<uint64_t>((static_cast<unsigned __int128>(lhs) * rhs) >> 64);
+}
+
+inline constexpr auto mul_high(int64_t lhs, int64_t rhs) noexcept -> int64_t
+{
+    return static_cast<int64_t>((static_cast<__int128>(lhs) * rhs) >> 64);
+}
+
+// `divisor` must not be zero
+inline constexpr auto unsigned_divider(uint64_t divisor) noexcept -> Divider
+{
+    auto log2 = static_cast<uint8_t>(std::bit_width(divisor) - 1);
+    if (std::has_single_bit(divisor)) {
+        return { 0, log2 };
+    }
+
+    // 2^(64 + log2) / divisor
+    auto dividend  = static_cast<unsigned __int128>(1) << (64 + log2);
+    auto magic     = static_cast<uint64_t>(dividend / divisor);
+    auto remainder = static_cast<uint64_t>(dividend % divisor);
+    if (divisor - remainder < (uint64_t { 1 } << log2)) {
+        return { magic + 1, log2 };
+    }
+    // one more bit of precision, which no longer fits
+    magic += magic;
+    auto twice_remainder = remainder + remainder;
+    if (twice_remainder >= divisor || twice_remainder < remainder) {
+        magic++;
+    }
+    return { magic + 1, static_cast<uint8_t>(log2 | add_marker) };
+}
+
+// `divisor` must be neither zero nor -1, which wraps the least integer around instead of overflowing
+inline constexpr auto signed_divider(int64_t divisor) noexcept -> Divider
+{
+    auto absolute = divisor < 0 ? uint64_t { 0 } - static_cast<uint64_t>(divisor) : static_cast<uint64_t>(divisor);
+    auto log2     = static_cast<uint8_t>(std::bit_width(absolute) - 1);
+    uint8_t sign  = divisor < 0 ? negative_marker : 0;
+    if (std::has_single_bit(absolute)) {
+        return { 0, static_cast<uint8_t>(log2 | sign) };
+    }
+
+    // 2^(63 + log2) / |divisor|
+    auto dividend  = static_cast<unsigned __int128>(1) << (63 + log2);
+    auto magic     = static_cast<uint64_t>(dividend / absolute);
+    auto remainder = static_cast<uint64_t>(dividend % absolute);
+    uint8_t more {};
+    if (absolute - remainder < (uint64_t { 1 } << log2)) {
+        more = log2 - 1;
+    } else {
+        magic += magic;
+        auto twice_remainder = remainder + remainder;
+        if (twice_remainder >= absolute || twice_remainder < remainder) {
+            magic++;
+        }
+        more = log2 | add_marker;
+    }
+    magic++;
+    // a negative divisor negates the magic, the quotient then comes out negated for free
+    return { divisor < 0 ? uint64_t { 0 } - magic : magic, static_cast<uint8_t>(more | sign) };
+}
+
+inline constexpr auto divide(uint64_t dividend, Divider divider) noexcept -> uint64_t
+{
+    if (divider.is_power_of_two()) {
+        return dividend >> divider.shift();
+    }
+    auto quotient = mul_high(divider.magic, dividend);
+    if ((divider.more & add_marker) != 0) {
+        return (((dividend - quotient) >> 1) + quotient) >> divider.shift();
+    }
+    return quotient >> divider.shift();
+}
+
+inline constexpr auto divide(int64_t dividend, Divider divider) noexcept -> int64_t
+{
+    // all zeros or all ones, used to negate without branching
+    auto sign = static_cast<uint64_t>((divider.more & negative_marker) != 0 ? -1 : 0);
+    if (divider.is_power_of_two()) {
+        // round towards zero: bias negative dividends by 2^shift - 1 before the arithmetic shift
+        auto mask     = (uint64_t { 1 } << divider.shift()) - 1;
+        auto biased   = static_cast<uint64_t>(dividend) + ((dividend < 0 ? ~uint64_t {} : 0) & mask);
+        auto quotient = static_cast<uint64_t>(static_cast<int64_t>(biased) >> divider.shift());
+        return static_cast<int64_t>((quotient ^ sign) - sign);
+    }
+    auto quotient = static_cast<uint64_t>(mul_high(static_cast<int64_t>(divider.magic), dividend));
+    if ((divider.more & add_marker) != 0) {
+        quotient += (static_cast<uint64_t>(dividend) ^ sign) - sign;
+    }
+    auto shifted = static_cast<int64_t>(quotient) >> divider.shift();
+    return shifted + (shifted < 0 ? 1 : 0);
+}
+
+// remainders go through the quotient with wrapping arithmetic, `divisor` is what the divider was made from
+inline constexpr auto remainder(uint64_t dividend, Divider divider, uint64_t divisor) noexcept -> uint64_t
+{
+    if (divider.is_power_of_two()) {
+        return dividend & (divisor - 1);
+    }
+    return dividend - divide(dividend, divider) * divisor;
+}
+
+inline constexpr auto remainder(int64_t dividend, Divider divider, int64_t divisor) noexcept -> int64_t
+{
+    return static_cast<int64_t>(static_cast<uint64_t>(dividend) - static_cast<uint64_t>(divide(dividend, divider)) * static_cast<uint64_t>(divisor));
+}
+}
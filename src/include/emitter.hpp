@@ -0,0 +1,124 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ast.hpp"
+#include "code_segment.hpp"
+#include "fusion.hpp"
+#include "instr.hpp"
+
+/**
+ * Appends instructions to a `ByteCode`, shared by every pass producing it.
+ *
+ * Opcodes go through the `LOAD` fusion peephole, so whoever drives the
+ * emitter gets the superinstructions `Fusions` allows for free.
+ */
+class Emitter {
+public:
+    Emitter(Fusions fusions)
+        : m_fusions { fusions }
+    {
+    }
+
+    // emits `LOAD value`, interning strings into `pool`
+    void constant(TypeIndex type_index, TypeVariant value, StringTable& pool, Location location);
+
+    template <typename T>
+    void load(TypeIndex type_index, T value, Location location)
+    {
+        m_last_load = m_bc.code().size();
+        m_emit_bytes({
+                         std::to_underlying(Opcode::LOAD),
+                         static_cast<uint8_t>(type_index),
+                     },
+                     location);
+        for (auto byte : std::bit_cast<std::array<uint8_t, sizeof(T)>>(value)) {
+            m_bc.write_byte(byte, location);
+        }
+    }
+
+    // emits `opcode`, fusing it with the preceding `LOAD` when `m_fusions` allows
+    void opcode(Opcode opcode, Location location);
+    // emits `opcode` followed by the raw bytes of every operand, never fused
+    template <typename... Operands>
+    void instruction(Opcode opcode, Location location, Operands... operands)
+    {
+        m_last_load.reset();
+        m_emit_bytes({ std::to_underlying(opcode) }, location);
+        auto emit_operand = [&](auto operand) {
+            for (auto byte : std::bit_cast<std::array<uint8_t, sizeof(operand)>>(operand)) {
+                m_bc.write_byte(byte, location);
+            }
+        };
+        (emit_operand(operands), ...);
+    }
+    // emits `PICK depth`, copying the value `depth` slots below the top of stack
+    void pick(uint8_t depth, Location location)
+    {
+        instruction(Opcode::PICK, location, depth);
+    }
+
+    // emits `POP count`, dropping that many values off the stack
+    void pop(uint8_t count, Location location)
+    {
+        instruction(Opcode::POP, location, count);
+    }
+    // pushes the variable `binding` resolved to, for a boxed binding the value in the box and otherwise what the slot holds
+    void get(Binding binding, Location location);
+    // assigns the variable `binding` resolved to, the assigned value stays on the stack
+    void set(Binding binding, Location location);
+
+    // emits `opcode` with a placeholder offset, returns the jump for `patch`
+    [[nodiscard]] auto jump(Opcode opcode, Location location) -> std::size_t
+    {
+        instruction(opcode, location, int16_t {});
+        return m_bc.code().size() - 1 - sizeof(int16_t);
+    }
+    // points `jump` at the next instruction emitted
+    void patch(std::size_t jump);
+    // offset the next instruction is emitted at, for a backward jump to come back to
+    [[nodiscard]] auto label() -> std::size_t
+    {
+        m_last_load.reset();   // a jump target starts a new instruction, nothing fuses across it
+        return m_bc.code().size();
+    }
+    // emits a `JUMP` back to `label`
+    void loop(std::size_t label, Location location);
+
+    // index of `signature` in the code's signature table, equal signatures share one
+    [[nodiscard]] auto signature(Signature signature) -> uint16_t;
+    // adds a function to the code, returns the index `LOAD FUNCTION` or `CLOSURE` pushes it by, its body starts at `begin`
+    [[nodiscard]] auto function(std::string name, uint16_t signature, std::vector<SlotType> captures = {}) -> uint16_t;
+    // adds a class to the code, returns the index `NEW` makes instances of it by
+    [[nodiscard]] auto klass(ClassInfo info) -> uint16_t;
+    // index of the field or method `name` in the code's name table, every class shares one
+    [[nodiscard]] auto name(std::string_view name) -> uint16_t;
+    // emits `GET_PROP` or `SET_PROP` of the field `name`, which gets an inline cache of its own
+    void property(Opcode opcode, std::string_view name, Location location);
+    // emits `INVOKE` of the method `name` with that many arguments after the instance, which gets an inline cache of its own
+    void invoke(std::string_view name, uint8_t arguments, Location location);
+    // ends the top level code with `RETURN`, function bodies go after it
+    void halt();
+    // the body of `function` starts at the next instruction
+    void begin(uint16_t function);
+
+    // halts unless `halt` already did, sizing the globals array to every global used
+    [[nodiscard]] auto finish() && -> ByteCode;
+
+private:
+    void m_emit_bytes(std::initializer_list<uint8_t> bytes, Location location);
+    // i16 offset from the end of the jump at `jump` to `target`, reports jumps too far to encode
+    [[nodiscard]] auto m_offset(std::size_t jump, std::size_t target) const -> int16_t;
+
+    ByteCode m_bc;
+    Fusions m_fusions;
+    // offset of the last emitted instruction when it is a `LOAD`, the only candidate for fusion
+    std::optional<std::size_t> m_last_load;
+    std::size_t m_globals {};
+    bool m_is_halted {};
+};
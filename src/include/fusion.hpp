@@ -0,0 +1,40 @@
+#pragma once
+#include <bitset>
+#include <istream>
+#include <optional>
+
+#include "instr.hpp"
+
+/**
+ * Opcodes the compiler may fuse with a directly preceding `LOAD`.
+ *
+ * Every enabled opcode `X` turns `LOAD constant; X` into the `XK`
+ * superinstruction, which dispatches once and never pushes the constant.
+ */
+class Fusions {
+public:
+    // the fixed list: every opcode that has a superinstruction
+    [[nodiscard]] static auto all() noexcept -> Fusions;
+    [[nodiscard]] static auto none() noexcept -> Fusions;
+    /**
+     * Reads the `FIRST SECOND COUNT` pair profile an instrumented vm writes
+     * to `$CPPLOX_OPCODE_PROFILE` and enables every `LOAD; X` pair which
+     * makes up at least `min_share` of all executed pairs.
+     * Empty when the profile can not be parsed.
+     */
+    [[nodiscard]] static auto from_profile(std::istream& profile, double min_share = 0.01) -> std::optional<Fusions>;
+
+    [[nodiscard]] auto fuses(Opcode opcode) const noexcept -> bool
+    {
+        return m_opcodes.test(std::to_underlying(opcode));
+    }
+    void enable(Opcode opcode) noexcept
+    {
+        if (util::opcode::fused(opcode).has_value()) {
+            m_opcodes.set(std::to_underlying(opcode));
+        }
+    }
+
+private:
+    std::bitset<util::opcode::count> m_opcodes;
+};
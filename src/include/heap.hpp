@@ -0,0 +1,384 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <span>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include "string.hpp"
+#include "types.hpp"
+
+// a function value, the index `LOAD FUNCTION` names it by in `ByteCode::functions`
+struct FunctionRef {
+    uint16_t index;
+
+    auto operator==(FunctionRef const&) const -> bool = default;
+};
+struct Closure;
+struct Box;
+struct Instance;
+struct Array;
+
+class Stack {
+public:
+    static constexpr uint16_t max_size = 8'192;
+    // most slots a function's frame takes, its arguments, locals and temporaries, calls keep this much room free
+    static constexpr uint16_t frame_size = 256;
+
+    using value_type = std::variant<bool,
+                                    StringPtr,
+                                    int64_t, uint64_t,
+                                    double,
+                                    FunctionRef,
+                                    Closure const*,
+                                    Box*,
+                                    Instance*,
+                                    Array*>;
+
+    [[nodiscard]] auto top() const noexcept -> value_type
+    {
+        return m_stack[m_sptr - 1];
+    }
+
+    // value `depth` slots below the top, `peek(0)` is `top()`
+    [[nodiscard]] auto peek(std::size_t depth) const noexcept -> value_type
+    {
+        return m_stack[m_sptr - 1 - depth];
+    }
+
+    auto push(value_type value) noexcept -> std::size_t
+    {
+        m_stack[m_sptr] = value;
+        return m_sptr++;
+    }
+
+    auto pop() noexcept -> value_type
+    {
+        return m_stack[--m_sptr];
+    }
+
+    // drops the `count` values on top
+    void drop(std::size_t count) noexcept
+    {
+        m_sptr -= count;
+    }
+
+    // value in slot `index` counted from the bottom, where locals live
+    [[nodiscard]] auto get(std::size_t index) const noexcept -> value_type
+    {
+        return m_stack[index];
+    }
+
+    void set(std::size_t index, value_type value) noexcept
+    {
+        m_stack[index] = value;
+    }
+
+    [[nodiscard]] auto size() const noexcept -> std::size_t
+    {
+        return m_sptr;
+    }
+
+    // the slots below the top, which is all a collection has to scan
+    [[nodiscard]] auto slots() noexcept -> std::span<value_type>
+    {
+        return { m_stack.data(), m_sptr };
+    }
+
+private:
+    std::size_t m_sptr {};
+    std::array<value_type, max_size> m_stack {};
+};
+
+/**
+ * Header of everything `Heap` allocates. `kind` tells which of the structs
+ * deriving from it follows, which the collector needs to find the values
+ * inside without any type information from the program.
+ */
+struct Object {
+    enum class Kind : uint8_t {
+        CLOSURE,
+        BOX,
+        INSTANCE,
+        ARRAY,
+    };
+
+    Kind kind;
+    bool is_old {};          // promoted out of the nursery, or allocated past its end
+    bool is_marked {};       // reached by the running major collection
+    bool is_remembered {};   // written since the last minor collection, while old
+    Object* forward {};      // where the promoting minor collection moved a nursery object
+};
+
+// a function value made by `CLOSURE`, calls find the captured values where they were when it was made
+struct Closure : Object {
+    uint16_t function;   // index into `ByteCode::functions`
+    std::vector<Stack::value_type> captures;
+};
+
+// a variable closures share with the frame declaring it, the frame and every closure hold a pointer to it
+struct Box : Object {
+    Stack::value_type value;
+};
+
+/**
+ * Hidden class of an instance: its class and the fields it got so far, in
+ * the order they were first assigned. Instances assigning the same fields
+ * in the same order share a shape, assigning a field the shape lacks moves
+ * the instance along a transition to the shape with the field appended.
+ */
+struct Shape {
+    uint16_t klass;                                          // index into `ByteCode::classes`
+    std::vector<uint16_t> fields {};                         // name of each of `Instance::fields`
+    std::vector<std::pair<uint16_t, Shape*>> transitions {}; // the shape assigning a new field of that name leads to
+};
+
+// a value made by `NEW`, holding its fields where its shape says
+struct Instance : Object {
+    Shape* shape;
+    std::vector<Stack::value_type> fields {};
+};
+
+/**
+ * A value made by `NEW_ARRAY`, `FILL_ARRAY` or `ELEMENTWISE`. Its elements
+ * are stored unboxed at the width of `element`, one after the other, in a
+ * buffer of their own aligned to a cache line, which is wider than any
+ * vector the kernels load. The buffer never moves, a minor collection only
+ * copies the header pointing to it.
+ */
+struct Array : Object {
+    static constexpr std::size_t alignment = 64;
+    // largest buffer an array may take, making a longer one halts
+    static constexpr std::size_t max_bytes = std::size_t { 1 } << 32;
+
+    struct Free {
+        void operator()(std::byte* data) const noexcept
+        {
+            ::operator delete[](data, std::align_val_t { alignment });
+        }
+    };
+
+    TypeIndex element;
+    std::size_t length;
+    std::unique_ptr<std::byte[], Free> data;
+
+    [[nodiscard]] auto bytes() const noexcept -> std::size_t
+    {
+        return length * util::type::size_of(element);
+    }
+};
+
+
+/**
+ * Distribution of collection pauses in power of two buckets of
+ * nanoseconds, which stays the same size however long the vm runs. A
+ * percentile is the upper bound of the bucket it falls in, so it is off by
+ * at most a factor of two and never above the longest pause.
+ */
+class PauseHistogram {
+public:
+    void record(std::chrono::nanoseconds pause) noexcept;
+
+    [[nodiscard]] auto count() const noexcept -> std::size_t
+    {
+        return m_count;
+    }
+    [[nodiscard]] auto total() const noexcept -> std::chrono::nanoseconds
+    {
+        return m_total;
+    }
+    [[nodiscard]] auto max() const noexcept -> std::chrono::nanoseconds
+    {
+        return m_max;
+    }
+    // pause at least `fraction` of all pauses were no longer than, zero before the first one
+    [[nodiscard]] auto percentile(double fraction) const noexcept -> std::chrono::nanoseconds;
+
+private:
+    std::array<std::size_t, 65> m_buckets {};   // bucket `b` counts pauses whose nanoseconds are `b` bits wide
+    std::size_t m_count {};
+    std::chrono::nanoseconds m_total {};
+    std::chrono::nanoseconds m_max {};
+};
+
+/**
+ * Generational heap of the values a running program makes: closures,
+ * boxes, instances, arrays and the strings concatenation adds to the pool.
+ *
+ * Objects start out in a bump allocated nursery. A minor collection copies
+ * the ones reachable from the roots, or from an old object written since
+ * the last one, out to the old space and resets the nursery, so the cost
+ * only grows with what survives.
+ *
+ * The old space is mark-sweep, done incrementally so no single pause
+ * grows with it. Once it doubles in size after a minor collection, a major
+ * collection starts marking from the roots and every later call of
+ * `collect` scans at most `mark_budget` objects. An old object written
+ * after marking scanned it gets scanned again, and marking finishes with
+ * a minor collection and a rescan of the roots, which nothing guards. The
+ * sweep then frees `sweep_budget` dead objects and strings at a time. What
+ * gets promoted while a major collection runs counts as reached.
+ *
+ * The buffers of arrays live outside of both spaces and count towards
+ * them by their bytes: the young ones filling `nursery_bytes` make a minor
+ * collection due, the old ones growing past what survived the last major
+ * collection twice over start the next one.
+ *
+ * Strings are nodes of the pool the bytecode's constants point into and
+ * compare by address, so they never move: a concatenation interning a new
+ * string registers it with `track`, one that dies young is erased from the
+ * pool by the next minor collection and one that survives is left to the
+ * major ones. Constants are never tracked, so never collected.
+ *
+ * Roots are every value the vm holds outside the heap, found precisely by
+ * their variant alternative. Collections only run when the vm calls
+ * `collect` at a point where every live value is in one of the roots it
+ * passes, so allocation itself never collects: a nursery filling up, or
+ * an allocation while a major collection runs, only makes
+ * `is_collection_due` true. Stores into an existing object go through
+ * `write`, which remembers the old objects that could now point into the
+ * nursery.
+ */
+class Heap {
+public:
+    static constexpr std::size_t nursery_size = 256 * 1'024;   // bytes
+    // most strings the nursery keeps before a collection is due, they live in the pool instead of the nursery
+    static constexpr std::size_t nursery_strings = 4'096;
+    // fewest old objects and strings there are before a major collection, whatever survived the last one
+    static constexpr std::size_t major_threshold = 16'384;
+    // most bytes the buffers of young arrays take before a collection is due
+    static constexpr std::size_t nursery_bytes = 4 * 1'024 * 1'024;
+    // fewest bytes the buffers of old arrays take before a major collection, whatever survived the last one
+    static constexpr std::size_t major_bytes = 16 * 1'024 * 1'024;
+    // most old objects one step of marking scans
+    static constexpr std::size_t mark_budget = 1'024;
+    // most old objects, and separately strings, one step of sweeping looks at
+    static constexpr std::size_t sweep_budget = 4'096;
+
+    enum class Phase : uint8_t {
+        IDLE,
+        MARKING,
+        SWEEPING,
+    };
+
+    explicit Heap(StringTable& pool);
+    Heap(Heap const&)                    = delete;
+    auto operator=(Heap const&) -> Heap& = delete;
+    ~Heap();
+
+    auto make_closure(uint16_t function, std::vector<Stack::value_type> captures) -> Closure*;
+    auto make_box(Stack::value_type value) -> Box*;
+    auto make_instance(Shape* shape) -> Instance*;
+    // an array of `length` elements of type `element`, left for whoever made it to fill
+    auto make_array(TypeIndex element, std::size_t length) -> Array*;
+    // takes over a string a concatenation just added to the pool
+    void track(StringPtr string);
+    // frees every object and every string it took over, leaving the heap as it was made apart from its statistics
+    void clear();
+
+    // write barrier, called whenever a value is stored into `object` after it was made
+    void write(Object& object)
+    {
+        if (object.is_old && (!object.is_remembered || m_phase == Phase::MARKING)) {
+            m_write(object);
+        }
+    }
+
+    [[nodiscard]] auto is_collection_due() const noexcept -> bool
+    {
+        return m_is_due;
+    }
+    // collects the nursery, only when it is full while a major collection runs, and takes the next step of the major
+    // collection, starting one when the old space grew enough, updating the values in `roots` to where their objects
+    // moved
+    void collect(std::initializer_list<std::span<Stack::value_type>> roots);
+
+    [[nodiscard]] auto phase() const noexcept -> Phase
+    {
+        return m_phase;
+    }
+    [[nodiscard]] auto minor_collections() const noexcept -> std::size_t
+    {
+        return m_minor_collections;
+    }
+    // major collections started, the last one may still be running
+    [[nodiscard]] auto major_collections() const noexcept -> std::size_t
+    {
+        return m_major_collections;
+    }
+    // how long every call of `collect` took
+    [[nodiscard]] auto pauses() const noexcept -> PauseHistogram const&
+    {
+        return m_pauses;
+    }
+    // objects and strings the heap holds, dead ones included until the collection freeing them
+    [[nodiscard]] auto size() const noexcept -> std::size_t
+    {
+        return m_nursery_objects + m_old.size() + m_strings.size();
+    }
+    // bytes the buffers of arrays take, dead ones included until the collection freeing them
+    [[nodiscard]] auto array_bytes() const noexcept -> std::size_t
+    {
+        return m_young_bytes + m_old_bytes;
+    }
+
+private:
+    struct String {
+        StringPtr string;
+        bool is_old {};
+        bool is_marked {};
+    };
+
+    template <typename T>
+    auto m_allocate(T object) -> T*;
+    // runs the destructor of every object and frees the old ones
+    void m_free();
+    [[nodiscard]] auto m_is_nursery_full() const noexcept -> bool;
+    void m_write(Object& object);
+    // an object entering the old space while a major collection runs, which has to treat it as reached
+    void m_enter_old(Object& object);
+    void m_minor(std::initializer_list<std::span<Stack::value_type>> roots);
+    void m_start_marking(std::initializer_list<std::span<Stack::value_type>> roots);
+    void m_mark_step(std::initializer_list<std::span<Stack::value_type>> roots);
+    void m_sweep_step();
+    // moves a nursery object `value` points to into the old space, unless that already happened, and points `value`
+    // there, a young string it is gets promoted in place
+    void m_evacuate(Stack::value_type& value);
+    // marks the old object or string `value` is, leaving nursery objects to the minor collection ending marking
+    void m_mark(Stack::value_type const& value);
+    // every value stored in `object`
+    static auto m_slots(Object& object) -> std::span<Stack::value_type>;
+    // runs the destructor of `object`, returning the size of its nursery cell
+    static auto m_destroy(Object& object) -> std::size_t;
+
+    StringTable& m_pool;
+    std::unique_ptr<std::byte[]> m_nursery;
+    std::size_t m_top {};               // first free byte of the nursery
+    std::size_t m_nursery_objects {};   // allocated since the last minor collection
+    std::vector<Object*> m_old;
+    std::vector<Object*> m_remembered;
+    std::vector<Object*> m_promoted;   // by the running minor collection, their values are yet to be scanned
+    std::vector<Object*> m_gray;       // marked, their values are yet to be scanned
+    // every string `track` took over, by the address of its node, the ones taken over since the last minor and the
+    // ones which survived one
+    std::unordered_map<std::string const*, String> m_strings;
+    std::vector<std::string const*> m_young_strings;
+    std::vector<std::string const*> m_old_strings;
+    Phase m_phase { Phase::IDLE };
+    std::size_t m_swept_objects {};   // `m_old` before this index is swept
+    std::size_t m_swept_strings {};   // `m_old_strings` before this index is swept
+    std::size_t m_next_major { major_threshold };
+    std::size_t m_young_bytes {};   // of the buffers of arrays in the nursery
+    std::size_t m_old_bytes {};     // of the buffers of arrays in the old space
+    std::size_t m_next_major_bytes { major_bytes };
+    bool m_is_due {};
+    std::size_t m_minor_collections {};
+    std::size_t m_major_collections {};
+    PauseHistogram m_pauses;
+};
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
 #ifndef NDEBUG
 #include <iostream>
@@ -6,8 +7,12 @@
 #else
 #include <utility>
 #endif
+#include <optional>
 #include <string_view>
 
+#include "bytecode.hpp"
+#include "types.hpp"
+
 enum class Opcode : uint8_t {
     LOG,
     ADD,
@@ -20,11 +25,82 @@ enum class Opcode : uint8_t {
     LOAD,
     NEGATE,
     NOT,
-    RETURN,
+    PICK,   // one operand byte: how many slots below the top of stack the copied value sits
+
+    // variables, resolved at compile time so no name is ever looked up while running
+    POP,          // u8 count: drops that many values off the stack
+    GET_LOCAL,    // u8 slot: pushes the stack slot counted from the bottom of the running function's frame
+    SET_LOCAL,    // u8 slot: copies the top of stack into the slot, leaving it on the stack
+    GET_GLOBAL,   // u16 index: pushes the global
+    SET_GLOBAL,   // u16 index: copies the top of stack into the global, leaving it on the stack
+
+    // control flow, every jump takes an i16 offset counted from the end of the jump
+    JUMP,
+    JUMP_IF_FALSE,          // pops the condition
+    JUMP_IF_FALSE_OR_POP,   // `and`: keeps the condition as the result when jumping, pops it otherwise
+    JUMP_IF_TRUE_OR_POP,    // `or`: keeps the condition as the result when jumping, pops it otherwise
+    // compare and branch, pop both operands and jump when `lhs relation rhs` holds
+    JLT,
+    JLE,
+    JGT,
+    JGE,
+    JEQ,
+    JNE,
+
+    // integer arithmetic by a constant, operands as `util::divide::Divider` lays them out
+    SHL,     // u8 shift: multiply by 2^shift
+    DIVP2,   // u8 more: divide by a power of two
+    MODP2,   // u8 more: remainder by a power of two
+    DIVM,    // u8 more, u64 magic: divide by multiplying high
+    MODM,    // u8 more, u64 magic, u64 divisor: remainder by multiplying high
+
+    // superinstructions, `LOAD constant` fused into the opcode after it, operands laid out like `LOAD`
+    ADDK,
+    SUBK,
+    MULK,
+    DIVK,
+    MODK,
+    CMPK,
+    CMPEK,
+    LOGK,
+
+    // functions, a call's frame starts right above the callee, with its arguments as the first locals
+    CALL,        // u8 count: calls the function below that many arguments, which are replaced by its result
+    TAIL_CALL,   // u8 count: the same but in place of the running function, whose frame it reuses
+    GET_CALLEE,  // pushes the running function, how a function names itself without capturing its own closure
+
+    // closures hold a flat copy of every variable they capture, one that changes afterwards is shared through a box
+    CLOSURE,             // u16 function: replaces the function's captures on top of the stack by a closure over them
+    GET_CAPTURE,         // u8 index: pushes the running closure's capture
+    GET_BOXED_CAPTURE,   // u8 index: pushes the value in the box the running closure captured
+    SET_BOXED_CAPTURE,   // u8 index: copies the top of stack into the captured box, leaving it on the stack
+    BOX,                 // u8 slot: moves the local's value into a new box
+    GET_BOXED,           // u8 slot: pushes the value in the local's box
+    SET_BOXED,           // u8 slot: copies the top of stack into the local's box, leaving it on the stack
+
+    // instances, every property access caches what it found for the last shapes it saw
+    NEW,        // u16 class: pushes an instance without any field
+    GET_PROP,   // u16 name, u16 cache: replaces the instance on top of the stack by its field
+    SET_PROP,   // u16 name, u16 cache: assigns the top of stack to the field of the instance below
+    INVOKE,     // u16 name, u8 count, u16 cache: calls the method of the instance below that many arguments
+
+    // arrays, holding their elements unboxed in one aligned buffer
+    NEW_ARRAY,     // u8 type, u16 count: replaces that many values by an array of them
+    FILL_ARRAY,    // u8 type: replaces a value and a length by an array of that many copies
+    GET_INDEX,     // replaces an array and an index by the element
+    SET_INDEX,     // assigns the top of stack to the element of the array and index below
+    ELEMENTWISE,   // u8 op: replaces two arrays of one length by the array of what `op` gives
+    REDUCE,        // u8 op: replaces an array by the sum, least or greatest of its elements
+    LENGTH,        // replaces an array by its length
+
+    RETURN,   // halts in the top level code, in a function hands the top of stack back to the caller
 };
 
 namespace util::opcode {
-auto to_string(Opcode opcode) -> std::string_view
+// number of opcodes, RETURN is always kept as the last one
+inline constexpr std::size_t count = static_cast<std::size_t>(Opcode::RETURN) + 1;
+
+inline auto to_string(Opcode opcode) -> std::string_view
 {
     switch (opcode) {
         using enum Opcode;
@@ -38,8 +114,58 @@ auto to_string(Opcode opcode) -> std::string_view
         case LOAD: return "LOAD";
         case NEGATE: return "NEGATE";
         case NOT: return "NOT";
+        case PICK: return "PICK";
+        case POP: return "POP";
+        case GET_LOCAL: return "GET_LOCAL";
+        case SET_LOCAL: return "SET_LOCAL";
+        case GET_GLOBAL: return "GET_GLOBAL";
+        case SET_GLOBAL: return "SET_GLOBAL";
+        case JUMP: return "JUMP";
+        case JUMP_IF_FALSE: return "JUMP_IF_FALSE";
+        case JUMP_IF_FALSE_OR_POP: return "JUMP_IF_FALSE_OR_POP";
+        case JUMP_IF_TRUE_OR_POP: return "JUMP_IF_TRUE_OR_POP";
+        case JLT: return "JLT";
+        case JLE: return "JLE";
+        case JGT: return "JGT";
+        case JGE: return "JGE";
+        case JEQ: return "JEQ";
+        case JNE: return "JNE";
+        case SHL: return "SHL";
+        case DIVP2: return "DIVP2";
+        case MODP2: return "MODP2";
+        case DIVM: return "DIVM";
+        case MODM: return "MODM";
+        case CALL: return "CALL";
+        case TAIL_CALL: return "TAIL_CALL";
+        case GET_CALLEE: return "GET_CALLEE";
+        case CLOSURE: return "CLOSURE";
+        case GET_CAPTURE: return "GET_CAPTURE";
+        case GET_BOXED_CAPTURE: return "GET_BOXED_CAPTURE";
+        case SET_BOXED_CAPTURE: return "SET_BOXED_CAPTURE";
+        case BOX: return "BOX";
+        case GET_BOXED: return "GET_BOXED";
+        case SET_BOXED: return "SET_BOXED";
+        case NEW: return "NEW";
+        case GET_PROP: return "GET_PROP";
+        case SET_PROP: return "SET_PROP";
+        case INVOKE: return "INVOKE";
+        case NEW_ARRAY: return "NEW_ARRAY";
+        case FILL_ARRAY: return "FILL_ARRAY";
+        case GET_INDEX: return "GET_INDEX";
+        case SET_INDEX: return "SET_INDEX";
+        case ELEMENTWISE: return "ELEMENTWISE";
+        case REDUCE: return "REDUCE";
+        case LENGTH: return "LENGTH";
         case RETURN: return "RETURN";
         case LOG: return "LOG";
+        case ADDK: return "ADDK";
+        case SUBK: return "SUBK";
+        case MULK: return "MULK";
+        case DIVK: return "DIVK";
+        case MODK: return "MODK";
+        case CMPK: return "CMPK";
+        case CMPEK: return "CMPEK";
+        case LOGK: return "LOGK";
     }
 #ifndef NDEBUG
     std::println(std::cerr, "[DEBUG] Unknown opcode");
@@ -47,4 +173,130 @@ auto to_string(Opcode opcode) -> std::string_view
     std::unreachable();
 #endif
 }
-}
\ No newline at end of file
+
+// inverse of `to_string`, used when reading opcode profiles back
+inline auto from_string(std::string_view name) noexcept -> std::optional<Opcode>
+{
+    for (std::size_t opcode {}; opcode < count; opcode++) {
+        if (to_string(static_cast<Opcode>(opcode)) == name) {
+            return static_cast<Opcode>(opcode);
+        }
+    }
+    return {};
+}
+
+// superinstruction executing `LOAD constant; opcode`, if there is one
+inline constexpr auto fused(Opcode opcode) noexcept -> std::optional<Opcode>
+{
+    switch (opcode) {
+        using enum Opcode;
+        case ADD: return ADDK;
+        case SUB: return SUBK;
+        case MUL: return MULK;
+        case DIV: return DIVK;
+        case MOD: return MODK;
+        case CMP: return CMPK;
+        case CMPE: return CMPEK;
+        case LOG: return LOGK;
+        default: return {};
+    }
+}
+
+// opcode a superinstruction applies after loading its constant, `opcode` itself for every other opcode
+inline constexpr auto unfused(Opcode opcode) noexcept -> Opcode
+{
+    switch (opcode) {
+        using enum Opcode;
+        case ADDK: return ADD;
+        case SUBK: return SUB;
+        case MULK: return MUL;
+        case DIVK: return DIV;
+        case MODK: return MOD;
+        case CMPK: return CMP;
+        case CMPEK: return CMPE;
+        case LOGK: return LOG;
+        default: return opcode;
+    }
+}
+
+// whether `opcode` is followed by an i16 jump offset
+inline constexpr auto is_jump(Opcode opcode) noexcept -> bool
+{
+    return opcode >= Opcode::JUMP && opcode <= Opcode::JNE;
+}
+
+// whether `opcode` is a compare and branch, which pops two operands
+inline constexpr auto is_compare_jump(Opcode opcode) noexcept -> bool
+{
+    return opcode >= Opcode::JLT && opcode <= Opcode::JNE;
+}
+
+// whether `opcode` is followed by a type byte and a constant, like `LOAD` is
+inline constexpr auto has_constant(Opcode opcode) noexcept -> bool
+{
+    return opcode == Opcode::LOAD || unfused(opcode) != opcode;
+}
+
+/**
+ * Size in bytes of the instruction starting at `offset`.
+ *
+ * This is the only place which knows how many operand bytes follow each
+ * opcode, everything walking over bytecode should advance through it.
+ */
+inline auto length(ByteCode const& bc, std::size_t offset) noexcept -> std::size_t
+{
+    auto opcode = static_cast<Opcode>(bc.code()[offset]);
+    if (has_constant(opcode)) {
+        return 2 + util::type::size_of(util::type::get_type(bc.code()[offset + 1]));
+    }
+    switch (opcode) {
+        using enum Opcode;
+        case PICK:
+        case POP:
+        case GET_LOCAL:
+        case SET_LOCAL:
+        case SHL:
+        case DIVP2:
+        case MODP2:
+        case CALL:
+        case TAIL_CALL:
+        case GET_CAPTURE:
+        case GET_BOXED_CAPTURE:
+        case SET_BOXED_CAPTURE:
+        case BOX:
+        case GET_BOXED:
+        case SET_BOXED:
+        case FILL_ARRAY:
+        case ELEMENTWISE:
+        case REDUCE: return 2;
+        case GET_GLOBAL:
+        case SET_GLOBAL:
+        case CLOSURE:
+        case NEW: return 1 + sizeof(uint16_t);
+        case GET_PROP:
+        case SET_PROP: return 1 + 2 * sizeof(uint16_t);
+        case INVOKE: return 2 + 2 * sizeof(uint16_t);
+        case NEW_ARRAY: return 2 + sizeof(uint16_t);
+        case JUMP:
+        case JUMP_IF_FALSE:
+        case JUMP_IF_FALSE_OR_POP:
+        case JUMP_IF_TRUE_OR_POP:
+        case JLT:
+        case JLE:
+        case JGT:
+        case JGE:
+        case JEQ:
+        case JNE: return 1 + sizeof(int16_t);
+        case DIVM: return 2 + sizeof(uint64_t);
+        case MODM: return 2 + 2 * sizeof(uint64_t);
+        default: return 1;
+    }
+}
+
+// offset the jump at `offset` lands on, which may lie outside the code when the bytecode is malformed
+inline auto jump_target(ByteCode const& bc, std::size_t offset) noexcept -> std::ptrdiff_t
+{
+    auto end = static_cast<std::ptrdiff_t>(offset + 1 + sizeof(int16_t));
+    return end + bc.read_value<int16_t>(offset + 1);
+}
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "bytecode.hpp"
+#include "verifier.hpp"
+
+/**
+ * Baseline template jit for x86-64.
+ *
+ * `compile` walks the bytecode once and copies a pre-assembled machine
+ * code template per opcode, specialised by the operand representation,
+ * into an executable mapping. Constants are patched into the templates as
+ * immediates and the operand stack lives on the native stack, so nothing
+ * is decoded or dispatched at runtime.
+ *
+ * Jumps become native jumps with 32 bit displacements, compare and branch
+ * opcodes a single `cmp` or `ucomisd` and a conditional jump for the
+ * operands' representation. Integer divisions compare their operands and
+ * branch to a stub halting the run before they would trap.
+ *
+ * Types are tracked abstractly while compiling, every jump to a target
+ * has to agree on the types of the operand stack. Any opcode or type
+ * without a template, currently everything touching strings or functions,
+ * makes `compile` return empty and the caller runs the program on `VM`
+ * instead.
+ */
+class Jit {
+public:
+    [[nodiscard]] static auto compile(ByteCode const& bc) -> std::optional<Jit>;
+
+    Jit(Jit const&)                    = delete;
+    auto operator=(Jit const&) -> Jit& = delete;
+    Jit(Jit&& other) noexcept;
+    auto operator=(Jit&& other) noexcept -> Jit&;
+    ~Jit();
+
+    void execute();
+    // why the last run stopped before reaching the end, the offset is the bytecode's
+    [[nodiscard]] auto error() const noexcept -> std::optional<BytecodeError> const&
+    {
+        return m_error;
+    }
+    // bytes of machine code generated
+    [[nodiscard]] auto size() const noexcept -> std::size_t
+    {
+        return m_size;
+    }
+
+private:
+    Jit(void* code, std::size_t size, std::vector<BytecodeError> halts) noexcept
+        : m_code { code }
+        , m_size { size }
+        , m_halts { std::move(halts) }
+    {
+    }
+
+    void* m_code {};
+    std::size_t m_size {};
+    // what the code stopped at, by the index it returns minus one
+    std::vector<BytecodeError> m_halts;
+    std::optional<BytecodeError> m_error;
+};
@@ -9,6 +9,7 @@ public:
         : m_source { source }
         , m_start { source.begin() }
         , m_curr { source.begin() }
+        , m_line_start { source.begin() }
     {
     }
 
@@ -33,11 +34,15 @@ private:
     // If matched emit a token of the given type
     [[nodiscard]] auto m_match_kwd(std::size_t offset, std::string_view expected, TokenType type) noexcept -> Token;
     void m_skip_whitespace() noexcept;
+    [[nodiscard]] auto m_column() const noexcept -> std::size_t;
+    // moves on to the line after the '\n' at `m_curr`
+    void m_newline() noexcept;
     [[nodiscard]] auto m_is_end() const noexcept -> bool;
 
     std::string_view m_source;
     std::string_view::const_iterator m_start { nullptr };
     std::string_view::const_iterator m_curr { nullptr };
     std::vector<Token> m_tokens;
+    std::string_view::const_iterator m_line_start { nullptr };   // first character of the current line
     std::size_t m_line { 1 };
 };
\ No newline at end of file
@@ -0,0 +1,174 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// source position code comes from, columns count from 1 and 0 stands for an unknown column
+struct Location {
+    constexpr Location(std::size_t line_nr = 0, std::size_t column_nr = 0) noexcept
+        : line { line_nr }
+        , column { column_nr }
+    {
+    }
+
+    std::size_t line;
+    std::size_t column;
+
+    auto operator==(Location const&) const -> bool = default;
+};
+
+namespace util {
+/**
+ * Maps code offsets back to source locations.
+ *
+ * Only offsets where the location changes get an entry. Entries are
+ * grouped into blocks of `block_size`: a block keeps its first entry in
+ * full in `m_blocks`, the rest are varint encoded deltas to the entry
+ * before them in `m_deltas`. A lookup binary searches the blocks and
+ * decodes at most one block, so nothing is decoded until an error or the
+ * profiler asks for a location, while most entries take three bytes.
+ */
+class LineTable {
+public:
+    static constexpr std::size_t block_size = 16;
+
+    struct Entry {
+        std::size_t offset;
+        Location location;
+    };
+
+    // code from `offset` on comes from `location`, offsets are written in increasing order
+    void write(std::size_t offset, Location location)
+    {
+        if (m_entries != 0 && m_last.location == location) {
+            return;
+        }
+        if (m_entries % block_size == 0) {
+            m_blocks.push_back({ static_cast<uint32_t>(offset),
+                                 static_cast<uint32_t>(location.line),
+                                 static_cast<uint32_t>(location.column),
+                                 static_cast<uint32_t>(m_deltas.size()) });
+        } else {
+            m_write_varint(offset - m_last.offset);
+            m_write_varint(m_zigzag(location.line, m_last.location.line));
+            m_write_varint(m_zigzag(location.column, m_last.location.column));
+        }
+        m_last = { offset, location };
+        m_entries++;
+    }
+
+    // location of the code at `offset`, line 0 when nothing was written
+    [[nodiscard]] auto read(std::size_t offset) const noexcept -> Location
+    {
+        if (m_blocks.empty()) {
+            return {};
+        }
+        auto block = std::ranges::upper_bound(m_blocks, offset, {}, &Block::offset);
+        if (block != m_blocks.begin()) {
+            block--;
+        }
+
+        Entry entry { block->offset, { block->line, block->column } };
+        auto end = std::next(block) != m_blocks.end() ? std::next(block)->deltas : m_deltas.size();
+        for (std::size_t position = block->deltas; position < end;) {
+            auto next = m_decode(entry, position);
+            if (next.offset > offset) {
+                break;
+            }
+            entry = next;
+        }
+        return entry.location;
+    }
+
+    [[nodiscard]] auto read_line_number(std::size_t offset) const noexcept -> std::size_t
+    {
+        return read(offset).line;
+    }
+
+    // location of the last entry written
+    [[nodiscard]] auto last() const noexcept -> Location
+    {
+        return m_last.location;
+    }
+
+    // every entry in order, for tools listing a whole program
+    [[nodiscard]] auto decode() const -> std::vector<Entry>
+    {
+        std::vector<Entry> entries;
+        entries.reserve(m_entries);
+        for (std::size_t index {}; index < m_blocks.size(); index++) {
+            auto const& block = m_blocks[index];
+            entries.push_back({ block.offset, { block.line, block.column } });
+            auto end = index + 1 < m_blocks.size() ? m_blocks[index + 1].deltas : m_deltas.size();
+            for (std::size_t position = block.deltas; position < end;) {
+                entries.push_back(m_decode(entries.back(), position));
+            }
+        }
+        return entries;
+    }
+
+    [[nodiscard]] auto entries() const noexcept -> std::size_t
+    {
+        return m_entries;
+    }
+
+    // bytes the encoded table occupies
+    [[nodiscard]] auto bytes() const noexcept -> std::size_t
+    {
+        return m_blocks.size() * sizeof(Block) + m_deltas.size();
+    }
+
+private:
+    // first entry of a block in full, `deltas` indexes where the block's remaining entries start
+    struct Block {
+        uint32_t offset;
+        uint32_t line;
+        uint32_t column;
+        uint32_t deltas;
+    };
+
+    // lines and columns can go back, zigzag encoding keeps small negative deltas small
+    static constexpr auto m_zigzag(std::size_t value, std::size_t previous) noexcept -> uint64_t
+    {
+        auto delta = static_cast<int64_t>(value - previous);
+        return (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63);
+    }
+    static constexpr auto m_unzigzag(std::size_t previous, uint64_t value) noexcept -> std::size_t
+    {
+        return previous + static_cast<std::size_t>((value >> 1) ^ (0 - (value & 1)));
+    }
+
+    // 7 bits per byte, the high bit marks that another byte follows
+    void m_write_varint(uint64_t value)
+    {
+        for (; value >= 0x80; value >>= 7) {
+            m_deltas.push_back(static_cast<uint8_t>(value | 0x80));
+        }
+        m_deltas.push_back(static_cast<uint8_t>(value));
+    }
+    [[nodiscard]] auto m_read_varint(std::size_t& position) const noexcept -> uint64_t
+    {
+        uint64_t value {};
+        for (unsigned shift {};; shift += 7) {
+            auto byte = m_deltas[position++];
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+    }
+    // entry following `previous` whose deltas start at `position`, which moves past them
+    [[nodiscard]] auto m_decode(Entry const& previous, std::size_t& position) const noexcept -> Entry
+    {
+        auto offset = previous.offset + m_read_varint(position);
+        auto line   = m_unzigzag(previous.location.line, m_read_varint(position));
+        auto column = m_unzigzag(previous.location.column, m_read_varint(position));
+        return { offset, { line, column } };
+    }
+
+    std::vector<Block> m_blocks;
+    std::vector<uint8_t> m_deltas;
+    Entry m_last {};
+    std::size_t m_entries {};
+};
+}
@@ -1,6 +1,10 @@
 #pragma once
 #include "code_segment.hpp"
+#include "register_code.hpp"
+#include "wordcode.hpp"
 
 struct Logger {
     static void log(CodeSegment const& code_pair);
+    static void log(RegisterSegment const& code_pair);
+    static void log(WordSegment const& code_pair);
 };
\ No newline at end of file
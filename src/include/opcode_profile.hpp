@@ -0,0 +1,93 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "instr.hpp"
+
+/**
+ * Per opcode execution counts, cycle totals and opcode pair frequencies.
+ *
+ * Only compiled into the vm when configured with `-DCPPLOX_INSTRUMENT_VM=ON`.
+ * A single process wide profile aggregates every vm run and prints its
+ * table to stderr at exit. Setting `CPPLOX_OPCODE_PROFILE=<path>` also
+ * dumps the pair frequencies to `<path>`, which the compiler can read back
+ * to pick superinstructions.
+ */
+class OpcodeProfile {
+public:
+    // Records a single instruction: counted on construction, timed until destruction
+    class Probe {
+    public:
+        Probe(OpcodeProfile& profile, Opcode opcode) noexcept
+            : m_profile { profile }
+            , m_opcode { opcode }
+            , m_start { read_cycles() }
+        {
+        }
+        Probe(Probe const&)                    = delete;
+        auto operator=(Probe const&) -> Probe& = delete;
+        ~Probe()
+        {
+            m_profile.m_cycles[static_cast<std::size_t>(m_opcode)] += read_cycles() - m_start;
+        }
+
+    private:
+        OpcodeProfile& m_profile;
+        Opcode m_opcode;
+        uint64_t m_start;
+    };
+
+    OpcodeProfile() = default;
+    OpcodeProfile(OpcodeProfile const&)                    = delete;
+    auto operator=(OpcodeProfile const&) -> OpcodeProfile& = delete;
+    ~OpcodeProfile();
+
+    [[nodiscard]] auto probe(Opcode opcode) noexcept -> Probe
+    {
+        auto index = static_cast<std::size_t>(opcode);
+        m_counts[index]++;
+        if (m_prev < util::opcode::count) {
+            m_pairs[m_prev][index]++;
+        }
+        m_prev = index;
+        return Probe { *this, opcode };
+    }
+    // a run starts, so its first opcode pairs with nothing the last run executed
+    void start() noexcept
+    {
+        m_prev = util::opcode::count;
+    }
+
+    [[nodiscard]] auto count(Opcode opcode) const noexcept -> uint64_t
+    {
+        return m_counts[static_cast<std::size_t>(opcode)];
+    }
+    // how often `second` was executed right after `first` in the same run
+    [[nodiscard]] auto pairs(Opcode first, Opcode second) const noexcept -> uint64_t
+    {
+        return m_pairs[static_cast<std::size_t>(first)][static_cast<std::size_t>(second)];
+    }
+
+    // rdtsc where available, otherwise steady clock ticks
+    static auto read_cycles() noexcept -> uint64_t
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+    }
+
+    void print() const;
+    void dump_pairs(char const* path) const;
+
+private:
+    std::array<uint64_t, util::opcode::count> m_counts {};
+    std::array<uint64_t, util::opcode::count> m_cycles {};
+    std::array<std::array<uint64_t, util::opcode::count>, util::opcode::count> m_pairs {};
+    std::size_t m_prev { util::opcode::count };
+};
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string_view>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -20,7 +22,7 @@ class Parser {
         TERM,         // + -
         FACTOR,       // * /
         UNARY,        // ! -
-        CALL,         // . ()
+        CALL,         // . () []
         PRIMARY
     };
 
@@ -32,13 +34,44 @@ class Parser {
         Precedence precedence;
     };
 
+    // a declared variable, only the parser ever looks variables up by name
+    struct Symbol {
+        std::string_view name;
+        Type type;
+        Binding binding;
+        std::size_t depth;      // blocks the variable is nested in, 0 for globals
+        std::size_t function;   // function bodies the variable is declared in, 0 for the top level code
+        Fun* declaration {};    // the `fun` statement declaring a local function, null for everything else
+        // every `Binding::boxed` naming the local, they all get set once it turns out closures need to share it
+        std::vector<bool*> boxes {};
+        std::size_t first_capture {};   // `m_order` of the first and the last capture by a closure, 0 when there is none
+        std::size_t last_capture {};
+        std::size_t assigned {};        // `m_order` of the last assignment
+        bool is_boxed {};               // assigned after a capture in an earlier iteration of a loop
+    };
+
+    // a function body being parsed
+    struct Enclosing {
+        Fun* node;                           // collects the variables the body captures
+        std::vector<std::size_t> captured;   // index into `m_locals` of each of the node's captures
+        ClassType const* klass {};           // the class a method belongs to, null for a function
+        bool is_initializer {};              // whether the body is `init`, which returns the instance by itself
+    };
+
 public:
-    Parser(std::vector<Token> tokens);
+    // a global the host binds before the program runs, which the program reads like any other global
+    struct Input {
+        std::string_view name;   // has to outlive the parser like the source the tokens point into
+        Type type;
+    };
+
+    // `inputs` take the first globals in order, ahead of the ones the program declares
+    Parser(std::vector<Token> tokens, std::vector<Input> const& inputs = {});
 
     // optional return type: when no value is returned means parsing failed
     auto parse() -> std::optional<StmtType>
     {
-        m_declaration();
+        m_program();
         if (m_is_parsed) {
             return std::move(m_stmt);
         }
@@ -46,12 +79,39 @@ public:
     }
 
 private:
-    // root function which starts the parser
+    // root function which starts the parser, the program is a block of declarations ending at the end of the source
+    void m_program();
+    // parse a declaration or any other statement
     void m_declaration();
+    // let name [: type] = initializer;
+    void m_let_declaration();
+    // fun name ( [parameter : type [, parameter : type]*] ) : type { declaration* }
+    void m_fun_declaration();
+    // class name [< superclass] { [field : type ; | method ( parameters ) : type { declaration* }]* }
+    // `init ( parameters ) { declaration* }` initializes the instance a call of the class makes
+    void m_class_declaration();
+    // [parameter : type [, parameter : type]*] ) appending to `signature` and `names`, false after an error
+    auto m_parameters(FunctionType& signature, std::vector<std::vector<Token>::const_iterator>& names) -> bool;
+    // declaration* } of `node`, in a frame of its own whose first slots hold the parameters named by `parameters`
+    void m_function_body(Fun& node, std::vector<std::vector<Token>::const_iterator> const& parameters, Enclosing enclosing);
     // parent function for parsing all kinds of statements
     void m_statement();
     // parse log statements
     void m_log_statement();
+    // { declaration* }
+    void m_block();
+    // expression;
+    void m_expression_statement();
+    // if ( condition ) statement [else statement]
+    void m_if_statement();
+    // while ( condition ) statement
+    void m_while_statement();
+    // for ( initializer; condition; increment ) statement, desugared into a block with a while loop
+    void m_for_statement();
+    // return expression;
+    void m_return_statement();
+    // ( condition ) of an `if` or a loop, reports anything that is not a bool
+    void m_condition(std::string_view keyword);
     // grouping -> ( expression )
     void m_grouping();
     // parent function for all kinds of expressions
@@ -61,17 +121,61 @@ private:
     // `<`, `<=`, `>`, `>=`,
     // `!=`, `==`
     void m_binary();
+    // parse the short circuiting `and`, `or`
+    void m_logical();
     // parse all unary expressions - `!`, `-`
     void m_unary();
     // parse numbers like floats and ints
     void m_number();
     // parse literal values - string, interpolations, true and false
     void m_literal();
+    // parse variable reads and assignments
+    void m_variable();
+    // parse calls, callee ( [argument [, argument]*] )
+    void m_call();
+    // [argument [, argument]*] ) checked against the parameters of `signature` from `first` on
+    auto m_arguments(std::vector<Token>::const_iterator paren, FunctionType const& signature, std::size_t first) -> std::optional<std::vector<ExprType>>;
+    // parse property accesses, object . field [= value] and object . method ( [argument [, argument]*] )
+    void m_property();
+    // parse array literals, [element [, element]*] and [value ; length]
+    void m_array();
+    // parse indexing, array [ index ] [= value]
+    void m_index();
+    // element-wise `+`, `-`, `*`, `/` and comparisons between the array `left` and the one in `m_expr`
+    void m_elementwise(std::vector<Token>::const_iterator op, ExprType left);
+    // parse the methods of an array after the '.', len ( ), sum ( ), min ( ) and max ( )
+    void m_array_method();
+    // parse `this`, the instance a method runs for
+    void m_this();
+    // parse super . method ( [argument [, argument]*] ), calling the superclass's method for `this`
+    void m_super();
+
+    // type named by a `: type` annotation, functions are written `fun(type, ...): type`
+    auto m_type_annotation() -> std::optional<Type>;
+    // retypes the numeric literal in `m_expr` to `type`, or the literal elements of an array to its element type, false
+    // when it is not one or a value does not fit
+    auto m_convert_literal(Type const& type) -> bool;
+    // binds `name` in the current scope
+    auto m_declare(std::vector<Token>::const_iterator name, Type type) -> std::optional<Binding>;
+    // innermost variable called `name`, null when there is none
+    [[nodiscard]] auto m_resolve(std::string_view name) -> Symbol*;
+    // binding `symbol` has in the body being parsed, capturing it in every function on the way when it is a local of
+    // an enclosing function
+    auto m_binding(std::vector<Token>::const_iterator name, Symbol& symbol) -> std::optional<Binding>;
+    // binding the local `m_locals[local]` has in the body of `m_functions[function]`, capturing it in every function on the way
+    auto m_capture(std::vector<Token>::const_iterator name, std::size_t local, std::size_t function) -> std::optional<Binding>;
+    // the innermost local goes out of scope, now that all of its uses are known boxes it when closures need to share it
+    void m_release();
+    // whatever the loop body starting at `m_order` `start` captured and assigned may happen in either order
+    void m_end_loop(std::size_t start);
+    // skip tokens until the start of the next statement after an error
+    void m_synchronize();
 
     // consume current character and advance
     // if encountering an error token then keep consuming all error tokens
     void m_advance();
     auto m_match(TokenType type) -> bool;
+    [[nodiscard]] auto m_check(TokenType type) const noexcept -> bool;
     void m_match(TokenType type, std::string_view err_msg);
     // we report maximum errors in the parsing phase itself
     void m_report(std::vector<Token>::const_iterator token, std::string_view err_msg);
@@ -89,6 +193,22 @@ private:
     StmtType m_stmt;
     // holds all expression types
     ExprType m_expr;
+    // locals in scope, innermost last, a local's slot is its index counted from `m_frame`
+    std::vector<Symbol> m_locals;
+    // first of `m_locals` belonging to the function being parsed, whose frame starts at slot 0 again
+    std::size_t m_frame {};
+    // function bodies being parsed, innermost last, empty at the top level
+    std::vector<Enclosing> m_functions;
+    // numbers the captures and assignments in the order they are parsed
+    std::size_t m_order {};
+    // globals by name, a redeclared global gets a new index
+    std::unordered_map<std::string_view, Symbol> m_globals;
+    std::size_t m_global_count {};
+    // classes by name, which types name them by, shared with their `Class` nodes
+    std::unordered_map<std::string_view, std::shared_ptr<ClassType>> m_classes;
+    std::size_t m_depth {};
+    // whether the expression being parsed may be the target of an `=`
+    bool m_can_assign {};
     // enables panic mode and sets is parsed to false to indicate program is incorrect
     bool m_is_panicked {};
     bool m_is_parsed { true };
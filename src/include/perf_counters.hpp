@@ -0,0 +1,51 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string_view>
+
+/**
+ * Hardware performance counters read through Linux `perf_event_open`.
+ *
+ * Every event is opened on its own so a machine (or container) which lacks
+ * one of them still reports the others. When nothing could be opened, for
+ * example off Linux or with `perf_event_paranoid` too strict, `available`
+ * returns false and every reading is empty instead of failing the run.
+ */
+class PerfCounters {
+public:
+    enum class Event : uint8_t {
+        CYCLES,
+        INSTRUCTIONS,
+        BRANCH_MISSES,
+        L1I_MISSES,
+        L1D_MISSES,
+    };
+    static constexpr std::size_t event_count = 5;
+
+    // scaled counter values, empty for events that could not be opened
+    using Reading = std::array<std::optional<uint64_t>, event_count>;
+
+    PerfCounters();
+    PerfCounters(PerfCounters const&)                    = delete;
+    auto operator=(PerfCounters const&) -> PerfCounters& = delete;
+    ~PerfCounters();
+
+    [[nodiscard]] auto available() const noexcept -> bool;
+
+    // resets and enables every opened counter
+    void start() noexcept;
+    // disables every opened counter and returns the values counted since `start`
+    auto stop() noexcept -> Reading;
+
+    /**
+     * Prints one row for `stage`. `bytecode_instructions` is the number of vm
+     * instructions executed during the stage, 0 to skip the per bytecode columns.
+     */
+    static void report(std::ostream& os, std::string_view stage, Reading const& reading, std::size_t bytecode_instructions);
+    static void report_header(std::ostream& os);
+
+private:
+    std::array<int, event_count> m_fds {};
+};
@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "code_segment.hpp"
+#include "parser.hpp"
+#include "vm.hpp"
+
+/**
+ * A program compiled once and run any number of times, the library entry
+ * point for hosts embedding the language.
+ *
+ * The host declares the parameters the program reads, which the program
+ * sees as globals it never declared, and binds a value to each of them for
+ * every run. A run hands back the value of the top level code's last
+ * statement when it is an expression statement.
+ *
+ * Nothing a run does changes the compiled code, so any number of threads
+ * may run the same program at once, each through a `Session` of its own. A
+ * session keeps its vm between runs and only resets what the last run
+ * changed, the heap, the globals and the inline caches, instead of making
+ * a new vm, whose stack alone takes a few hundred kilobytes.
+ */
+class Program {
+    // what every session shares, never changed after compiling
+    struct Code {
+        std::shared_ptr<CodeSegment const> segment;
+        std::vector<TypeIndex> parameters;
+        std::optional<TypeIndex> result;   // empty when the last statement leaves no value a host can take
+    };
+
+public:
+    // a parameter or result in the representation the vm gives its type, integers at 64 bits and floats as doubles
+    using Value = std::variant<bool, int64_t, uint64_t, double, std::string>;
+
+    // why a run stopped, at line and column 0 when the arguments did not fit the parameters
+    struct Error {
+        std::size_t line;
+        std::size_t column;
+        std::string message;
+    };
+
+    // the value of the last statement, empty when the program does not end in an expression statement of a scalar type
+    using Result = std::expected<std::optional<Value>, Error>;
+
+    // runs of the program on one thread at a time, all in the same vm
+    class Session {
+    public:
+        // `arguments` holds a value for every parameter, in the order the program declared them
+        [[nodiscard]] auto run(std::span<Value const> arguments) -> Result;
+
+    private:
+        friend class Program;
+
+        Session(std::shared_ptr<Code const> code)
+            : m_code { std::move(code) }
+            , m_vm { std::make_unique<VM>(m_code->segment) }
+        {
+        }
+
+        std::shared_ptr<Code const> m_code;
+        std::unique_ptr<VM> m_vm;
+        std::vector<Stack::value_type> m_arguments;   // kept between runs for the capacity
+    };
+
+    // empty when the source does not parse or its bytecode fails verification, either reports why
+    [[nodiscard]] static auto compile(std::string_view source, std::vector<Parser::Input> const& parameters = {}) -> std::optional<Program>;
+
+    [[nodiscard]] auto session() const -> Session
+    {
+        return Session { m_code };
+    }
+    // a single run in a session of its own, a host running the program often keeps a session per thread instead
+    [[nodiscard]] auto run(std::span<Value const> arguments) const -> Result
+    {
+        return session().run(arguments);
+    }
+
+private:
+    Program(std::shared_ptr<Code const> code)
+        : m_code { std::move(code) }
+    {
+    }
+
+    std::shared_ptr<Code const> m_code;
+};
@@ -0,0 +1,221 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#ifndef NDEBUG
+#include <iostream>
+#include <print>
+#else
+#include <utility>
+#endif
+
+#include "bytecode.hpp"
+#include "string.hpp"
+
+/**
+ * Instruction set of the register engine.
+ *
+ * Every instruction is a fixed 4 byte word `op a b c` where `a` is the
+ * destination register and `b`, `c` the source registers. Opcodes are
+ * specialised per runtime representation, which the parser already knows
+ * for every expression, so the interpreter never inspects a value's type:
+ *  - I64 for every signed width, U64 for every unsigned width
+ *  - F64 for f32 and f64, BOOL and STR
+ */
+enum class RegOpcode : uint8_t {
+    LOADK,   // r[a] = k[b | c << 8]
+    INPUT,   // r[a] = the value the host bound to parameter b | c << 8
+
+    ADD_I64,
+    ADD_U64,
+    ADD_F64,
+    ADD_STR,
+    SUB_I64,
+    SUB_U64,
+    SUB_F64,
+    MUL_I64,
+    MUL_U64,
+    MUL_F64,
+    DIV_I64,
+    DIV_U64,
+    DIV_F64,
+    MOD_I64,
+    MOD_U64,
+    MOD_F64,
+
+    LT_I64,
+    LT_U64,
+    LT_F64,
+    GT_I64,
+    GT_U64,
+    GT_F64,
+    EQ_BOOL,
+    EQ_I64,   // also used for u64, equality does not care about signedness
+    EQ_F64,
+
+    NEG_I64,
+    NEG_F64,
+    NOT_BOOL,
+    NOT_I64,   // also used for u64
+    NOT_F64,
+    NOT_STR,
+
+    TOSTR_BOOL,   // r[a] = format(r[b]), used by string interpolation
+    TOSTR_I64,
+    TOSTR_U64,
+    TOSTR_F64,
+
+    LOG_BOOL,   // log(r[a])
+    LOG_I64,
+    LOG_U64,
+    LOG_F64,
+    LOG_STR,
+
+    RETURN,   // ends the code, r[a] holds its result when it has one
+};
+
+struct RegInstr {
+    RegOpcode op;
+    uint8_t a;
+    uint8_t b;
+    uint8_t c;
+};
+static_assert(sizeof(RegInstr) == 4);
+
+// A register is untagged, the opcode reading it decides which member is active
+union Register {
+    bool b;
+    int64_t i;
+    uint64_t u;
+    double f;
+    std::string const* s;   // points into the interned `StringTable`
+};
+static_assert(sizeof(Register) == 8);
+
+class RegisterCode {
+public:
+    static constexpr std::size_t max_registers = 256;
+    static constexpr std::size_t max_constants = 65'536;
+
+    [[nodiscard]] auto code() const noexcept -> std::vector<RegInstr> const&
+    {
+        return m_code;
+    }
+    [[nodiscard]] auto constants() const noexcept -> std::vector<Register> const&
+    {
+        return m_constants;
+    }
+    // number of registers a frame needs, decided by the compiler's register allocator
+    [[nodiscard]] auto registers() const noexcept -> std::size_t
+    {
+        return m_registers;
+    }
+    void set_registers(std::size_t registers) noexcept
+    {
+        m_registers = registers;
+    }
+    void write_instr(RegInstr instr, std::size_t line_nr)
+    {
+        m_line_info.write(m_code.size(), line_nr);
+        m_code.push_back(instr);
+    }
+    [[nodiscard]] auto add_constant(Register value) -> std::size_t
+    {
+        m_constants.push_back(value);
+        return m_constants.size() - 1;
+    }
+    // type of every parameter the code reads by its index, empty for the ones it never reads
+    [[nodiscard]] auto inputs() const noexcept -> std::vector<std::optional<TypeIndex>> const&
+    {
+        return m_inputs;
+    }
+    void add_input(std::size_t index, TypeIndex type)
+    {
+        m_inputs.resize(std::max(m_inputs.size(), index + 1));
+        m_inputs[index] = type;
+    }
+    // type of the value `RETURN` leaves, the program's last statement when it is an expression statement
+    [[nodiscard]] auto result() const noexcept -> std::optional<TypeIndex>
+    {
+        return m_result;
+    }
+    void set_result(std::optional<TypeIndex> type) noexcept
+    {
+        m_result = type;
+    }
+    [[nodiscard]] auto read_line_number(std::size_t index) const noexcept -> std::size_t
+    {
+        return m_line_info.read_line_number(index);
+    }
+
+private:
+    std::vector<RegInstr> m_code;
+    std::vector<Register> m_constants;
+    std::vector<std::optional<TypeIndex>> m_inputs;
+    std::optional<TypeIndex> m_result;
+    std::size_t m_registers {};
+    util::LineTable m_line_info {};
+};
+
+using RegisterSegment = std::pair<RegisterCode, StringTable>;
+
+namespace util::reg_opcode {
+inline auto to_string(RegOpcode opcode) -> std::string_view
+{
+    switch (opcode) {
+        using enum RegOpcode;
+        case LOADK: return "LOADK";
+        case INPUT: return "INPUT";
+        case ADD_I64: return "ADD_I64";
+        case ADD_U64: return "ADD_U64";
+        case ADD_F64: return "ADD_F64";
+        case ADD_STR: return "ADD_STR";
+        case SUB_I64: return "SUB_I64";
+        case SUB_U64: return "SUB_U64";
+        case SUB_F64: return "SUB_F64";
+        case MUL_I64: return "MUL_I64";
+        case MUL_U64: return "MUL_U64";
+        case MUL_F64: return "MUL_F64";
+        case DIV_I64: return "DIV_I64";
+        case DIV_U64: return "DIV_U64";
+        case DIV_F64: return "DIV_F64";
+        case MOD_I64: return "MOD_I64";
+        case MOD_U64: return "MOD_U64";
+        case MOD_F64: return "MOD_F64";
+        case LT_I64: return "LT_I64";
+        case LT_U64: return "LT_U64";
+        case LT_F64: return "LT_F64";
+        case GT_I64: return "GT_I64";
+        case GT_U64: return "GT_U64";
+        case GT_F64: return "GT_F64";
+        case EQ_BOOL: return "EQ_BOOL";
+        case EQ_I64: return "EQ_I64";
+        case EQ_F64: return "EQ_F64";
+        case NEG_I64: return "NEG_I64";
+        case NEG_F64: return "NEG_F64";
+        case NOT_BOOL: return "NOT_BOOL";
+        case NOT_I64: return "NOT_I64";
+        case NOT_F64: return "NOT_F64";
+        case NOT_STR: return "NOT_STR";
+        case TOSTR_BOOL: return "TOSTR_BOOL";
+        case TOSTR_I64: return "TOSTR_I64";
+        case TOSTR_U64: return "TOSTR_U64";
+        case TOSTR_F64: return "TOSTR_F64";
+        case LOG_BOOL: return "LOG_BOOL";
+        case LOG_I64: return "LOG_I64";
+        case LOG_U64: return "LOG_U64";
+        case LOG_F64: return "LOG_F64";
+        case LOG_STR: return "LOG_STR";
+        case RETURN: return "RETURN";
+    }
+#ifndef NDEBUG
+    std::println(std::cerr, "[DEBUG] Unknown register opcode");
+    return "<UNKNOWN>";
+#else
+    std::unreachable();
+#endif
+}
+}
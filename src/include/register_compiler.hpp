@@ -0,0 +1,44 @@
+#pragma once
+#include <optional>
+
+#include "ast.hpp"
+#include "register_code.hpp"
+
+/**
+ * Compiles the typed ast into register code.
+ *
+ * Registers are handed out like a stack: an expression's result lands in
+ * the lowest free register and every temporary above it is released as
+ * soon as the parent instruction consumed it, so a frame needs as many
+ * registers as the deepest expression tree needs live values.
+ */
+class RegisterCompiler {
+public:
+    RegisterCompiler(StmtType const& ast)
+        : m_ast { ast }
+    {
+    }
+
+    // empty when the program does not fit the register engine's limits
+    [[nodiscard]] auto compile() && -> std::optional<RegisterSegment>;
+
+private:
+    void m_statement(StmtType const& stmt);
+    // compiles `expr` and returns the register holding its value
+    auto m_expression(ExprType const& expr) -> uint8_t;
+    auto m_constant(std::unique_ptr<Literal> const& expr) -> uint8_t;
+    // converts a non string operand of a string `+` in place
+    void m_to_string(uint8_t reg, TypeIndex type, std::size_t line_nr);
+
+    auto m_alloc() -> uint8_t;
+    void m_emit(RegOpcode op, uint8_t a, uint8_t b, uint8_t c, std::size_t line_nr);
+
+    StmtType const& m_ast;
+    RegisterCode m_rc;
+    StringTable m_pool;
+    std::size_t m_next_reg {};
+    std::size_t m_max_regs {};
+    // register and type of the last statement's value, when it is an expression statement
+    std::optional<std::pair<uint8_t, TypeIndex>> m_result;
+    bool m_is_compiled { true };
+};
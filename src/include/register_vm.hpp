@@ -0,0 +1,56 @@
+#pragma once
+#include <array>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "register_code.hpp"
+#include "stats.hpp"
+#include "verifier.hpp"
+
+class RegisterVM {
+public:
+    // `inputs` holds a value for every parameter the code reads, by the parameter's index
+    RegisterVM(RegisterSegment seg, std::vector<Register> inputs = {})
+        : m_pool { std::move(seg.second) }
+        , m_rc { std::move(seg.first) }
+        , m_inputs { std::move(inputs) }
+    {
+    }
+    void execute();
+    // same as `execute` but also counts the instructions executed
+    void execute(Stats& stats);
+    // forgets how the last run ended, every run writes a register before reading it
+    void reset() noexcept
+    {
+        m_result = {};
+        m_error.reset();
+    }
+    // value of the program's last statement, only meaningful when the code has a result
+    [[nodiscard]] auto result() const noexcept -> Register
+    {
+        return m_result;
+    }
+    // why the last run stopped before `RETURN`, its offset is the index of the instruction that failed
+    [[nodiscard]] auto error() const noexcept -> std::optional<BytecodeError> const&
+    {
+        return m_error;
+    }
+    [[nodiscard]] auto code() const noexcept -> RegisterCode const&
+    {
+        return m_rc;
+    }
+
+private:
+    template <bool counted>
+    void m_run(Stats* stats);
+    // `util::vm::division_error` of the registers' integers, which `is_signed` reads as `i` instead of `u`
+    [[nodiscard]] static auto m_division_error(Register lhs, Register rhs, bool is_signed) noexcept -> std::optional<std::string_view>;
+
+    StringTable m_pool;
+    RegisterCode m_rc;
+    std::vector<Register> m_inputs;
+    Register m_result {};
+    std::optional<BytecodeError> m_error;
+    std::array<Register, RegisterCode::max_registers> m_regs {};
+};
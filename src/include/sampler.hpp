@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <csignal>
+#include <memory>
+#include <ostream>
+
+#include "bytecode.hpp"
+
+/**
+ * Statistical profiler for the vm.
+ *
+ * A `SIGPROF` interval timer interrupts the process `frequency` times per
+ * cpu second and the signal handler only bumps a counter for the byte
+ * offset the vm last stored in its sampled instruction pointer, a lock free
+ * atomic. Offsets are resolved to source lines through
+ * `ByteCode::read_line_number` after sampling has stopped, `BM_VMBinarySampled`
+ * measures what sampling costs a run.
+ *
+ * Only one sampler can be running at a time.
+ */
+class Sampler {
+public:
+    static constexpr unsigned default_frequency { 997 };   // prime, so we do not sample in lockstep with periodic work
+
+    explicit Sampler(unsigned frequency = default_frequency)
+        : m_frequency { frequency }
+    {
+    }
+    Sampler(Sampler const&)                    = delete;
+    auto operator=(Sampler const&) -> Sampler& = delete;
+    ~Sampler()
+    {
+        stop();
+    }
+
+    // start sampling `iptr`, which must keep pointing into `bc` until `stop` is called
+    auto start(ByteCode const& bc, std::atomic<std::size_t> const& iptr) -> bool;
+    void stop();
+
+    [[nodiscard]] auto samples() const noexcept -> std::size_t;
+    // `LINE SAMPLES %` table, hottest line first
+    void report_flat(std::ostream& os) const;
+    // `script;fun NAME;line N;OPCODE count` lines accepted by flamegraph.pl and speedscope, top level code has no `fun`
+    void report_collapsed(std::ostream& os) const;
+
+private:
+    static void m_on_signal(int);
+
+    unsigned m_frequency;
+    ByteCode const* m_bc {};
+    std::atomic<std::size_t> const* m_iptr {};
+    std::unique_ptr<std::atomic<uint32_t>[]> m_hits;
+    std::size_t m_size {};
+    struct sigaction m_previous {};   // `SIGPROF` action before `start`, put back by `stop`
+    bool m_running {};
+};
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "types.hpp"
+
+/**
+ * Kernels of the array operations, working on the unboxed elements of
+ * `Array` buffers.
+ *
+ * Every kernel comes in a version for each instruction set in `Isa`, which
+ * processes as many elements per instruction as the widest vector of that
+ * set holds, finishing the elements that don't fill a vector one at a
+ * time. The best set the cpu supports is detected once per process and
+ * picked once per call, never per element.
+ *
+ * Integers wrap at the width of their elements and sums accumulate at it
+ * too, float sums add up the lanes of a vector separately so they may
+ * round differently than adding the elements in order. Integer division
+ * has no vector instruction and always goes one element at a time, the
+ * caller has to rule out dividing by zero and the overflow of the least
+ * signed value divided by -1.
+ */
+namespace util::simd {
+enum class Isa : uint8_t {
+    SCALAR,
+    SSE2,
+    AVX2,
+};
+
+// best instruction set the running cpu supports
+auto isa() noexcept -> Isa;
+
+// `out[i] = lhs[i] op rhs[i]` for every element of type `element`, comparisons store a bool per element
+void elementwise(ArrayOp op, TypeIndex element, std::byte const* lhs, std::byte const* rhs, std::byte* out, std::size_t length, Isa target = isa());
+
+// sum, least or greatest of the elements, stored as a single element at `result`, least and greatest need one
+void reduce(ArrayOp op, TypeIndex element, std::byte const* data, std::size_t length, std::byte* result, Isa target = isa());
+}
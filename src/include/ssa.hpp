@@ -0,0 +1,142 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "ast.hpp"
+#include "code_segment.hpp"
+#include "fusion.hpp"
+
+/**
+ * Typed SSA form of a program, sitting between the ast and `ByteCode`.
+ *
+ * Every instruction defines exactly one value, named by its index, and
+ * only reads values defined before it, so the instruction order is also a
+ * valid schedule. Operations mirror the stack vm's opcodes one to one and
+ * carry the static type of the value they define, which leaves lowering
+ * nothing to decide but where each value lives on the stack.
+ *
+ * A program is one basic block, the ir has no control flow yet. Programs
+ * with branches or loops are left to the direct compiler.
+ * Variables never show up in the ir either: the builder tracks the value
+ * every variable holds, a read is that value and an assignment rebinds it.
+ */
+enum class SsaOp : uint8_t {
+    CONST,
+    COPY,   // same value as operand 0, left behind by rewrites until copy propagation removes it
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    MOD,
+    CMP,
+    CMPE,
+    NEGATE,
+    NOT,
+    // integer arithmetic by the constant kept in `constant`, left behind by strength reduction
+    SHL,
+    DIVP2,
+    MODP2,
+    DIVM,
+    MODM,
+    LOG,   // the only side effect, never removed or merged
+};
+
+using SsaValue = uint32_t;
+
+struct SsaInstr {
+    SsaOp op;
+    TypeIndex type;   // type of the value defined, of the logged value for `LOG`
+    Location location;
+    std::array<SsaValue, 2> operands {};
+    TypeVariant constant {};   // only read for `CONST` and the ops reduced by a constant
+};
+
+class SsaProgram {
+public:
+    [[nodiscard]] auto instructions() const noexcept -> std::vector<SsaInstr> const&
+    {
+        return m_instrs;
+    }
+    [[nodiscard]] auto instructions() noexcept -> std::vector<SsaInstr>&
+    {
+        return m_instrs;
+    }
+    auto append(SsaInstr instr) -> SsaValue
+    {
+        m_instrs.push_back(std::move(instr));
+        return static_cast<SsaValue>(m_instrs.size() - 1);
+    }
+
+private:
+    std::vector<SsaInstr> m_instrs;
+};
+
+namespace util::ssa {
+// number of values `op` reads
+inline constexpr auto arity(SsaOp op) noexcept -> std::size_t
+{
+    switch (op) {
+        using enum SsaOp;
+        case CONST: return 0;
+        case COPY:
+        case NEGATE:
+        case NOT:
+        case SHL:
+        case DIVP2:
+        case MODP2:
+        case DIVM:
+        case MODM:
+        case LOG: return 1;
+        default: return 2;
+    }
+}
+
+// whether `op` reads `SsaInstr::constant`
+inline constexpr auto has_immediate(SsaOp op) noexcept -> bool
+{
+    return op == SsaOp::CONST || (op >= SsaOp::SHL && op <= SsaOp::MODM);
+}
+
+auto to_string(SsaOp op) -> std::string_view;
+
+// `ast` has to be straight line code, without `if`, loops or short circuiting
+auto build(StmtType const& ast) -> SsaProgram;
+
+/**
+ * Rewrites integer multiplication by a power of two into a shift, and
+ * division and remainder by any non zero constant into shifts and masks or
+ * a multiply-high by a precomputed magic number (see `divide.hpp`). The
+ * constant moves into the rewritten instruction.
+ */
+void strength_reduction(SsaProgram& program);
+/**
+ * Global value numbering: every pure instruction computing a value which
+ * an earlier instruction already computed becomes a `COPY` of it.
+ * Constants are numbered by bit pattern and the operands of commutative
+ * operations are ordered first, so `a + b` and `b + a` share a number.
+ */
+void value_numbering(SsaProgram& program);
+// rewrites every use of a `COPY` to the value it copies
+void copy_propagation(SsaProgram& program);
+// drops every instruction no `LOG` or integer division that may halt depends on and renumbers the rest
+void dead_code_elimination(SsaProgram& program);
+// the above in the order they feed each other
+void optimize(SsaProgram& program);
+
+/**
+ * Schedules `program` onto the operand stack.
+ *
+ * Values used once are left where their user pops them, exactly as the
+ * direct compiler emits them. Values used more than once stay on the
+ * stack and every use pushes a copy with `PICK`, while constants used
+ * more than once are loaded again instead. Empty when a copy sits deeper
+ * than `PICK` can reach.
+ */
+auto lower(SsaProgram program, Fusions fusions = Fusions::all()) -> std::optional<CodeSegment>;
+
+// ast straight to optimized bytecode, empty for programs with control flow or functions
+auto compile(StmtType const& ast, Fusions fusions = Fusions::all()) -> std::optional<CodeSegment>;
+}
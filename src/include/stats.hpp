@@ -0,0 +1,77 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <ctime>
+#include <cstdint>
+#include <utility>
+#include <type_traits>
+
+/**
+ * Collects phase timings and memory statistics for a single run of the
+ * pipeline. Nothing here is touched unless the driver is started with
+ * `--stats`; a disabled `Stats` object costs one branch per phase and the
+ * vm only counts instructions through `VM::execute(Stats&)`.
+ */
+struct Stats {
+    enum class Phase : uint8_t {
+        LEX,
+        PARSE,
+        COMPILE,
+        VERIFY,
+        EXECUTE,
+    };
+
+    struct Timing {
+        std::chrono::nanoseconds wall {};
+        std::chrono::nanoseconds cpu {};
+    };
+
+    // Runs `func` and accounts its wall and cpu time to `phase`
+    template <typename Func>
+    auto measure(Phase phase, Func&& func) -> auto
+    {
+        if (!enabled) {
+            return std::forward<Func>(func)();
+        }
+
+        auto wall_start = std::chrono::steady_clock::now();
+        auto cpu_start  = std::clock();
+        auto stop       = [&, this] {
+            auto& timing = timings[std::to_underlying(phase)];
+            timing.wall += std::chrono::steady_clock::now() - wall_start;
+            timing.cpu += std::chrono::nanoseconds { (std::clock() - cpu_start) * (1'000'000'000 / CLOCKS_PER_SEC) };
+        };
+
+        if constexpr (std::is_void_v<std::invoke_result_t<Func>>) {
+            std::forward<Func>(func)();
+            stop();
+        } else {
+            auto result = std::forward<Func>(func)();
+            stop();
+            return result;
+        }
+    }
+
+    // human readable report written to stderr
+    void print() const;
+    // single line json object written to stderr for dashboards
+    void print_json() const;
+
+    bool enabled {};
+    std::array<Timing, 5> timings {};
+
+    std::size_t tokens {};
+    std::size_t ast_nodes {};
+    std::size_t bytecode_bytes {};
+    std::size_t line_entries {};
+    std::size_t line_bytes {};
+    std::size_t strings {};
+    std::size_t string_bytes {};
+    std::size_t peak_stack_depth {};
+    std::size_t instructions {};
+    std::size_t minor_collections {};
+    std::size_t major_collections {};
+    std::size_t gc_pauses {};
+    std::chrono::nanoseconds gc_pause_p99 {};
+    std::chrono::nanoseconds gc_pause_max {};
+};
@@ -7,6 +7,8 @@ enum class TokenType : uint8_t {
     RIGHT_PAREN,
     LEFT_BRACE,
     RIGHT_BRACE,
+    LEFT_BRACKET,
+    RIGHT_BRACKET,
     COMMA,
     SEMICOLON,
     COLON,
@@ -73,4 +75,5 @@ struct Token {
     TokenType type;
     std::string_view word;
     std::size_t line;
+    std::size_t column {};   // of the first character, counting from 1
 };
\ No newline at end of file
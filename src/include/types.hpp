@@ -1,10 +1,11 @@
 #pragma once
 #include <variant>
+
+#include "string.hpp"
+#include <utility>
 #ifndef NDEBUG
 #include <print>
 #include <iostream>
-#else
-#include <utility>
 #endif
 
 namespace util {
@@ -31,6 +32,26 @@ enum class TypeIndex : uint8_t {
     FLOAT32,
     FLOAT64,
     STRING,
+    FUNCTION,   // no literal has this type, the parser tracks a function's signature next to it
+    INSTANCE,   // neither has this, the parser tracks the class of an instance next to it
+    ARRAY,      // nor this, the parser tracks the type of the elements next to it
+};
+
+// what an array operation computes from every pair of elements, or from all elements of one array
+enum class ArrayOp : uint8_t {
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    LT,
+    LE,
+    GT,
+    GE,
+    EQ,
+    NE,
+    SUM,
+    MIN,
+    MAX,
 };
 
 using TypeList = std::tuple<bool,
@@ -42,7 +63,7 @@ using TypeList = std::tuple<bool,
 using TypeVariant = util::from<std::variant, TypeList>::type;
 
 namespace util::type {
-auto to_string(TypeIndex index) -> std::string_view
+inline auto to_string(TypeIndex index) -> std::string_view
 {
     switch (index) {
         using namespace std::string_view_literals;
@@ -59,6 +80,9 @@ auto to_string(TypeIndex index) -> std::string_view
         case FLOAT32: return "f32";
         case FLOAT64: return "f64";
         case STRING: return "str";
+        case FUNCTION: return "fun";
+        case INSTANCE: return "instance";
+        case ARRAY: return "array";
     }
 #ifndef NDEBUG
     std::println(std::cerr, "[DEBUG] Unknown type");
@@ -67,13 +91,101 @@ auto to_string(TypeIndex index) -> std::string_view
 #endif
 };
 
-auto get_type(TypeVariant const& type) noexcept -> TypeIndex   // used in vm when popping out pushed value from stack
+inline auto to_string(ArrayOp op) -> std::string_view
+{
+    switch (op) {
+        using enum ArrayOp;
+        case ADD: return "+";
+        case SUB: return "-";
+        case MUL: return "*";
+        case DIV: return "/";
+        case LT: return "<";
+        case LE: return "<=";
+        case GT: return ">";
+        case GE: return ">=";
+        case EQ: return "==";
+        case NE: return "!=";
+        case SUM: return "sum";
+        case MIN: return "min";
+        case MAX: return "max";
+    }
+#ifndef NDEBUG
+    std::println(std::cerr, "[DEBUG] Unknown array operation");
+#else
+    std::unreachable();
+#endif
+};
+
+inline auto get_type(TypeVariant const& type) noexcept -> TypeIndex   // used in vm when popping out pushed value from stack
 {
     return static_cast<TypeIndex>(type.index());
 }
 
-auto get_type(uint8_t type_index) noexcept -> TypeIndex   // used in logger and vm when converting from byte to index
+inline auto get_type(uint8_t type_index) noexcept -> TypeIndex   // used in logger and vm when converting from byte to index
 {
     return static_cast<TypeIndex>(type_index);
 }
+
+inline constexpr auto is_signed_integer(TypeIndex index) noexcept -> bool
+{
+    return index >= TypeIndex::INT8 && index <= TypeIndex::INT64;
+}
+
+inline constexpr auto is_unsigned_integer(TypeIndex index) noexcept -> bool
+{
+    return index >= TypeIndex::UINT8 && index <= TypeIndex::UINT64;
+}
+
+// whether arrays of `index` exist, their elements are stored unboxed at their own width
+inline constexpr auto is_element(TypeIndex index) noexcept -> bool
+{
+    return index <= TypeIndex::FLOAT64;
+}
+
+// calls `visit` with a value of the type an array of `element` stores, which has to be one
+template <typename Visit>
+inline constexpr auto with_element(TypeIndex element, Visit&& visit) -> decltype(auto)
+{
+    switch (element) {
+        using enum TypeIndex;
+        case BOOL: return visit(bool {});
+        case INT8: return visit(int8_t {});
+        case INT16: return visit(int16_t {});
+        case INT32: return visit(int32_t {});
+        case INT64: return visit(int64_t {});
+        case UINT8: return visit(uint8_t {});
+        case UINT16: return visit(uint16_t {});
+        case UINT32: return visit(uint32_t {});
+        case UINT64: return visit(uint64_t {});
+        case FLOAT32: return visit(float {});
+        case FLOAT64: return visit(double {});
+        default: break;
+    }
+    std::unreachable();
+}
+
+// number of bytes a `LOAD` of this type carries in the bytecode, strings are stored as their interned `StringPtr`
+// and functions as their u16 index into `ByteCode::functions`
+inline constexpr auto size_of(TypeIndex index) noexcept -> std::size_t
+{
+    switch (index) {
+        using enum TypeIndex;
+        case BOOL: return sizeof(bool);
+        case INT8: return sizeof(int8_t);
+        case INT16: return sizeof(int16_t);
+        case INT32: return sizeof(int32_t);
+        case INT64: return sizeof(int64_t);
+        case UINT8: return sizeof(uint8_t);
+        case UINT16: return sizeof(uint16_t);
+        case UINT32: return sizeof(uint32_t);
+        case UINT64: return sizeof(uint64_t);
+        case FLOAT32: return sizeof(float);
+        case FLOAT64: return sizeof(double);
+        case STRING: return sizeof(StringPtr);
+        case FUNCTION: return sizeof(uint16_t);
+        case INSTANCE: break;   // only `NEW` makes instances
+        case ARRAY: break;      // and only `NEW_ARRAY` and `FILL_ARRAY` arrays
+    }
+    return 0;
+}
 }
\ No newline at end of file
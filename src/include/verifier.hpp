@@ -0,0 +1,98 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <set>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "code_segment.hpp"
+
+// types of everything an instruction can read: the running frame's stack, bottom first, and the globals
+struct TypeState {
+    std::vector<SlotType> stack;
+    std::vector<std::optional<SlotType>> globals;   // empty until the first `SET_GLOBAL` to the global
+    std::optional<std::size_t> function {};         // index of the running function, empty in the top level code
+
+    auto operator==(TypeState const&) const -> bool = default;
+};
+
+// first problem found in a piece of bytecode, `offset` is the byte offset of the instruction
+struct BytecodeError {
+    std::size_t offset;
+    std::string message;
+};
+
+/**
+ * Load time verifier for stack bytecode.
+ *
+ * Interprets the code abstractly, tracking the type of every stack slot
+ * instead of its value. Accepted code only holds valid opcodes, operands
+ * and constants (strings pointing into the segment's pool), never pops an
+ * empty stack nor outgrows `Stack`, only reaches operators with operand
+ * types `util::vm` defines them for, only reads locals below the top of
+ * stack and globals after setting them, never changes the type of a
+ * variable, only unboxes boxes and only reads the captures the running
+ * closure has, only jumps to the start of an instruction and halts through
+ * `RETURN` instead of running off the end. Calls pass the arguments the
+ * callee's signature names, a function returns its result type and keeps
+ * its frame within `Stack::frame_size`. Property instructions only reach
+ * instances of a class with the field or method they name, where an
+ * instance of a subclass goes for one of its superclass. Those are all the
+ * cases `VM::execute` leaves unchecked, so it runs verified code without
+ * checking anything but for fields read before their first assignment.
+ *
+ * Every instruction is reached with one stack layout: where control flow
+ * joins the stack types have to agree, while a global only counts as set
+ * when every path into the join set it. A function's body is reached from
+ * every `LOAD` or `CLOSURE` of it, since it can only run after that, with
+ * its parameters as the frame and a global's type fixed across the
+ * program. Functions with captures are only made by `CLOSURE`, so their
+ * callee always holds the captures. An `INVOKE` reaches every method its
+ * name finds in the receiver's class and in each of its subclasses.
+ */
+class Verifier {
+public:
+    Verifier(ByteCode const& bc, StringTable const& pool);
+
+    // verifies the whole program, returning the deepest a frame gets, the leading globals hold `parameters` from the start
+    [[nodiscard]] auto verify(std::span<SlotType const> parameters = {}) const -> std::expected<std::size_t, BytecodeError>;
+
+    /**
+     * Checks the instruction at `offset` against `state`, the types of the
+     * values it can read, and applies its effect on them. Returns the
+     * offset of the next instruction, the end of the code after `RETURN`
+     * and `TAIL_CALL` and the target after `JUMP`. A conditional jump
+     * returns the fall through, whose state is the one left behind, as does
+     * `CALL` with the callee's result pushed. `state` holds one frame, its
+     * `function` tells which function runs it.
+     *
+     * `VM::execute_checked` steps through untrusted code with this right
+     * before executing each instruction.
+     */
+    [[nodiscard]] auto step(std::size_t offset, TypeState& state) const -> std::expected<std::size_t, BytecodeError>;
+
+private:
+    // merges `state` into the state control reaches `target` with, whether that changed anything
+    [[nodiscard]] auto m_join(std::optional<TypeState>& target, TypeState const& state) const -> std::expected<bool, std::string>;
+    // type a `LOAD` or superinstruction at `offset` pushes, once its operand bytes are known to be in range
+    [[nodiscard]] auto m_constant(std::size_t offset) const -> std::expected<SlotType, std::string>;
+    // whether `signature` indexes the signature table and only names types there are
+    [[nodiscard]] auto m_is_signature(std::size_t signature) const -> bool;
+    // signature of the function running `state`, which runs one
+    [[nodiscard]] auto m_signature(TypeState const& state) const -> Signature const&;
+    // first problem with the class table, whose classes only extend earlier ones and override methods compatibly
+    [[nodiscard]] auto m_check_classes() const -> std::optional<BytecodeError>;
+    // whether a value of type `from` can go where one of type `to` is expected, an instance where its superclass's is
+    [[nodiscard]] auto m_is_assignable(SlotType from, SlotType to) const -> bool;
+    // type of the field `name` instances of `klass` have, or of its closest superclass declaring one
+    [[nodiscard]] auto m_field(std::size_t klass, uint16_t name) const -> std::optional<SlotType>;
+    // function `INVOKE` of the method `name` calls on an instance of `klass`
+    [[nodiscard]] auto m_method(std::size_t klass, uint16_t name) const -> std::optional<uint16_t>;
+
+    ByteCode const& m_bc;
+    std::set<std::array<uint8_t, sizeof(StringPtr)>> m_strings;   // bytes of every `StringPtr` into the pool
+    std::optional<BytecodeError> m_class_error;                   // nothing about instances can be checked against a bad table
+};
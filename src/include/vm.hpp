@@ -2,56 +2,241 @@
 
 #include <variant>
 #include <array>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
 
 #include "code_segment.hpp"
+#include "heap.hpp"
+#include "instr.hpp"
+#include "stats.hpp"
+#include "verifier.hpp"
 
-class Stack {
-public:
-    using value_type = std::variant<bool,
-                                    StringPtr,
-                                    int64_t, uint64_t,
-                                    double>;
+/**
+ * Per instruction cache of what a property access found for the last
+ * shapes it saw, so a hit neither searches the shape's fields nor walks
+ * the class chain for a method. An access seeing more than `ways` shapes
+ * stays megamorphic: the cache keeps its entries and misses look the name
+ * up every time.
+ */
+struct InlineCache {
+    static constexpr std::size_t ways = 4;
 
-    [[nodiscard]] auto top() const noexcept -> value_type
-    {
-        return m_stack[m_sptr - 1];
-    }
+    struct Entry {
+        Shape const* shape;
+        Shape* next;      // the shape `SET_PROP` of a field the instance lacks moves it to, null otherwise
+        uint16_t index;   // into `Instance::fields` for a field, into `ByteCode::functions` for a method
+    };
 
-    auto push(value_type value) noexcept -> std::size_t
+    [[nodiscard]] auto find(Shape const* shape) const noexcept -> Entry const*
     {
-        m_stack[m_sptr] = value;
-        return m_sptr++;
+        for (std::size_t entry {}; entry < count; entry++) {
+            if (entries[entry].shape == shape) {
+                return &entries[entry];
+            }
+        }
+        return nullptr;
     }
-
-    auto pop() noexcept -> value_type
+    void fill(Entry entry) noexcept
     {
-        return m_stack[--m_sptr];
+        if (count < ways) {
+            entries[count++] = entry;
+        }
     }
 
-private:
-    static constexpr uint16_t max_size = 8'192;
-    std::size_t m_sptr {};
-    std::array<value_type, max_size> m_stack {};
+    std::array<Entry, ways> entries {};
+    uint8_t count {};
 };
 
+/**
+ * Stack bytecode interpreter. Unchecked runs trust their bytecode and only
+ * halt for what verification cannot rule out: the stack overflowing, reading
+ * a field no one assigned, an integer division by zero or overflowing, an
+ * array length negative or too large, an array index out of bounds, arrays
+ * of different lengths and reducing an empty array without a sum. The reason
+ * is left in `error()`.
+ */
 class VM {
 public:
     VM(CodeSegment seg)
-        : m_pool { std::move(seg.second) }
-        , m_bc { std::move(seg.first) }
+        : VM { std::make_shared<CodeSegment const>(std::move(seg)) }
+    {
+    }
+    // runs code other vms may be running at the same time, which only ever read it
+    VM(std::shared_ptr<CodeSegment const> code)
+        : m_heap { m_pool }
+        , m_code { std::move(code) }
+        , m_bc { m_code->first }
+        , m_globals(m_bc.globals())
+        , m_caches(m_bc.caches())
     {
+        m_make_shapes();
     }
+    /**
+     * Runs the program without checking anything, its bytecode has to come
+     * from the compiler or pass `Verifier::verify` against the same pool.
+     */
     void execute();
+    // same as `execute` but also counts instructions and tracks the peak stack depth
+    void execute(Stats& stats);
+    /**
+     * Runs untrusted bytecode, verifying every instruction right before
+     * executing it and checking integer divisions for zero divisors and
+     * overflow. Returns the error the program stopped at.
+     */
+    auto execute_checked() -> std::optional<BytecodeError>;
+    // executes a single instruction without caching the top of stack
     void execute_next();
+    // puts the vm back where it was made, freeing everything the last run left behind, so it can run the code again
+    void reset();
+    // assigns `parameters` to the first globals, the ones the parser declared for them, before the program runs
+    void bind(std::span<Stack::value_type const> parameters);
+    // `value` as a string the heap owns, which `bind` takes and `reset` frees
+    auto intern(std::string_view value) -> StringPtr;
+    // value of the top level code's last statement after a run reached its end, when it is an expression statement
+    [[nodiscard]] auto result() const noexcept -> std::optional<Stack::value_type>
+    {
+        if (m_iptr != m_bc.code().size() || m_error.has_value() || m_stack.size() == 0) {
+            return {};
+        }
+        return m_stack.top();
+    }
+    // why the last run stopped before reaching the end
+    [[nodiscard]] auto error() const noexcept -> std::optional<BytecodeError> const&
+    {
+        return m_error;
+    }
+
+    [[nodiscard]] auto bytecode() const noexcept -> ByteCode const&
+    {
+        return m_bc;
+    }
+    [[nodiscard]] auto heap() const noexcept -> Heap const&
+    {
+        return m_heap;
+    }
+    // byte offset of the next instruction to execute
+    [[nodiscard]] auto instruction_pointer() const noexcept -> std::size_t
+    {
+        return m_iptr;
+    }
+    // byte offset of the instruction being executed, which `Sampler` reads from its signal handler
+    [[nodiscard]] auto sampled_instruction_pointer() const noexcept -> std::atomic<std::size_t> const&
+    {
+        return m_sampled_iptr;
+    }
 
 private:
+    template <bool counted>
+    void m_run(Stats* stats);
+    // decodes the constant of the `LOAD` or superinstruction at `m_iptr` and steps over the instruction
+    auto m_load() -> Stack::value_type;
+    // why the integer division or remainder at `m_iptr` would trap, if it would
+    auto m_division_error() -> std::optional<std::string_view>;
+    // enters the function below the `arguments` values on top, false and halting when its frame would not fit
+    auto m_call(uint8_t arguments, std::size_t return_address) -> bool;
+    // puts the method the `INVOKE` at `m_iptr` finds below the instance and arguments on top and calls it
+    auto m_invoke() -> bool;
+    // function the method the `INVOKE` at `m_iptr` calls on `instance` is compiled to
+    auto m_method(Instance const& instance) -> uint16_t;
+    // field of `instance` the `GET_PROP` at `m_iptr` reads, empty and halting when the instance has none
+    auto m_get_property(Instance const& instance) -> std::optional<Stack::value_type>;
+    // assigns `value` to the field of `instance` the `SET_PROP` at `m_iptr` names, adding it when the instance has none
+    void m_set_property(Instance& instance, Stack::value_type value);
+    // moves the function and its `arguments` down in place of the running frame and enters it
+    void m_tail_call(uint8_t arguments);
+    // drops the running frame, whose result the caller holds, and continues in the caller
+    void m_return();
+    // types of the running frame's slots, as `Verifier::step` tracks them
+    [[nodiscard]] auto m_frame_types() const -> std::vector<SlotType>;
+    // type `Verifier::step` tracks for `value`
+    [[nodiscard]] auto m_type_of(Stack::value_type const& value) const -> SlotType;
+    // index into `ByteCode::functions` of a function value
+    [[nodiscard]] static auto m_function(Stack::value_type const& callee) noexcept -> uint16_t;
+    // the closure running the current frame
+    [[nodiscard]] auto m_closure() const noexcept -> Closure const&
+    {
+        return *std::get<Closure const*>(m_stack.get(m_base - 1));
+    }
+    // makes a closure over the captures of `function` on top of the stack, which it drops
+    auto m_make_closure(uint16_t function) -> Closure const*;
+    // moves `value` into a new box shared by whoever holds the pointer
+    auto m_box(Stack::value_type value) -> Box*
+    {
+        return m_heap.make_box(value);
+    }
+    // a new instance of `ByteCode::classes()[klass]` without any field
+    auto m_new(uint16_t klass) -> Instance*
+    {
+        return m_heap.make_instance(&m_shapes[klass]);
+    }
+    // an array of `element` holding the `count` values on top of the stack, which it drops
+    auto m_new_array(TypeIndex element, uint16_t count) -> Array*;
+    // an array of `length` copies of `value`, empty and halting when the length is negative
+    auto m_fill_array(TypeIndex element, Stack::value_type const& value, Stack::value_type const& length) -> std::optional<Stack::value_type>;
+    // where the element of `array` at `index` is stored, null and halting when the index is out of its bounds
+    auto m_element(Array& array, Stack::value_type const& index) -> std::byte*;
+    // array of `op` applied to every pair of elements, empty and halting on an error
+    auto m_elementwise(ArrayOp op, Array const& lhs, Array const& rhs) -> std::optional<Stack::value_type>;
+    // sum, least or greatest element of `array`, empty and halting for the least or greatest of no elements
+    auto m_reduce(ArrayOp op, Array const& array) -> std::optional<Stack::value_type>;
+    // the empty shape of every class, in class order
+    void m_make_shapes();
+    // stops the run at the instruction at `m_iptr`, which failed for `message`
+    void m_halt(std::string message);
+    // `m_binary` of an integer division or remainder, empty and halting when it would trap
+    auto m_divide(Opcode opcode, Stack::value_type const& lhs, Stack::value_type const& rhs) -> std::optional<Stack::value_type>;
+    // `util::vm::binary`, handing the string a concatenation adds to the pool over to the heap
+    auto m_binary(Opcode opcode, Stack::value_type const& lhs, Stack::value_type const& rhs) -> Stack::value_type;
+    // collects if the last allocation filled the nursery, only called between instructions which leaves every live
+    // value on the stack, in a global or in `cached`, the top of stack a dispatch loop keeps apart
+    void m_safepoint(std::span<Stack::value_type> cached = {})
+    {
+        if (m_heap.is_collection_due()) [[unlikely]] {
+            m_heap.collect({ m_stack.slots(), m_globals, cached });
+        }
+    }
+
     auto m_is_end() noexcept -> bool
     {
         return m_iptr == m_bc.code().size();
     }
 
     Stack m_stack {};
+    // strings the program makes while it runs, its constants point into the code's pool
     StringTable m_pool;
-    ByteCode m_bc {};
+    // owns the closures, boxes, instances and arrays the program makes and the strings it adds to `m_pool`
+    Heap m_heap;
+    std::shared_ptr<CodeSegment const> m_code;
+    ByteCode const& m_bc;
+    // indexed by `GET_GLOBAL` and `SET_GLOBAL`, the compiler resolved every name to its index
+    std::vector<Stack::value_type> m_globals;
+    // the empty shape of every class first, in class order, then the shapes the transitions made
+    std::deque<Shape> m_shapes;
+    // indexed by the cache operand of the property instructions, shapes only exist in this vm so neither does the cache
+    std::vector<InlineCache> m_caches;
     std::size_t m_iptr {};
+    // `m_iptr` as every dispatch stores it, a signal handler may only read lock free atomics
+    std::atomic<std::size_t> m_sampled_iptr {};
+    static_assert(std::atomic<std::size_t>::is_always_lock_free);
+
+    // a call in progress: where its caller continues and where the caller's frame starts
+    struct Frame {
+        std::size_t return_address;
+        std::size_t base;
+    };
+    // every frame holds at least its callee, so there are never more frames than stack slots
+    std::array<Frame, Stack::max_size> m_frames {};
+    std::size_t m_frame_count {};
+    // slot `GET_LOCAL 0` reads, the running function's first argument
+    std::size_t m_base {};
+    // leading globals `bind` assigned, which the program reads without setting them
+    std::size_t m_parameters {};
+    std::optional<BytecodeError> m_error;
 };
\ No newline at end of file
@@ -0,0 +1,440 @@
+#pragma once
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <limits>
+#include <optional>
+#include <print>
+#include <string_view>
+#ifndef NDEBUG
+#include <iostream>
+#else
+#include <utility>
+#endif
+
+#include "common.hpp"
+#include "divide.hpp"
+#include "instr.hpp"
+#include "vm.hpp"
+
+/**
+ * Semantics of every stack opcode, shared by every dispatch loop.
+ *
+ * Each helper takes its operands by value and returns the result instead
+ * of touching a `Stack`, so the byte and word interpreters and any loop
+ * which keeps operands out of memory all compute exactly the same thing.
+ */
+namespace util::vm {
+using Value = Stack::value_type;
+
+template <typename T>
+concept Arithmetic = std::integral<T> || std::floating_point<T>;
+
+// values no operator is defined for, they only get called, copied around or read through
+template <typename T>
+concept Opaque = std::same_as<T, FunctionRef> || std::same_as<T, Closure const*> || std::same_as<T, Box*> || std::same_as<T, Instance*> || std::same_as<T, Array*>;
+
+// widens a decoded `LOAD` operand to the representation the stack holds
+template <typename T>
+inline auto widen(T value) noexcept -> Value
+{
+    if constexpr (std::is_same_v<T, bool> || std::is_same_v<T, StringPtr> || std::is_same_v<T, FunctionRef>) {
+        return value;
+    } else if constexpr (std::signed_integral<T>) {
+        return static_cast<int64_t>(value);
+    } else if constexpr (std::unsigned_integral<T>) {
+        return static_cast<uint64_t>(value);
+    } else {
+        return static_cast<double>(value);
+    }
+}
+
+// the element of type `element` stored at `data`, widened like every value on the stack
+inline auto load_element(TypeIndex element, std::byte const* data) -> Value
+{
+    return util::type::with_element(element, [data]<typename T>(T) -> Value {
+        T value;
+        std::memcpy(&value, data, sizeof(T));
+        return widen(value);
+    });
+}
+
+// stores `value` at `data` as an element of type `element`, wrapping it to the element's width
+inline void store_element(TypeIndex element, std::byte* data, Value const& value)
+{
+    util::type::with_element(element, [data, &value]<typename T>(T) {
+        auto narrowed = std::visit(util::Visitor {
+                                       []<Arithmetic V>(V val) -> T {
+                                           return static_cast<T>(val);
+                                       },
+                                       []<typename V>(V) -> T {
+#ifndef NDEBUG
+                                           std::println(std::cerr, "[DEBUG] Reached SET_INDEX instruction with a value no array holds");
+                                           return {};
+#else
+                                           std::unreachable();
+#endif
+                                       },
+                                   },
+                                   value);
+        std::memcpy(data, &narrowed, sizeof(T));
+    });
+}
+
+inline void log(Value const& value)
+{
+    std::visit(util::Visitor {
+                   []<typename T>(T val) {
+                       std::println("{}", val);
+                   },
+                   [](StringPtr val) {
+                       std::println("{}", *val);
+                   },
+                   []<Opaque T>(T) {
+#ifndef NDEBUG
+                       std::println(std::cerr, "[DEBUG] Reached LOG instruction with a function");
+#else
+                       std::unreachable();
+#endif
+                   },
+               },
+               value);
+}
+
+inline auto add(Value const& lhs, Value const& rhs, StringTable& pool) -> Value
+{
+    return std::visit(util::Visitor {
+                          []<Arithmetic T>(T v1, T v2) -> Value {
+                              return v1 + v2;
+                          },
+                          [&pool](StringPtr v1, StringPtr v2) -> Value {
+                              return pool.emplace(*v1 + *v2).first;
+                          },
+                          [&pool]<typename T>(StringPtr v1, T v2) -> Value {
+                              return pool.emplace(*v1 + std::format("{}", v2)).first;
+                          },
+                          [&pool]<typename T>(T v1, StringPtr v2) -> Value {
+                              return pool.emplace(std::format("{}", v1) + *v2).first;
+                          },
+                          []<Opaque T>(StringPtr, T) -> Value {
+#ifndef NDEBUG
+                              std::println(std::cerr, "[DEBUG] Reached ADD instruction with a function");
+                              return {};
+#else
+                              std::unreachable();
+#endif
+                          },
+                          []<Opaque T>(T, StringPtr) -> Value {
+#ifndef NDEBUG
+                              std::println(std::cerr, "[DEBUG] Reached ADD instruction with a function");
+                              return {};
+#else
+                              std::unreachable();
+#endif
+                          },
+                          []<typename T1, typename T2>(T1, T2) -> Value {
+#ifndef NDEBUG
+                              std::println(std::cerr, "[DEBUG] Reached ADD instruction with two different types");
+                              return {};
+#else
+                              std::unreachable();
+#endif
+                          } },
+                      lhs, rhs);
+}
+
+inline auto sub(Value const& lhs, Value const& rhs) -> Value
+{
+    return std::visit(util::Visitor {
+                          []<Arithmetic T>(T v1, T v2) -> Value {
+                              return v1 - v2;
+                          },
+                          []<typename T1, typename T2>(T1, T2) -> Value {
+#ifndef NDEBUG
+                              std::println(std::cerr, "[DEBUG] Reached SUB instruction with two different types");
+                              return {};
+#else
+                              std::unreachable();
+#endif
+                          },
+                      },
+                      lhs, rhs);
+}
+
+inline auto mul(Value const& lhs, Value const& rhs) -> Value
+{
+    return std::visit(util::Visitor {
+                          []<Arithmetic T>(T v1, T v2) -> Value {
+                              return v1 * v2;
+                          },
+                          []<typename T1, typename T2>(T1, T2) -> Value {
+#ifndef NDEBUG
+                              std::println(std::cerr, "[DEBUG] Reached MUL instruction with two different types");
+                              return {};
+#else
+                              std::unreachable();
+#endif
+                          },
+                      },
+                      lhs, rhs);
+}
+
+inline auto div(Value const& lhs, Value const& rhs) -> Value
+{
+    return std::visit(util::Visitor {
+                          []<Arithmetic T>(T v1, T v2) -> Value {
+                              return v1 / v2;
+                          },
+                          []<typename T1, typename T2>(T1, T2) -> Value {
+#ifndef NDEBUG
+                              std::println(std::cerr, "[DEBUG] Reached DIV instruction with two different types");
+                              return {};
+#else
+                              std::unreachable();
+#endif
+                          },
+                      },
+                      lhs, rhs);
+}
+
+inline auto mod(Value const& lhs, Value const& rhs) -> Value
+{
+    return std::visit(util::Visitor {
+                          []<Arithmetic T>(T v1, T v2) -> Value {
+                              if constexpr (std::is_integral_v<T>) {
+                                  return v1 % v2;
+                              } else {
+                                  return std::fmod(v1, v2);
+                              }
+                          },
+                          []<typename T1, typename T2>(T1, T2) -> Value {
+#ifndef NDEBUG
+                              std::println(std::cerr, "[DEBUG] Reached MOD instruction with two different types");
+                              return {};
+#else
+                              std::unreachable();
+#endif
+                          },
+                      },
+                      lhs, rhs);
+}
+
+// why dividing `lhs` by `rhs` would trap, if it would
+inline auto division_error(Value const& lhs, Value const& rhs) -> std::optional<std::string_view>
+{
+    return std::visit(util::Visitor {
+                          []<std::integral T>(T dividend, T divisor) -> std::optional<std::string_view> {
+                              if (divisor == 0) {
+                                  return "integer division by zero";
+                              }
+                              if constexpr (std::is_same_v<T, int64_t>) {
+                                  if (dividend == std::numeric_limits<int64_t>::min() && divisor == -1) {
+                                      return "integer division overflows";
+                                  }
+                              }
+                              return {};
+                          },
+                          []<typename T1, typename T2>(T1, T2) -> std::optional<std::string_view> {
+                              return {};
+                          },
+                      },
+                      lhs, rhs);
+}
+
+// three way comparison pushed as -1, 0 or 1
+inline auto cmp(Value const& lhs, Value const& rhs) -> Value
+{
+    return std::visit(util::Visitor {
+                          []<typename T>(T v1, T v2) -> Value {
+                              auto sign = [](auto cmp) { return static_cast<int64_t>(cmp < 0 ? -1 : (cmp > 0 ? 1 : 0)); };
+                              if constexpr (Arithmetic<T>) {
+                                  return sign(v1 <=> v2);
+                              } else {
+                                  return sign(*v1 <=> *v2);
+                              }
+                          },
+                          []<Opaque T>(T, T) -> Value {
+#ifndef NDEBUG
+                              std::println(std::cerr, "[DEBUG] Reached CMP instruction with functions");
+                              return {};
+#else
+                              std::unreachable();
+#endif
+                          },
+                          []<typename T1, typename T2>(T1, T2) -> Value {
+#ifndef NDEBUG
+                              std::println(std::cerr, "[DEBUG] Reached CMP instruction with two different types");
+                              return {};
+#else
+                              std::unreachable();
+#endif
+                          },
+                      },
+                      lhs, rhs);
+}
+
+inline auto cmpe(Value const& lhs, Value const& rhs) -> Value
+{
+    return std::visit(util::Visitor {
+                          []<typename T>(T v1, T v2) -> Value {
+                              return static_cast<bool>(v1 == v2);
+                          },
+                          []<typename T1, typename T2>(T1, T2) -> Value {
+#ifndef NDEBUG
+                              std::println(std::cerr, "[DEBUG] Reached CMPE instruction with two different types");
+                              return {};
+#else
+                              std::unreachable();
+#endif
+                          },
+                      },
+                      lhs, rhs);
+}
+
+inline auto negate(Value const& value) -> Value
+{
+    return std::visit(util::Visitor {
+                          []<Arithmetic T>(T v1) -> Value {
+                              return -v1;
+                          },
+                          [](bool) -> Value {
+#ifndef NDEBUG
+                              std::println(std::cerr, "[DEBUG] Reached NEGATE instruction with bool type");
+                              return {};
+#else
+                              std::unreachable();
+#endif
+                          },
+                          [](StringPtr) -> Value {
+#ifndef NDEBUG
+                              std::println(std::cerr, "[DEBUG] Reached NEGATE instruction with str types");
+                              return {};
+#else
+                              std::unreachable();
+#endif
+                          },
+                          []<Opaque T>(T) -> Value {
+#ifndef NDEBUG
+                              std::println(std::cerr, "[DEBUG] Reached NEGATE instruction with a function");
+                              return {};
+#else
+                              std::unreachable();
+#endif
+                          },
+                      },
+                      value);
+}
+
+inline auto logical_not(Value const& value) -> Value
+{
+    return std::visit(util::Visitor {
+                          []<typename T>(T v1) -> Value {
+                              return !v1;
+                          },
+                          [](StringPtr iter_to_str) -> Value {
+                              return !iter_to_str->empty();
+                          },
+                          []<Opaque T>(T) -> Value {
+#ifndef NDEBUG
+                              std::println(std::cerr, "[DEBUG] Reached NOT instruction with a function");
+                              return {};
+#else
+                              std::unreachable();
+#endif
+                          },
+                      },
+                      value);
+}
+
+// `MUL` by 2^shift, wrapping the same way
+inline auto shl(Value const& value, uint8_t shift) -> Value
+{
+    if (auto const* v = std::get_if<int64_t>(&value)) {
+        return static_cast<int64_t>(static_cast<uint64_t>(*v) << shift);
+    }
+    return std::get<uint64_t>(value) << shift;
+}
+
+// `DIV` by the constant `divider` was made from
+inline auto div_const(Value const& value, util::divide::Divider divider) -> Value
+{
+    if (auto const* v = std::get_if<int64_t>(&value)) {
+        return util::divide::divide(*v, divider);
+    }
+    return util::divide::divide(std::get<uint64_t>(value), divider);
+}
+
+// `MOD` by `divisor`, given as raw bits of the dividend's representation
+inline auto mod_const(Value const& value, util::divide::Divider divider, uint64_t divisor) -> Value
+{
+    if (auto const* v = std::get_if<int64_t>(&value)) {
+        return util::divide::remainder(*v, divider, static_cast<int64_t>(divisor));
+    }
+    return util::divide::remainder(std::get<uint64_t>(value), divider, divisor);
+}
+
+// applies the strength reduced opcode at `offset` of `bc` to `value`
+inline auto strength_reduced(Opcode opcode, Value const& value, ByteCode const& bc, std::size_t offset) -> Value
+{
+    uint8_t more = bc.code()[offset + 1];
+    switch (opcode) {
+        using enum Opcode;
+        case SHL: return shl(value, more);
+        case DIVP2: return div_const(value, { 0, more });
+        // the remainder takes the dividend's sign, a negative power of two divisor acts like its absolute value
+        case MODP2: return mod_const(value, { 0, static_cast<uint8_t>(more & util::divide::shift_mask) }, uint64_t { 1 } << (more & util::divide::shift_mask));
+        case DIVM: return div_const(value, { bc.read_value<uint64_t>(offset + 2), more });
+        case MODM: return mod_const(value, { bc.read_value<uint64_t>(offset + 2), more }, bc.read_value<uint64_t>(offset + 2 + sizeof(uint64_t)));
+        default: break;
+    }
+#ifndef NDEBUG
+    std::println(std::cerr, "[DEBUG] {} is not a strength reduced opcode", util::opcode::to_string(opcode));
+    return {};
+#else
+    std::unreachable();
+#endif
+}
+
+// whether the compare and branch `opcode` jumps for these operands, defined through `cmp` and `cmpe` so it agrees with them on unordered floats
+inline auto compare_jump(Opcode opcode, Value const& lhs, Value const& rhs) -> bool
+{
+    switch (opcode) {
+        using enum Opcode;
+        case JLT: return std::get<int64_t>(cmp(lhs, rhs)) == -1;
+        case JLE: return std::get<int64_t>(cmp(lhs, rhs)) != 1;
+        case JGT: return std::get<int64_t>(cmp(lhs, rhs)) == 1;
+        case JGE: return std::get<int64_t>(cmp(lhs, rhs)) != -1;
+        case JEQ: return std::get<bool>(cmpe(lhs, rhs));
+        case JNE: return !std::get<bool>(cmpe(lhs, rhs));
+        default: break;
+    }
+#ifndef NDEBUG
+    std::println(std::cerr, "[DEBUG] {} is not a compare and branch opcode", util::opcode::to_string(opcode));
+    return {};
+#else
+    std::unreachable();
+#endif
+}
+
+// applies any binary opcode, `pool` interns the result of string concatenation
+inline auto binary(Opcode opcode, Value const& lhs, Value const& rhs, StringTable& pool) -> Value
+{
+    switch (opcode) {
+        using enum Opcode;
+        case ADD: return add(lhs, rhs, pool);
+        case SUB: return sub(lhs, rhs);
+        case MUL: return mul(lhs, rhs);
+        case DIV: return div(lhs, rhs);
+        case MOD: return mod(lhs, rhs);
+        case CMP: return cmp(lhs, rhs);
+        case CMPE: return cmpe(lhs, rhs);
+        default: break;
+    }
+#ifndef NDEBUG
+    std::println(std::cerr, "[DEBUG] {} is not a binary opcode", util::opcode::to_string(opcode));
+    return {};
+#else
+    std::unreachable();
+#endif
+}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "stats.hpp"
+#include "vm.hpp"
+#include "wordcode.hpp"
+
+// Stack vm executing the fixed width `WordCode` encoding, `m_iptr` is an instruction index
+class WordVM {
+public:
+    WordVM(WordSegment seg)
+        : m_pool { std::move(seg.second) }
+        , m_wc { std::move(seg.first) }
+        , m_globals(m_wc.globals())
+    {
+    }
+    void execute();
+    // same as `execute` but also counts instructions and tracks the peak stack depth
+    void execute(Stats& stats);
+    void execute_next();
+    // puts the vm back where it was made so it can run the code again
+    void reset();
+    // why the last run stopped before `RETURN`, its offset is the index of the word that failed
+    [[nodiscard]] auto error() const noexcept -> std::optional<BytecodeError> const&
+    {
+        return m_error;
+    }
+    [[nodiscard]] auto code() const noexcept -> WordCode const&
+    {
+        return m_wc;
+    }
+
+private:
+    // the constant a `LOAD` or superinstruction word indexes, in its pushed representation
+    [[nodiscard]] auto m_constant(Word word) const -> Stack::value_type;
+    // false and halting at the word just read when dividing `lhs` by `rhs` would trap
+    auto m_divides(Stack::value_type const& lhs, Stack::value_type const& rhs) -> bool;
+
+    auto m_is_end() noexcept -> bool
+    {
+        return m_iptr == m_wc.code().size();
+    }
+
+    Stack m_stack {};
+    StringTable m_pool;
+    WordCode m_wc {};
+    std::vector<Stack::value_type> m_globals;
+    std::size_t m_iptr {};
+    std::optional<BytecodeError> m_error;
+};
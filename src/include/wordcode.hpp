@@ -0,0 +1,189 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "code_segment.hpp"
+#include "instr.hpp"
+#include "types.hpp"
+
+/**
+ * Fixed width encoding of `ByteCode`.
+ *
+ * Every instruction is one aligned 32 bit word laid out as
+ *
+ *   bits  0 -  7  opcode, the same `Opcode` values `ByteCode` uses
+ *   bits  8 - 15  operand `a`
+ *   bits 16 - 31  operand `b`
+ *
+ * Operands wider than a field live in a side table of aligned 64 bit
+ * constants indexed by `b`, so decoding is a single load plus shifts and
+ * an instruction index alone is enough to address a jump target.
+ *
+ * PICK:
+ *   a = depth below the top of stack
+ *
+ * POP, GET_LOCAL, SET_LOCAL:
+ *   a = count or stack slot, the opcode's byte operand
+ *
+ * GET_GLOBAL, SET_GLOBAL:
+ *   b = index into the globals array
+ *
+ * JUMP and every conditional jump:
+ *   b = instruction index of the target, absolute instead of relative
+ *
+ * SHL, DIVP2, MODP2:
+ *   a = the opcode's byte operand
+ *
+ * DIVM, MODM:
+ *   a = the opcode's byte operand
+ *   b = constant index of the magic, followed by the divisor for MODM
+ *
+ * LOAD and every superinstruction:
+ *   a = representation the constant is pushed as (BOOL, INT64, UINT64, FLOAT64 or STRING)
+ *   b = constant index
+ */
+class Word {
+public:
+    constexpr Word(Opcode opcode, uint8_t a = 0, uint16_t b = 0) noexcept
+        : m_raw { static_cast<uint32_t>(std::to_underlying(opcode)) | static_cast<uint32_t>(a) << 8 | static_cast<uint32_t>(b) << 16 }
+    {
+    }
+
+    [[nodiscard]] constexpr auto opcode() const noexcept -> Opcode
+    {
+        return static_cast<Opcode>(m_raw & 0xff);
+    }
+    [[nodiscard]] constexpr auto a() const noexcept -> uint8_t
+    {
+        return static_cast<uint8_t>(m_raw >> 8);
+    }
+    [[nodiscard]] constexpr auto b() const noexcept -> uint16_t
+    {
+        return static_cast<uint16_t>(m_raw >> 16);
+    }
+
+private:
+    uint32_t m_raw;
+};
+static_assert(sizeof(Word) == 4);
+
+class WordCode {
+public:
+    static constexpr std::size_t max_constants = 65'536;
+    static constexpr std::size_t max_jump_target = 65'535;
+
+    [[nodiscard]] auto code() const noexcept -> std::vector<Word> const&
+    {
+        return m_code;
+    }
+    [[nodiscard]] auto constants() const noexcept -> std::vector<uint64_t> const&
+    {
+        return m_constants;
+    }
+    [[nodiscard]] auto line_table() const noexcept -> util::LineTable const&
+    {
+        return m_line_info;
+    }
+    void write_word(Word word, Location location)
+    {
+        m_line_info.write(m_code.size(), location);
+        m_code.push_back(word);
+    }
+    // size of the globals array, the same as the encoded `ByteCode`'s
+    [[nodiscard]] auto globals() const noexcept -> std::size_t
+    {
+        return m_globals;
+    }
+    void set_globals(std::size_t globals) noexcept
+    {
+        m_globals = globals;
+    }
+    [[nodiscard]] auto add_constant(uint64_t bits) -> std::size_t
+    {
+        m_constants.push_back(bits);
+        return m_constants.size() - 1;
+    }
+    // line numbers are keyed by instruction index instead of byte offset
+    [[nodiscard]] auto read_line_number(std::size_t index) const noexcept -> std::size_t
+    {
+        return m_line_info.read_line_number(index);
+    }
+
+private:
+    std::vector<Word> m_code;
+    std::vector<uint64_t> m_constants;
+    util::LineTable m_line_info {};
+    std::size_t m_globals {};
+};
+
+using WordSegment = std::pair<WordCode, StringTable>;
+
+namespace util::wordcode {
+// strings are stored in the constant table as their interned `StringPtr`
+static_assert(sizeof(StringPtr) == sizeof(uint64_t) && std::is_trivially_copyable_v<StringPtr>);
+
+/**
+ * Decodes the constant of the `LOAD` or superinstruction at `offset`,
+ * widened to the representation the vm pushes it as and returned as raw
+ * bits alongside that representation.
+ */
+inline auto decode_constant(ByteCode const& bc, std::size_t offset) noexcept -> std::pair<TypeIndex, uint64_t>
+{
+    auto load = [&]<typename T>(T) -> std::pair<TypeIndex, uint64_t> {
+        auto value = bc.read_value<T>(offset + 2);
+        if constexpr (std::is_same_v<T, bool>) {
+            return { TypeIndex::BOOL, value ? 1 : 0 };
+        } else if constexpr (std::is_same_v<T, StringPtr>) {
+            return { TypeIndex::STRING, std::bit_cast<uint64_t>(value) };
+        } else if constexpr (std::signed_integral<T>) {
+            return { TypeIndex::INT64, std::bit_cast<uint64_t>(static_cast<int64_t>(value)) };
+        } else if constexpr (std::unsigned_integral<T>) {
+            return { TypeIndex::UINT64, static_cast<uint64_t>(value) };
+        } else {
+            return { TypeIndex::FLOAT64, std::bit_cast<uint64_t>(static_cast<double>(value)) };
+        }
+    };
+
+    switch (util::type::get_type(bc.code()[offset + 1])) {
+        using enum TypeIndex;
+        case BOOL: return load(bool {});
+        case INT8: return load(int8_t {});
+        case INT16: return load(int16_t {});
+        case INT32: return load(int32_t {});
+        case INT64: return load(int64_t {});
+        case UINT8: return load(uint8_t {});
+        case UINT16: return load(uint16_t {});
+        case UINT32: return load(uint32_t {});
+        case UINT64: return load(uint64_t {});
+        case FLOAT32: return load(float {});
+        case FLOAT64: return load(double {});
+        case STRING: return load(StringPtr {});
+        case FUNCTION: return { FUNCTION, bc.read_value<uint16_t>(offset + 2) };
+        case INSTANCE:
+        case ARRAY: break;   // instances and arrays are never constants
+    }
+    return {};
+}
+
+/**
+ * Re-encodes `bc` into words, widening every `LOAD` operand to the
+ * representation the vm pushes it as. Empty when the program has more
+ * constants than operand `b` can index, jumps to an instruction it
+ * cannot, has functions, which the word vm has no frames for, or arrays,
+ * which it has no heap for.
+ */
+auto encode(ByteCode const& bc) -> std::optional<WordCode>;
+
+// reads constant `index` back as the representation `T` its instruction names
+template <typename T>
+inline auto constant(WordCode const& wc, std::size_t index) noexcept -> T
+{
+    if constexpr (std::is_same_v<T, bool>) {
+        return wc.constants()[index] != 0;
+    } else {
+        return std::bit_cast<T>(wc.constants()[index]);
+    }
+}
+}
@@ -0,0 +1,881 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <optional>
+#include <print>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <sys/mman.h>
+
+#include "divide.hpp"
+#include "instr.hpp"
+#include "jit.hpp"
+#include "wordcode.hpp"
+
+namespace {
+// runtime representation of a value on the native stack, every one of them is 8 bytes wide
+enum class Rep : uint8_t {
+    BOOL,
+    I64,
+    U64,
+    F64,
+};
+
+auto rep_of(TypeIndex type) -> std::optional<Rep>
+{
+    switch (type) {
+        using enum TypeIndex;
+        case BOOL: return Rep::BOOL;
+        case INT64: return Rep::I64;
+        case UINT64: return Rep::U64;
+        case FLOAT64: return Rep::F64;
+        default: return {};   // `decode_constant` only yields the widened types, strings have no template
+    }
+}
+
+// called from generated code, formats exactly like `util::vm::log`
+void log_bool(bool value)
+{
+    std::println("{}", value);
+}
+void log_i64(int64_t value)
+{
+    std::println("{}", value);
+}
+void log_u64(uint64_t value)
+{
+    std::println("{}", value);
+}
+void log_f64(double value)
+{
+    std::println("{}", value);
+}
+auto fmod_f64(double lhs, double rhs) -> double
+{
+    return std::fmod(lhs, rhs);
+}
+
+/**
+ * Emits the templates while tracking the representation of every value
+ * the generated code keeps on the native stack. Every template pops its
+ * operands into rax/rcx (xmm0/xmm1 for doubles) and pushes its result
+ * from rax, so templates compose without any register allocation.
+ */
+class TemplateEmitter {
+public:
+    // globals live in the native frame, keep it small
+    static constexpr std::size_t max_globals = 1'024;
+
+    explicit TemplateEmitter(std::size_t globals)
+        : m_globals(globals)
+    {
+        m_emit({ 0x55 });               // push rbp
+        m_emit({ 0x48, 0x89, 0xE5 });   // mov rbp, rsp, the stack is 16 byte aligned from here on
+        if (globals > 0) {
+            m_emit({ 0x48, 0x81, 0xEC });   // sub rsp, globals rounded up to keep the alignment
+            m_emit_u32(static_cast<uint32_t>((globals + 1) / 2 * 16));
+        }
+    }
+
+    auto load(TypeIndex type, uint64_t bits) -> bool
+    {
+        auto rep = rep_of(type);
+        if (!rep.has_value()) {
+            return false;
+        }
+        m_mov_rax(bits);
+        m_push(*rep);
+        return true;
+    }
+
+    // `offset` is where the bytecode halts when an integer division traps
+    auto binary(Opcode opcode, std::size_t offset) -> bool
+    {
+        if (m_types.size() < 2 || m_types.back() != m_types[m_types.size() - 2]) {
+            return false;
+        }
+        auto rep = m_types.back();
+        m_pop_operands();
+
+        switch (opcode) {
+            using enum Opcode;
+            case ADD:
+            case SUB:
+            case MUL:
+            case DIV:
+            case MOD: return m_arithmetic(opcode, rep, offset);
+            case CMP: return m_compare(rep);
+            case CMPE: return m_equal(rep);
+            default: return false;
+        }
+    }
+
+    auto unary(Opcode opcode) -> bool
+    {
+        if (m_types.empty()) {
+            return false;
+        }
+        auto rep = m_types.back();
+        if (rep == Rep::BOOL && opcode == Opcode::NEGATE) {
+            return false;
+        }
+        m_pop();
+        m_emit({ 0x58 });   // pop rax
+
+        if (opcode == Opcode::NEGATE) {
+            if (rep == Rep::F64) {
+                m_emit({ 0x48, 0xB9 });   // mov rcx, sign bit
+                m_emit_u64(0x8000'0000'0000'0000);
+                m_emit({ 0x48, 0x31, 0xC8 });   // xor rax, rcx
+            } else {
+                m_emit({ 0x48, 0xF7, 0xD8 });   // neg rax
+            }
+            m_push(rep);
+            return true;
+        }
+
+        switch (rep) {
+            case Rep::BOOL:
+                m_emit({ 0x48, 0x83, 0xF0, 0x01 });   // xor rax, 1
+                break;
+            case Rep::I64:
+            case Rep::U64:
+                m_emit({ 0x48, 0x85, 0xC0 });   // test rax, rax
+                m_emit({ 0x0F, 0x94, 0xC0 });   // sete al
+                m_emit({ 0x0F, 0xB6, 0xC0 });   // movzx eax, al
+                break;
+            case Rep::F64:
+                m_emit({ 0x66, 0x48, 0x0F, 0x6E, 0xC0 });   // movq xmm0, rax
+                m_emit({ 0x66, 0x0F, 0x57, 0xC9 });         // xorpd xmm1, xmm1
+                m_emit_sete_ordered();
+                break;
+        }
+        m_push(Rep::BOOL);
+        return true;
+    }
+
+    auto log() -> bool
+    {
+        if (m_types.empty()) {
+            return false;
+        }
+        auto rep = m_types.back();
+        m_pop();
+        if (rep == Rep::F64) {
+            m_emit({ 0x58 });                           // pop rax
+            m_emit({ 0x66, 0x48, 0x0F, 0x6E, 0xC0 });   // movq xmm0, rax
+        } else {
+            m_emit({ 0x5F });   // pop rdi
+        }
+
+        switch (rep) {
+            case Rep::BOOL: m_call(std::bit_cast<uint64_t>(&log_bool)); break;
+            case Rep::I64: m_call(std::bit_cast<uint64_t>(&log_i64)); break;
+            case Rep::U64: m_call(std::bit_cast<uint64_t>(&log_u64)); break;
+            case Rep::F64: m_call(std::bit_cast<uint64_t>(&log_f64)); break;
+        }
+        return true;
+    }
+
+    auto pick(std::size_t depth) -> bool
+    {
+        if (depth >= m_types.size()) {
+            return false;
+        }
+        m_emit({ 0x48, 0x8B, 0x84, 0x24 });   // mov rax, [rsp + 8 * depth]
+        m_emit_u32(static_cast<uint32_t>(depth) * 8);
+        m_push(m_types[m_types.size() - 1 - depth]);
+        return true;
+    }
+
+    auto pop(std::size_t count) -> bool
+    {
+        if (count > m_types.size()) {
+            return false;
+        }
+        m_emit({ 0x48, 0x81, 0xC4 });   // add rsp, 8 * count
+        m_emit_u32(static_cast<uint32_t>(count) * 8);
+        m_types.resize(m_types.size() - count);
+        return true;
+    }
+
+    // locals are native stack slots counted from the bottom of the operand stack
+    auto get_local(std::size_t slot) -> bool
+    {
+        return slot < m_types.size() && pick(m_types.size() - 1 - slot);
+    }
+
+    auto set_local(std::size_t slot) -> bool
+    {
+        if (slot + 1 >= m_types.size() || m_types[slot] != m_types.back()) {
+            return false;
+        }
+        m_emit({ 0x48, 0x8B, 0x04, 0x24 });   // mov rax, [rsp]
+        m_emit({ 0x48, 0x89, 0x84, 0x24 });   // mov [rsp + 8 * depth], rax
+        m_emit_u32(static_cast<uint32_t>(m_types.size() - 1 - slot) * 8);
+        return true;
+    }
+
+    // globals sit right below the saved rbp
+    auto get_global(std::size_t index) -> bool
+    {
+        if (index >= m_globals.size() || !m_globals[index].has_value()) {
+            return false;
+        }
+        m_emit({ 0x48, 0x8B, 0x85 });   // mov rax, [rbp - 8 * (index + 1)]
+        m_emit_u32(static_cast<uint32_t>(-8 * static_cast<int32_t>(index + 1)));
+        m_push(m_globals[index].value());
+        return true;
+    }
+
+    auto set_global(std::size_t index) -> bool
+    {
+        if (index >= m_globals.size() || m_types.empty() || m_globals[index].value_or(m_types.back()) != m_types.back()) {
+            return false;
+        }
+        m_emit({ 0x48, 0x8B, 0x04, 0x24 });   // mov rax, [rsp]
+        m_emit({ 0x48, 0x89, 0x85 });         // mov [rbp - 8 * (index + 1)], rax
+        m_emit_u32(static_cast<uint32_t>(-8 * static_cast<int32_t>(index + 1)));
+        m_globals[index] = m_types.back();
+        return true;
+    }
+
+    // `MUL` by 2^shift, which is the same shift for both signednesses
+    auto shl(uint8_t shift) -> bool
+    {
+        if (m_types.empty() || (m_types.back() != Rep::I64 && m_types.back() != Rep::U64)) {
+            return false;
+        }
+        auto rep = m_types.back();
+        m_pop();
+        m_emit({ 0x58 });                     // pop rax
+        m_emit({ 0x48, 0xC1, 0xE0, shift });   // shl rax, shift
+        m_push(rep);
+        return true;
+    }
+
+    // `DIV` or `MOD` by a constant, `divisor` is only read for remainders
+    auto divide(Opcode opcode, util::divide::Divider divider, uint64_t divisor) -> bool
+    {
+        if (m_types.empty() || (m_types.back() != Rep::I64 && m_types.back() != Rep::U64)) {
+            return false;
+        }
+        auto rep = m_types.back();
+        m_pop();
+        m_emit({ 0x58 });   // pop rax
+
+        bool is_remainder = opcode == Opcode::MODP2 || opcode == Opcode::MODM;
+        if (opcode == Opcode::MODP2 && rep == Rep::U64) {
+            m_emit({ 0x48, 0xB9 });   // mov rcx, 2^shift - 1
+            m_emit_u64(divisor - 1);
+            m_emit({ 0x48, 0x21, 0xC8 });   // and rax, rcx
+            m_push(rep);
+            return true;
+        }
+        if (is_remainder) {
+            m_emit({ 0x49, 0x89, 0xC0 });   // mov r8, rax, keep the dividend
+        }
+        rep == Rep::I64 ? m_signed_quotient(divider) : m_unsigned_quotient(divider);
+        if (is_remainder) {
+            m_emit({ 0x48, 0xB9 });   // mov rcx, divisor
+            m_emit_u64(divisor);
+            m_emit({ 0x48, 0x0F, 0xAF, 0xC1 });   // imul rax, rcx
+            m_emit({ 0x49, 0x29, 0xC0 });         // sub r8, rax
+            m_emit({ 0x4C, 0x89, 0xC0 });         // mov rax, r8
+        }
+        m_push(rep);
+        return true;
+    }
+
+    /**
+     * Marks the bytecode at `offset`, a jump target, as starting here.
+     *
+     * Every jump to it has to agree on the operand stack, so it is the
+     * same native stack layout whichever way control arrives. Globals
+     * only count as set when every way in set them.
+     */
+    auto bind(std::size_t offset) -> bool
+    {
+        auto& label = m_labels[offset];
+        if (label.state.has_value()) {
+            if (m_is_reachable && !m_join(label.state.value(), { m_types, m_globals })) {
+                return false;
+            }
+            m_types   = label.state->types;
+            m_globals = label.state->globals;
+        }
+        m_is_reachable = true;
+        label.native   = m_code.size();
+        label.state    = State { m_types, m_globals };   // what backward jumps are checked against
+        for (auto fixup : label.fixups) {
+            m_patch_rel32(fixup, m_code.size());
+        }
+        label.fixups.clear();
+        return true;
+    }
+
+    // `JUMP`, `JUMP_IF_FALSE` and the `and`, `or` jumps which keep their condition when taken
+    auto jump(Opcode opcode, std::size_t target) -> bool
+    {
+        if (opcode == Opcode::JUMP) {
+            m_emit({ 0xE9 });   // jmp rel32
+            auto is_bound = m_branch(target, { m_types, m_globals });
+            m_is_reachable = false;
+            return is_bound;
+        }
+        if (m_types.empty() || m_types.back() != Rep::BOOL) {
+            return false;
+        }
+        if (opcode == Opcode::JUMP_IF_FALSE) {
+            m_pop();
+            m_emit({ 0x58 });               // pop rax
+            m_emit({ 0x48, 0x85, 0xC0 });   // test rax, rax
+            m_emit({ 0x0F, 0x84 });         // je rel32
+            return m_branch(target, { m_types, m_globals });
+        }
+        m_emit({ 0x48, 0x8B, 0x04, 0x24 });   // mov rax, [rsp]
+        m_emit({ 0x48, 0x85, 0xC0 });         // test rax, rax
+        m_emit({ 0x0F, static_cast<uint8_t>(opcode == Opcode::JUMP_IF_FALSE_OR_POP ? 0x84 : 0x85) });   // je or jne rel32
+        if (!m_branch(target, { m_types, m_globals })) {
+            return false;
+        }
+        m_pop();
+        m_emit({ 0x48, 0x83, 0xC4, 0x08 });   // add rsp, 8
+        return true;
+    }
+
+    // compare and branch, one cmp or ucomisd followed by the conditional jump for the operands' representation
+    auto compare_jump(Opcode opcode, std::size_t target) -> bool
+    {
+        if (m_types.size() < 2 || m_types.back() != m_types[m_types.size() - 2]) {
+            return false;
+        }
+        auto rep = m_types.back();
+        m_pop_operands();
+        State taken { m_types, m_globals };
+
+        if (rep != Rep::F64) {
+            m_emit({ 0x48, 0x39, 0xC8 });   // cmp rax, rcx
+            bool is_signed = rep == Rep::I64;
+            uint8_t condition {};
+            switch (opcode) {
+                using enum Opcode;
+                case JLT: condition = is_signed ? 0x8C : 0x82; break;   // jl or jb
+                case JLE: condition = is_signed ? 0x8E : 0x86; break;   // jle or jbe
+                case JGT: condition = is_signed ? 0x8F : 0x87; break;   // jg or ja
+                case JGE: condition = is_signed ? 0x8D : 0x83; break;   // jge or jae
+                case JEQ: condition = 0x84; break;                       // je
+                case JNE: condition = 0x85; break;                       // jne
+                default: return false;
+            }
+            m_emit({ 0x0F, condition });
+            return m_branch(target, taken);
+        }
+
+        // unordered operands set every flag, they only satisfy the negated relations like with `util::vm::cmp`
+        m_emit({ 0x66, 0x48, 0x0F, 0x6E, 0xC0 });   // movq xmm0, rax
+        m_emit({ 0x66, 0x48, 0x0F, 0x6E, 0xC9 });   // movq xmm1, rcx
+        switch (opcode) {
+            using enum Opcode;
+            case JLT:
+                m_emit({ 0x66, 0x0F, 0x2E, 0xC8 });   // ucomisd xmm1, xmm0
+                m_emit({ 0x0F, 0x87 });               // ja rel32
+                return m_branch(target, taken);
+            case JGT:
+                m_emit({ 0x66, 0x0F, 0x2E, 0xC1 });   // ucomisd xmm0, xmm1
+                m_emit({ 0x0F, 0x87 });               // ja rel32
+                return m_branch(target, taken);
+            case JLE:
+                m_emit({ 0x66, 0x0F, 0x2E, 0xC1 });   // ucomisd xmm0, xmm1
+                m_emit({ 0x0F, 0x86 });               // jbe rel32
+                return m_branch(target, taken);
+            case JGE:
+                m_emit({ 0x66, 0x0F, 0x2E, 0xC8 });   // ucomisd xmm1, xmm0
+                m_emit({ 0x0F, 0x86 });               // jbe rel32
+                return m_branch(target, taken);
+            case JEQ:
+                m_emit({ 0x66, 0x0F, 0x2E, 0xC1 });   // ucomisd xmm0, xmm1
+                m_emit({ 0x7A, 0x06 });               // jp over the je
+                m_emit({ 0x0F, 0x84 });               // je rel32
+                return m_branch(target, taken);
+            case JNE:
+                m_emit({ 0x66, 0x0F, 0x2E, 0xC1 });   // ucomisd xmm0, xmm1
+                m_emit({ 0x0F, 0x8A });               // jp rel32
+                if (!m_branch(target, taken)) {
+                    return false;
+                }
+                m_emit({ 0x0F, 0x85 });   // jne rel32
+                return m_branch(target, taken);
+            default: return false;
+        }
+    }
+
+    /**
+     * Returns the code and what each of its halts stopped at, empty when
+     * a jump's target was never bound, its code was not compiled.
+     *
+     * The code returns 0 when it reaches the end and the index of the halt
+     * plus one when a division traps, every halt is a stub after the
+     * epilogue which loads its index and leaves through the epilogue.
+     */
+    auto finish() && -> std::optional<std::pair<std::vector<uint8_t>, std::vector<BytecodeError>>>
+    {
+        m_emit({ 0x31, 0xC0 });   // xor eax, eax
+        auto epilogue = m_code.size();
+        m_emit({ 0x48, 0x89, 0xEC });   // mov rsp, rbp, drops whatever is left on the operand stack
+        m_emit({ 0x5D });               // pop rbp
+        m_emit({ 0xC3 });               // ret
+        if (std::ranges::any_of(m_labels, [](auto const& label) { return !label.second.fixups.empty(); })) {
+            return {};
+        }
+
+        std::vector<BytecodeError> errors;
+        for (auto& [field, error] : m_halts) {
+            m_patch_rel32(field, m_code.size());
+            m_emit({ 0xB8 });   // mov eax, index + 1
+            m_emit_u32(static_cast<uint32_t>(errors.size() + 1));
+            m_emit({ 0xE9 });   // jmp rel32
+            m_emit_u32(0);
+            m_patch_rel32(m_code.size() - sizeof(uint32_t), epilogue);
+            errors.push_back(std::move(error));
+        }
+        return std::pair { std::move(m_code), std::move(errors) };
+    }
+
+private:
+    // what the compiled code knows about the operand stack and the globals at some point
+    struct State {
+        std::vector<Rep> types;
+        std::vector<std::optional<Rep>> globals;
+    };
+
+    struct Label {
+        std::optional<std::size_t> native;   // offset into `m_code` once bound
+        std::optional<State> state;          // agreed on by every jump so far
+        std::vector<std::size_t> fixups;     // rel32 fields of forward jumps waiting for `native`
+    };
+
+    // merges `other` into `state`, false when the stacks disagree or a global is set with different types
+    static auto m_join(State& state, State const& other) -> bool
+    {
+        if (state.types != other.types) {
+            return false;
+        }
+        for (std::size_t index {}; index < state.globals.size(); index++) {
+            if (state.globals[index] != other.globals[index]) {
+                if (state.globals[index].has_value() && other.globals[index].has_value()) {
+                    return false;
+                }
+                state.globals[index].reset();
+            }
+        }
+        return true;
+    }
+
+    // finishes the jump whose opcode bytes were just emitted with its rel32, leaving `taken` at `target`
+    auto m_branch(std::size_t target, State const& taken) -> bool
+    {
+        auto& label = m_labels[target];
+        auto field  = m_code.size();
+        m_emit_u32(0);
+        if (!label.native.has_value()) {
+            label.fixups.push_back(field);
+            if (!label.state.has_value()) {
+                label.state = taken;
+                return true;
+            }
+            return m_join(label.state.value(), taken);
+        }
+        // a backward jump, the code at the target already relies on the globals it was compiled with
+        auto const& bound = label.state.value();
+        for (std::size_t index {}; index < bound.globals.size(); index++) {
+            if (bound.globals[index].has_value() && bound.globals[index] != taken.globals[index]) {
+                return false;
+            }
+        }
+        m_patch_rel32(field, label.native.value());
+        return bound.types == taken.types;
+    }
+
+    // finishes the jump whose opcode bytes were just emitted with the rel32 of a stub halting at `offset`
+    void m_halt(std::size_t offset, std::string_view message)
+    {
+        m_halts.emplace_back(m_code.size(), BytecodeError { offset, std::string { message } });
+        m_emit_u32(0);
+    }
+
+    void m_patch_rel32(std::size_t field, std::size_t target)
+    {
+        auto rel   = static_cast<int32_t>(static_cast<std::ptrdiff_t>(target) - static_cast<std::ptrdiff_t>(field + sizeof(int32_t)));
+        auto bytes = std::bit_cast<std::array<uint8_t, sizeof(rel)>>(rel);
+        std::ranges::copy(bytes, std::next(m_code.begin(), static_cast<std::ptrdiff_t>(field)));
+    }
+
+    auto m_arithmetic(Opcode opcode, Rep rep, std::size_t offset) -> bool
+    {
+        if (rep == Rep::BOOL) {
+            return false;
+        }
+
+        if (rep == Rep::F64) {
+            m_emit({ 0x66, 0x48, 0x0F, 0x6E, 0xC0 });   // movq xmm0, rax
+            m_emit({ 0x66, 0x48, 0x0F, 0x6E, 0xC9 });   // movq xmm1, rcx
+            switch (opcode) {
+                using enum Opcode;
+                case ADD: m_emit({ 0xF2, 0x0F, 0x58, 0xC1 }); break;   // addsd xmm0, xmm1
+                case SUB: m_emit({ 0xF2, 0x0F, 0x5C, 0xC1 }); break;   // subsd xmm0, xmm1
+                case MUL: m_emit({ 0xF2, 0x0F, 0x59, 0xC1 }); break;   // mulsd xmm0, xmm1
+                case DIV: m_emit({ 0xF2, 0x0F, 0x5E, 0xC1 }); break;   // divsd xmm0, xmm1
+                default: m_call(std::bit_cast<uint64_t>(&fmod_f64)); break;
+            }
+            m_emit({ 0x66, 0x48, 0x0F, 0x7E, 0xC0 });   // movq rax, xmm0
+            m_push(rep);
+            return true;
+        }
+
+        switch (opcode) {
+            using enum Opcode;
+            case ADD: m_emit({ 0x48, 0x01, 0xC8 }); break;         // add rax, rcx
+            case SUB: m_emit({ 0x48, 0x29, 0xC8 }); break;         // sub rax, rcx
+            case MUL: m_emit({ 0x48, 0x0F, 0xAF, 0xC1 }); break;   // imul rax, rcx, the low half is the same for unsigned
+            case DIV:
+            case MOD:
+                // the same traps `util::vm::division_error` reports, checked before the instruction would fault
+                m_emit({ 0x48, 0x85, 0xC9 });   // test rcx, rcx
+                m_emit({ 0x0F, 0x84 });         // je rel32
+                m_halt(offset, "integer division by zero");
+                if (rep == Rep::I64) {
+                    m_emit({ 0x48, 0x83, 0xF9, 0xFF });   // cmp rcx, -1
+                    m_emit({ 0x75, 0x13 });               // jne over the dividend check
+                    m_emit({ 0x48, 0xBA });               // mov rdx, INT64_MIN
+                    m_emit_u64(std::bit_cast<uint64_t>(std::numeric_limits<int64_t>::min()));
+                    m_emit({ 0x48, 0x39, 0xD0 });   // cmp rax, rdx
+                    m_emit({ 0x0F, 0x84 });         // je rel32
+                    m_halt(offset, "integer division overflows");
+                    m_emit({ 0x48, 0x99 });         // cqo
+                    m_emit({ 0x48, 0xF7, 0xF9 });   // idiv rcx
+                } else {
+                    m_emit({ 0x31, 0xD2 });         // xor edx, edx
+                    m_emit({ 0x48, 0xF7, 0xF1 });   // div rcx
+                }
+                if (opcode == MOD) {
+                    m_emit({ 0x48, 0x89, 0xD0 });   // mov rax, rdx
+                }
+                break;
+            default: return false;
+        }
+        m_push(rep);
+        return true;
+    }
+
+    // three way comparison, -1, 0 or 1 as an i64 like `util::vm::cmp`
+    auto m_compare(Rep rep) -> bool
+    {
+        switch (rep) {
+            case Rep::I64:
+                m_emit({ 0x48, 0x39, 0xC8 });   // cmp rax, rcx
+                m_emit({ 0x0F, 0x9F, 0xC0 });   // setg al
+                m_emit({ 0x0F, 0x9C, 0xC1 });   // setl cl
+                break;
+            case Rep::BOOL:
+            case Rep::U64:
+                m_emit({ 0x48, 0x39, 0xC8 });   // cmp rax, rcx
+                m_emit({ 0x0F, 0x97, 0xC0 });   // seta al
+                m_emit({ 0x0F, 0x92, 0xC1 });   // setb cl
+                break;
+            case Rep::F64:
+                // compare both ways so unordered operands yield 0 like the partial ordering does
+                m_emit({ 0x66, 0x48, 0x0F, 0x6E, 0xC0 });   // movq xmm0, rax
+                m_emit({ 0x66, 0x48, 0x0F, 0x6E, 0xC9 });   // movq xmm1, rcx
+                m_emit({ 0x66, 0x0F, 0x2E, 0xC1 });         // ucomisd xmm0, xmm1
+                m_emit({ 0x0F, 0x97, 0xC0 });               // seta al
+                m_emit({ 0x66, 0x0F, 0x2E, 0xC8 });         // ucomisd xmm1, xmm0
+                m_emit({ 0x0F, 0x97, 0xC1 });               // seta cl
+                break;
+        }
+        m_emit({ 0x28, 0xC8 });               // sub al, cl
+        m_emit({ 0x48, 0x0F, 0xBE, 0xC0 });   // movsx rax, al
+        m_push(Rep::I64);
+        return true;
+    }
+
+    auto m_equal(Rep rep) -> bool
+    {
+        if (rep == Rep::F64) {
+            m_emit({ 0x66, 0x48, 0x0F, 0x6E, 0xC0 });   // movq xmm0, rax
+            m_emit({ 0x66, 0x48, 0x0F, 0x6E, 0xC9 });   // movq xmm1, rcx
+            m_emit_sete_ordered();
+        } else {
+            m_emit({ 0x48, 0x39, 0xC8 });   // cmp rax, rcx
+            m_emit({ 0x0F, 0x94, 0xC0 });   // sete al
+            m_emit({ 0x0F, 0xB6, 0xC0 });   // movzx eax, al
+        }
+        m_push(Rep::BOOL);
+        return true;
+    }
+
+    // rax = xmm0 == xmm1, false for NaN operands
+    void m_emit_sete_ordered()
+    {
+        m_emit({ 0x66, 0x0F, 0x2E, 0xC1 });   // ucomisd xmm0, xmm1
+        m_emit({ 0x0F, 0x94, 0xC0 });         // sete al
+        m_emit({ 0x0F, 0x9B, 0xC1 });         // setnp cl
+        m_emit({ 0x20, 0xC8 });               // and al, cl
+        m_emit({ 0x0F, 0xB6, 0xC0 });         // movzx eax, al
+    }
+
+    void m_pop_operands()
+    {
+        m_pop();
+        m_pop();
+        m_emit({ 0x59 });   // pop rcx
+        m_emit({ 0x58 });   // pop rax
+    }
+
+    void m_mov_rax(uint64_t imm)
+    {
+        m_emit({ 0x48, 0xB8 });   // mov rax, imm64
+        m_emit_u64(imm);
+    }
+
+    // calls `function` keeping rsp 16 byte aligned, which depends on how many values are on the operand stack
+    void m_call(uint64_t function)
+    {
+        bool misaligned = m_types.size() % 2 != 0;
+        if (misaligned) {
+            m_emit({ 0x48, 0x83, 0xEC, 0x08 });   // sub rsp, 8
+        }
+        m_mov_rax(function);
+        m_emit({ 0xFF, 0xD0 });   // call rax
+        if (misaligned) {
+            m_emit({ 0x48, 0x83, 0xC4, 0x08 });   // add rsp, 8
+        }
+    }
+
+    // pushes rax, which holds a value of representation `rep`
+    void m_push(Rep rep)
+    {
+        m_emit({ 0x50 });   // push rax
+        m_types.push_back(rep);
+    }
+
+    void m_pop()
+    {
+        m_types.pop_back();
+    }
+
+    // rax = rax / divisor, see `util::divide::divide`
+    void m_unsigned_quotient(util::divide::Divider divider)
+    {
+        if (divider.is_power_of_two()) {
+            m_emit({ 0x48, 0xC1, 0xE8, divider.shift() });   // shr rax, shift
+            return;
+        }
+        m_emit({ 0x48, 0x89, 0xC1 });   // mov rcx, rax
+        m_emit({ 0x48, 0xB8 });         // mov rax, magic
+        m_emit_u64(divider.magic);
+        m_emit({ 0x48, 0xF7, 0xE1 });   // mul rcx, rdx = high half
+        if ((divider.more & util::divide::add_marker) != 0) {
+            m_emit({ 0x48, 0x89, 0xC8 });   // mov rax, rcx
+            m_emit({ 0x48, 0x29, 0xD0 });   // sub rax, rdx
+            m_emit({ 0x48, 0xD1, 0xE8 });   // shr rax, 1
+            m_emit({ 0x48, 0x01, 0xD0 });   // add rax, rdx
+        } else {
+            m_emit({ 0x48, 0x89, 0xD0 });   // mov rax, rdx
+        }
+        m_emit({ 0x48, 0xC1, 0xE8, divider.shift() });   // shr rax, shift
+    }
+
+    // rax = rax / divisor rounded towards zero
+    void m_signed_quotient(util::divide::Divider divider)
+    {
+        bool is_negative = (divider.more & util::divide::negative_marker) != 0;
+        if (divider.is_power_of_two()) {
+            if (divider.shift() > 0) {
+                m_emit({ 0x48, 0x89, 0xC1 });                                           // mov rcx, rax
+                m_emit({ 0x48, 0xC1, 0xF9, 0x3F });                                     // sar rcx, 63
+                m_emit({ 0x48, 0xC1, 0xE9, static_cast<uint8_t>(64 - divider.shift()) });   // shr rcx, 64 - shift, bias negative dividends
+                m_emit({ 0x48, 0x01, 0xC8 });                                           // add rax, rcx
+                m_emit({ 0x48, 0xC1, 0xF8, divider.shift() });                          // sar rax, shift
+            }
+            if (is_negative) {
+                m_emit({ 0x48, 0xF7, 0xD8 });   // neg rax
+            }
+            return;
+        }
+        m_emit({ 0x48, 0x89, 0xC1 });   // mov rcx, rax
+        m_emit({ 0x48, 0xB8 });         // mov rax, magic
+        m_emit_u64(divider.magic);
+        m_emit({ 0x48, 0xF7, 0xE9 });   // imul rcx, rdx = high half
+        if ((divider.more & util::divide::add_marker) != 0) {
+            m_emit(is_negative ? std::initializer_list<uint8_t> { 0x48, 0x29, 0xCA }     // sub rdx, rcx
+                               : std::initializer_list<uint8_t> { 0x48, 0x01, 0xCA });   // add rdx, rcx
+        }
+        m_emit({ 0x48, 0x89, 0xD0 });                    // mov rax, rdx
+        m_emit({ 0x48, 0xC1, 0xF8, divider.shift() });   // sar rax, shift
+        m_emit({ 0x48, 0x89, 0xC1 });                    // mov rcx, rax
+        m_emit({ 0x48, 0xC1, 0xE9, 0x3F });              // shr rcx, 63
+        m_emit({ 0x48, 0x01, 0xC8 });                    // add rax, rcx, round negative quotients up
+    }
+
+    void m_emit(std::initializer_list<uint8_t> bytes)
+    {
+        m_code.insert(m_code.end(), bytes);
+    }
+
+    void m_emit_u32(uint32_t value)
+    {
+        auto bytes = std::bit_cast<std::array<uint8_t, sizeof(value)>>(value);
+        m_code.insert(m_code.end(), bytes.begin(), bytes.end());
+    }
+
+    void m_emit_u64(uint64_t value)
+    {
+        auto bytes = std::bit_cast<std::array<uint8_t, sizeof(value)>>(value);
+        m_code.insert(m_code.end(), bytes.begin(), bytes.end());
+    }
+
+    std::vector<uint8_t> m_code;
+    std::vector<Rep> m_types;
+    std::vector<std::optional<Rep>> m_globals;   // empty until the code sets the global
+    std::unordered_map<std::size_t, Label> m_labels;   // by bytecode offset of the jump target
+    std::vector<std::pair<std::size_t, BytecodeError>> m_halts;   // rel32 fields of the jumps to each halt stub
+    bool m_is_reachable { true };                      // false right after a `JUMP`, until the next label
+};
+}
+
+auto Jit::compile(ByteCode const& bc) -> std::optional<Jit>
+{
+    // calls need frames the templates do not keep, programs with functions stay interpreted
+    if (bc.globals() > TemplateEmitter::max_globals || !bc.functions().empty()) {
+        return {};
+    }
+    // jump targets first, the code for a label is bound before the code jumping back to it
+    std::vector<bool> targets(bc.code().size());
+    for (std::size_t offset {}; offset < bc.code().size(); offset += util::opcode::length(bc, offset)) {
+        if (util::opcode::is_jump(static_cast<Opcode>(bc.code()[offset]))) {
+            auto target = util::opcode::jump_target(bc, offset);
+            if (target < 0 || static_cast<std::size_t>(target) >= bc.code().size()) {
+                return {};
+            }
+            targets[static_cast<std::size_t>(target)] = true;
+        }
+    }
+
+    TemplateEmitter emitter { bc.globals() };
+    for (std::size_t offset {}; offset < bc.code().size(); offset += util::opcode::length(bc, offset)) {
+        if (targets[offset] && !emitter.bind(offset)) {
+            return {};
+        }
+        auto opcode = static_cast<Opcode>(bc.code()[offset]);
+        if (opcode == Opcode::RETURN) {
+            break;
+        }
+
+        // superinstructions are compiled as their `LOAD` followed by the opcode they fuse
+        if (util::opcode::has_constant(opcode)) {
+            auto [type, bits] = util::wordcode::decode_constant(bc, offset);
+            if (!emitter.load(type, bits)) {
+                return {};
+            }
+        }
+
+        bool is_supported {};
+        switch (util::opcode::unfused(opcode)) {
+            using enum Opcode;
+            case LOAD: is_supported = true; break;
+            case LOG: is_supported = emitter.log(); break;
+            case ADD:
+            case SUB:
+            case MUL:
+            case DIV:
+            case MOD:
+            case CMP:
+            case CMPE: is_supported = emitter.binary(util::opcode::unfused(opcode), offset); break;
+            case NEGATE:
+            case NOT: is_supported = emitter.unary(opcode); break;
+            case PICK: is_supported = emitter.pick(bc.code()[offset + 1]); break;
+            case POP: is_supported = emitter.pop(bc.code()[offset + 1]); break;
+            case GET_LOCAL: is_supported = emitter.get_local(bc.code()[offset + 1]); break;
+            case SET_LOCAL: is_supported = emitter.set_local(bc.code()[offset + 1]); break;
+            case GET_GLOBAL: is_supported = emitter.get_global(bc.read_value<uint16_t>(offset + 1)); break;
+            case SET_GLOBAL: is_supported = emitter.set_global(bc.read_value<uint16_t>(offset + 1)); break;
+            case SHL: is_supported = emitter.shl(bc.code()[offset + 1]); break;
+            case DIVP2: is_supported = emitter.divide(opcode, { 0, bc.code()[offset + 1] }, 0); break;
+            case MODP2: {
+                uint8_t shift = bc.code()[offset + 1] & util::divide::shift_mask;
+                is_supported  = emitter.divide(opcode, { 0, shift }, uint64_t { 1 } << shift);
+            } break;
+            case DIVM: is_supported = emitter.divide(opcode, { bc.read_value<uint64_t>(offset + 2), bc.code()[offset + 1] }, 0); break;
+            case MODM: is_supported = emitter.divide(opcode, { bc.read_value<uint64_t>(offset + 2), bc.code()[offset + 1] }, bc.read_value<uint64_t>(offset + 2 + sizeof(uint64_t))); break;
+            case JUMP:
+            case JUMP_IF_FALSE:
+            case JUMP_IF_FALSE_OR_POP:
+            case JUMP_IF_TRUE_OR_POP: is_supported = emitter.jump(opcode, static_cast<std::size_t>(util::opcode::jump_target(bc, offset))); break;
+            case JLT:
+            case JLE:
+            case JGT:
+            case JGE:
+            case JEQ:
+            case JNE: is_supported = emitter.compare_jump(opcode, static_cast<std::size_t>(util::opcode::jump_target(bc, offset))); break;
+            default: break;
+        }
+        if (!is_supported) {
+            return {};
+        }
+    }
+    auto finished = std::move(emitter).finish();
+    if (!finished.has_value()) {
+        return {};
+    }
+    auto& [code, halts] = finished.value();
+
+    void* memory = mmap(nullptr, code.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return {};
+    }
+    std::memcpy(memory, code.data(), code.size());
+    // never writable and executable at the same time
+    if (mprotect(memory, code.size(), PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, code.size());
+        return {};
+    }
+    return Jit { memory, code.size(), std::move(halts) };
+}
+
+Jit::Jit(Jit&& other) noexcept
+    : m_code { std::exchange(other.m_code, nullptr) }
+    , m_size { std::exchange(other.m_size, 0) }
+    , m_halts { std::move(other.m_halts) }
+    , m_error { std::move(other.m_error) }
+{
+}
+
+auto Jit::operator=(Jit&& other) noexcept -> Jit&
+{
+    std::swap(m_code, other.m_code);
+    std::swap(m_size, other.m_size);
+    std::swap(m_halts, other.m_halts);
+    std::swap(m_error, other.m_error);
+    return *this;
+}
+
+Jit::~Jit()
+{
+    if (m_code != nullptr) {
+        munmap(m_code, m_size);
+    }
+}
+
+void Jit::execute()
+{
+    auto halt = reinterpret_cast<uint64_t (*)()>(m_code)();
+    m_error   = halt == 0 ? std::nullopt : std::optional { m_halts[halt - 1] };
+}
@@ -17,7 +17,7 @@ auto Lexer::scan() && -> std::vector<Token>&&
     while (!m_is_end()) {
         m_tokens.emplace_back(scan_token());
     }
-    if (m_tokens.back().type != TokenType::END) {
+    if (m_tokens.empty() || m_tokens.back().type != TokenType::END) {
         m_start = m_curr;
         m_tokens.emplace_back(m_create_token(TokenType::END));
     }
@@ -50,6 +50,8 @@ auto Lexer::scan_token() -> Token
         case ')': return m_create_token(RIGHT_PAREN);
         case '{': return m_create_token(LEFT_BRACE);
         case '}': return m_create_token(RIGHT_BRACE);
+        case '[': return m_create_token(LEFT_BRACKET);
+        case ']': return m_create_token(RIGHT_BRACKET);
         case ';': return m_create_token(SEMICOLON);
         case ',': return m_create_token(COMMA);
         case '.': return m_create_token(DOT);
@@ -88,6 +90,7 @@ auto Lexer::m_create_token(TokenType type) const noexcept -> Token
         type,
         std::string_view { m_start, m_curr },
         m_line,
+        m_column(),
     };
 }
 
@@ -97,6 +100,7 @@ auto Lexer::m_create_errtok(std::string_view err_msg) const noexcept -> Token
         TokenType::ERROR,
         err_msg,
         m_line,
+        m_column(),
     };
 }
 
@@ -105,7 +109,7 @@ auto Lexer::m_create_strtok() -> Token
     for (char c {}; !m_is_end() && (c = m_peek()) != '"';) {
         switch (c) {
             case '\n':
-                m_line++;
+                m_newline();
                 break;
             case '$':
                 if (m_peek_next() == '{') {
@@ -174,6 +178,7 @@ auto Lexer::m_create_idtok() noexcept -> Token
     switch (*m_start) {
         using enum TokenType;
         case 'a': return m_match_kwd(1, "nd", AND);
+        case 'b': return m_match_kwd(1, "ool", BOOL);
         case 'c':
             if (std::distance(m_start, m_curr) > 1) {
                 switch (*std::next(m_start)) {
@@ -187,8 +192,8 @@ auto Lexer::m_create_idtok() noexcept -> Token
         case 'f':
             if (std::distance(m_start, m_curr) > 1) {
                 switch (*std::next(m_start)) {
-                    case '3': return m_match_kwd(2, "oat", FLOAT32);
-                    case '6': return m_match_kwd(2, "oat", FLOAT64);
+                    case '3': return m_match_kwd(2, "2", FLOAT32);
+                    case '6': return m_match_kwd(2, "4", FLOAT64);
                     case 'a': return m_match_kwd(2, "lse", FALSE);
                     case 'o': return m_match_kwd(2, "r", FOR);
                     case 'u': return m_match_kwd(2, "n", FUN);
@@ -301,8 +306,8 @@ void Lexer::m_skip_whitespace() noexcept
         char c = m_peek();
         switch (c) {
             case '\n':
-                m_line++;
-                [[fallthrough]];
+                m_newline();
+                break;
             case ' ':
             case '\r':
             case '\t':
@@ -322,6 +327,19 @@ void Lexer::m_skip_whitespace() noexcept
     }
 }
 
+auto Lexer::m_column() const noexcept -> std::size_t
+{
+    // a string spanning lines started before the current one, its column is not known anymore
+    return m_start < m_line_start ? 0 : static_cast<std::size_t>(m_start - m_line_start) + 1;
+}
+
+void Lexer::m_newline() noexcept
+{
+    m_advance();
+    m_line++;
+    m_line_start = m_curr;
+}
+
 auto Lexer::m_is_end() const noexcept -> bool
 {
     return m_curr == m_source.end();
@@ -15,19 +15,28 @@ void Logger::log(CodeSegment const& code_pair)
                  "LINE", field_width,
                  "OPCODE", field_width,
                  "VALUE", field_width);
-    for (auto it = bc.lines().begin(); it != bc.lines().end(); it++) {
+    auto entries = bc.line_table().decode();
+    for (auto it = entries.begin(); it != entries.end(); it++) {
 
-        auto const& line_info = std::format("[{}]", it->second);
+        auto const& line_info = it->location.column == 0 ? std::format("[{}]", it->location.line)
+                                                           : std::format("[{}:{}]", it->location.line, it->location.column);
 
-        std::size_t next_offset = std::next(it) != bc.lines().end() ? std::next(it)->first : bc.code().size();
+        std::size_t next_offset = std::next(it) != entries.end() ? std::next(it)->offset : bc.code().size();
 
-        for (std::size_t offset { it->first }; offset < bc.code().size() && offset < next_offset;) {
+        for (std::size_t offset { it->offset }; offset < bc.code().size() && offset < next_offset;) {
+            // function bodies follow the top level code, each headed by its name
+            for (auto const& function : bc.functions()) {
+                if (function.entry == offset) {
+                    std::println("fun {}:", function.name);
+                }
+            }
 
             auto opcode = static_cast<Opcode>(bc.code()[offset]);
             switch (opcode) {
                 using enum Opcode;
                 case LOG:
                 case RETURN:
+                case GET_CALLEE:
                 case ADD:
                 case SUB:
                 case MUL:
@@ -37,31 +46,125 @@ void Logger::log(CodeSegment const& code_pair)
                 case NOT:
                 case CMP:
                 case CMPE:
+                case GET_INDEX:
+                case SET_INDEX:
+                case LENGTH:
                     std::println("{:^#{}x} {:^{}} {:^{}}", offset, field_width, line_info, field_width, util::opcode::to_string(opcode), field_width);
                     offset++;
                     break;
-                case LOAD: {
-                    // we first get the type of the value we are loading
+                case PICK:
+                case POP:
+                case GET_LOCAL:
+                case SET_LOCAL:
+                case SHL:
+                case DIVP2:
+                case MODP2:
+                case CALL:
+                case TAIL_CALL:
+                case GET_CAPTURE:
+                case GET_BOXED_CAPTURE:
+                case SET_BOXED_CAPTURE:
+                case BOX:
+                case GET_BOXED:
+                case SET_BOXED:
+                    std::println("{:^#{}x} {:^{}} {:^{}} {:^{}}", offset, field_width, line_info, field_width, util::opcode::to_string(opcode), field_width, bc.code()[offset + 1], field_width);
+                    offset += 2;
+                    break;
+                case GET_GLOBAL:
+                case SET_GLOBAL:
+                    std::println("{:^#{}x} {:^{}} {:^{}} {:^{}}", offset, field_width, line_info, field_width, util::opcode::to_string(opcode), field_width, bc.read_value<uint16_t>(offset + 1), field_width);
+                    offset += util::opcode::length(bc, offset);
+                    break;
+                case CLOSURE: {
+                    auto const& function = bc.functions()[bc.read_value<uint16_t>(offset + 1)];
+                    std::println("{:^#{}x} {:^{}} {:^{}} {:^{}}", offset, field_width, line_info, field_width, util::opcode::to_string(opcode), field_width, std::format("<fun {}>", function.name), field_width);
+                    offset += util::opcode::length(bc, offset);
+                } break;
+                case NEW: {
+                    auto const& klass = bc.classes()[bc.read_value<uint16_t>(offset + 1)];
+                    std::println("{:^#{}x} {:^{}} {:^{}} {:^{}}", offset, field_width, line_info, field_width, util::opcode::to_string(opcode), field_width, std::format("<class {}>", klass.name), field_width);
+                    offset += util::opcode::length(bc, offset);
+                } break;
+                case NEW_ARRAY:
+                case FILL_ARRAY: {
+                    // the element type and, for a literal, the number of elements
+                    auto operands = std::format("[{}]", util::type::to_string(util::type::get_type(bc.code()[offset + 1])));
+                    if (opcode == NEW_ARRAY) {
+                        operands += std::format(" {}", bc.read_value<uint16_t>(offset + 2));
+                    }
+                    std::println("{:^#{}x} {:^{}} {:^{}} {:^{}}", offset, field_width, line_info, field_width, util::opcode::to_string(opcode), field_width, operands, field_width);
+                    offset += util::opcode::length(bc, offset);
+                } break;
+                case ELEMENTWISE:
+                case REDUCE:
+                    std::println("{:^#{}x} {:^{}} {:^{}} {:^{}}", offset, field_width, line_info, field_width, util::opcode::to_string(opcode), field_width, util::type::to_string(static_cast<ArrayOp>(bc.code()[offset + 1])), field_width);
+                    offset += 2;
+                    break;
+                case GET_PROP:
+                case SET_PROP:
+                case INVOKE: {
+                    // the property and, for calls, the number of arguments besides the instance
+                    auto operands = std::string { bc.names()[bc.read_value<uint16_t>(offset + 1)] };
+                    if (opcode == INVOKE) {
+                        operands += std::format(" {}", bc.code()[offset + 3]);
+                    }
+                    std::println("{:^#{}x} {:^{}} {:^{}} {:^{}}", offset, field_width, line_info, field_width, util::opcode::to_string(opcode), field_width, operands, field_width);
+                    offset += util::opcode::length(bc, offset);
+                } break;
+                case JUMP:
+                case JUMP_IF_FALSE:
+                case JUMP_IF_FALSE_OR_POP:
+                case JUMP_IF_TRUE_OR_POP:
+                case JLT:
+                case JLE:
+                case JGT:
+                case JGE:
+                case JEQ:
+                case JNE: {
+                    // the relative offset as encoded and the absolute offset it lands on
+                    auto target = std::format("{:+} -> {:#x}", bc.read_value<int16_t>(offset + 1), util::opcode::jump_target(bc, offset));
+                    std::println("{:^#{}x} {:^{}} {:^{}} {:^{}}", offset, field_width, line_info, field_width, util::opcode::to_string(opcode), field_width, target, field_width);
+                    offset += util::opcode::length(bc, offset);
+                } break;
+                case DIVM:
+                case MODM: {
+                    auto operands = std::format("{} {:#x}", bc.code()[offset + 1], bc.read_value<uint64_t>(offset + 2));
+                    if (opcode == MODM) {
+                        operands += std::format(" {:#x}", bc.read_value<uint64_t>(offset + 2 + sizeof(uint64_t)));
+                    }
+                    std::println("{:^#{}x} {:^{}} {:^{}} {:^{}}", offset, field_width, line_info, field_width, util::opcode::to_string(opcode), field_width, operands, field_width);
+                    offset += util::opcode::length(bc, offset);
+                } break;
+                case LOAD:
+                case ADDK:
+                case SUBK:
+                case MULK:
+                case DIVK:
+                case MODK:
+                case CMPK:
+                case CMPEK:
+                case LOGK: {
+                    // we first get the type of the value we are loading, superinstructions carry their constant the same way
                     auto type_index = bc.code()[offset + 1];
 
-                    auto log_val = [=, &offset]<typename T>(T) mutable {
-                        T value = *std::bit_cast<T*>(&bc.code()[offset + 2]);
+                    auto log_val = [=, &bc, &offset]<typename T>(T) mutable {
+                        T value = bc.read_value<T>(offset + 2);
                         // For string values we are extracting from our interned table and for all other values
                         // we simply read them off of the bytecode
                         if constexpr (std::is_same_v<T, std::unordered_set<std::string>::const_iterator>) {
                             std::println("{:^#{}x} {:^{}} {:^{}} {}",
                                          offset, field_width,
                                          line_info, field_width,
-                                         "LOAD", field_width,
+                                         util::opcode::to_string(opcode), field_width,
                                          std::format("({:#x})\"{}\"", std::bit_cast<uintptr_t>(value), *value), field_width);
                         } else {
                             std::println("{:^#{}x} {:^{}} {:^{}} {:^{}}",
                                          offset, field_width,
                                          line_info, field_width,
-                                         "LOAD", field_width,
+                                         util::opcode::to_string(opcode), field_width,
                                          util::literal::to_string(value), field_width);
                         }
-                        offset += 2 + sizeof(T);
+                        offset += util::opcode::length(bc, offset);
                     };
 
                     switch (util::type::get_type(type_index)) {
@@ -80,8 +183,13 @@ void Logger::log(CodeSegment const& code_pair)
                         case STRING:
                             log_val(std::unordered_set<std::string>::const_iterator {});
                             break;
+                        case FUNCTION: {
+                            auto index = bc.read_value<uint16_t>(offset + 2);
+                            std::println("{:^#{}x} {:^{}} {:^{}} {:^{}}", offset, field_width, line_info, field_width, util::opcode::to_string(opcode), field_width, std::format("<fun {}>", bc.functions()[index].name), field_width);
+                            offset += util::opcode::length(bc, offset);
+                        } break;
                         default:
-                            std::println("{:^#{}x} {:^{}} {:^{}} {:^{}}", offset, field_width, line_info, field_width, "LOAD", field_width, "<UNKNOWN>", field_width);
+                            std::println("{:^#{}x} {:^{}} {:^{}} {:^{}}", offset, field_width, line_info, field_width, util::opcode::to_string(opcode), field_width, "<UNKNOWN>", field_width);
                             offset += 2;
                     }
                 } break;
@@ -95,4 +203,103 @@ void Logger::log(CodeSegment const& code_pair)
             }
         }
     }
-}
\ No newline at end of file
+}
+
+void Logger::log(RegisterSegment const& code_pair)
+{
+    auto const& [rc, _] = code_pair;
+
+    constexpr std::size_t field_width { 20 };
+    std::println("{:^{}} {:^{}} {:^{}} {:^{}}",
+                 "INDEX", field_width,
+                 "LINE", field_width,
+                 "OPCODE", field_width,
+                 "OPERANDS", field_width);
+    for (std::size_t index {}; index < rc.code().size(); index++) {
+        auto [op, a, b, c] = rc.code()[index];
+        auto const& line_info = std::format("[{}]", rc.read_line_number(index));
+
+        std::string operands;
+        switch (op) {
+            using enum RegOpcode;
+            case LOADK: {
+                std::size_t constant = b | (c << 8);
+                operands = std::format("r{}, k{} ({:#x})", a, constant, std::bit_cast<uint64_t>(rc.constants()[constant]));
+            } break;
+            case RETURN:
+                break;
+            case LOG_BOOL:
+            case LOG_I64:
+            case LOG_U64:
+            case LOG_F64:
+            case LOG_STR:
+                operands = std::format("r{}", a);
+                break;
+            case NEG_I64:
+            case NEG_F64:
+            case NOT_BOOL:
+            case NOT_I64:
+            case NOT_F64:
+            case NOT_STR:
+            case TOSTR_BOOL:
+            case TOSTR_I64:
+            case TOSTR_U64:
+            case TOSTR_F64:
+                operands = std::format("r{}, r{}", a, b);
+                break;
+            default:
+                operands = std::format("r{}, r{}, r{}", a, b, c);
+                break;
+        }
+
+        std::println("{:^#{}x} {:^{}} {:^{}} {:^{}}",
+                     index, field_width,
+                     line_info, field_width,
+                     util::reg_opcode::to_string(op), field_width,
+                     operands, field_width);
+    }
+}
+void Logger::log(WordSegment const& code_pair)
+{
+    auto const& [wc, _] = code_pair;
+
+    constexpr std::size_t field_width { 20 };
+    std::println("{:^{}} {:^{}} {:^{}} {:^{}}",
+                 "INDEX", field_width,
+                 "LINE", field_width,
+                 "OPCODE", field_width,
+                 "VALUE", field_width);
+    for (std::size_t index {}; index < wc.code().size(); index++) {
+        auto word             = wc.code()[index];
+        auto const& line_info = std::format("[{}]", wc.read_line_number(index));
+
+        std::string value;
+        if (util::opcode::has_constant(word.opcode())) {
+            switch (util::type::get_type(word.a())) {
+                using enum TypeIndex;
+                case BOOL: value = util::literal::to_string(util::wordcode::constant<bool>(wc, word.b())); break;
+                case INT64: value = util::literal::to_string(util::wordcode::constant<int64_t>(wc, word.b())); break;
+                case UINT64: value = util::literal::to_string(util::wordcode::constant<uint64_t>(wc, word.b())); break;
+                case FLOAT64: value = util::literal::to_string(util::wordcode::constant<double>(wc, word.b())); break;
+                case STRING: value = std::format("\"{}\"", *util::wordcode::constant<StringPtr>(wc, word.b())); break;
+                default: value = "<UNKNOWN>"; break;
+            }
+            value = std::format("k{} {}", word.b(), value);
+        } else if (word.opcode() == Opcode::DIVM || word.opcode() == Opcode::MODM) {
+            value = std::format("{} k{}", word.a(), word.b());
+        } else if (word.opcode() == Opcode::GET_GLOBAL || word.opcode() == Opcode::SET_GLOBAL) {
+            value = std::format("{}", word.b());
+        } else if (util::opcode::is_jump(word.opcode())) {
+            value = std::format("-> {:#x}", word.b());
+        } else if (word.opcode() == Opcode::PICK || word.opcode() == Opcode::POP || word.opcode() == Opcode::GET_LOCAL || word.opcode() == Opcode::SET_LOCAL
+                   || word.opcode() == Opcode::SHL || word.opcode() == Opcode::DIVP2 || word.opcode() == Opcode::MODP2) {
+            value = std::format("{}", word.a());
+        }
+
+        std::println("{:^#{}x} {:^{}} {:^{}} {:^{}}",
+                     index, field_width,
+                     line_info, field_width,
+                     util::opcode::to_string(word.opcode()), field_width,
+                     value, field_width);
+    }
+}
@@ -1,32 +1,398 @@
 #include "lexer.hpp"
 #include "parser.hpp"
+#include "c_backend.hpp"
 #include "compiler.hpp"
+#include "fusion.hpp"
+#include "ssa.hpp"
+#ifdef CPPLOX_ENABLE_JIT
+#include "jit.hpp"
+#endif
+#include "register_compiler.hpp"
+#include "register_vm.hpp"
 #include "logger.hpp"
+#include "perf_counters.hpp"
+#include "sampler.hpp"
+#include "stats.hpp"
+#include "verifier.hpp"
 #include "vm.hpp"
+#include "word_vm.hpp"
+#include "wordcode.hpp"
 
+#include <charconv>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <optional>
 #include <print>
+#include <span>
+#include <sstream>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
 
+namespace {
+enum class Engine : uint8_t {
+    STACK,
+    REGISTER,
+    WORD,
+    JIT,
+};
+
+auto read_file(std::string_view path) -> std::optional<std::string>
+{
+    std::ifstream file { std::string { path } };
+    if (!file) {
+        return {};
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return std::move(buffer).str();
+}
+
+// points stdout at /dev/null while it lives, so a program can run again without logging everything twice
+class DiscardedStdout {
+public:
+    DiscardedStdout()
+    {
+        std::fflush(stdout);
+        m_saved = dup(STDOUT_FILENO);
+        int null = open("/dev/null", O_WRONLY);
+        if (null != -1) {
+            dup2(null, STDOUT_FILENO);
+            close(null);
+        }
+    }
+    DiscardedStdout(DiscardedStdout const&)                    = delete;
+    auto operator=(DiscardedStdout const&) -> DiscardedStdout& = delete;
+    ~DiscardedStdout()
+    {
+        std::fflush(stdout);
+        if (m_saved != -1) {
+            dup2(m_saved, STDOUT_FILENO);
+            close(m_saved);
+        }
+    }
+
+private:
+    int m_saved;
+};
+}
+
+// usage: CppLox [--engine=stack|register|word|jit] [--fuse=all|none|profile] [--opt=ssa|none] [--checked] [--emit-c=file | --aot=binary | --aot-shared=library] [--stats | --stats=json] [--profile[=hz]] [--profile-out=file] [--perf | --perf=all] [script]
 auto main(int argc, char** argv) -> int
 {
-    Lexer lexer = Lexer(R"(log(1 < 2);)");
+    std::string source { R"(log(1 < 2);)" };
+    Stats stats {};
+    bool stats_json {};
+    std::optional<unsigned> profile_frequency;
+    std::string_view profile_out;
+    std::optional<PerfCounters> perf;
+    bool perf_stages {};   // also count the lexer, parser and compiler and not only the vm
+    Engine engine { Engine::STACK };
+    Fusions fusions { Fusions::all() };
+    bool optimize { true };   // go through the ssa ir instead of compiling the ast directly
+    bool checked {};          // run the stack engine checked instead of verifying the bytecode up front
+    std::string_view emit_c;
+    std::string_view aot_output;
+    bool aot_shared {};
+
+    for (std::string_view arg : std::span { argv + 1, static_cast<std::size_t>(argc - 1) }) {
+        if (arg == "--engine=stack") {
+            engine = Engine::STACK;
+        } else if (arg == "--engine=register") {
+            engine = Engine::REGISTER;
+        } else if (arg == "--engine=word") {
+            engine = Engine::WORD;
+        } else if (arg == "--engine=jit") {
+            engine = Engine::JIT;
+        } else if (arg == "--fuse=all") {
+            fusions = Fusions::all();
+        } else if (arg == "--fuse=none") {
+            fusions = Fusions::none();
+        } else if (arg.starts_with("--fuse=")) {
+            // pair profile written by a CPPLOX_INSTRUMENT_VM build through $CPPLOX_OPCODE_PROFILE
+            auto path = arg.substr(std::string_view { "--fuse=" }.size());
+            std::ifstream profile { std::string { path } };
+            auto from_profile = profile ? Fusions::from_profile(profile) : std::nullopt;
+            if (!from_profile.has_value()) {
+                std::println(std::cerr, "Could not read opcode profile '{}'", path);
+                return 1;
+            }
+            fusions = from_profile.value();
+        } else if (arg == "--opt=ssa") {
+            optimize = true;
+        } else if (arg == "--opt=none") {
+            optimize = false;
+        } else if (arg == "--checked") {
+            checked = true;
+        } else if (arg.starts_with("--emit-c=")) {
+            emit_c = arg.substr(std::string_view { "--emit-c=" }.size());
+        } else if (arg.starts_with("--aot=")) {
+            aot_output = arg.substr(std::string_view { "--aot=" }.size());
+            aot_shared = false;
+        } else if (arg.starts_with("--aot-shared=")) {
+            aot_output = arg.substr(std::string_view { "--aot-shared=" }.size());
+            aot_shared = true;
+        } else if (arg == "--stats") {
+            stats.enabled = true;
+        } else if (arg == "--stats=json") {
+            stats.enabled = true;
+            stats_json    = true;
+        } else if (arg == "--profile") {
+            profile_frequency = Sampler::default_frequency;
+        } else if (arg.starts_with("--profile=")) {
+            unsigned frequency {};
+            auto value = arg.substr(std::string_view { "--profile=" }.size());
+            if (std::from_chars(value.data(), value.data() + value.size(), frequency).ec != std::errc {} || frequency == 0) {
+                std::println(std::cerr, "Invalid sampling frequency '{}'", value);
+                return 1;
+            }
+            profile_frequency = frequency;
+        } else if (arg.starts_with("--profile-out=")) {
+            profile_out       = arg.substr(std::string_view { "--profile-out=" }.size());
+            profile_frequency = profile_frequency.value_or(Sampler::default_frequency);
+        } else if (arg == "--perf") {
+            perf.emplace();
+        } else if (arg == "--perf=all") {
+            perf.emplace();
+            perf_stages = true;
+        } else if (arg.starts_with("--")) {
+            std::println(std::cerr, "Unknown option '{}'", arg);
+            return 1;
+        } else if (auto file = read_file(arg); file.has_value()) {
+            source = std::move(file.value());
+        } else {
+            std::println(std::cerr, "Could not read file '{}'", arg);
+            return 1;
+        }
+    }
+
+    if (perf.has_value() && !perf->available()) {
+        std::println(std::cerr, "Hardware performance counters are unavailable, running without them");
+        perf.reset();
+        perf_stages = false;
+    }
 
-    Parser parser { std::move(lexer).scan() };
+    std::vector<std::pair<std::string_view, PerfCounters::Reading>> perf_readings;
+    auto front_end = [&](Stats::Phase phase, std::string_view stage, auto&& func) {
+        if (!perf_stages) {
+            return stats.measure(phase, func);
+        }
+        perf->start();
+        auto result = stats.measure(phase, func);
+        perf_readings.emplace_back(stage, perf->stop());
+        return result;
+    };
 
-    auto ast = std::move(parser).parse();
+    auto tokens = front_end(Stats::Phase::LEX, "lex", [&] { return Lexer { source }.scan(); });
+    stats.tokens = tokens.size();
+
+    auto ast = front_end(Stats::Phase::PARSE, "parse", [&] { return Parser { std::move(tokens) }.parse(); });
     if (!ast.has_value()) {
         std::println("Could not parse the program!");
         return 1;
     }
 
     std::println("{}", std::visit(util::ast::to_string, ast.value()));
+    if (stats.enabled) {
+        stats.ast_nodes = std::visit(util::ast::node_count, ast.value());
+    }
+
+    // runs `vm` under whatever perf counters and stats collection were requested
+    auto run = [&](auto& vm) {
+        constexpr bool is_counted = requires { vm.execute(stats); };   // generated code has no instructions to count
+        if (perf.has_value()) {
+            // counting instructions would add its own work to every counter, the window only holds the plain run
+            perf->start();
+            stats.measure(Stats::Phase::EXECUTE, [&] { vm.execute(); });
+            perf_readings.emplace_back("execute", perf->stop());
+            if constexpr (is_counted) {
+                // the per bytecode figures divide by the instruction count of a second, silent run
+                DiscardedStdout discarded;
+                vm.reset();
+                vm.execute(stats);
+            }
+        } else if constexpr (is_counted) {
+            if (stats.enabled) {
+                stats.measure(Stats::Phase::EXECUTE, [&] { vm.execute(stats); });
+            } else {
+                vm.execute();
+            }
+        } else {
+            stats.measure(Stats::Phase::EXECUTE, [&] { vm.execute(); });
+        }
+    };
+    auto report = [&] {
+        if (perf.has_value()) {
+            PerfCounters::report_header(std::cerr);
+            for (auto const& [stage, reading] : perf_readings) {
+                PerfCounters::report(std::cerr, stage, reading, stage == "execute" ? stats.instructions : 0);
+            }
+        }
+        if (stats.enabled) {
+            stats_json ? stats.print_json() : stats.print();
+        }
+    };
+    auto count_strings = [&](StringTable const& pool) {
+        stats.strings = pool.size();
+        for (auto const& string : pool) {
+            stats.string_bytes += string.size();
+        }
+    };
+
+    // ahead of time compilation replaces running the program
+    if (!emit_c.empty()) {
+        std::ofstream file { std::string { emit_c } };
+        if (!(file << CBackend { ast.value() }.translate())) {
+            std::println(std::cerr, "Could not write file '{}'", emit_c);
+            return 1;
+        }
+        return 0;
+    }
+    if (!aot_output.empty()) {
+        auto built = front_end(Stats::Phase::COMPILE, "compile", [&] { return CBackend { ast.value() }.build(aot_output, aot_shared); });
+        if (!built) {
+            std::println(std::cerr, "Could not build '{}' with the C compiler", aot_output);
+            return 1;
+        }
+        report();
+        return 0;
+    }
+
+    if (engine == Engine::REGISTER) {
+        auto segment = front_end(Stats::Phase::COMPILE, "compile", [&] { return RegisterCompiler { ast.value() }.compile(); });
+        if (segment.has_value()) {
+            if (stats.enabled) {
+                auto const& rc       = segment->first;
+                stats.bytecode_bytes = rc.code().size() * sizeof(RegInstr) + rc.constants().size() * sizeof(Register);
+                count_strings(segment->second);
+            }
+
+            Logger::log(segment.value());
 
-    Compiler compiler { std::move(ast.value()) };
+            auto vm = std::make_unique<RegisterVM>(std::move(segment.value()));
+            run(*vm);
+            report();
+            // register code only keeps the line of every instruction
+            if (auto const& error = vm->error(); error.has_value()) {
+                std::println(std::cerr, "[line {}] Runtime error: {}", vm->code().read_line_number(error->offset), error->message);
+                return 1;
+            }
+            return 0;
+        }
+        std::println(std::cerr, "Program does not fit the register engine, falling back to the stack engine");
+    }
+
+    auto code_segment = front_end(Stats::Phase::COMPILE, "compile", [&] {
+        if (optimize) {
+            if (auto segment = util::ssa::compile(ast.value(), fusions); segment.has_value()) {
+                return std::move(segment.value());
+            }
+        }
+        return Compiler { std::move(ast.value()), fusions }.compile();
+    });
+    if (stats.enabled) {
+        auto const& [bc, pool] = code_segment;
+
+        stats.bytecode_bytes = bc.code().size();
+        stats.line_entries   = bc.line_table().entries();
+        stats.line_bytes     = bc.line_table().bytes();
+        count_strings(pool);
+    }
+
+    if (engine == Engine::WORD) {
+        auto words = util::wordcode::encode(code_segment.first);
+        if (words.has_value()) {
+            if (stats.enabled) {
+                stats.bytecode_bytes = words->code().size() * sizeof(Word) + words->constants().size() * sizeof(uint64_t);
+                stats.line_entries   = words->line_table().entries();
+                stats.line_bytes     = words->line_table().bytes();
+            }
+
+            // the pool moves along with the words, whose string constants point into it
+            WordSegment segment { std::move(words.value()), std::move(code_segment.second) };
+            Logger::log(segment);
 
-    auto code_segment = std::move(compiler).compile();
+            auto vm = std::make_unique<WordVM>(std::move(segment));
+            run(*vm);
+            report();
+            if (auto const& error = vm->error(); error.has_value()) {
+                auto location = vm->code().line_table().read(error->offset);
+                std::println(std::cerr, "[line {}:{}] Runtime error: {}", location.line, location.column, error->message);
+                return 1;
+            }
+            return 0;
+        }
+        std::println(std::cerr, "Program does not fit the word encoding, falling back to the stack engine");
+    }
+
+    if (engine == Engine::JIT) {
+#ifdef CPPLOX_ENABLE_JIT
+        auto jit = front_end(Stats::Phase::COMPILE, "jit", [&] { return Jit::compile(code_segment.first); });
+        if (jit.has_value()) {
+            if (stats.enabled) {
+                stats.bytecode_bytes = jit->size();
+            }
+
+            Logger::log(code_segment);
+
+            run(*jit);
+            report();
+            if (auto const& error = jit->error(); error.has_value()) {
+                auto location = code_segment.first.read_location(error->offset);
+                std::println(std::cerr, "[line {}:{}] Runtime error: {}", location.line, location.column, error->message);
+                return 1;
+            }
+            return 0;
+        }
+        std::println(std::cerr, "Program is not supported by the jit, falling back to the stack engine");
+#else
+        std::println(std::cerr, "Built without the jit, falling back to the stack engine");
+#endif
+    }
 
     Logger::log(code_segment);
 
-    VM vm { code_segment };
-    vm.execute();
+    if (!checked) {
+        auto verified = front_end(Stats::Phase::VERIFY, "verify", [&] { return Verifier { code_segment.first, code_segment.second }.verify(); });
+        if (!verified.has_value()) {
+            std::println(std::cerr, "Bytecode failed verification at offset {}: {}, falling back to checked execution",
+                         verified.error().offset, verified.error().message);
+            checked = true;
+        }
+    }
+
+    // the pool moves along with the bytecode, whose string constants point into it
+    VM vm { std::move(code_segment) };
+
+    Sampler sampler { profile_frequency.value_or(Sampler::default_frequency) };
+    if (profile_frequency.has_value()) {
+        sampler.start(vm.bytecode(), vm.sampled_instruction_pointer());
+    }
+
+    std::optional<BytecodeError> error;
+    if (checked) {
+        error = stats.measure(Stats::Phase::EXECUTE, [&] { return vm.execute_checked(); });
+    } else {
+        run(vm);
+        // verified code still halts on what only shows at runtime, `VM` lists what
+        error = vm.error();
+    }
+
+    // a run that stopped early is profiled and measured all the same
+    if (profile_frequency.has_value()) {
+        sampler.stop();
+        sampler.report_flat(std::cerr);
+        if (!profile_out.empty()) {
+            std::ofstream out { std::string { profile_out } };
+            sampler.report_collapsed(out);
+        }
+    }
+    report();
+
+    if (error.has_value()) {
+        auto location = vm.bytecode().read_location(error->offset);
+        std::println(std::cerr, "[line {}:{}] Runtime error: {}", location.line, location.column, error->message);
+        return 1;
+    }
 }
@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <print>
+#include <ranges>
+#include <vector>
+
+#include "opcode_profile.hpp"
+
+OpcodeProfile::~OpcodeProfile()
+{
+    if (std::ranges::all_of(m_counts, [](uint64_t count) { return count == 0; })) {
+        return;
+    }
+
+    print();
+    if (char const* path = std::getenv("CPPLOX_OPCODE_PROFILE"); path != nullptr) {
+        dump_pairs(path);
+    }
+}
+
+void OpcodeProfile::print() const
+{
+    constexpr std::size_t field_width { 14 };
+    constexpr std::size_t top_pairs { 20 };
+
+    auto total_cycles = std::accumulate(m_cycles.begin(), m_cycles.end(), uint64_t {});
+
+    std::vector<std::size_t> order(util::opcode::count);
+    std::iota(order.begin(), order.end(), 0);
+    std::ranges::sort(order, std::ranges::greater {}, [this](std::size_t index) { return m_cycles[index]; });
+
+    std::println(std::cerr, "{:<{}} {:>{}} {:>{}} {:>{}} {:>{}}",
+                 "OPCODE", field_width,
+                 "COUNT", field_width,
+                 "CYCLES", field_width,
+                 "CYCLES/OP", field_width,
+                 "% CYCLES", field_width);
+    for (auto index : order) {
+        if (m_counts[index] == 0) {
+            continue;
+        }
+        std::println(std::cerr, "{:<{}} {:>{}} {:>{}} {:>{}.1f} {:>{}.2f}",
+                     util::opcode::to_string(static_cast<Opcode>(index)), field_width,
+                     m_counts[index], field_width,
+                     m_cycles[index], field_width,
+                     static_cast<double>(m_cycles[index]) / m_counts[index], field_width,
+                     total_cycles == 0 ? 0.0 : 100.0 * m_cycles[index] / total_cycles, field_width);
+    }
+
+    std::vector<std::pair<std::size_t, std::size_t>> pairs;
+    for (std::size_t first {}; first < util::opcode::count; first++) {
+        for (std::size_t second {}; second < util::opcode::count; second++) {
+            if (m_pairs[first][second] != 0) {
+                pairs.emplace_back(first, second);
+            }
+        }
+    }
+    std::ranges::sort(pairs, std::ranges::greater {}, [this](auto const& pair) { return m_pairs[pair.first][pair.second]; });
+
+    std::println(std::cerr, "");
+    std::println(std::cerr, "{:<{}} {:>{}}", "OPCODE PAIR", 2 * field_width + 1, "COUNT", field_width);
+    for (auto const& [first, second] : pairs | std::views::take(top_pairs)) {
+        std::println(std::cerr, "{:<{}} {:<{}} {:>{}}",
+                     util::opcode::to_string(static_cast<Opcode>(first)), field_width,
+                     util::opcode::to_string(static_cast<Opcode>(second)), field_width,
+                     m_pairs[first][second], field_width);
+    }
+}
+
+/**
+ * One `FIRST SECOND COUNT` line per opcode pair that was executed at least once.
+ * This is the format `Fusions::from_profile` reads when choosing superinstructions.
+ */
+void OpcodeProfile::dump_pairs(char const* path) const
+{
+    std::ofstream file { path };
+    if (!file) {
+        std::println(std::cerr, "Could not write opcode profile to '{}'", path);
+        return;
+    }
+
+    for (std::size_t first {}; first < util::opcode::count; first++) {
+        for (std::size_t second {}; second < util::opcode::count; second++) {
+            if (m_pairs[first][second] != 0) {
+                std::println(file, "{} {} {}",
+                             util::opcode::to_string(static_cast<Opcode>(first)),
+                             util::opcode::to_string(static_cast<Opcode>(second)),
+                             m_pairs[first][second]);
+            }
+        }
+    }
+}
@@ -3,28 +3,35 @@
     statement   -> exprStmt | forStmt | ifStmt | logStmt | returnStmt | whileStmt | block
  */
 
+#include <algorithm>
 #include <iostream>
 #ifndef NDEBUG
 #include <print>
 #endif
 #include <format>
 #include <charconv>
+#include <concepts>
+#include <limits>
+#include <ranges>
 #include <string_view>
+#include <utility>
 
 #include "parser.hpp"
 
-Parser::Parser(std::vector<Token> tokens)
+Parser::Parser(std::vector<Token> tokens, std::vector<Input> const& inputs)
     : m_tokens { std::move(tokens) }
     , m_curr { m_tokens.cbegin() }
     , m_prev { nullptr }
 {
-    m_table[std::to_underlying(TokenType::LEFT_PAREN)]    = { &Parser::m_grouping, nullptr, Precedence::NONE };
+    m_table[std::to_underlying(TokenType::LEFT_PAREN)]    = { &Parser::m_grouping, &Parser::m_call, Precedence::CALL };
     m_table[std::to_underlying(TokenType::RIGHT_PAREN)]   = { nullptr, nullptr, Precedence::NONE };
     m_table[std::to_underlying(TokenType::LEFT_BRACE)]    = { nullptr, nullptr, Precedence::NONE };
     m_table[std::to_underlying(TokenType::RIGHT_BRACE)]   = { nullptr, nullptr, Precedence::NONE };
+    m_table[std::to_underlying(TokenType::LEFT_BRACKET)]  = { &Parser::m_array, &Parser::m_index, Precedence::CALL };
+    m_table[std::to_underlying(TokenType::RIGHT_BRACKET)] = { nullptr, nullptr, Precedence::NONE };
     m_table[std::to_underlying(TokenType::INTRPL)]        = { &Parser::m_literal, nullptr, Precedence::PRIMARY };
     m_table[std::to_underlying(TokenType::COMMA)]         = { nullptr, nullptr, Precedence::NONE };
-    m_table[std::to_underlying(TokenType::DOT)]           = { nullptr, nullptr, Precedence::NONE };
+    m_table[std::to_underlying(TokenType::DOT)]           = { nullptr, &Parser::m_property, Precedence::CALL };
     m_table[std::to_underlying(TokenType::MINUS)]         = { &Parser::m_unary, &Parser::m_binary, Precedence::TERM };
     m_table[std::to_underlying(TokenType::PLUS)]          = { nullptr, &Parser::m_binary, Precedence::TERM };
     m_table[std::to_underlying(TokenType::SEMICOLON)]     = { nullptr, nullptr, Precedence::NONE };
@@ -39,7 +46,7 @@ Parser::Parser(std::vector<Token> tokens)
     m_table[std::to_underlying(TokenType::GREATER_EQUAL)] = { nullptr, &Parser::m_binary, Precedence::COMPARISON };
     m_table[std::to_underlying(TokenType::LESS)]          = { nullptr, &Parser::m_binary, Precedence::COMPARISON };
     m_table[std::to_underlying(TokenType::LESS_EQUAL)]    = { nullptr, &Parser::m_binary, Precedence::COMPARISON };
-    m_table[std::to_underlying(TokenType::IDENTIFIER)]    = { nullptr, nullptr, Precedence::NONE };
+    m_table[std::to_underlying(TokenType::IDENTIFIER)]    = { &Parser::m_variable, nullptr, Precedence::NONE };
     m_table[std::to_underlying(TokenType::STRING)]        = { &Parser::m_literal, nullptr, Precedence::PRIMARY };
     m_table[std::to_underlying(TokenType::INT8)]          = { &Parser::m_number, nullptr, Precedence::PRIMARY };
     m_table[std::to_underlying(TokenType::INT16)]         = { &Parser::m_number, nullptr, Precedence::PRIMARY };
@@ -51,7 +58,7 @@ Parser::Parser(std::vector<Token> tokens)
     m_table[std::to_underlying(TokenType::UINT64)]        = { &Parser::m_number, nullptr, Precedence::PRIMARY };
     m_table[std::to_underlying(TokenType::FLOAT32)]       = { &Parser::m_number, nullptr, Precedence::PRIMARY };
     m_table[std::to_underlying(TokenType::FLOAT64)]       = { &Parser::m_number, nullptr, Precedence::PRIMARY };
-    m_table[std::to_underlying(TokenType::AND)]           = { nullptr, nullptr, Precedence::NONE };
+    m_table[std::to_underlying(TokenType::AND)]           = { nullptr, &Parser::m_logical, Precedence::AND };
     m_table[std::to_underlying(TokenType::CLASS)]         = { nullptr, nullptr, Precedence::NONE };
     m_table[std::to_underlying(TokenType::ELSE)]          = { nullptr, nullptr, Precedence::NONE };
     m_table[std::to_underlying(TokenType::FALSE)]         = { &Parser::m_literal, nullptr, Precedence::NONE };
@@ -59,23 +66,410 @@ Parser::Parser(std::vector<Token> tokens)
     m_table[std::to_underlying(TokenType::FUN)]           = { nullptr, nullptr, Precedence::NONE };
     m_table[std::to_underlying(TokenType::IF)]            = { nullptr, nullptr, Precedence::NONE };
     m_table[std::to_underlying(TokenType::NIL)]           = { &Parser::m_literal, nullptr, Precedence::NONE };
-    m_table[std::to_underlying(TokenType::OR)]            = { nullptr, nullptr, Precedence::NONE };
+    m_table[std::to_underlying(TokenType::OR)]            = { nullptr, &Parser::m_logical, Precedence::OR };
     m_table[std::to_underlying(TokenType::LOG)]           = { nullptr, nullptr, Precedence::NONE };
     m_table[std::to_underlying(TokenType::RETURN)]        = { nullptr, nullptr, Precedence::NONE };
-    m_table[std::to_underlying(TokenType::SUPER)]         = { nullptr, nullptr, Precedence::NONE };
-    m_table[std::to_underlying(TokenType::THIS)]          = { nullptr, nullptr, Precedence::NONE };
+    m_table[std::to_underlying(TokenType::SUPER)]         = { &Parser::m_super, nullptr, Precedence::NONE };
+    m_table[std::to_underlying(TokenType::THIS)]          = { &Parser::m_this, nullptr, Precedence::NONE };
     m_table[std::to_underlying(TokenType::TRUE)]          = { &Parser::m_literal, nullptr, Precedence::NONE };
     m_table[std::to_underlying(TokenType::LET)]           = { nullptr, nullptr, Precedence::NONE };
     m_table[std::to_underlying(TokenType::WHILE)]         = { nullptr, nullptr, Precedence::NONE };
     m_table[std::to_underlying(TokenType::ERROR)]         = { nullptr, nullptr, Precedence::NONE };
     m_table[std::to_underlying(TokenType::END)]           = { nullptr, nullptr, Precedence::NONE };
+
+    for (auto const& input : inputs) {
+        Binding binding { Binding::Scope::GLOBAL, static_cast<uint16_t>(m_global_count++) };
+        m_globals.insert_or_assign(input.name, Symbol { input.name, input.type, binding, 0, 0 });
+    }
+}
+
+void Parser::m_program()
+{
+    auto program = std::make_unique<Block>(Stmt { .line = m_curr->line, .column = m_curr->column }, std::vector<StmtType> {}, uint8_t {});
+    while (!m_check(TokenType::END)) {
+        m_declaration();
+        program->stmts.push_back(std::move(m_stmt));
+    }
+    m_stmt = std::move(program);
 }
 
 void Parser::m_declaration()
 {
-    while (!m_match(TokenType::END)) {
+    if (m_match(TokenType::LET)) {
+        m_let_declaration();
+    } else if (m_match(TokenType::FUN)) {
+        m_fun_declaration();
+    } else if (m_match(TokenType::CLASS)) {
+        m_class_declaration();
+    } else {
         m_statement();
     }
+
+    if (m_is_panicked) {
+        m_synchronize();
+    }
+}
+
+void Parser::m_let_declaration()
+{
+    auto let = m_prev;
+    m_match(TokenType::IDENTIFIER, "Expect variable name after 'let'");
+    if (m_is_panicked) {
+        return;
+    }
+    auto name = m_prev;
+
+    std::optional<Type> annotation;
+    if (m_match(TokenType::COLON)) {
+        annotation = m_type_annotation();
+    }
+    // there is no nil, every variable starts out with a value of its type
+    m_match(TokenType::EQUAL, "Expect '=' after variable name");
+    if (m_is_panicked) {
+        return;
+    }
+    m_expression();
+    m_match(TokenType::SEMICOLON, "Expect ';' after variable declaration");
+    if (m_is_panicked) {
+        return;
+    }
+
+    auto type = util::type::get_static_type(m_expr);
+    if (annotation.has_value() && annotation.value() != type && !m_convert_literal(annotation.value())) {
+        m_report(name, std::format("Cannot initialize variable of type {} with value of type {}",
+                                   util::type::to_string(annotation.value()), util::type::to_string(type)));
+        return;
+    }
+
+    // declared only after its initializer, which still sees whatever the name meant before
+    auto binding = m_declare(name, annotation.value_or(type));
+    if (!binding.has_value()) {
+        return;
+    }
+    auto node = std::make_unique<Let>(Stmt { .line = let->line, .column = let->column }, std::string { name->word }, binding.value(), std::move(m_expr));
+    if (binding->scope == Binding::Scope::LOCAL) {
+        m_locals.back().boxes.push_back(&node->binding.boxed);
+    }
+    m_stmt = std::move(node);
+}
+
+namespace {
+// whether every path through `stmt` ends in a `return`, loops may run zero times
+auto returns(StmtType const& stmt) -> bool
+{
+    return std::visit(util::Visitor {
+                          [](std::unique_ptr<Return> const&) { return true; },
+                          [](std::unique_ptr<Block> const& block) {
+                              return std::ranges::any_of(block->stmts, [](auto const& inner) { return returns(inner); });
+                          },
+                          [](std::unique_ptr<If> const& branch) {
+                              return branch->else_branch.has_value() && returns(branch->then_branch) && returns(branch->else_branch.value());
+                          },
+                          []<typename Node>(std::unique_ptr<Node> const&) { return false; },
+                      },
+                      stmt);
+}
+
+// whether a value of type `from` can be passed, returned or stored in a field where `to` is expected, which an instance
+// of a subclass can, variables keep the exact type they are declared with
+auto is_assignable(Type const& from, Type const& to) -> bool
+{
+    return from == to || (from.klass != nullptr && to.klass != nullptr && from.klass->is_subclass_of(to.klass));
+}
+}
+
+void Parser::m_fun_declaration()
+{
+    auto fun = m_prev;
+    m_match(TokenType::IDENTIFIER, "Expect function name after 'fun'");
+    if (m_is_panicked) {
+        return;
+    }
+    auto name = m_prev;
+    m_match(TokenType::LEFT_PAREN, "Expect '(' after function name");
+
+    std::vector<std::vector<Token>::const_iterator> parameters;
+    FunctionType signature;
+    if (!m_parameters(signature, parameters)) {
+        return;
+    }
+    m_match(TokenType::COLON, "Expect ':' and a result type after ')'");
+    if (m_is_panicked) {
+        return;
+    }
+    auto result = m_type_annotation();
+    if (!result.has_value()) {
+        return;
+    }
+    signature.result = std::move(result.value());
+    // `CALL` counts its arguments in a byte
+    if (parameters.size() > std::numeric_limits<uint8_t>::max()) {
+        m_report(name, "Cannot have more than 255 parameters");
+        return;
+    }
+
+    auto type = std::make_shared<FunctionType const>(std::move(signature));
+    // declared before the body, which may call itself
+    auto binding = m_declare(name, Type { TypeIndex::FUNCTION, type });
+    m_match(TokenType::LEFT_BRACE, "Expect '{' before function body");
+    if (!binding.has_value() || m_is_panicked) {
+        return;
+    }
+    // made up front, the body records its captures and the uses of the function in it
+    auto node = std::make_unique<Fun>(Stmt { .line = fun->line, .column = fun->column }, std::string { name->word }, binding.value(), type, std::vector<Parameter> {}, std::vector<StmtType> {});
+    m_resolve(name->word)->declaration = node.get();
+
+    m_function_body(*node, parameters, Enclosing { .node = node.get(), .captured = {} });
+
+    // a statement which failed to parse leaves no node behind, which would look like a missing `return`
+    if (m_is_parsed && std::ranges::none_of(node->body, [](auto const& stmt) { return returns(stmt); })) {
+        m_report(name, "Function does not return a value on every path");
+        return;
+    }
+    m_stmt = std::move(node);
+}
+
+void Parser::m_class_declaration()
+{
+    auto keyword = m_prev;
+    m_match(TokenType::IDENTIFIER, "Expect class name after 'class'");
+    if (m_is_panicked) {
+        return;
+    }
+    auto name = m_prev;
+    // methods are functions of the top level code, which leaves them no locals to capture
+    if (m_depth > 0) {
+        m_report(keyword, "Classes can only be declared in the top level code");
+        return;
+    }
+    if (m_classes.contains(name->word)) {
+        m_report(name, "Already a class with this name");
+        return;
+    }
+    if (m_classes.size() > std::numeric_limits<uint16_t>::max()) {
+        m_report(name, "Too many classes");
+        return;
+    }
+    auto type   = std::make_shared<ClassType>();
+    type->name  = std::string { name->word };
+    type->index = static_cast<uint16_t>(m_classes.size());
+    if (m_match(TokenType::LESS)) {
+        m_match(TokenType::IDENTIFIER, "Expect superclass name after '<'");
+        if (m_is_panicked) {
+            return;
+        }
+        auto superclass = m_classes.find(m_prev->word);
+        if (superclass == m_classes.end()) {
+            m_report(m_prev, "Undefined class");
+            return;
+        }
+        type->superclass = superclass->second.get();
+    }
+    m_match(TokenType::LEFT_BRACE, "Expect '{' before class body");
+    if (m_is_panicked) {
+        return;
+    }
+    // the members' types may name the class itself
+    m_classes.emplace(name->word, type);
+    Type instance { .index = TypeIndex::INSTANCE, .klass = type.get() };
+
+    // every member is known before the first method body, which may use any of them
+    struct Body {
+        std::vector<Token>::const_iterator name;
+        std::vector<std::vector<Token>::const_iterator> parameters;
+        std::vector<Token>::const_iterator start;   // first token after the '{'
+    };
+    std::vector<Body> bodies;
+    while (!m_check(TokenType::RIGHT_BRACE) && !m_check(TokenType::END)) {
+        m_match(TokenType::IDENTIFIER, "Expect field or method declaration");
+        if (m_is_panicked) {
+            return;
+        }
+        auto member = m_prev;
+        // a method may only override a superclass's method, anything else needs a name of its own
+        auto const* inherited = type->method(member->word);
+        bool is_own           = std::ranges::any_of(type->methods, [member](auto const& method) { return method.name == member->word; });
+        if (type->field(member->word) != nullptr || is_own || (inherited != nullptr && !m_check(TokenType::LEFT_PAREN))) {
+            m_report(member, "Already a field or method with this name");
+            return;
+        }
+
+        if (m_match(TokenType::COLON)) {
+            auto field = m_type_annotation();
+            if (!field.has_value()) {
+                return;
+            }
+            m_match(TokenType::SEMICOLON, "Expect ';' after field declaration");
+            if (m_is_panicked) {
+                return;
+            }
+            type->fields.push_back(ClassType::Field { std::string { member->word }, std::move(field.value()) });
+            continue;
+        }
+
+        m_match(TokenType::LEFT_PAREN, "Expect ':' after field name or '(' after method name");
+        FunctionType signature { .parameters = { instance }, .result = {} };
+        std::vector<std::vector<Token>::const_iterator> parameters;
+        if (!m_parameters(signature, parameters)) {
+            return;
+        }
+        // `init` always gives back the instance it initialized
+        bool is_initializer = member->word == "init";
+        if (is_initializer) {
+            signature.result = instance;
+        } else {
+            m_match(TokenType::COLON, "Expect ':' and a result type after ')'");
+            if (m_is_panicked) {
+                return;
+            }
+            auto result = m_type_annotation();
+            if (!result.has_value()) {
+                return;
+            }
+            signature.result = std::move(result.value());
+        }
+        // `CALL` counts its arguments in a byte, the instance is one of them
+        if (signature.parameters.size() > std::numeric_limits<uint8_t>::max()) {
+            m_report(member, "Cannot have more than 254 parameters");
+            return;
+        }
+        // an overriding method runs wherever the one it overrides would, with the same arguments
+        if (inherited != nullptr && !is_initializer
+            && (signature.result != inherited->signature->result
+                || !std::ranges::equal(signature.parameters | std::views::drop(1), inherited->signature->parameters | std::views::drop(1)))) {
+            m_report(member, "Cannot override a method with a different signature");
+            return;
+        }
+        m_match(TokenType::LEFT_BRACE, "Expect '{' before method body");
+        if (m_is_panicked) {
+            return;
+        }
+        bodies.push_back(Body { member, std::move(parameters), m_curr });
+        type->methods.push_back(ClassType::Method { std::string { member->word }, std::make_shared<FunctionType const>(std::move(signature)) });
+
+        // skipped for now, an interpolation opens a brace as well
+        for (std::size_t depth { 1 }; depth > 0;) {
+            if (m_check(TokenType::END)) {
+                m_report(m_curr, "Expect '}' after method body");
+                return;
+            }
+            m_advance();
+            if (m_prev->type == TokenType::LEFT_BRACE || m_prev->type == TokenType::INTRPL) {
+                depth++;
+            } else if (m_prev->type == TokenType::RIGHT_BRACE) {
+                depth--;
+            }
+        }
+    }
+    m_match(TokenType::RIGHT_BRACE, "Expect '}' after class body");
+    if (m_is_panicked) {
+        return;
+    }
+    auto end = m_curr;
+
+    // calling the class makes an instance and passes it on to `init` with the arguments, when there is one
+    FunctionType constructor { .parameters = {}, .result = instance };
+    if (auto const* init = type->method("init"); init != nullptr) {
+        constructor.parameters.assign(std::next(init->signature->parameters.cbegin()), init->signature->parameters.cend());
+    }
+    auto constructor_type = std::make_shared<FunctionType const>(std::move(constructor));
+    auto binding          = m_declare(name, Type { TypeIndex::FUNCTION, constructor_type });
+    if (!binding.has_value()) {
+        return;
+    }
+
+    std::vector<std::unique_ptr<Fun>> methods;
+    for (std::size_t index {}; index < bodies.size(); index++) {
+        auto const& body = bodies[index];
+        auto& method     = type->methods[index];
+        auto node        = std::make_unique<Fun>(Stmt { .line = body.name->line, .column = body.name->column }, method.name, Binding {}, method.signature, std::vector<Parameter> {}, std::vector<StmtType> {});
+
+        method.declaration = node.get();
+
+        // `this` is the first parameter, a keyword no parameter of the source can be called
+        std::vector<Token> receiver { Token { TokenType::THIS, "this", body.name->line, body.name->column } };
+        std::vector<std::vector<Token>::const_iterator> parameters { receiver.cbegin() };
+        parameters.insert(parameters.end(), body.parameters.cbegin(), body.parameters.cend());
+        bool is_initializer = method.name == "init";
+        m_prev              = std::prev(body.start);
+        m_curr              = body.start;
+        m_function_body(*node, parameters, Enclosing { .node = node.get(), .captured = {}, .klass = type.get(), .is_initializer = is_initializer });
+
+        if (is_initializer) {
+            Expr expr { .line = body.name->line, .type = TypeIndex::INSTANCE, .column = body.name->column, .klass = type.get() };
+            node->body.push_back(std::make_unique<Return>(Stmt { .line = body.name->line, .column = body.name->column },
+                                                          std::make_unique<Variable>(expr, "this", node->parameters.front().binding)));
+        } else if (m_is_parsed && std::ranges::none_of(node->body, [](auto const& stmt) { return returns(stmt); })) {
+            m_report(body.name, "Method does not return a value on every path");
+        }
+        methods.push_back(std::move(node));
+        if (m_is_panicked) {
+            break;
+        }
+    }
+    m_prev = std::prev(end);
+    m_curr = end;
+    if (m_is_panicked) {
+        return;
+    }
+    m_stmt = std::make_unique<Class>(Stmt { .line = keyword->line, .column = keyword->column }, std::string { name->word }, binding.value(), type, constructor_type, std::move(methods));
+}
+
+auto Parser::m_parameters(FunctionType& signature, std::vector<std::vector<Token>::const_iterator>& names) -> bool
+{
+    if (!m_is_panicked && !m_check(TokenType::RIGHT_PAREN)) {
+        do {
+            m_match(TokenType::IDENTIFIER, "Expect parameter name");
+            if (m_is_panicked) {
+                return false;
+            }
+            names.push_back(m_prev);
+            m_match(TokenType::COLON, "Expect ':' and a type after parameter name");
+            if (m_is_panicked) {
+                return false;
+            }
+            auto type = m_type_annotation();
+            if (!type.has_value()) {
+                return false;
+            }
+            signature.parameters.push_back(std::move(type.value()));
+        } while (m_match(TokenType::COMMA));
+    }
+    m_match(TokenType::RIGHT_PAREN, "Expect ')' after parameters");
+    return !m_is_panicked;
+}
+
+void Parser::m_function_body(Fun& node, std::vector<std::vector<Token>::const_iterator> const& parameters, Enclosing enclosing)
+{
+    // the body runs in a frame of its own, whose first slots hold the arguments
+    auto enclosing_frame = std::exchange(m_frame, m_locals.size());
+    m_functions.push_back(std::move(enclosing));
+    m_depth++;
+    node.parameters.reserve(parameters.size());   // the locals point into it
+    for (std::size_t index {}; index < parameters.size(); index++) {
+        auto parameter = m_declare(parameters[index], node.signature->parameters[index]);
+        node.parameters.push_back(Parameter { std::string { parameters[index]->word }, parameter.value_or(Binding {}) });
+        if (parameter.has_value()) {
+            m_locals.back().boxes.push_back(&node.parameters.back().binding.boxed);
+        }
+    }
+    while (!m_check(TokenType::RIGHT_BRACE) && !m_check(TokenType::END)) {
+        m_declaration();
+        node.body.push_back(std::move(m_stmt));
+    }
+    m_match(TokenType::RIGHT_BRACE, "Expect '}' after function body");
+    // returning drops the whole frame, the body's locals need no `POP`
+    while (m_locals.size() > m_frame) {
+        m_release();
+    }
+    m_depth--;
+    auto finished = std::move(m_functions.back());
+    m_functions.pop_back();
+    m_frame = enclosing_frame;
+    // no more captures come, their sources are uses of the enclosing functions' variables like any other
+    for (std::size_t index {}; index < finished.captured.size(); index++) {
+        m_locals[finished.captured[index]].boxes.push_back(&node.captures[index].source.boxed);
+    }
 }
 
 void Parser::m_statement()
@@ -83,16 +477,203 @@ void Parser::m_statement()
     using enum TokenType;
     if (m_match(LOG)) {
         m_log_statement();
+    } else if (m_match(LEFT_BRACE)) {
+        m_block();
+    } else if (m_match(IF)) {
+        m_if_statement();
+    } else if (m_match(WHILE)) {
+        m_while_statement();
+    } else if (m_match(FOR)) {
+        m_for_statement();
+    } else if (m_match(RETURN)) {
+        m_return_statement();
+    } else {
+        m_expression_statement();
     }
 }
 
 void Parser::m_log_statement()
 {
-    std::size_t line = m_prev->line;
+    std::size_t line   = m_prev->line;
+    std::size_t column = m_prev->column;
     m_advance();    // consume 'log' token
+    auto start = m_curr;
     m_grouping();   // parse the expression inside log(...)
+    if (!m_is_panicked && util::type::get_type(m_expr) == TypeIndex::FUNCTION) {
+        m_report(start, "Cannot log a function");
+    } else if (!m_is_panicked && util::type::get_type(m_expr) == TypeIndex::INSTANCE) {
+        m_report(start, "Cannot log an instance");
+    } else if (!m_is_panicked && util::type::get_type(m_expr) == TypeIndex::ARRAY) {
+        m_report(start, "Cannot log an array");
+    }
     m_match(TokenType::SEMICOLON, "Expect ';' after statement");
-    m_stmt = std::make_unique<Log>(Stmt { .line = line }, std::move(m_expr));
+    m_stmt = std::make_unique<Log>(Stmt { .line = line, .column = column }, std::move(m_expr));
+}
+
+void Parser::m_block()
+{
+    auto brace = m_prev;
+    m_depth++;
+
+    std::vector<StmtType> stmts;
+    while (!m_check(TokenType::RIGHT_BRACE) && !m_check(TokenType::END)) {
+        m_declaration();
+        stmts.push_back(std::move(m_stmt));
+    }
+    m_match(TokenType::RIGHT_BRACE, "Expect '}' after block");
+
+    // the block's locals go out of scope, their slots are free for whatever comes next
+    uint8_t locals {};
+    for (; !m_locals.empty() && m_locals.back().depth == m_depth; locals++) {
+        m_release();
+    }
+    m_depth--;
+
+    m_stmt = std::make_unique<Block>(Stmt { .line = brace->line, .column = brace->column }, std::move(stmts), locals);
+}
+
+void Parser::m_expression_statement()
+{
+    auto start = m_curr;
+    m_expression();
+    m_match(TokenType::SEMICOLON, "Expect ';' after expression");
+    m_stmt = std::make_unique<Expression>(Stmt { .line = start->line, .column = start->column }, std::move(m_expr));
+}
+
+void Parser::m_if_statement()
+{
+    auto keyword = m_prev;
+    m_condition("if");
+    if (m_is_panicked) {
+        return;
+    }
+    auto condition = std::move(m_expr);
+
+    m_statement();
+    auto then_branch = std::move(m_stmt);
+    std::optional<StmtType> else_branch;
+    if (m_match(TokenType::ELSE)) {
+        m_statement();
+        else_branch = std::move(m_stmt);
+    }
+    m_stmt = std::make_unique<If>(Stmt { .line = keyword->line, .column = keyword->column }, std::move(condition), std::move(then_branch), std::move(else_branch));
+}
+
+void Parser::m_while_statement()
+{
+    auto keyword = m_prev;
+    auto start   = m_order;
+    m_condition("while");
+    if (m_is_panicked) {
+        return;
+    }
+    auto condition = std::move(m_expr);
+
+    m_statement();
+    m_end_loop(start);
+    m_stmt = std::make_unique<While>(Stmt { .line = keyword->line, .column = keyword->column }, std::move(condition), std::move(m_stmt));
+}
+
+void Parser::m_for_statement()
+{
+    auto keyword = m_prev;
+    Stmt stmt { .line = keyword->line, .column = keyword->column };
+    m_match(TokenType::LEFT_PAREN, "Expect '(' after 'for'");
+    if (m_is_panicked) {
+        return;
+    }
+    // the initializer's variable lives in a block of its own around the loop
+    m_depth++;
+    std::vector<StmtType> stmts;
+    if (m_match(TokenType::LET)) {
+        m_let_declaration();
+        stmts.push_back(std::move(m_stmt));
+    } else if (!m_match(TokenType::SEMICOLON)) {
+        m_expression_statement();
+        stmts.push_back(std::move(m_stmt));
+    }
+
+    // the loop starts with the condition, the initializer only runs once
+    auto start = m_order;
+    // a missing condition loops until something else leaves the loop
+    ExprType condition = std::make_unique<Literal>(Expr { .line = keyword->line, .type = TypeIndex::BOOL, .column = keyword->column }, true);
+    if (!m_is_panicked && !m_check(TokenType::SEMICOLON)) {
+        auto start = m_curr;
+        m_expression();
+        if (!m_is_panicked && util::type::get_type(m_expr) != TypeIndex::BOOL) {
+            m_report(start, "Expect a bool condition after 'for'");
+        }
+        condition = std::move(m_expr);
+    }
+    m_match(TokenType::SEMICOLON, "Expect ';' after loop condition");
+
+    std::optional<StmtType> increment;
+    if (!m_is_panicked && !m_check(TokenType::RIGHT_PAREN)) {
+        auto start = m_curr;
+        m_expression();
+        increment = std::make_unique<Expression>(Stmt { .line = start->line, .column = start->column }, std::move(m_expr));
+    }
+    m_match(TokenType::RIGHT_PAREN, "Expect ')' after for clauses");
+
+    if (!m_is_panicked) {
+        m_statement();
+        if (increment.has_value()) {
+            std::vector<StmtType> body;
+            body.push_back(std::move(m_stmt));
+            body.push_back(std::move(increment.value()));
+            m_stmt = std::make_unique<Block>(stmt, std::move(body), uint8_t {});
+        }
+        stmts.push_back(std::make_unique<While>(stmt, std::move(condition), std::move(m_stmt)));
+    }
+    m_end_loop(start);
+
+    uint8_t locals {};
+    for (; !m_locals.empty() && m_locals.back().depth == m_depth; locals++) {
+        m_release();
+    }
+    m_depth--;
+    m_stmt = std::make_unique<Block>(stmt, std::move(stmts), locals);
+}
+
+void Parser::m_return_statement()
+{
+    auto keyword = m_prev;
+    if (m_functions.empty()) {
+        m_report(keyword, "Cannot return from top level code");
+        return;
+    }
+    if (m_functions.back().is_initializer) {
+        m_report(keyword, "Cannot return from an initializer");
+        return;
+    }
+    auto start = m_curr;
+    m_expression();
+    m_match(TokenType::SEMICOLON, "Expect ';' after return value");
+    if (m_is_panicked) {
+        return;
+    }
+
+    auto const& result = m_functions.back().node->signature->result;
+    auto type          = util::type::get_static_type(m_expr);
+    if (!is_assignable(type, result) && !m_convert_literal(result)) {
+        m_report(start, std::format("Cannot return value of type {} from function returning {}",
+                                    util::type::to_string(type), util::type::to_string(result)));
+        return;
+    }
+    m_stmt = std::make_unique<Return>(Stmt { .line = keyword->line, .column = keyword->column }, std::move(m_expr));
+}
+
+void Parser::m_condition(std::string_view keyword)
+{
+    m_match(TokenType::LEFT_PAREN, std::format("Expect '(' after '{}'", keyword));
+    if (m_is_panicked) {
+        return;
+    }
+    auto start = m_curr;
+    m_grouping();
+    if (!m_is_panicked && util::type::get_type(m_expr) != TypeIndex::BOOL) {
+        m_report(start, std::format("Expect a bool condition after '{}'", keyword));
+    }
 }
 
 void Parser::m_grouping()
@@ -122,6 +703,10 @@ void Parser::m_binary()
         m_report(op, "Expect expressions of same type");
         return;
     }
+    if (type_index == TypeIndex::ARRAY) {
+        m_elementwise(op, std::move(left));
+        return;
+    }
 
     auto make_binary_expr = [this, op, &left, type_index]<typename ExprType>(ExprType, std::string_view c, TypeIndex new_type_index) {
         switch (type_index) {
@@ -137,7 +722,7 @@ void Parser::m_binary()
             case FLOAT32:
             case FLOAT64:
                 m_expr = std::make_unique<ExprType>(Binary {
-                    Expr { .line = op->line, .type = new_type_index },
+                    Expr { .line = op->line, .type = new_type_index, .column = op->column },
                     std::move(left), std::move(m_expr)
                 });
                 break;
@@ -153,7 +738,7 @@ void Parser::m_binary()
         case PLUS:
             if (type_index == TypeIndex::STRING) {
                 m_expr = std::make_unique<Add>(Binary {
-                    Expr { .line = op->line, .type = TypeIndex::STRING },
+                    Expr { .line = op->line, .type = TypeIndex::STRING, .column = op->column },
                     std::move(left), std::move(m_expr)
                 });
             } else {
@@ -171,13 +756,14 @@ void Parser::m_binary()
             break;
         case PERCENT:
             make_binary_expr(Modulus {}, "%", type_index);
+            break;
         case LESS:
             make_binary_expr(Compare<Order::LESS> {}, "<", TypeIndex::BOOL);
             break;
         case LESS_EQUAL:
             make_binary_expr(Compare<Order::GREATER> {}, "<=", TypeIndex::BOOL);
             m_expr = std::make_unique<Not>(Unary {
-                Expr { op->line, TypeIndex::BOOL },
+                Expr { op->line, TypeIndex::BOOL, op->column },
                 std::move(m_expr),
             });
             break;
@@ -187,14 +773,14 @@ void Parser::m_binary()
         case GREATER_EQUAL:
             make_binary_expr(Compare<Order::LESS> {}, ">=", TypeIndex::BOOL);
             m_expr = std::make_unique<Not>(Unary {
-                Expr { op->line, TypeIndex::BOOL },
+                Expr { op->line, TypeIndex::BOOL, op->column },
                 std::move(m_expr),
             });
             break;
         case EQUAL_EQUAL:
             if (type_index == TypeIndex::BOOL) {
                 m_expr = std::make_unique<Compare<Order::EQUAL>>(Binary {
-                    Expr { .line = op->line, .type = TypeIndex::BOOL },
+                    Expr { .line = op->line, .type = TypeIndex::BOOL, .column = op->column },
                     std::move(left), std::move(m_expr)
                 });
             } else {
@@ -204,14 +790,14 @@ void Parser::m_binary()
         case BANG_EQUAL:
             if (type_index == TypeIndex::BOOL) {
                 m_expr = std::make_unique<Compare<Order::EQUAL>>(Binary {
-                    Expr { .line = op->line, .type = TypeIndex::BOOL },
+                    Expr { .line = op->line, .type = TypeIndex::BOOL, .column = op->column },
                     std::move(left), std::move(m_expr)
                 });
             } else {
                 make_binary_expr(Compare<Order::EQUAL> {}, "!=", TypeIndex::BOOL);
             }
             m_expr = std::make_unique<Not>(Unary {
-                Expr { op->line, TypeIndex::BOOL },
+                Expr { op->line, TypeIndex::BOOL, op->column },
                 std::move(m_expr),
             });
             break;
@@ -224,6 +810,29 @@ void Parser::m_binary()
     }
 }
 
+void Parser::m_logical()
+{
+    auto op           = m_prev;
+    auto const& entry = m_get_entry(op->type);
+
+    m_parse_precedence(entry.precedence);
+
+    auto left = std::move(m_stack.back());
+    m_stack.pop_back();
+
+    if (util::type::get_type(left) != TypeIndex::BOOL || util::type::get_type(m_expr) != TypeIndex::BOOL) {
+        m_report(op, std::format("Expect bool operands for '{}'", op->word));
+        return;
+    }
+
+    Binary binary { Expr { .line = op->line, .type = TypeIndex::BOOL, .column = op->column }, std::move(left), std::move(m_expr) };
+    if (op->type == TokenType::AND) {
+        m_expr = std::make_unique<And>(std::move(binary));
+    } else {
+        m_expr = std::make_unique<Or>(std::move(binary));
+    }
+}
+
 void Parser::m_unary()
 {
     auto op = m_prev;
@@ -243,7 +852,7 @@ void Parser::m_unary()
                 case FLOAT32:
                 case FLOAT64:
                     m_expr = std::make_unique<Negate>(Unary {
-                        Expr { .line = op->line, .type = type_index },
+                        Expr { .line = op->line, .type = type_index, .column = op->column },
                         std::move(m_expr)
                     });
                     break;
@@ -257,9 +866,22 @@ void Parser::m_unary()
                     m_report(op, "Expect a numeric expression here");
                     return;
             }
+            break;
         case TokenType::BANG:
+            if (type_index == TypeIndex::FUNCTION) {
+                m_report(op, "Cannot apply '!' to a function");
+                return;
+            }
+            if (type_index == TypeIndex::INSTANCE) {
+                m_report(op, "Cannot apply '!' to an instance");
+                return;
+            }
+            if (type_index == TypeIndex::ARRAY) {
+                m_report(op, "Cannot apply '!' to an array");
+                return;
+            }
             m_expr = std::make_unique<Not>(Unary {
-                Expr { .line = op->line, .type = TypeIndex::BOOL },
+                Expr { .line = op->line, .type = TypeIndex::BOOL, .column = op->column },
                 std::move(m_expr)
             });
             break;
@@ -282,7 +904,7 @@ void Parser::m_number()
     auto make_number = [this]<typename T>(T, TypeIndex type_index) {
         T value {};
         std::from_chars(m_prev->word.data(), m_prev->word.data() + m_prev->word.size(), value);
-        m_expr = std::make_unique<Literal>(Expr { .line = m_prev->line, .type = type_index }, value);
+        m_expr = std::make_unique<Literal>(Expr { .line = m_prev->line, .type = type_index, .column = m_prev->column }, value);
     };
     switch (type) {
         using enum TokenType;
@@ -313,28 +935,42 @@ void Parser::m_literal()
     switch (m_prev->type) {
         using enum TokenType;
         case TRUE:
-            m_expr = std::make_unique<Literal>(Expr { .line = m_prev->line, .type = TypeIndex::BOOL }, true);
+            m_expr = std::make_unique<Literal>(Expr { .line = m_prev->line, .type = TypeIndex::BOOL, .column = m_prev->column }, true);
             break;
         case FALSE:
-            m_expr = std::make_unique<Literal>(Expr { .line = m_prev->line, .type = TypeIndex::BOOL }, false);
+            m_expr = std::make_unique<Literal>(Expr { .line = m_prev->line, .type = TypeIndex::BOOL, .column = m_prev->column }, false);
             break;
         case STRING:
             m_expr = std::make_unique<Literal>(
-                Expr { .line = m_prev->line, .type = TypeIndex::STRING },
+                Expr { .line = m_prev->line, .type = TypeIndex::STRING, .column = m_prev->column },
                 std::string { m_prev->word });
             break;
         case INTRPL: {
             // left string
-            std::size_t line = m_prev->line;
-            m_expr           = std::make_unique<Literal>(Expr { .line = line, .type = TypeIndex::STRING }, std::string { m_prev->word });
+            std::size_t line   = m_prev->line;
+            std::size_t column = m_prev->column;
+            m_expr             = std::make_unique<Literal>(Expr { .line = line, .type = TypeIndex::STRING, .column = column }, std::string { m_prev->word });
 
             // middle expression
+            auto start = m_curr;
             m_expression();
+            if (!m_is_panicked && util::type::get_type(m_expr) == TypeIndex::FUNCTION) {
+                m_report(start, "Cannot interpolate a function");
+                return;
+            }
+            if (!m_is_panicked && util::type::get_type(m_expr) == TypeIndex::INSTANCE) {
+                m_report(start, "Cannot interpolate an instance");
+                return;
+            }
+            if (!m_is_panicked && util::type::get_type(m_expr) == TypeIndex::ARRAY) {
+                m_report(start, "Cannot interpolate an array");
+                return;
+            }
 
             auto left = std::move(m_stack.back());
             m_stack.pop_back();
             m_expr = std::make_unique<Add>(Binary {
-                Expr { .line = line, .type = TypeIndex::STRING },
+                Expr { .line = line, .type = TypeIndex::STRING, .column = column },
                 std::move(left),
                 std::move(m_expr),
             });
@@ -343,13 +979,14 @@ void Parser::m_literal()
             m_advance();   // consume closing braces
 
             // right string
-            line = m_prev->line;
+            line   = m_prev->line;
+            column = m_prev->column;
             m_literal();   // consume the rest of the string
 
             left = std::move(m_stack.back());
             m_stack.pop_back();
             m_expr = std::make_unique<Add>(Binary {
-                Expr { .line = line, .type = TypeIndex::STRING },
+                Expr { .line = line, .type = TypeIndex::STRING, .column = column },
                 std::move(left),
                 std::move(m_expr)
             });
@@ -363,28 +1000,789 @@ void Parser::m_literal()
     }
 }
 
-void Parser::m_advance()
+void Parser::m_variable()
 {
-    m_prev = m_curr;
+    // push the left sub-expression into the stack and make ast point to primary expression
+    m_stack.emplace_back(std::move(m_expr));
 
-    ++m_curr;   // consume all error tokens until we get a non error token or reach the end
-    if (m_curr->type == TokenType::ERROR) {
-        m_report(m_curr, m_curr->word);
-        while (m_curr != m_tokens.cend() && m_curr->type != TokenType::ERROR) {
-            ++m_curr;
-        }
+    auto name   = m_prev;
+    auto symbol = m_resolve(name->word);
+    if (symbol == nullptr) {
+        m_report(name, "Undefined variable");
+        return;
     }
-}
-
-auto Parser::m_match(TokenType type) -> bool
-{
-    if (type == m_curr->type) {
-        m_advance();
-        return true;
+    Expr expr { .line = name->line, .type = symbol->type.index, .column = name->column, .signature = symbol->type.signature, .klass = symbol->type.klass, .element = symbol->type.element };
+    auto found = m_binding(name, *symbol);
+    if (!found.has_value()) {
+        return;
     }
+    auto binding = found.value();
+    // every node naming a local learns at once whether the local ends up boxed
+    auto use = [symbol](Binding& used) {
+        if (symbol->binding.scope == Binding::Scope::LOCAL) {
+            symbol->boxes.push_back(&used.boxed);
+        }
+    };
 
-    return false;
-}
+    if (m_can_assign && m_match(TokenType::EQUAL)) {
+        auto equal = m_prev;
+        // a function may refer to itself by name, which always has to mean that function
+        if (symbol->declaration != nullptr) {
+            m_report(equal, "Cannot assign to a function declaration");
+            return;
+        }
+        auto depth = m_stack.size();
+        m_expression();   // assignments are right associative, `a = b = c` assigns `c` to both
+        if (m_stack.size() > depth) {
+            m_stack.pop_back();   // the value's leftmost operand pushed our own left sub-expression again
+        }
+        if (m_is_panicked) {
+            return;
+        }
+
+        if (util::type::get_static_type(m_expr) != symbol->type) {
+            m_report(equal, std::format("Cannot assign value of type {} to variable of type {}",
+                                        util::type::to_string(util::type::get_static_type(m_expr)), util::type::to_string(symbol->type)));
+            return;
+        }
+        symbol->assigned = ++m_order;
+        auto node        = std::make_unique<Assign>(expr, std::string { name->word }, binding, std::move(m_expr));
+        use(node->binding);
+        m_expr = std::move(node);
+        return;
+    }
+
+    // called by name where it is declared a function needs no closure, any other use lets the function escape
+    if (symbol->declaration != nullptr && (binding.scope == Binding::Scope::CAPTURE || !m_check(TokenType::LEFT_PAREN))) {
+        symbol->declaration->escapes = true;
+    }
+    auto node = std::make_unique<Variable>(expr, std::string { name->word }, binding, symbol->declaration);
+    use(node->binding);
+    m_expr = std::move(node);
+}
+
+void Parser::m_call()
+{
+    if (m_is_panicked) {
+        return;   // nothing sensible was parsed in front of the '('
+    }
+    auto paren     = m_prev;
+    auto callee    = std::move(m_expr);
+    auto signature = util::type::get_static_type(callee).signature;
+    if (signature == nullptr) {
+        m_report(paren, "Can only call functions");
+        return;
+    }
+
+    auto arguments = m_arguments(paren, *signature, 0);
+    if (!arguments.has_value()) {
+        return;
+    }
+
+    auto const& result = signature->result;
+    Expr expr { .line = paren->line, .type = result.index, .column = paren->column, .signature = result.signature, .klass = result.klass, .element = result.element };
+    m_expr = std::make_unique<Call>(expr, std::move(callee), std::move(arguments.value()));
+}
+
+auto Parser::m_arguments(std::vector<Token>::const_iterator paren, FunctionType const& signature, std::size_t first) -> std::optional<std::vector<ExprType>>
+{
+    auto const parameters = signature.parameters.size() - first;
+    std::vector<ExprType> arguments;
+    if (!m_check(TokenType::RIGHT_PAREN)) {
+        do {
+            auto start = m_curr;
+            auto depth = m_stack.size();
+            m_expression();
+            if (m_stack.size() > depth) {
+                m_stack.pop_back();   // the argument's leftmost operand pushed the callee's left sub-expression
+            }
+            if (m_is_panicked) {
+                return {};
+            }
+            if (arguments.size() < parameters) {
+                auto const& parameter = signature.parameters[first + arguments.size()];
+                auto type             = util::type::get_static_type(m_expr);
+                if (!is_assignable(type, parameter) && !m_convert_literal(parameter)) {
+                    m_report(start, std::format("Cannot pass value of type {} as parameter of type {}",
+                                                util::type::to_string(type), util::type::to_string(parameter)));
+                    return {};
+                }
+            }
+            arguments.push_back(std::move(m_expr));
+        } while (m_match(TokenType::COMMA));
+    }
+    m_match(TokenType::RIGHT_PAREN, "Expect ')' after arguments");
+    if (m_is_panicked) {
+        return {};
+    }
+    if (arguments.size() != parameters) {
+        m_report(paren, std::format("Expect {} arguments but got {}", parameters, arguments.size()));
+        return {};
+    }
+    return arguments;
+}
+
+void Parser::m_property()
+{
+    if (m_is_panicked) {
+        return;   // nothing sensible was parsed in front of the '.'
+    }
+    auto dot = m_prev;
+    if (util::type::get_type(m_expr) == TypeIndex::ARRAY) {
+        m_array_method();
+        return;
+    }
+    auto const* klass = util::type::get_static_type(m_expr).klass;
+    if (klass == nullptr) {
+        m_report(dot, "Only instances have properties");
+        return;
+    }
+    m_match(TokenType::IDENTIFIER, "Expect property name after '.'");
+    if (m_is_panicked) {
+        return;
+    }
+    auto name   = m_prev;
+    auto object = std::move(m_expr);
+
+    if (auto const* method = klass->method(name->word); method != nullptr) {
+        // methods are no values, they are looked up anew by every call
+        if (method->name == "init") {
+            m_report(name, "Cannot call 'init' on an instance");
+            return;
+        }
+        m_match(TokenType::LEFT_PAREN, "Expect '(' after method name, methods can only be called");
+        if (m_is_panicked) {
+            return;
+        }
+        auto arguments = m_arguments(m_prev, *method->signature, 1);
+        if (!arguments.has_value()) {
+            return;
+        }
+        auto const& result = method->signature->result;
+        Expr expr { .line = name->line, .type = result.index, .column = name->column, .signature = result.signature, .klass = result.klass, .element = result.element };
+        m_expr = std::make_unique<Invoke>(expr, std::move(object), std::string { name->word }, std::move(arguments.value()));
+        return;
+    }
+
+    auto const* field = klass->field(name->word);
+    if (field == nullptr) {
+        m_report(name, "Undefined property");
+        return;
+    }
+    Expr expr { .line = name->line, .type = field->type.index, .column = name->column, .signature = field->type.signature, .klass = field->type.klass, .element = field->type.element };
+    if (m_can_assign && m_match(TokenType::EQUAL)) {
+        auto equal = m_prev;
+        auto depth = m_stack.size();
+        m_expression();   // right associative like assigning a variable
+        if (m_stack.size() > depth) {
+            m_stack.pop_back();
+        }
+        if (m_is_panicked) {
+            return;
+        }
+        auto type = util::type::get_static_type(m_expr);
+        if (!is_assignable(type, field->type) && !m_convert_literal(field->type)) {
+            m_report(equal, std::format("Cannot assign value of type {} to field of type {}",
+                                        util::type::to_string(type), util::type::to_string(field->type)));
+            return;
+        }
+        m_expr = std::make_unique<Set>(expr, std::move(object), std::string { name->word }, std::move(m_expr));
+        return;
+    }
+    m_expr = std::make_unique<Get>(expr, std::move(object), std::string { name->word });
+}
+
+void Parser::m_this()
+{
+    if (m_resolve("this") == nullptr) {
+        m_stack.emplace_back(std::move(m_expr));
+        m_report(m_prev, "Cannot use 'this' outside of a method");
+        return;
+    }
+    // a parameter, only it cannot be assigned to
+    m_can_assign = false;
+    m_variable();
+}
+
+void Parser::m_super()
+{
+    // push the left sub-expression into the stack and make ast point to primary expression
+    m_stack.emplace_back(std::move(m_expr));
+
+    auto keyword = m_prev;
+    // classes are only declared in the top level code, the outermost function being parsed is the method
+    auto const* klass = m_functions.empty() ? nullptr : m_functions.front().klass;
+    if (klass == nullptr) {
+        m_report(keyword, "Cannot use 'super' outside of a method");
+        return;
+    }
+    if (klass->superclass == nullptr) {
+        m_report(keyword, "Cannot use 'super' in a class without a superclass");
+        return;
+    }
+    m_match(TokenType::DOT, "Expect '.' after 'super'");
+    m_match(TokenType::IDENTIFIER, "Expect superclass method name");
+    if (m_is_panicked) {
+        return;
+    }
+    auto name          = m_prev;
+    auto const* method = klass->superclass->method(name->word);
+    if (method == nullptr) {
+        m_report(name, "Undefined superclass method");
+        return;
+    }
+    m_match(TokenType::LEFT_PAREN, "Expect '(' after superclass method name, methods can only be called");
+    if (m_is_panicked) {
+        return;
+    }
+    auto paren = m_prev;
+
+    // the method runs for `this`, which is in scope inside any method
+    auto* receiver = m_resolve("this");
+    auto binding   = m_binding(keyword, *receiver);
+    if (!binding.has_value()) {
+        return;
+    }
+    Expr self { .line = keyword->line, .type = TypeIndex::INSTANCE, .column = keyword->column, .klass = receiver->type.klass };
+    auto object = std::make_unique<Variable>(self, "this", binding.value());
+    receiver->boxes.push_back(&object->binding.boxed);
+
+    auto arguments = m_arguments(paren, *method->signature, 1);
+    if (!arguments.has_value()) {
+        return;
+    }
+    auto const& result = method->signature->result;
+    Expr expr { .line = name->line, .type = result.index, .column = name->column, .signature = result.signature, .klass = result.klass, .element = result.element };
+    m_expr = std::make_unique<Invoke>(expr, std::move(object), std::string { name->word }, std::move(arguments.value()), method->declaration);
+}
+
+void Parser::m_array()
+{
+    // push the left sub-expression into the stack and make ast point to primary expression
+    m_stack.emplace_back(std::move(m_expr));
+
+    auto bracket = m_prev;
+    if (m_check(TokenType::RIGHT_BRACKET)) {
+        m_report(bracket, "Cannot infer the type of an empty array, use [value; 0]");
+        return;
+    }
+    // every element is an operand of its own, its leftmost one pushes what came before the '['
+    auto element = [this] {
+        auto depth = m_stack.size();
+        m_expression();
+        if (m_stack.size() > depth) {
+            m_stack.pop_back();
+        }
+    };
+
+    auto start = m_curr;
+    element();
+    if (m_is_panicked) {
+        return;
+    }
+    auto type = util::type::get_type(m_expr);
+    if (!util::type::is_element(type)) {
+        m_report(start, std::format("Cannot make an array of {}", util::type::to_string(util::type::get_static_type(m_expr))));
+        return;
+    }
+    Expr expr { .line = bracket->line, .type = TypeIndex::ARRAY, .column = bracket->column, .element = type };
+
+    if (m_match(TokenType::SEMICOLON)) {
+        auto value = std::move(m_expr);
+        start      = m_curr;
+        element();
+        m_match(TokenType::RIGHT_BRACKET, "Expect ']' after array length");
+        if (m_is_panicked) {
+            return;
+        }
+        auto length = util::type::get_type(m_expr);
+        if (!util::type::is_signed_integer(length) && !util::type::is_unsigned_integer(length)) {
+            m_report(start, "Expect an integer array length");
+            return;
+        }
+        m_expr = std::make_unique<ArrayFill>(expr, std::move(value), std::move(m_expr));
+        return;
+    }
+
+    std::vector<ExprType> elements;
+    elements.push_back(std::move(m_expr));
+    while (m_match(TokenType::COMMA)) {
+        start = m_curr;
+        element();
+        if (m_is_panicked) {
+            return;
+        }
+        auto other = util::type::get_static_type(m_expr);
+        if (other != Type { type } && !m_convert_literal(Type { type })) {
+            m_report(start, std::format("Expect an element of type {} but got {}", util::type::to_string(type), util::type::to_string(other)));
+            return;
+        }
+        elements.push_back(std::move(m_expr));
+    }
+    m_match(TokenType::RIGHT_BRACKET, "Expect ']' after array elements");
+    if (m_is_panicked) {
+        return;
+    }
+    if (elements.size() > std::numeric_limits<uint16_t>::max()) {
+        m_report(bracket, "Cannot have more than 65535 elements in an array literal");
+        return;
+    }
+    m_expr = std::make_unique<ArrayLiteral>(expr, std::move(elements));
+}
+
+void Parser::m_index()
+{
+    if (m_is_panicked) {
+        return;   // nothing sensible was parsed in front of the '['
+    }
+    auto bracket = m_prev;
+    auto element = util::type::get_static_type(m_expr).element;
+    if (util::type::get_type(m_expr) != TypeIndex::ARRAY) {
+        m_report(bracket, "Only arrays can be indexed");
+        return;
+    }
+    auto array = std::move(m_expr);
+
+    auto start = m_curr;
+    auto depth = m_stack.size();
+    m_expression();
+    if (m_stack.size() > depth) {
+        m_stack.pop_back();   // the index's leftmost operand pushed the array's left sub-expression
+    }
+    m_match(TokenType::RIGHT_BRACKET, "Expect ']' after index");
+    if (m_is_panicked) {
+        return;
+    }
+    auto type = util::type::get_type(m_expr);
+    if (!util::type::is_signed_integer(type) && !util::type::is_unsigned_integer(type)) {
+        m_report(start, "Expect an integer index");
+        return;
+    }
+    auto index = std::move(m_expr);
+
+    Expr expr { .line = bracket->line, .type = element, .column = bracket->column };
+    if (m_can_assign && m_match(TokenType::EQUAL)) {
+        auto equal = m_prev;
+        depth      = m_stack.size();
+        m_expression();   // right associative like assigning a variable
+        if (m_stack.size() > depth) {
+            m_stack.pop_back();
+        }
+        if (m_is_panicked) {
+            return;
+        }
+        auto value = util::type::get_static_type(m_expr);
+        if (value != Type { element } && !m_convert_literal(Type { element })) {
+            m_report(equal, std::format("Cannot assign value of type {} to element of type {}",
+                                        util::type::to_string(value), util::type::to_string(element)));
+            return;
+        }
+        m_expr = std::make_unique<SetIndex>(expr, std::move(array), std::move(index), std::move(m_expr));
+        return;
+    }
+    m_expr = std::make_unique<Index>(expr, std::move(array), std::move(index));
+}
+
+void Parser::m_elementwise(std::vector<Token>::const_iterator op, ExprType left)
+{
+    auto element = util::type::get_static_type(left).element;
+    if (element != util::type::get_static_type(m_expr).element) {
+        m_report(op, "Expect arrays of same type");
+        return;
+    }
+
+    std::optional<ArrayOp> array_op;
+    switch (op->type) {
+        using enum TokenType;
+        case PLUS: array_op = ArrayOp::ADD; break;
+        case MINUS: array_op = ArrayOp::SUB; break;
+        case STAR: array_op = ArrayOp::MUL; break;
+        case SLASH: array_op = ArrayOp::DIV; break;
+        case LESS: array_op = ArrayOp::LT; break;
+        case LESS_EQUAL: array_op = ArrayOp::LE; break;
+        case GREATER: array_op = ArrayOp::GT; break;
+        case GREATER_EQUAL: array_op = ArrayOp::GE; break;
+        case EQUAL_EQUAL: array_op = ArrayOp::EQ; break;
+        case BANG_EQUAL: array_op = ArrayOp::NE; break;
+        default: break;
+    }
+    if (!array_op.has_value() || element == TypeIndex::BOOL) {
+        m_report(op, std::format("Cannot perform '{}' operation on arrays of {}", op->word, util::type::to_string(element)));
+        return;
+    }
+    // comparisons give an array of bools saying where they hold
+    auto result = array_op.value() >= ArrayOp::LT ? TypeIndex::BOOL : element;
+    m_expr      = std::make_unique<Elementwise>(Expr { .line = op->line, .type = TypeIndex::ARRAY, .column = op->column, .element = result },
+                                           array_op.value(), std::move(left), std::move(m_expr));
+}
+
+void Parser::m_array_method()
+{
+    auto element = util::type::get_static_type(m_expr).element;
+    m_match(TokenType::IDENTIFIER, "Expect method name after '.'");
+    if (m_is_panicked) {
+        return;
+    }
+    auto name = m_prev;
+    m_match(TokenType::LEFT_PAREN, "Expect '(' after method name, methods can only be called");
+    m_match(TokenType::RIGHT_PAREN, "Expect ')', array methods take no arguments");
+    if (m_is_panicked) {
+        return;
+    }
+
+    auto array = std::move(m_expr);
+    if (name->word == "len") {
+        m_expr = std::make_unique<Length>(Expr { .line = name->line, .type = TypeIndex::INT64, .column = name->column }, std::move(array));
+        return;
+    }
+    std::optional<ArrayOp> op;
+    if (name->word == "sum") {
+        op = ArrayOp::SUM;
+    } else if (name->word == "min") {
+        op = ArrayOp::MIN;
+    } else if (name->word == "max") {
+        op = ArrayOp::MAX;
+    }
+    if (!op.has_value()) {
+        m_report(name, "Undefined array method, arrays have 'len', 'sum', 'min' and 'max'");
+        return;
+    }
+    if (element == TypeIndex::BOOL) {
+        m_report(name, std::format("Cannot '{}' an array of bool", name->word));
+        return;
+    }
+    m_expr = std::make_unique<Reduce>(Expr { .line = name->line, .type = element, .column = name->column }, op.value(), std::move(array));
+}
+
+auto Parser::m_type_annotation() -> std::optional<Type>
+{
+    m_advance();
+    switch (m_prev->type) {
+        using enum TokenType;
+        case BOOL: return Type { TypeIndex::BOOL };
+        case INT8: return Type { TypeIndex::INT8 };
+        case INT16: return Type { TypeIndex::INT16 };
+        case INT32: return Type { TypeIndex::INT32 };
+        case INT64: return Type { TypeIndex::INT64 };
+        case UINT8: return Type { TypeIndex::UINT8 };
+        case UINT16: return Type { TypeIndex::UINT16 };
+        case UINT32: return Type { TypeIndex::UINT32 };
+        case UINT64: return Type { TypeIndex::UINT64 };
+        case FLOAT32: return Type { TypeIndex::FLOAT32 };
+        case FLOAT64: return Type { TypeIndex::FLOAT64 };
+        case STRING:
+            // the `string` keyword shares its token type with string literals
+            if (m_prev->word == "string") {
+                return Type { TypeIndex::STRING };
+            }
+            break;
+        case FUN: {
+            auto fun = m_prev;
+            FunctionType signature;
+            m_match(LEFT_PAREN, "Expect '(' after 'fun'");
+            if (!m_is_panicked && !m_check(RIGHT_PAREN)) {
+                do {
+                    auto parameter = m_type_annotation();
+                    if (!parameter.has_value()) {
+                        return {};
+                    }
+                    signature.parameters.push_back(std::move(parameter.value()));
+                } while (m_match(COMMA));
+            }
+            m_match(RIGHT_PAREN, "Expect ')' after parameter types");
+            m_match(COLON, "Expect ':' and a result type after ')'");
+            if (m_is_panicked) {
+                return {};
+            }
+            auto result = m_type_annotation();
+            if (!result.has_value()) {
+                return {};
+            }
+            signature.result = std::move(result.value());
+            if (signature.parameters.size() > std::numeric_limits<uint8_t>::max()) {
+                m_report(fun, "Cannot have more than 255 parameters");
+                return {};
+            }
+            return Type { TypeIndex::FUNCTION, std::make_shared<FunctionType const>(std::move(signature)) };
+        }
+        case LEFT_BRACKET: {
+            auto bracket = m_prev;
+            auto element = m_type_annotation();
+            if (!element.has_value()) {
+                return {};
+            }
+            m_match(RIGHT_BRACKET, "Expect ']' after element type");
+            if (m_is_panicked) {
+                return {};
+            }
+            if (!util::type::is_element(element->index)) {
+                m_report(bracket, std::format("Cannot make an array of {}", util::type::to_string(element.value())));
+                return {};
+            }
+            return Type { .index = TypeIndex::ARRAY, .element = element->index };
+        }
+        case IDENTIFIER:
+            // a class names the type of its instances
+            if (auto klass = m_classes.find(m_prev->word); klass != m_classes.end()) {
+                return Type { .index = TypeIndex::INSTANCE, .klass = klass->second.get() };
+            }
+            break;
+        default: break;
+    }
+    m_report(m_prev, "Expect a type after ':'");
+    return {};
+}
+
+namespace {
+// retypes the numeric literal `expr` to `type`, false when it is not one or its value does not fit
+auto convert_literal(ExprType& expr, TypeIndex type) -> bool
+{
+    auto* literal = std::get_if<std::unique_ptr<Literal>>(&expr);
+    if (literal == nullptr || literal->get() == nullptr) {
+        return false;
+    }
+
+    // integer literals take any numeric type they fit in, float literals only the other float type
+    auto convert = [&]<typename To>(To) {
+        return std::visit(util::Visitor {
+                              [&]<typename From>(From value) -> bool
+                                  requires(std::integral<From> && !std::is_same_v<From, bool>)
+                              {
+                                  if constexpr (std::integral<To>) {
+                                      if (!std::in_range<To>(value)) {
+                                          return false;
+                                      }
+                                  }
+                                  (*literal)->value = static_cast<To>(value);
+                                  return true;
+                              },
+                              [&]<std::floating_point From>(From value) -> bool {
+                                  if constexpr (std::floating_point<To>) {
+                                      (*literal)->value = static_cast<To>(value);
+                                      return true;
+                                  }
+                                  return false;
+                              },
+                              [](auto) { return false; },
+                          },
+                          (*literal)->value);
+    };
+
+    bool is_converted {};
+    switch (type) {
+        using enum TypeIndex;
+        case INT8: is_converted = convert(int8_t {}); break;
+        case INT16: is_converted = convert(int16_t {}); break;
+        case INT32: is_converted = convert(int32_t {}); break;
+        case INT64: is_converted = convert(int64_t {}); break;
+        case UINT8: is_converted = convert(uint8_t {}); break;
+        case UINT16: is_converted = convert(uint16_t {}); break;
+        case UINT32: is_converted = convert(uint32_t {}); break;
+        case UINT64: is_converted = convert(uint64_t {}); break;
+        case FLOAT32: is_converted = convert(float {}); break;
+        case FLOAT64: is_converted = convert(double {}); break;
+        default: break;
+    }
+    if (is_converted) {
+        (*literal)->type = type;
+    }
+    return is_converted;
+}
+}
+
+auto Parser::m_convert_literal(Type const& type) -> bool
+{
+    if (type.index != TypeIndex::ARRAY) {
+        return convert_literal(m_expr, type.index);
+    }
+    // an array made of literals takes any element type every one of them converts to
+    if (auto* array = std::get_if<std::unique_ptr<ArrayLiteral>>(&m_expr); array != nullptr && *array != nullptr) {
+        if (!std::ranges::all_of((*array)->elements, [&type](auto& element) { return convert_literal(element, type.element); })) {
+            return false;
+        }
+        (*array)->element = type.element;
+        return true;
+    }
+    if (auto* fill = std::get_if<std::unique_ptr<ArrayFill>>(&m_expr); fill != nullptr && *fill != nullptr) {
+        if (!convert_literal((*fill)->value, type.element)) {
+            return false;
+        }
+        (*fill)->element = type.element;
+        return true;
+    }
+    return false;
+}
+
+auto Parser::m_declare(std::vector<Token>::const_iterator name, Type type) -> std::optional<Binding>
+{
+    if (m_depth == 0) {
+        if (m_global_count > std::numeric_limits<uint16_t>::max()) {
+            m_report(name, "Too many global variables");
+            return {};
+        }
+        Binding binding { Binding::Scope::GLOBAL, static_cast<uint16_t>(m_global_count++) };
+        m_globals.insert_or_assign(name->word, Symbol { name->word, std::move(type), binding, 0, 0 });
+        return binding;
+    }
+
+    for (auto const& local : m_locals | std::views::reverse) {
+        if (local.depth < m_depth) {
+            break;
+        }
+        if (local.name == name->word) {
+            m_report(name, "Already a variable with this name in this scope");
+            return {};
+        }
+    }
+    // slots are a one byte operand, and a block drops at most that many locals
+    auto slot = m_locals.size() - m_frame;
+    if (slot >= std::numeric_limits<uint8_t>::max()) {
+        m_report(name, "Too many local variables");
+        return {};
+    }
+    Binding binding { Binding::Scope::LOCAL, static_cast<uint16_t>(slot) };
+    if (!m_functions.empty()) {
+        m_functions.back().node->locals = std::max(m_functions.back().node->locals, slot + 1);
+    }
+    m_locals.push_back({ name->word, std::move(type), binding, m_depth, m_functions.size() });
+    return binding;
+}
+
+auto Parser::m_resolve(std::string_view name) -> Symbol*
+{
+    for (auto& local : m_locals | std::views::reverse) {
+        if (local.name == name) {
+            return &local;
+        }
+    }
+    auto global = m_globals.find(name);
+    return global != m_globals.end() ? &global->second : nullptr;
+}
+
+auto Parser::m_binding(std::vector<Token>::const_iterator name, Symbol& symbol) -> std::optional<Binding>
+{
+    auto binding = symbol.binding;
+    // frames only hold their own function's locals, one of an enclosing function is reached through the closure
+    if (binding.scope == Binding::Scope::LOCAL && symbol.function < m_functions.size()) {
+        auto captured = m_capture(name, static_cast<std::size_t>(&symbol - m_locals.data()), m_functions.size() - 1);
+        if (!captured.has_value()) {
+            return {};
+        }
+        binding = captured.value();
+        if (binding.scope == Binding::Scope::CAPTURE) {
+            symbol.last_capture = ++m_order;
+            if (symbol.first_capture == 0) {
+                symbol.first_capture = symbol.last_capture;
+            }
+        }
+    }
+    return binding;
+}
+
+auto Parser::m_capture(std::vector<Token>::const_iterator name, std::size_t local, std::size_t function) -> std::optional<Binding>
+{
+    auto& enclosing    = m_functions[function];
+    auto const& symbol = m_locals[local];
+    if (enclosing.node == symbol.declaration) {
+        return Binding { Binding::Scope::SELF, 0 };
+    }
+    if (auto found = std::ranges::find(enclosing.captured, local); found != enclosing.captured.end()) {
+        return Binding { Binding::Scope::CAPTURE, static_cast<uint16_t>(found - enclosing.captured.begin()) };
+    }
+    // declared in the code around the function, or a capture of that code in turn
+    auto source = symbol.function == function ? std::optional { symbol.binding } : m_capture(name, local, function - 1);
+    if (!source.has_value()) {
+        return {};
+    }
+    // captures are indexed by a one byte operand
+    if (enclosing.captured.size() > std::numeric_limits<uint8_t>::max()) {
+        m_report(name, "Too many captured variables in one function");
+        return {};
+    }
+    enclosing.captured.push_back(local);
+    enclosing.node->captures.push_back(Capture { std::string { symbol.name }, symbol.type, source.value() });
+    return Binding { Binding::Scope::CAPTURE, static_cast<uint16_t>(enclosing.captured.size() - 1) };
+}
+
+void Parser::m_release()
+{
+    auto const& local = m_locals.back();
+    // a closure holds a copy, which only stays right while nothing changes the variable after copying it
+    bool is_boxed = local.is_boxed || (local.first_capture != 0 && local.assigned > local.first_capture);
+    // after an error the nodes the uses point into may already be gone
+    if (is_boxed && m_is_parsed) {
+        for (auto* boxed : local.boxes) {
+            *boxed = true;
+        }
+    }
+    m_locals.pop_back();
+}
+
+void Parser::m_end_loop(std::size_t start)
+{
+    // the next iteration's assignment comes after this one's capture, wherever the two are in the body
+    for (auto& local : m_locals) {
+        if (local.last_capture > start && local.assigned > start) {
+            local.is_boxed = true;
+        }
+    }
+}
+
+void Parser::m_synchronize()
+{
+    m_is_panicked = false;
+    m_stack.clear();
+
+    while (!m_check(TokenType::END)) {
+        if (m_prev->type == TokenType::SEMICOLON) {
+            return;
+        }
+        switch (m_curr->type) {
+            using enum TokenType;
+            case CLASS:
+            case FUN:
+            case LET:
+            case FOR:
+            case IF:
+            case WHILE:
+            case LOG:
+            case RETURN:
+            case RIGHT_BRACE: return;
+            default: m_advance();
+        }
+    }
+}
+
+void Parser::m_advance()
+{
+    m_prev = m_curr;
+    if (m_curr->type == TokenType::END) {   // keep pointing at the end, whoever expected more reports it
+        return;
+    }
+
+    ++m_curr;   // consume all error tokens until we get a non error token or reach the end
+    if (m_curr->type == TokenType::ERROR) {
+        m_report(m_curr, m_curr->word);
+        while (m_curr != m_tokens.cend() && m_curr->type != TokenType::ERROR) {
+            ++m_curr;
+        }
+    }
+}
+
+auto Parser::m_check(TokenType type) const noexcept -> bool
+{
+    return m_curr->type == type;
+}
+
+auto Parser::m_match(TokenType type) -> bool
+{
+    if (type == m_curr->type) {
+        m_advance();
+        return true;
+    }
+
+    return false;
+}
 
 void Parser::m_match(TokenType type, std::string_view err_msg)
 {
@@ -398,6 +1796,9 @@ void Parser::m_match(TokenType type, std::string_view err_msg)
 
 void Parser::m_report(std::vector<Token>::const_iterator token, std::string_view err_msg)
 {
+    if (m_is_panicked) {   // everything up to the next statement is likely fallout of the first error
+        return;
+    }
     m_is_parsed   = false;
     m_is_panicked = true;
 
@@ -430,10 +1831,13 @@ void Parser::m_parse_precedence(Precedence prec)
         return;
     }
 
+    bool can_assign = prec <= Precedence::ASSIGNMENT;
+    m_can_assign    = can_assign;
     (this->*prefix_func)();   // call the prefix function and form the prefix expression / 1st operand
 
     while (prec <= m_get_entry(m_curr->type).precedence) {
         m_advance();
+        m_can_assign = can_assign;   // the prefix may have ruled itself out, `this.x = ...` still assigns the field
         auto infix_func = m_get_entry(m_prev->type).infix;
         if (infix_func == nullptr) {
             m_report(m_prev, "Expect operator here");
@@ -441,4 +1845,9 @@ void Parser::m_parse_precedence(Precedence prec)
         }
         (this->*infix_func)();
     }
+
+    // only a variable consumes the `=` after it, anything else in front of one cannot be assigned to
+    if (can_assign && m_match(TokenType::EQUAL)) {
+        m_report(m_prev, "Invalid assignment target");
+    }
 }
\ No newline at end of file
@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <format>
+#include <print>
+#include <utility>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "perf_counters.hpp"
+
+namespace {
+#if defined(__linux__)
+auto open_event(PerfCounters::Event event) -> int
+{
+    perf_event_attr attr {};
+    attr.size           = sizeof(attr);
+    attr.disabled       = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    auto cache_miss = [](uint64_t cache) -> uint64_t {
+        return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    };
+
+    switch (event) {
+        using enum PerfCounters::Event;
+        case CYCLES:
+            attr.type   = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case INSTRUCTIONS:
+            attr.type   = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case BRANCH_MISSES:
+            attr.type   = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        case L1I_MISSES:
+            attr.type   = PERF_TYPE_HW_CACHE;
+            attr.config = cache_miss(PERF_COUNT_HW_CACHE_L1I);
+            break;
+        case L1D_MISSES:
+            attr.type   = PERF_TYPE_HW_CACHE;
+            attr.config = cache_miss(PERF_COUNT_HW_CACHE_L1D);
+            break;
+    }
+
+    // measure this process on any cpu, no group leader
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+#endif
+
+auto format_ratio(std::optional<uint64_t> num, std::optional<uint64_t> den) -> std::string
+{
+    if (!num.has_value() || !den.has_value() || *den == 0) {
+        return "-";
+    }
+    return std::format("{:.3f}", static_cast<double>(*num) / static_cast<double>(*den));
+}
+
+auto format_count(std::optional<uint64_t> count) -> std::string
+{
+    return count.has_value() ? std::format("{}", *count) : "-";
+}
+}
+
+PerfCounters::PerfCounters()
+{
+    for (std::size_t event {}; event < event_count; event++) {
+#if defined(__linux__)
+        m_fds[event] = open_event(static_cast<Event>(event));
+#else
+        m_fds[event] = -1;
+#endif
+    }
+}
+
+PerfCounters::~PerfCounters()
+{
+#if defined(__linux__)
+    for (int fd : m_fds) {
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+#endif
+}
+
+auto PerfCounters::available() const noexcept -> bool
+{
+    return std::ranges::any_of(m_fds, [](int fd) { return fd != -1; });
+}
+
+void PerfCounters::start() noexcept
+{
+#if defined(__linux__)
+    for (int fd : m_fds) {
+        if (fd != -1) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+}
+
+auto PerfCounters::stop() noexcept -> Reading
+{
+    Reading reading {};
+#if defined(__linux__)
+    for (std::size_t event {}; event < event_count; event++) {
+        if (m_fds[event] != -1) {
+            ioctl(m_fds[event], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    for (std::size_t event {}; event < event_count; event++) {
+        // value, time enabled, time running
+        std::array<uint64_t, 3> values {};
+        if (m_fds[event] == -1 || read(m_fds[event], values.data(), sizeof(values)) != sizeof(values)) {
+            continue;
+        }
+        auto [value, enabled, running] = values;
+        if (running == 0) {
+            continue;   // counter never got scheduled on the pmu
+        }
+        // scale up when the kernel had to multiplex counters
+        reading[event] = running == enabled
+                           ? value
+                           : static_cast<uint64_t>(static_cast<double>(value) * enabled / running);
+    }
+#endif
+    return reading;
+}
+
+void PerfCounters::report_header(std::ostream& os)
+{
+    constexpr std::size_t field_width { 14 };
+    std::println(os, "{:<{}} {:>{}} {:>{}} {:>{}} {:>{}} {:>{}} {:>{}} {:>{}} {:>{}} {:>{}} {:>{}}",
+                 "STAGE", field_width,
+                 "CYCLES", field_width,
+                 "INSTRUCTIONS", field_width,
+                 "IPC", field_width,
+                 "BR-MISSES", field_width,
+                 "L1I-MISSES", field_width,
+                 "L1D-MISSES", field_width,
+                 "CYC/BC", field_width,
+                 "BR-MISS/BC", field_width,
+                 "L1I-MISS/BC", field_width,
+                 "L1D-MISS/BC", field_width);
+}
+
+void PerfCounters::report(std::ostream& os, std::string_view stage, Reading const& reading, std::size_t bytecode_instructions)
+{
+    constexpr std::size_t field_width { 14 };
+
+    auto at = [&reading](Event event) { return reading[std::to_underlying(event)]; };
+    auto per_bytecode = [&](Event event) {
+        return bytecode_instructions == 0 ? std::string { "-" } : format_ratio(at(event), bytecode_instructions);
+    };
+
+    using enum Event;
+    std::println(os, "{:<{}} {:>{}} {:>{}} {:>{}} {:>{}} {:>{}} {:>{}} {:>{}} {:>{}} {:>{}} {:>{}}",
+                 stage, field_width,
+                 format_count(at(CYCLES)), field_width,
+                 format_count(at(INSTRUCTIONS)), field_width,
+                 format_ratio(at(INSTRUCTIONS), at(CYCLES)), field_width,
+                 format_count(at(BRANCH_MISSES)), field_width,
+                 format_count(at(L1I_MISSES)), field_width,
+                 format_count(at(L1D_MISSES)), field_width,
+                 per_bytecode(CYCLES), field_width,
+                 per_bytecode(BRANCH_MISSES), field_width,
+                 per_bytecode(L1I_MISSES), field_width,
+                 per_bytecode(L1D_MISSES), field_width);
+}
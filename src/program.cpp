@@ -0,0 +1,132 @@
+#include <format>
+#include <iostream>
+#include <print>
+#include <utility>
+
+#include "compiler.hpp"
+#include "lexer.hpp"
+#include "program.hpp"
+#include "verifier.hpp"
+
+namespace {
+// type of the value the top level code's last statement leaves, when it is an expression statement of a scalar type
+auto result_type(StmtType const& ast) -> std::optional<TypeIndex>
+{
+    auto const* program = std::get_if<std::unique_ptr<Block>>(&ast);
+    if (program == nullptr || (*program)->stmts.empty()) {
+        return {};
+    }
+    auto const* last = std::get_if<std::unique_ptr<Expression>>(&(*program)->stmts.back());
+    if (last == nullptr) {
+        return {};
+    }
+    auto type = util::type::get_type((*last)->expr);
+    if (type == TypeIndex::FUNCTION || type == TypeIndex::INSTANCE || type == TypeIndex::ARRAY) {
+        return {};
+    }
+    return type;
+}
+
+// `value` as the vm holds a value of `type`, empty when it is of another representation or out of the type's range
+auto to_stack(Program::Value const& value, TypeIndex type, VM& vm) -> std::optional<Stack::value_type>
+{
+    return std::visit(util::Visitor {
+                          [type](bool v) -> std::optional<Stack::value_type> {
+                              return type == TypeIndex::BOOL ? std::optional<Stack::value_type> { v } : std::nullopt;
+                          },
+                          [type]<std::integral T>(T v) -> std::optional<Stack::value_type> {
+                              // the integer types lie between `BOOL` and `FLOAT32`
+                              if (type <= TypeIndex::BOOL || type >= TypeIndex::FLOAT32) {
+                                  return {};
+                              }
+                              auto fits = util::type::with_element(type, [v]<typename E>(E) {
+                                  if constexpr (std::is_integral_v<E> && !std::is_same_v<E, bool>) {
+                                      return std::is_signed_v<E> == std::is_signed_v<T> && std::in_range<E>(v);
+                                  }
+                                  return false;
+                              });
+                              return fits ? std::optional<Stack::value_type> { v } : std::nullopt;
+                          },
+                          [type](double v) -> std::optional<Stack::value_type> {
+                              return type == TypeIndex::FLOAT32 || type == TypeIndex::FLOAT64 ? std::optional<Stack::value_type> { v } : std::nullopt;
+                          },
+                          [type, &vm](std::string const& v) -> std::optional<Stack::value_type> {
+                              return type == TypeIndex::STRING ? std::optional<Stack::value_type> { vm.intern(v) } : std::nullopt;
+                          },
+                      },
+                      value);
+}
+
+auto to_value(Stack::value_type const& value) -> Program::Value
+{
+    return std::visit(util::Visitor {
+                          [](StringPtr v) -> Program::Value { return *v; },
+                          []<typename T>(T v) -> Program::Value {
+                              if constexpr (std::is_same_v<T, bool> || std::is_same_v<T, int64_t> || std::is_same_v<T, uint64_t> || std::is_same_v<T, double>) {
+                                  return v;
+                              } else {
+#ifndef NDEBUG
+                                  std::println(std::cerr, "[DEBUG] Result of a type without a host value");
+                                  return {};
+#else
+                                  std::unreachable();
+#endif
+                              }
+                          },
+                      },
+                      value);
+}
+}
+
+auto Program::compile(std::string_view source, std::vector<Parser::Input> const& parameters) -> std::optional<Program>
+{
+    auto ast = Parser { Lexer { source }.scan(), parameters }.parse();
+    if (!ast.has_value()) {
+        return {};
+    }
+    Code code { .segment = {}, .parameters = {}, .result = result_type(ast.value()) };
+    for (auto const& parameter : parameters) {
+        code.parameters.push_back(parameter.type.index);
+    }
+    auto segment = Compiler { std::move(ast.value()) }.compile();
+    // the vm runs it unchecked, which only the verifier makes safe, as with code jumping further than a jump reaches
+    std::vector<SlotType> bound;
+    for (auto type : code.parameters) {
+        bound.push_back(util::slot::scalar(type));
+    }
+    if (auto verified = Verifier { segment.first, segment.second }.verify(bound); !verified.has_value()) {
+        std::println(std::cerr, "Bytecode failed verification at offset {}: {}", verified.error().offset, verified.error().message);
+        return {};
+    }
+    code.segment = std::make_shared<CodeSegment const>(std::move(segment));
+    return Program { std::make_shared<Code const>(std::move(code)) };
+}
+
+auto Program::Session::run(std::span<Value const> arguments) -> Result
+{
+    auto const& parameters = m_code->parameters;
+    if (arguments.size() != parameters.size()) {
+        return std::unexpected(Error { 0, 0, std::format("expected {} arguments but got {}", parameters.size(), arguments.size()) });
+    }
+
+    m_vm->reset();
+    m_arguments.clear();
+    for (std::size_t index {}; index < arguments.size(); index++) {
+        auto argument = to_stack(arguments[index], parameters[index], *m_vm);
+        if (!argument.has_value()) {
+            return std::unexpected(Error { 0, 0, std::format("argument {} is not a {}", index, util::type::to_string(parameters[index])) });
+        }
+        m_arguments.push_back(argument.value());
+    }
+    m_vm->bind(m_arguments);
+    m_vm->execute();
+
+    if (auto const& error = m_vm->error(); error.has_value()) {
+        auto location = m_vm->bytecode().read_location(error->offset);
+        return std::unexpected(Error { location.line, location.column, error->message });
+    }
+    if (!m_code->result.has_value()) {
+        return std::optional<Value> {};
+    }
+    return m_vm->result().transform(to_value);
+}
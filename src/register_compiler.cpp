@@ -0,0 +1,244 @@
+#include <utility>
+
+#include "register_compiler.hpp"
+
+namespace {
+// runtime representation of every static type
+enum class Rep : uint8_t {
+    BOOL,
+    I64,
+    U64,
+    F64,
+    STR,
+};
+
+auto rep_of(TypeIndex type) -> Rep
+{
+    switch (type) {
+        using enum TypeIndex;
+        case BOOL: return Rep::BOOL;
+        case INT8:
+        case INT16:
+        case INT32:
+        case INT64: return Rep::I64;
+        case UINT8:
+        case UINT16:
+        case UINT32:
+        case UINT64: return Rep::U64;
+        case FLOAT32:
+        case FLOAT64: return Rep::F64;
+        case STRING: return Rep::STR;
+        case FUNCTION:
+        case INSTANCE:
+        case ARRAY: break;   // functions are only called, instances and arrays live on the heap, which keeps them off the register vm
+    }
+    std::unreachable();
+}
+
+// One opcode per runtime representation, empty where the parser never allows the operation
+struct Family {
+    std::optional<RegOpcode> b, i, u, f, s;
+
+    [[nodiscard]] auto select(Rep rep) const -> std::optional<RegOpcode>
+    {
+        switch (rep) {
+            case Rep::BOOL: return b;
+            case Rep::I64: return i;
+            case Rep::U64: return u;
+            case Rep::F64: return f;
+            case Rep::STR: return s;
+        }
+        std::unreachable();
+    }
+};
+
+template <typename Node>
+constexpr Family family_of {};
+
+using enum RegOpcode;
+template <>
+constexpr Family family_of<Add> { {}, ADD_I64, ADD_U64, ADD_F64, ADD_STR };
+template <>
+constexpr Family family_of<Subtract> { {}, SUB_I64, SUB_U64, SUB_F64, {} };
+template <>
+constexpr Family family_of<Multiply> { {}, MUL_I64, MUL_U64, MUL_F64, {} };
+template <>
+constexpr Family family_of<Divide> { {}, DIV_I64, DIV_U64, DIV_F64, {} };
+template <>
+constexpr Family family_of<Modulus> { {}, MOD_I64, MOD_U64, MOD_F64, {} };
+template <>
+constexpr Family family_of<Compare<Order::LESS>> { {}, LT_I64, LT_U64, LT_F64, {} };
+template <>
+constexpr Family family_of<Compare<Order::GREATER>> { {}, GT_I64, GT_U64, GT_F64, {} };
+template <>
+constexpr Family family_of<Compare<Order::EQUAL>> { EQ_BOOL, EQ_I64, EQ_I64, EQ_F64, {} };
+template <>
+constexpr Family family_of<Negate> { {}, NEG_I64, {}, NEG_F64, {} };
+template <>
+constexpr Family family_of<Not> { NOT_BOOL, NOT_I64, NOT_I64, NOT_F64, NOT_STR };
+
+constexpr Family tostr_family { TOSTR_BOOL, TOSTR_I64, TOSTR_U64, TOSTR_F64, {} };
+constexpr Family log_family { LOG_BOOL, LOG_I64, LOG_U64, LOG_F64, LOG_STR };
+}
+
+auto RegisterCompiler::compile() && -> std::optional<RegisterSegment>
+{
+    m_statement(m_ast);
+    auto result = m_result.has_value() ? m_result->first : uint8_t {};
+    m_emit(RegOpcode::RETURN, result, 0, 0, m_rc.code().empty() ? 1 : m_rc.read_line_number(m_rc.code().size() - 1));
+
+    if (!m_is_compiled) {
+        return {};
+    }
+    m_rc.set_registers(m_max_regs);
+    m_rc.set_result(m_result.transform([](auto result) { return result.second; }));
+    return std::pair { std::move(m_rc), std::move(m_pool) };
+}
+
+void RegisterCompiler::m_statement(StmtType const& stmt)
+{
+    std::visit(util::Visitor {
+                   [this](std::unique_ptr<Log> const& log) {
+                       auto reg  = m_expression(log->expr);
+                       auto type = util::type::get_type(log->expr);
+                       m_emit(log_family.select(rep_of(type)).value(), reg, 0, 0, log->line);
+                       m_next_reg = reg;
+                       m_result.reset();
+                   },
+                   [this](std::unique_ptr<Block> const& block) {
+                       for (auto const& inner : block->stmts) {
+                           m_statement(inner);
+                       }
+                   },
+                   [this](std::unique_ptr<Expression> const& expression) {
+                       // nothing reads the result, unless it is the last statement's which `RETURN` hands to the host
+                       m_next_reg = m_expression(expression->expr);
+                       m_result   = std::pair { static_cast<uint8_t>(m_next_reg), util::type::get_type(expression->expr) };
+                   },
+                   [this](std::unique_ptr<Let> const&) {
+                       m_is_compiled = false;   // variables only live on the stack engines
+                   },
+                   [this]<typename Node>(std::unique_ptr<Node> const&)
+                       requires(std::is_same_v<Node, If> || std::is_same_v<Node, While>)
+                   {
+                       m_is_compiled = false;   // so does control flow
+                   },
+                   [this]<typename Node>(std::unique_ptr<Node> const&)
+                       requires(std::is_same_v<Node, Fun> || std::is_same_v<Node, Return> || std::is_same_v<Node, Class>)
+                   {
+                       m_is_compiled = false;   // and functions, which need frames, as do methods
+                   },
+               },
+               stmt);
+}
+
+auto RegisterCompiler::m_expression(ExprType const& expr) -> uint8_t
+{
+    return std::visit(util::Visitor {
+                          [this]<typename Node>(std::unique_ptr<Node> const& node) -> uint8_t
+                              requires std::is_base_of_v<Binary, Node>
+                          {
+                              auto lhs_type = util::type::get_type(node->left);
+                              auto rhs_type = util::type::get_type(node->right);
+
+                              auto lhs = m_expression(node->left);
+                              auto rhs = m_expression(node->right);
+                              m_next_reg = lhs + 1;   // release `rhs` and reuse `lhs` as the destination
+
+                              // interpolation is the only place where a string meets another type
+                              if constexpr (std::is_same_v<Node, Add>) {
+                                  if (lhs_type == TypeIndex::STRING && rhs_type != TypeIndex::STRING) {
+                                      m_to_string(rhs, rhs_type, node->line);
+                                      rhs_type = TypeIndex::STRING;
+                                  } else if (lhs_type != TypeIndex::STRING && rhs_type == TypeIndex::STRING) {
+                                      m_to_string(lhs, lhs_type, node->line);
+                                      lhs_type = TypeIndex::STRING;
+                                  }
+                              }
+
+                              if (auto op = family_of<Node>.select(rep_of(lhs_type)); op.has_value()) {
+                                  m_emit(*op, lhs, lhs, rhs, node->line);
+                              } else {
+                                  m_is_compiled = false;
+                              }
+                              return lhs;
+                          },
+                          [this]<typename Node>(std::unique_ptr<Node> const& node) -> uint8_t
+                              requires std::is_base_of_v<Unary, Node>
+                          {
+                              auto type = util::type::get_type(node->right);
+                              auto reg  = m_expression(node->right);
+
+                              if (auto op = family_of<Node>.select(rep_of(type)); op.has_value()) {
+                                  m_emit(*op, reg, reg, 0, node->line);
+                              } else {
+                                  m_is_compiled = false;
+                              }
+                              return reg;
+                          },
+                          [this](std::unique_ptr<Literal> const& node) -> uint8_t {
+                              return m_constant(node);
+                          },
+                          [this](std::unique_ptr<Variable> const& node) -> uint8_t {
+                              // without `let`s, which keep programs off this engine, a global can only be a parameter
+                              auto reg = m_alloc();
+                              auto scalar = node->type != TypeIndex::FUNCTION && node->type != TypeIndex::INSTANCE && node->type != TypeIndex::ARRAY;
+                              if (node->binding.scope != Binding::Scope::GLOBAL || !scalar) {
+                                  m_is_compiled = false;
+                                  return reg;
+                              }
+                              m_rc.add_input(node->binding.index, node->type);
+                              m_emit(RegOpcode::INPUT, reg, static_cast<uint8_t>(node->binding.index), static_cast<uint8_t>(node->binding.index >> 8), node->line);
+                              return reg;
+                          },
+                          [this]<typename Node>(std::unique_ptr<Node> const&) -> uint8_t
+                              requires std::is_same_v<Node, Assign> || std::is_same_v<Node, Call>
+                                       || std::is_same_v<Node, Get> || std::is_same_v<Node, Set> || std::is_same_v<Node, Invoke> || ArrayNode<Node>
+                          {
+                              m_is_compiled = false;
+                              return m_alloc();
+                          },
+                      },
+                      expr);
+}
+
+auto RegisterCompiler::m_constant(std::unique_ptr<Literal> const& expr) -> uint8_t
+{
+    Register value = std::visit(util::Visitor {
+                                    [](bool v) { return Register { .b = v }; },
+                                    []<std::signed_integral T>(T v) { return Register { .i = v }; },
+                                    []<std::unsigned_integral T>(T v) { return Register { .u = v }; },
+                                    []<std::floating_point T>(T v) { return Register { .f = v }; },
+                                    [this](std::string const& v) { return Register { .s = &*m_pool.emplace(v).first }; },
+                                },
+                                expr->value);
+
+    auto index = m_rc.add_constant(value);
+    if (index >= RegisterCode::max_constants) {
+        m_is_compiled = false;
+    }
+
+    auto reg = m_alloc();
+    m_emit(RegOpcode::LOADK, reg, static_cast<uint8_t>(index), static_cast<uint8_t>(index >> 8), expr->line);
+    return reg;
+}
+
+void RegisterCompiler::m_to_string(uint8_t reg, TypeIndex type, std::size_t line_nr)
+{
+    m_emit(tostr_family.select(rep_of(type)).value(), reg, reg, 0, line_nr);
+}
+
+auto RegisterCompiler::m_alloc() -> uint8_t
+{
+    if (m_next_reg == RegisterCode::max_registers) {
+        m_is_compiled = false;   // expression is too deep for a single frame
+        return 0;
+    }
+    m_max_regs = std::max(m_max_regs, m_next_reg + 1);
+    return static_cast<uint8_t>(m_next_reg++);
+}
+
+void RegisterCompiler::m_emit(RegOpcode op, uint8_t a, uint8_t b, uint8_t c, std::size_t line_nr)
+{
+    m_rc.write_instr(RegInstr { op, a, b, c }, line_nr);
+}
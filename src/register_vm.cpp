@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <limits>
+#include <print>
+
+#include "register_vm.hpp"
+
+void RegisterVM::execute()
+{
+    m_run<false>(nullptr);
+}
+
+void RegisterVM::execute(Stats& stats)
+{
+    m_run<true>(&stats);
+    stats.peak_stack_depth = std::max(stats.peak_stack_depth, m_rc.registers());
+}
+
+template <bool counted>
+void RegisterVM::m_run([[maybe_unused]] Stats* stats)
+{
+    auto const* code      = m_rc.code().data();
+    auto const* constants = m_rc.constants().data();
+    auto* r               = m_regs.data();
+
+    auto intern = [this](std::string value) {
+        return &*m_pool.emplace(std::move(value)).first;
+    };
+
+    m_error.reset();
+    // stops at the division at `pc - 1` when `r[b]` can't be divided by `r[c]`
+    auto divides = [&](uint8_t b, uint8_t c, std::size_t pc, bool is_signed) {
+        if (auto error = m_division_error(r[b], r[c], is_signed); error.has_value()) [[unlikely]] {
+            m_error = BytecodeError { pc - 1, std::string { error.value() } };
+            return false;
+        }
+        return true;
+    };
+
+    for (std::size_t pc {};;) {
+        auto [op, a, b, c] = code[pc++];
+        if constexpr (counted) {
+            stats->instructions++;
+        }
+
+        switch (op) {
+            using enum RegOpcode;
+            case LOADK: r[a] = constants[b | (c << 8)]; break;
+            case INPUT: r[a] = m_inputs[b | (c << 8)]; break;
+
+            case ADD_I64: r[a].i = r[b].i + r[c].i; break;
+            case ADD_U64: r[a].u = r[b].u + r[c].u; break;
+            case ADD_F64: r[a].f = r[b].f + r[c].f; break;
+            case ADD_STR: r[a].s = intern(*r[b].s + *r[c].s); break;
+            case SUB_I64: r[a].i = r[b].i - r[c].i; break;
+            case SUB_U64: r[a].u = r[b].u - r[c].u; break;
+            case SUB_F64: r[a].f = r[b].f - r[c].f; break;
+            case MUL_I64: r[a].i = r[b].i * r[c].i; break;
+            case MUL_U64: r[a].u = r[b].u * r[c].u; break;
+            case MUL_F64: r[a].f = r[b].f * r[c].f; break;
+            case DIV_I64:
+                if (!divides(b, c, pc, true)) {
+                    return;
+                }
+                r[a].i = r[b].i / r[c].i;
+                break;
+            case DIV_U64:
+                if (!divides(b, c, pc, false)) {
+                    return;
+                }
+                r[a].u = r[b].u / r[c].u;
+                break;
+            case DIV_F64: r[a].f = r[b].f / r[c].f; break;
+            case MOD_I64:
+                if (!divides(b, c, pc, true)) {
+                    return;
+                }
+                r[a].i = r[b].i % r[c].i;
+                break;
+            case MOD_U64:
+                if (!divides(b, c, pc, false)) {
+                    return;
+                }
+                r[a].u = r[b].u % r[c].u;
+                break;
+            case MOD_F64: r[a].f = std::fmod(r[b].f, r[c].f); break;
+
+            case LT_I64: r[a].b = r[b].i < r[c].i; break;
+            case LT_U64: r[a].b = r[b].u < r[c].u; break;
+            case LT_F64: r[a].b = r[b].f < r[c].f; break;
+            case GT_I64: r[a].b = r[b].i > r[c].i; break;
+            case GT_U64: r[a].b = r[b].u > r[c].u; break;
+            case GT_F64: r[a].b = r[b].f > r[c].f; break;
+            case EQ_BOOL: r[a].b = r[b].b == r[c].b; break;
+            case EQ_I64: r[a].b = r[b].i == r[c].i; break;
+            case EQ_F64: r[a].b = r[b].f == r[c].f; break;
+
+            case NEG_I64: r[a].i = -r[b].i; break;
+            case NEG_F64: r[a].f = -r[b].f; break;
+            case NOT_BOOL: r[a].b = !r[b].b; break;
+            case NOT_I64: r[a].b = r[b].i == 0; break;
+            case NOT_F64: r[a].b = !r[b].f; break;
+            case NOT_STR: r[a].b = !r[b].s->empty(); break;   // mirrors the stack vm's NOT on strings
+
+            case TOSTR_BOOL: r[a].s = intern(std::format("{}", r[b].b)); break;
+            case TOSTR_I64: r[a].s = intern(std::format("{}", r[b].i)); break;
+            case TOSTR_U64: r[a].s = intern(std::format("{}", r[b].u)); break;
+            case TOSTR_F64: r[a].s = intern(std::format("{}", r[b].f)); break;
+
+            case LOG_BOOL: std::println("{}", r[a].b); break;
+            case LOG_I64: std::println("{}", r[a].i); break;
+            case LOG_U64: std::println("{}", r[a].u); break;
+            case LOG_F64: std::println("{}", r[a].f); break;
+            case LOG_STR: std::println("{}", *r[a].s); break;
+
+            case RETURN: m_result = r[a]; return;
+        }
+    }
+}
+
+auto RegisterVM::m_division_error(Register lhs, Register rhs, bool is_signed) noexcept -> std::optional<std::string_view>
+{
+    if (rhs.u == 0) {
+        return "integer division by zero";
+    }
+    if (is_signed && lhs.i == std::numeric_limits<int64_t>::min() && rhs.i == -1) {
+        return "integer division overflows";
+    }
+    return {};
+}
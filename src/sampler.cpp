@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <csignal>
+#include <map>
+#include <optional>
+#include <print>
+#include <tuple>
+#include <vector>
+#include <sys/time.h>
+
+#include "instr.hpp"
+#include "sampler.hpp"
+
+namespace {
+std::atomic<Sampler*> active_sampler {};
+
+// index of the function whose body holds `offset`, none for the top level code ahead of every body
+auto enclosing_function(ByteCode const& bc, std::size_t offset) -> std::optional<std::size_t>
+{
+    std::optional<std::size_t> enclosing;
+    for (std::size_t index {}; index < bc.functions().size(); index++) {
+        auto entry = bc.functions()[index].entry;
+        if (entry <= offset && (!enclosing.has_value() || entry > bc.functions()[enclosing.value()].entry)) {
+            enclosing = index;
+        }
+    }
+    return enclosing;
+}
+}
+
+auto Sampler::start(ByteCode const& bc, std::atomic<std::size_t> const& iptr) -> bool
+{
+    Sampler* expected {};
+    if (m_running || !active_sampler.compare_exchange_strong(expected, this)) {
+        return false;
+    }
+
+    m_bc   = &bc;
+    m_iptr = &iptr;
+    m_size = bc.code().size();
+    m_hits = std::make_unique<std::atomic<uint32_t>[]>(m_size);
+
+    struct sigaction action {};
+    action.sa_handler = &Sampler::m_on_signal;
+    action.sa_flags   = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, &m_previous);
+
+    auto interval_us = static_cast<suseconds_t>(1'000'000 / std::max(m_frequency, 1U));
+    itimerval timer {
+        .it_interval = { .tv_sec = interval_us / 1'000'000, .tv_usec = interval_us % 1'000'000 },
+        .it_value    = { .tv_sec = interval_us / 1'000'000, .tv_usec = interval_us % 1'000'000 },
+    };
+    setitimer(ITIMER_PROF, &timer, nullptr);
+
+    m_running = true;
+    return true;
+}
+
+void Sampler::stop()
+{
+    if (!m_running) {
+        return;
+    }
+
+    itimerval timer {};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    // ignoring first discards a signal still pending from the timer, which the previous action may not expect
+    signal(SIGPROF, SIG_IGN);
+    sigaction(SIGPROF, &m_previous, nullptr);
+
+    active_sampler.store(nullptr);
+    m_running = false;
+}
+
+/**
+ * Runs inside the signal handler so only async signal safe work is done here:
+ * two lock free atomic loads and a lock free increment.
+ */
+void Sampler::m_on_signal(int)
+{
+    Sampler* sampler = active_sampler.load(std::memory_order_relaxed);
+    if (sampler == nullptr) {
+        return;
+    }
+
+    std::size_t offset = sampler->m_iptr->load(std::memory_order_relaxed);
+    if (offset < sampler->m_size) {
+        sampler->m_hits[offset].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+auto Sampler::samples() const noexcept -> std::size_t
+{
+    std::size_t total {};
+    for (std::size_t offset {}; offset < m_size; offset++) {
+        total += m_hits[offset].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void Sampler::report_flat(std::ostream& os) const
+{
+    std::map<std::size_t, std::size_t> line_hits;
+    for (std::size_t offset {}; offset < m_size; offset++) {
+        if (auto hits = m_hits[offset].load(std::memory_order_relaxed); hits != 0) {
+            line_hits[m_bc->read_line_number(offset)] += hits;
+        }
+    }
+
+    std::vector<std::pair<std::size_t, std::size_t>> lines { line_hits.begin(), line_hits.end() };
+    std::ranges::stable_sort(lines, std::ranges::greater {}, [](auto const& line) { return line.second; });
+
+    auto total = samples();
+
+    constexpr std::size_t field_width { 12 };
+    std::println(os, "{:>{}} {:>{}} {:>{}}", "LINE", field_width, "SAMPLES", field_width, "%", field_width);
+    for (auto const& [line, hits] : lines) {
+        std::println(os, "{:>{}} {:>{}} {:>{}.2f}", line, field_width, hits, field_width, 100.0 * hits / total, field_width);
+    }
+    std::println(os, "{} samples at {} Hz", total, m_frequency);
+}
+
+void Sampler::report_collapsed(std::ostream& os) const
+{
+    std::map<std::tuple<std::optional<std::size_t>, std::size_t, Opcode>, std::size_t> stacks;
+    for (std::size_t offset {}; offset < m_size; offset++) {
+        if (auto hits = m_hits[offset].load(std::memory_order_relaxed); hits != 0) {
+            stacks[{ enclosing_function(*m_bc, offset), m_bc->read_line_number(offset), static_cast<Opcode>(m_bc->code()[offset]) }] += hits;
+        }
+    }
+
+    for (auto const& [frame, hits] : stacks) {
+        auto const& [function, line, opcode] = frame;
+        if (function.has_value()) {
+            std::println(os, "script;fun {};line {};{} {}", m_bc->functions()[function.value()].name, line, util::opcode::to_string(opcode), hits);
+        } else {
+            std::println(os, "script;line {};{} {}", line, util::opcode::to_string(opcode), hits);
+        }
+    }
+}
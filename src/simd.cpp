@@ -0,0 +1,304 @@
+#include <array>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#ifndef NDEBUG
+#include <iostream>
+#include <print>
+#endif
+
+#include "simd.hpp"
+
+// the helpers below take and return vectors by value, they are always inlined into the function targeting an
+// instruction set so no call ever passes one in a register of a set the caller lacks
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+namespace {
+using util::simd::Isa;
+
+// `Bytes` wide vector of `T`, which the compiler maps to the registers of whatever instruction set it targets
+template <typename T, std::size_t Bytes>
+using Vector [[gnu::vector_size(Bytes)]] = T;
+
+// integers add, subtract and multiply in unsigned lanes so they wrap instead of overflowing
+template <typename T>
+using Lane = typename std::conditional_t<std::is_floating_point_v<T>, std::type_identity<T>, std::make_unsigned<T>>::type;
+// and one element at a time at least as wide as `unsigned`, which keeps narrow ones from promoting to `int`
+template <typename T>
+using Wide = typename std::conditional_t<std::is_floating_point_v<T>, std::type_identity<T>, std::common_type<unsigned, Lane<T>>>::type;
+
+template <typename V, typename T>
+[[gnu::always_inline]] inline auto load(T const* data) -> V
+{
+    V vector;
+    std::memcpy(&vector, data, sizeof(V));
+    return vector;
+}
+
+// `op` of two vectors or two elements, comparisons of vectors give a lane of all ones where they hold
+template <ArrayOp op, typename V>
+[[gnu::always_inline]] inline auto apply(V lhs, V rhs)
+{
+    using enum ArrayOp;
+    if constexpr (op == ADD || op == SUM) {
+        return lhs + rhs;
+    } else if constexpr (op == SUB) {
+        return lhs - rhs;
+    } else if constexpr (op == MUL) {
+        return lhs * rhs;
+    } else if constexpr (op == DIV) {
+        return lhs / rhs;
+    } else if constexpr (op == LT) {
+        return lhs < rhs;
+    } else if constexpr (op == LE) {
+        return lhs <= rhs;
+    } else if constexpr (op == GT) {
+        return lhs > rhs;
+    } else if constexpr (op == GE) {
+        return lhs >= rhs;
+    } else if constexpr (op == EQ) {
+        return lhs == rhs;
+    } else if constexpr (op == NE) {
+        return lhs != rhs;
+    } else if constexpr (op == MIN) {
+        return rhs < lhs ? rhs : lhs;
+    } else {
+        return lhs < rhs ? rhs : lhs;
+    }
+}
+
+// `op` of two elements of a reduction, sums wrap
+template <ArrayOp op, typename T>
+[[gnu::always_inline]] inline auto combine(T lhs, T rhs) -> T
+{
+    if constexpr (op == ArrayOp::SUM) {
+        return static_cast<T>(static_cast<Wide<T>>(lhs) + static_cast<Wide<T>>(rhs));
+    } else {
+        return apply<op>(lhs, rhs);
+    }
+}
+
+template <std::size_t Bytes, ArrayOp op, typename T>
+[[gnu::always_inline]] inline void arithmetic(T const* lhs, T const* rhs, T* out, std::size_t length)
+{
+    std::size_t index {};
+    // there is no instruction dividing vectors of integers
+    if constexpr (Bytes != 0 && (op != ArrayOp::DIV || std::is_floating_point_v<T>)) {
+        using V              = Vector<Lane<T>, Bytes>;
+        constexpr auto lanes = Bytes / sizeof(T);
+        for (; index + lanes <= length; index += lanes) {
+            auto result = apply<op>(load<V>(lhs + index), load<V>(rhs + index));
+            std::memcpy(out + index, &result, Bytes);
+        }
+    }
+    for (; index < length; index++) {
+        if constexpr (op == ArrayOp::DIV) {
+            out[index] = static_cast<T>(lhs[index] / rhs[index]);
+        } else {
+            out[index] = static_cast<T>(apply<op>(static_cast<Wide<T>>(lhs[index]), static_cast<Wide<T>>(rhs[index])));
+        }
+    }
+}
+
+template <std::size_t Bytes, ArrayOp op, typename T>
+[[gnu::always_inline]] inline void compare(T const* lhs, T const* rhs, bool* out, std::size_t length)
+{
+    std::size_t index {};
+    if constexpr (Bytes != 0) {
+        using V              = Vector<T, Bytes>;
+        constexpr auto lanes = Bytes / sizeof(T);
+        for (; index + lanes <= length; index += lanes) {
+            // narrows the lanes of all ones or zeros to a byte each, holding the 1 or 0 of a bool
+            auto result = __builtin_convertvector(apply<op>(load<V>(lhs + index), load<V>(rhs + index)), Vector<int8_t, lanes>) & 1;
+            std::memcpy(out + index, &result, lanes);
+        }
+    }
+    for (; index < length; index++) {
+        out[index] = apply<op>(lhs[index], rhs[index]);
+    }
+}
+
+template <std::size_t Bytes, ArrayOp op, typename T>
+[[gnu::always_inline]] inline auto fold(T const* data, std::size_t length) -> T
+{
+    // sums wrap, least and greatest compare with the sign
+    using L = std::conditional_t<op == ArrayOp::SUM, Lane<T>, T>;
+    std::size_t index = op == ArrayOp::SUM ? 0 : 1;
+    L result          = op == ArrayOp::SUM ? L {} : static_cast<L>(data[0]);
+    if constexpr (Bytes != 0) {
+        using V              = Vector<L, Bytes>;
+        constexpr auto lanes = Bytes / sizeof(T);
+        if (length >= lanes) {
+            auto folded = load<V>(data);
+            for (index = lanes; index + lanes <= length; index += lanes) {
+                folded = apply<op>(folded, load<V>(data + index));
+            }
+            std::array<L, lanes> lane;
+            std::memcpy(lane.data(), &folded, Bytes);
+            result = lane[0];
+            for (std::size_t next = 1; next < lanes; next++) {
+                result = combine<op>(result, lane[next]);
+            }
+        }
+    }
+    for (; index < length; index++) {
+        result = combine<op>(result, static_cast<L>(data[index]));
+    }
+    return static_cast<T>(result);
+}
+
+template <std::size_t Bytes, typename T>
+[[gnu::always_inline]] inline void elementwise(ArrayOp op, std::byte const* lhs, std::byte const* rhs, std::byte* out, std::size_t length)
+{
+    auto const* a = reinterpret_cast<T const*>(lhs);
+    auto const* b = reinterpret_cast<T const*>(rhs);
+    auto* c       = reinterpret_cast<T*>(out);
+    auto* is      = reinterpret_cast<bool*>(out);
+    switch (op) {
+        using enum ArrayOp;
+        case ADD: arithmetic<Bytes, ADD>(a, b, c, length); return;
+        case SUB: arithmetic<Bytes, SUB>(a, b, c, length); return;
+        case MUL: arithmetic<Bytes, MUL>(a, b, c, length); return;
+        case DIV: arithmetic<Bytes, DIV>(a, b, c, length); return;
+        case LT: compare<Bytes, LT>(a, b, is, length); return;
+        case LE: compare<Bytes, LE>(a, b, is, length); return;
+        case GT: compare<Bytes, GT>(a, b, is, length); return;
+        case GE: compare<Bytes, GE>(a, b, is, length); return;
+        case EQ: compare<Bytes, EQ>(a, b, is, length); return;
+        case NE: compare<Bytes, NE>(a, b, is, length); return;
+        default: break;
+    }
+#ifndef NDEBUG
+    std::println(std::cerr, "[DEBUG] {} is not an element-wise operation", util::type::to_string(op));
+#else
+    std::unreachable();
+#endif
+}
+
+template <std::size_t Bytes, typename T>
+[[gnu::always_inline]] inline void reduce(ArrayOp op, std::byte const* data, std::size_t length, std::byte* result)
+{
+    auto const* elements = reinterpret_cast<T const*>(data);
+    T folded {};
+    switch (op) {
+        using enum ArrayOp;
+        case SUM: folded = fold<Bytes, SUM>(elements, length); break;
+        case MIN: folded = fold<Bytes, MIN>(elements, length); break;
+        case MAX: folded = fold<Bytes, MAX>(elements, length); break;
+        default:
+#ifndef NDEBUG
+            std::println(std::cerr, "[DEBUG] {} is not a reduction", util::type::to_string(op));
+            break;
+#else
+            std::unreachable();
+#endif
+    }
+    std::memcpy(result, &folded, sizeof(T));
+}
+
+// spelled out instead of going through `util::type::with_element`, a lambda would be compiled without the instruction
+// set of the kernel calling it
+template <std::size_t Bytes>
+[[gnu::always_inline]] inline void elementwise(ArrayOp op, TypeIndex element, std::byte const* lhs, std::byte const* rhs, std::byte* out, std::size_t length)
+{
+    switch (element) {
+        using enum TypeIndex;
+        case INT8: elementwise<Bytes, int8_t>(op, lhs, rhs, out, length); return;
+        case INT16: elementwise<Bytes, int16_t>(op, lhs, rhs, out, length); return;
+        case INT32: elementwise<Bytes, int32_t>(op, lhs, rhs, out, length); return;
+        case INT64: elementwise<Bytes, int64_t>(op, lhs, rhs, out, length); return;
+        case UINT8: elementwise<Bytes, uint8_t>(op, lhs, rhs, out, length); return;
+        case UINT16: elementwise<Bytes, uint16_t>(op, lhs, rhs, out, length); return;
+        case UINT32: elementwise<Bytes, uint32_t>(op, lhs, rhs, out, length); return;
+        case UINT64: elementwise<Bytes, uint64_t>(op, lhs, rhs, out, length); return;
+        case FLOAT32: elementwise<Bytes, float>(op, lhs, rhs, out, length); return;
+        case FLOAT64: elementwise<Bytes, double>(op, lhs, rhs, out, length); return;
+        default: break;   // bool arrays neither compute nor compare
+    }
+#ifndef NDEBUG
+    std::println(std::cerr, "[DEBUG] Reached ELEMENTWISE instruction with {} arrays", util::type::to_string(element));
+#else
+    std::unreachable();
+#endif
+}
+
+template <std::size_t Bytes>
+[[gnu::always_inline]] inline void reduce(ArrayOp op, TypeIndex element, std::byte const* data, std::size_t length, std::byte* result)
+{
+    switch (element) {
+        using enum TypeIndex;
+        case INT8: reduce<Bytes, int8_t>(op, data, length, result); return;
+        case INT16: reduce<Bytes, int16_t>(op, data, length, result); return;
+        case INT32: reduce<Bytes, int32_t>(op, data, length, result); return;
+        case INT64: reduce<Bytes, int64_t>(op, data, length, result); return;
+        case UINT8: reduce<Bytes, uint8_t>(op, data, length, result); return;
+        case UINT16: reduce<Bytes, uint16_t>(op, data, length, result); return;
+        case UINT32: reduce<Bytes, uint32_t>(op, data, length, result); return;
+        case UINT64: reduce<Bytes, uint64_t>(op, data, length, result); return;
+        case FLOAT32: reduce<Bytes, float>(op, data, length, result); return;
+        case FLOAT64: reduce<Bytes, double>(op, data, length, result); return;
+        default: break;
+    }
+#ifndef NDEBUG
+    std::println(std::cerr, "[DEBUG] Reached REDUCE instruction with a {} array", util::type::to_string(element));
+#else
+    std::unreachable();
+#endif
+}
+
+#if defined(__x86_64__)
+// the only functions allowed to use avx2, called once it is known to be there
+[[gnu::target("avx2")]] void elementwise_avx2(ArrayOp op, TypeIndex element, std::byte const* lhs, std::byte const* rhs, std::byte* out, std::size_t length)
+{
+    elementwise<32>(op, element, lhs, rhs, out, length);
+}
+
+[[gnu::target("avx2")]] void reduce_avx2(ArrayOp op, TypeIndex element, std::byte const* data, std::size_t length, std::byte* result)
+{
+    reduce<32>(op, element, data, length, result);
+}
+#endif
+}
+
+namespace util::simd {
+auto isa() noexcept -> Isa
+{
+#if defined(__x86_64__)
+    // every x86-64 cpu has sse2
+    static Isa const best = __builtin_cpu_supports("avx2") ? Isa::AVX2 : Isa::SSE2;
+    return best;
+#else
+    return Isa::SCALAR;
+#endif
+}
+
+void elementwise(ArrayOp op, TypeIndex element, std::byte const* lhs, std::byte const* rhs, std::byte* out, std::size_t length, Isa target)
+{
+    switch (target) {
+        case Isa::SCALAR: ::elementwise<0>(op, element, lhs, rhs, out, length); return;
+        case Isa::SSE2: ::elementwise<16>(op, element, lhs, rhs, out, length); return;
+        case Isa::AVX2:
+#if defined(__x86_64__)
+            elementwise_avx2(op, element, lhs, rhs, out, length);
+#else
+            ::elementwise<16>(op, element, lhs, rhs, out, length);
+#endif
+            return;
+    }
+}
+
+void reduce(ArrayOp op, TypeIndex element, std::byte const* data, std::size_t length, std::byte* result, Isa target)
+{
+    switch (target) {
+        case Isa::SCALAR: ::reduce<0>(op, element, data, length, result); return;
+        case Isa::SSE2: ::reduce<16>(op, element, data, length, result); return;
+        case Isa::AVX2:
+#if defined(__x86_64__)
+            reduce_avx2(op, element, data, length, result);
+#else
+            ::reduce<16>(op, element, data, length, result);
+#endif
+            return;
+    }
+}
+}
@@ -0,0 +1,562 @@
+#include <algorithm>
+#include <bit>
+#include <compare>
+#include <functional>
+#include <limits>
+#include <map>
+#include <ranges>
+#include <span>
+#include <string>
+#include <utility>
+#ifndef NDEBUG
+#include <iostream>
+#include <print>
+#endif
+
+#include "divide.hpp"
+#include "emitter.hpp"
+#include "ssa.hpp"
+
+namespace {
+template <typename Node>
+constexpr SsaOp op_of {};
+template <>
+constexpr SsaOp op_of<Add> = SsaOp::ADD;
+template <>
+constexpr SsaOp op_of<Subtract> = SsaOp::SUB;
+template <>
+constexpr SsaOp op_of<Multiply> = SsaOp::MUL;
+template <>
+constexpr SsaOp op_of<Divide> = SsaOp::DIV;
+template <>
+constexpr SsaOp op_of<Modulus> = SsaOp::MOD;
+template <>
+constexpr SsaOp op_of<Compare<Order::EQUAL>> = SsaOp::CMPE;
+template <>
+constexpr SsaOp op_of<Negate> = SsaOp::NEGATE;
+template <>
+constexpr SsaOp op_of<Not> = SsaOp::NOT;
+
+// value every variable holds at the point being built, so reads need no instruction and assignments only rebind
+class Environment {
+public:
+    auto operator[](Binding binding) -> SsaValue&
+    {
+        auto& values = binding.scope == Binding::Scope::GLOBAL ? m_globals : m_locals;
+        if (values.size() <= binding.index) {
+            values.resize(binding.index + std::size_t { 1 });
+        }
+        return values[binding.index];
+    }
+
+private:
+    std::vector<SsaValue> m_globals;
+    std::vector<SsaValue> m_locals;
+};
+
+auto expression(SsaProgram& program, Environment& environment, ExprType const& expr) -> SsaValue
+{
+    return std::visit(util::Visitor {
+                          [&]<typename Node>(std::unique_ptr<Node> const& node) -> SsaValue
+                              requires(std::is_base_of_v<Binary, Node> && !std::is_same_v<Node, And> && !std::is_same_v<Node, Or>)
+                          {
+                              auto left  = expression(program, environment, node->left);
+                              auto right = expression(program, environment, node->right);
+
+                              if constexpr (std::is_same_v<Node, Compare<Order::LESS>> || std::is_same_v<Node, Compare<Order::GREATER>>) {
+                                  // same shape as the direct compiler: test `CMP`'s -1, 0 or 1 against the wanted order
+                                  auto cmp   = program.append({ SsaOp::CMP, TypeIndex::INT64, Location { node->line, node->column }, { left, right } });
+                                  auto order = program.append({ SsaOp::CONST, TypeIndex::INT8, Location { node->line, node->column }, {}, int8_t { std::is_same_v<Node, Compare<Order::LESS>> ? -1 : 1 } });
+                                  return program.append({ SsaOp::CMPE, TypeIndex::BOOL, Location { node->line, node->column }, { cmp, order } });
+                              } else {
+                                  return program.append({ op_of<Node>, node->type, Location { node->line, node->column }, { left, right } });
+                              }
+                          },
+                          [&]<typename Node>(std::unique_ptr<Node> const& node) -> SsaValue
+                              requires std::is_base_of_v<Unary, Node>
+                          {
+                              auto right = expression(program, environment, node->right);
+                              return program.append({ op_of<Node>, node->type, Location { node->line, node->column }, { right } });
+                          },
+                          [&](std::unique_ptr<Literal> const& node) -> SsaValue {
+                              return program.append({ SsaOp::CONST, node->type, Location { node->line, node->column }, {}, node->value });
+                          },
+                          [&](std::unique_ptr<Variable> const& node) -> SsaValue {
+                              return environment[node->binding];
+                          },
+                          [&](std::unique_ptr<Assign> const& node) -> SsaValue {
+                              return environment[node->binding] = expression(program, environment, node->value);
+                          },
+                          [&]<typename Node>(std::unique_ptr<Node> const&) -> SsaValue
+                              requires(std::is_same_v<Node, And> || std::is_same_v<Node, Or>)
+                          {
+#ifndef NDEBUG
+                              std::println(std::cerr, "[DEBUG] Short circuiting reached the ssa builder");
+                              return {};
+#else
+                              std::unreachable();
+#endif
+                          },
+                          [&]<typename Node>(std::unique_ptr<Node> const&) -> SsaValue
+                              requires(std::is_same_v<Node, Call> || std::is_same_v<Node, Invoke>)
+                          {
+#ifndef NDEBUG
+                              std::println(std::cerr, "[DEBUG] A call reached the ssa builder");
+                              return {};
+#else
+                              std::unreachable();
+#endif
+                          },
+                          [&]<typename Node>(std::unique_ptr<Node> const&) -> SsaValue
+                              requires(std::is_same_v<Node, Get> || std::is_same_v<Node, Set>)
+                          {
+#ifndef NDEBUG
+                              std::println(std::cerr, "[DEBUG] A property reached the ssa builder");
+                              return {};
+#else
+                              std::unreachable();
+#endif
+                          },
+                          [&]<typename Node>(std::unique_ptr<Node> const&) -> SsaValue
+                              requires ArrayNode<Node>
+                          {
+#ifndef NDEBUG
+                              std::println(std::cerr, "[DEBUG] An array reached the ssa builder");
+                              return {};
+#else
+                              std::unreachable();
+#endif
+                          },
+                      },
+                      expr);
+}
+
+void statement(SsaProgram& program, Environment& environment, StmtType const& stmt)
+{
+    std::visit(util::Visitor {
+                   [&](std::unique_ptr<Log> const& node) {
+                       auto value = expression(program, environment, node->expr);
+                       program.append({ SsaOp::LOG, program.instructions()[value].type, Location { node->line, node->column }, { value } });
+                   },
+                   [&](std::unique_ptr<Let> const& node) {
+                       environment[node->binding] = expression(program, environment, node->initializer);
+                   },
+                   [&](std::unique_ptr<Block> const& node) {
+                       for (auto const& inner : node->stmts) {
+                           statement(program, environment, inner);
+                       }
+                   },
+                   [&](std::unique_ptr<Expression> const& node) {
+                       (void)expression(program, environment, node->expr);   // dead code elimination drops it unless something is logged
+                   },
+                   [&]<typename Node>(std::unique_ptr<Node> const&)
+                       requires(std::is_same_v<Node, If> || std::is_same_v<Node, While>)
+                   {
+#ifndef NDEBUG
+                       std::println(std::cerr, "[DEBUG] Control flow reached the ssa builder");
+#else
+                       std::unreachable();
+#endif
+                   },
+                   [&]<typename Node>(std::unique_ptr<Node> const&)
+                       requires(std::is_same_v<Node, Fun> || std::is_same_v<Node, Return> || std::is_same_v<Node, Class>)
+                   {
+#ifndef NDEBUG
+                       std::println(std::cerr, "[DEBUG] A function reached the ssa builder");
+#else
+                       std::unreachable();
+#endif
+                   },
+               },
+               stmt);
+}
+
+// whether `expr` short circuits, calls, touches an instance or an array anywhere, the ir only has room for a single basic block
+auto has_control_flow(ExprType const& expr) -> bool
+{
+    return std::visit([]<typename Node>(std::unique_ptr<Node> const& node) -> bool {
+        if constexpr (std::is_same_v<Node, And> || std::is_same_v<Node, Or> || std::is_same_v<Node, Call> || std::is_same_v<Node, Get>
+                      || std::is_same_v<Node, Set> || std::is_same_v<Node, Invoke> || ArrayNode<Node>) {
+            return true;
+        } else if constexpr (std::is_base_of_v<Binary, Node>) {
+            return has_control_flow(node->left) || has_control_flow(node->right);
+        } else if constexpr (std::is_base_of_v<Unary, Node>) {
+            return has_control_flow(node->right);
+        } else if constexpr (std::is_same_v<Node, Assign>) {
+            return has_control_flow(node->value);
+        } else {
+            return false;
+        }
+    },
+                      expr);
+}
+
+auto has_control_flow(StmtType const& stmt) -> bool
+{
+    return std::visit(util::Visitor {
+                          [](std::unique_ptr<Log> const& node) { return has_control_flow(node->expr); },
+                          [](std::unique_ptr<Let> const& node) { return has_control_flow(node->initializer); },
+                          [](std::unique_ptr<Block> const& node) {
+                              return std::ranges::any_of(node->stmts, [](auto const& inner) { return has_control_flow(inner); });
+                          },
+                          [](std::unique_ptr<Expression> const& node) { return has_control_flow(node->expr); },
+                          [](std::unique_ptr<If> const&) { return true; },
+                          [](std::unique_ptr<While> const&) { return true; },
+                          [](std::unique_ptr<Fun> const&) { return true; },
+                          [](std::unique_ptr<Return> const&) { return true; },
+                          [](std::unique_ptr<Class> const&) { return true; },
+                      },
+                      stmt);
+}
+
+// identity of the value an instruction computes
+struct ValueKey {
+    SsaOp op;
+    TypeIndex type;
+    std::array<SsaValue, 2> operands;
+    uint64_t bits;      // constant bit pattern, so 0.0 and -0.0 stay apart
+    std::string text;   // string constant
+
+    auto operator<=>(ValueKey const&) const = default;
+};
+
+// an integer constant as the 64 bits the vm computes it in, empty for every other constant
+auto integer_bits(TypeVariant const& constant) -> std::optional<uint64_t>
+{
+    return std::visit([]<typename T>(T const& value) -> std::optional<uint64_t> {
+        if constexpr (std::is_same_v<T, bool> || !std::integral<T>) {
+            return {};
+        } else if constexpr (std::signed_integral<T>) {
+            return static_cast<uint64_t>(static_cast<int64_t>(value));
+        } else {
+            return static_cast<uint64_t>(value);
+        }
+    },
+                      constant);
+}
+
+// magic numbers for dividing by the constant of a `DIVP2`, `MODP2`, `DIVM` or `MODM`
+auto divider_of(SsaInstr const& instr) -> util::divide::Divider
+{
+    auto bits = integer_bits(instr.constant).value_or(1);
+    return util::type::is_signed_integer(instr.type) ? util::divide::signed_divider(static_cast<int64_t>(bits))
+                                                     : util::divide::unsigned_divider(bits);
+}
+
+auto is_commutative(SsaInstr const& instr) -> bool
+{
+    switch (instr.op) {
+        using enum SsaOp;
+        case ADD: return instr.type != TypeIndex::STRING;   // concatenation is not
+        case MUL:
+        case CMPE: return true;
+        default: return false;
+    }
+}
+
+// whether `instr` is an integer division the vm may halt at, which has to run even when nothing reads it
+auto may_halt(std::vector<SsaInstr> const& instrs, SsaInstr const& instr) -> bool
+{
+    if ((instr.op != SsaOp::DIV && instr.op != SsaOp::MOD)
+        || (!util::type::is_signed_integer(instr.type) && !util::type::is_unsigned_integer(instr.type))) {
+        return false;
+    }
+    auto const& divisor = instrs[instr.operands[1]];
+    auto bits           = divisor.op == SsaOp::CONST ? integer_bits(divisor.constant) : std::nullopt;
+    return !bits.has_value() || *bits == 0 || (util::type::is_signed_integer(instr.type) && static_cast<int64_t>(*bits) == -1);
+}
+}
+
+namespace util::ssa {
+auto to_string(SsaOp op) -> std::string_view
+{
+    switch (op) {
+        using enum SsaOp;
+        case CONST: return "CONST";
+        case COPY: return "COPY";
+        case ADD: return "ADD";
+        case SUB: return "SUB";
+        case MUL: return "MUL";
+        case DIV: return "DIV";
+        case MOD: return "MOD";
+        case CMP: return "CMP";
+        case CMPE: return "CMPE";
+        case NEGATE: return "NEGATE";
+        case NOT: return "NOT";
+        case SHL: return "SHL";
+        case DIVP2: return "DIVP2";
+        case MODP2: return "MODP2";
+        case DIVM: return "DIVM";
+        case MODM: return "MODM";
+        case LOG: return "LOG";
+    }
+#ifndef NDEBUG
+    std::println(std::cerr, "[DEBUG] Unknown ssa op");
+    return {};
+#else
+    std::unreachable();
+#endif
+}
+
+auto build(StmtType const& ast) -> SsaProgram
+{
+    SsaProgram program;
+    Environment environment;
+    statement(program, environment, ast);
+    return program;
+}
+
+void strength_reduction(SsaProgram& program)
+{
+    auto& instrs = program.instructions();
+    for (auto& instr : instrs) {
+        if ((instr.op != SsaOp::MUL && instr.op != SsaOp::DIV && instr.op != SsaOp::MOD)
+            || (!util::type::is_signed_integer(instr.type) && !util::type::is_unsigned_integer(instr.type))) {
+            continue;
+        }
+        bool is_signed     = util::type::is_signed_integer(instr.type);
+        auto constant_bits = [&](SsaValue value) -> std::optional<uint64_t> {
+            return instrs[value].op == SsaOp::CONST ? integer_bits(instrs[value].constant) : std::nullopt;
+        };
+        auto reduce = [&](SsaOp op, SsaValue operand, SsaValue constant) {
+            instr = { op, instr.type, instr.location, { operand }, instrs[constant].constant };
+        };
+
+        if (instr.op == SsaOp::MUL) {
+            // either side, multiplication commutes
+            for (auto [operand, constant] : { std::pair { instr.operands[0], instr.operands[1] }, std::pair { instr.operands[1], instr.operands[0] } }) {
+                auto bits = constant_bits(constant);
+                if (bits.has_value() && std::has_single_bit(*bits) && (!is_signed || static_cast<int64_t>(*bits) > 0)) {
+                    *bits == 1 ? reduce(SsaOp::COPY, operand, constant) : reduce(SsaOp::SHL, operand, constant);
+                    break;
+                }
+            }
+            continue;
+        }
+
+        auto [operand, constant] = instr.operands;
+        auto bits                = constant_bits(constant);
+        if (!bits.has_value() || *bits == 0) {   // dividing by zero keeps whatever `DIV` does with it
+            continue;
+        }
+        // the least integer over -1 halts as `DIV`, the reduced forms would wrap around instead
+        if (is_signed && static_cast<int64_t>(*bits) == -1) {
+            continue;
+        }
+        auto magnitude       = is_signed && static_cast<int64_t>(*bits) < 0 ? uint64_t { 0 } - *bits : *bits;
+        bool is_power_of_two = std::has_single_bit(magnitude);
+        if (instr.op == SsaOp::DIV) {
+            *bits == 1 ? reduce(SsaOp::COPY, operand, constant) : reduce(is_power_of_two ? SsaOp::DIVP2 : SsaOp::DIVM, operand, constant);
+        } else {
+            reduce(is_power_of_two ? SsaOp::MODP2 : SsaOp::MODM, operand, constant);
+        }
+    }
+}
+
+void value_numbering(SsaProgram& program)
+{
+    auto& instrs = program.instructions();
+    std::map<ValueKey, SsaValue> numbers;
+    std::vector<SsaValue> leader(instrs.size());
+
+    for (SsaValue value {}; value < instrs.size(); value++) {
+        auto& instr   = instrs[value];
+        leader[value] = value;
+        if (instr.op == SsaOp::LOG || instr.op == SsaOp::COPY) {
+            if (instr.op == SsaOp::COPY) {
+                leader[value] = leader[instr.operands[0]];
+            }
+            continue;
+        }
+
+        ValueKey key { instr.op, instr.type, {}, {}, {} };
+        for (std::size_t i {}; i < arity(instr.op); i++) {
+            key.operands[i] = leader[instr.operands[i]];
+        }
+        if (is_commutative(instr)) {
+            std::ranges::sort(key.operands);
+        }
+        if (has_immediate(instr.op)) {
+            std::visit(util::Visitor {
+                           [&](std::string const& v) { key.text = v; },
+                           [&](bool v) { key.bits = v ? 1 : 0; },
+                           [&]<std::integral T>(T v) { key.bits = static_cast<uint64_t>(v); },
+                           [&](float v) { key.bits = std::bit_cast<uint32_t>(v); },
+                           [&](double v) { key.bits = std::bit_cast<uint64_t>(v); },
+                       },
+                       instr.constant);
+        }
+
+        auto [it, is_new] = numbers.try_emplace(std::move(key), value);
+        if (!is_new) {
+            instr         = { SsaOp::COPY, instr.type, instr.location, { it->second } };
+            leader[value] = it->second;
+        }
+    }
+}
+
+void copy_propagation(SsaProgram& program)
+{
+    auto& instrs = program.instructions();
+    for (auto& instr : instrs) {
+        for (std::size_t i {}; i < arity(instr.op); i++) {
+            // operands always point backwards, so every chain ends
+            while (instrs[instr.operands[i]].op == SsaOp::COPY) {
+                instr.operands[i] = instrs[instr.operands[i]].operands[0];
+            }
+        }
+    }
+}
+
+void dead_code_elimination(SsaProgram& program)
+{
+    auto& instrs = program.instructions();
+    std::vector<bool> is_live(instrs.size());
+    for (auto value = instrs.size(); value-- > 0;) {
+        auto const& instr = instrs[value];
+        if (instr.op == SsaOp::LOG || may_halt(instrs, instr)) {
+            is_live[value] = true;
+        }
+        if (is_live[value]) {
+            for (std::size_t i {}; i < arity(instr.op); i++) {
+                is_live[instr.operands[i]] = true;
+            }
+        }
+    }
+
+    std::vector<SsaValue> renamed(instrs.size());
+    SsaValue next {};
+    for (SsaValue value {}; value < instrs.size(); value++) {
+        if (!is_live[value]) {
+            continue;
+        }
+        auto instr = std::move(instrs[value]);
+        for (std::size_t i {}; i < arity(instr.op); i++) {
+            instr.operands[i] = renamed[instr.operands[i]];
+        }
+        renamed[value]  = next;
+        instrs[next++] = std::move(instr);
+    }
+    instrs.resize(next);
+}
+
+void optimize(SsaProgram& program)
+{
+    strength_reduction(program);
+    value_numbering(program);
+    copy_propagation(program);
+    dead_code_elimination(program);
+}
+
+auto lower(SsaProgram program, Fusions fusions) -> std::optional<CodeSegment>
+{
+    // copies never reach the stack
+    copy_propagation(program);
+    dead_code_elimination(program);
+
+    auto const& instrs = program.instructions();
+    std::vector<std::size_t> uses(instrs.size());
+    // constants loaded right where they are read: shared ones, since loading again is as cheap as
+    // copying, and those read after another operand, which then fuse into their user
+    std::vector<bool> is_deferred(instrs.size());
+    for (auto const& instr : instrs) {
+        for (std::size_t i {}; i < arity(instr.op); i++) {
+            uses[instr.operands[i]]++;
+            is_deferred[instr.operands[i]] = is_deferred[instr.operands[i]] || i > 0;
+        }
+    }
+    for (SsaValue value {}; value < instrs.size(); value++) {
+        is_deferred[value] = instrs[value].op == SsaOp::CONST && (is_deferred[value] || uses[value] > 1);
+    }
+
+    Emitter emitter { fusions };
+    StringTable pool;
+    std::vector<SsaValue> stack;   // value held by every slot of the operand stack
+    auto load = [&](SsaValue value) {
+        emitter.constant(instrs[value].type, instrs[value].constant, pool, instrs[value].location);
+    };
+
+    for (SsaValue value {}; value < instrs.size(); value++) {
+        auto const& instr = instrs[value];
+        if (instr.op == SsaOp::CONST) {
+            if (!is_deferred[value]) {
+                load(value);
+                stack.push_back(value);
+            }
+            continue;
+        }
+
+        // the longest run of leading operands already on top in order and never read
+        // after this instruction is popped in place, every other operand is copied up
+        std::span operands { instr.operands.data(), arity(instr.op) };
+        auto in_place = operands.size();
+        for (; in_place > 0; in_place--) {
+            auto resident = operands.first(in_place);
+            if (in_place <= stack.size()
+                && std::ranges::equal(resident, std::span { stack }.last(in_place))
+                && std::ranges::all_of(resident, [&](SsaValue operand) {
+                       return !is_deferred[operand] && uses[operand] == static_cast<std::size_t>(std::ranges::count(operands, operand));
+                   })) {
+                break;
+            }
+        }
+
+        for (auto operand : operands.subspan(in_place)) {
+            if (is_deferred[operand]) {
+                load(operand);
+                stack.push_back(operand);
+                continue;
+            }
+            auto slot  = std::ranges::find(stack | std::views::reverse, operand);
+            auto depth = static_cast<std::size_t>(slot - std::ranges::rbegin(stack));
+            if (depth > std::numeric_limits<uint8_t>::max()) {
+                return {};
+            }
+            emitter.pick(static_cast<uint8_t>(depth), instr.location);
+            stack.push_back(operand);
+        }
+        stack.resize(stack.size() - operands.size());
+        for (auto operand : operands) {
+            uses[operand]--;
+        }
+
+        switch (instr.op) {
+            using enum SsaOp;
+            case ADD: emitter.opcode(Opcode::ADD, instr.location); break;
+            case SUB: emitter.opcode(Opcode::SUB, instr.location); break;
+            case MUL: emitter.opcode(Opcode::MUL, instr.location); break;
+            case DIV: emitter.opcode(Opcode::DIV, instr.location); break;
+            case MOD: emitter.opcode(Opcode::MOD, instr.location); break;
+            case CMP: emitter.opcode(Opcode::CMP, instr.location); break;
+            case CMPE: emitter.opcode(Opcode::CMPE, instr.location); break;
+            case NEGATE: emitter.opcode(Opcode::NEGATE, instr.location); break;
+            case NOT: emitter.opcode(Opcode::NOT, instr.location); break;
+            case LOG: emitter.opcode(Opcode::LOG, instr.location); break;
+            case SHL: emitter.instruction(Opcode::SHL, instr.location, static_cast<uint8_t>(std::countr_zero(*integer_bits(instr.constant)))); break;
+            case DIVP2: emitter.instruction(Opcode::DIVP2, instr.location, divider_of(instr).more); break;
+            case MODP2: emitter.instruction(Opcode::MODP2, instr.location, divider_of(instr).more); break;
+            case DIVM: emitter.instruction(Opcode::DIVM, instr.location, divider_of(instr).more, divider_of(instr).magic); break;
+            case MODM: {
+                auto divider = divider_of(instr);
+                emitter.instruction(Opcode::MODM, instr.location, divider.more, divider.magic, *integer_bits(instr.constant));
+            } break;
+            case CONST:
+            case COPY: break;
+        }
+        if (instr.op != SsaOp::LOG) {
+            stack.push_back(value);
+        }
+    }
+    return std::pair { std::move(emitter).finish(), std::move(pool) };
+}
+
+auto compile(StmtType const& ast, Fusions fusions) -> std::optional<CodeSegment>
+{
+    if (has_control_flow(ast)) {
+        return {};
+    }
+    auto program = build(ast);
+    optimize(program);
+    return lower(std::move(program), fusions);
+}
+}
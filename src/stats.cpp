@@ -0,0 +1,78 @@
+#include <iostream>
+#include <print>
+#include <string_view>
+#if __has_include(<sys/resource.h>)
+#include <sys/resource.h>
+#endif
+
+#include "stats.hpp"
+
+namespace {
+constexpr std::array<std::string_view, 5> phase_names { "lex", "parse", "compile", "verify", "execute" };
+
+// Peak resident set size of the whole process in KiB, 0 when the platform cannot tell
+auto peak_rss_kib() -> long
+{
+#if __has_include(<sys/resource.h>)
+    rusage usage {};
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        return usage.ru_maxrss;
+    }
+#endif
+    return 0;
+}
+
+auto to_us(std::chrono::nanoseconds time) -> double
+{
+    return std::chrono::duration<double, std::micro> { time }.count();
+}
+}
+
+void Stats::print() const
+{
+    constexpr std::size_t field_width { 12 };
+    std::println(std::cerr, "{:<{}} {:>{}} {:>{}}", "PHASE", field_width, "WALL(us)", field_width, "CPU(us)", field_width);
+
+    Timing total {};
+    for (std::size_t phase {}; phase < timings.size(); phase++) {
+        std::println(std::cerr, "{:<{}} {:>{}.3f} {:>{}.3f}",
+                     phase_names[phase], field_width,
+                     to_us(timings[phase].wall), field_width,
+                     to_us(timings[phase].cpu), field_width);
+        total.wall += timings[phase].wall;
+        total.cpu += timings[phase].cpu;
+    }
+    std::println(std::cerr, "{:<{}} {:>{}.3f} {:>{}.3f}", "total", field_width, to_us(total.wall), field_width, to_us(total.cpu), field_width);
+
+    std::println(std::cerr, "");
+    std::println(std::cerr, "tokens            : {}", tokens);
+    std::println(std::cerr, "ast nodes         : {}", ast_nodes);
+    std::println(std::cerr, "bytecode          : {} bytes", bytecode_bytes);
+    std::println(std::cerr, "line table        : {} entries, {} bytes", line_entries, line_bytes);
+    std::println(std::cerr, "string table      : {} strings, {} bytes", strings, string_bytes);
+    std::println(std::cerr, "peak stack depth  : {}", peak_stack_depth);
+    std::println(std::cerr, "instructions      : {}", instructions);
+    std::println(std::cerr, "collections       : {} minor, {} major", minor_collections, major_collections);
+    std::println(std::cerr, "gc pauses         : {}, p99 {:.3f} us, max {:.3f} us", gc_pauses, to_us(gc_pause_p99), to_us(gc_pause_max));
+    std::println(std::cerr, "peak rss          : {} KiB", peak_rss_kib());
+}
+
+void Stats::print_json() const
+{
+    std::string phases;
+    for (std::size_t phase {}; phase < timings.size(); phase++) {
+        phases += std::format(R"({}"{}":{{"wall_ns":{},"cpu_ns":{}}})",
+                              phase == 0 ? "" : ",",
+                              phase_names[phase],
+                              timings[phase].wall.count(),
+                              timings[phase].cpu.count());
+    }
+
+    std::println(std::cerr,
+                 R"({{"phases":{{{}}},"tokens":{},"ast_nodes":{},"bytecode_bytes":{},"line_entries":{},"line_bytes":{},)"
+                 R"("strings":{},"string_bytes":{},"peak_stack_depth":{},"instructions":{},"minor_collections":{},"major_collections":{},)"
+                 R"("gc_pauses":{},"gc_pause_p99_ns":{},"gc_pause_max_ns":{},"peak_rss_kib":{}}})",
+                 phases, tokens, ast_nodes, bytecode_bytes, line_entries, line_bytes,
+                 strings, string_bytes, peak_stack_depth, instructions, minor_collections, major_collections,
+                 gc_pauses, gc_pause_p99.count(), gc_pause_max.count(), peak_rss_kib());
+}
@@ -0,0 +1,907 @@
+#include <algorithm>
+#include <format>
+#include <optional>
+#include <ranges>
+
+#include "verifier.hpp"
+#include "instr.hpp"
+#include "vm.hpp"
+
+namespace {
+auto is_integer(SlotType type) noexcept -> bool
+{
+    return type == SlotType::INT || type == SlotType::UINT;
+}
+
+auto to_string(SlotType type) -> std::string
+{
+    if (auto value = util::slot::unboxed(type); value.has_value()) {
+        return std::format("box<{}>", to_string(value.value()));
+    }
+    if (auto signature = util::slot::signature(type); signature.has_value()) {
+        return std::format("fun#{}", signature.value());
+    }
+    if (auto klass = util::slot::class_of(type); klass.has_value()) {
+        return std::format("class#{}", klass.value());
+    }
+    if (auto element = util::slot::element(type); element.has_value() && util::type::is_element(element.value())) {
+        return std::format("[{}]", util::type::to_string(element.value()));
+    }
+    switch (type) {
+        using enum SlotType;
+        case BOOL: return "bool";
+        case STRING: return "str";
+        case INT: return "int";
+        case UINT: return "uint";
+        case FLOAT: return "float";
+        default: break;
+    }
+    return "?";
+}
+
+// type an element of an array of `element` has once it is read onto the stack
+auto element_slot(TypeIndex element) noexcept -> SlotType
+{
+    using enum TypeIndex;
+    if (element == BOOL) {
+        return SlotType::BOOL;
+    }
+    if (element >= FLOAT32) {
+        return SlotType::FLOAT;
+    }
+    return element >= UINT8 ? SlotType::UINT : SlotType::INT;
+}
+
+// type of the elements of the arrays `type` stands for, empty for every other type and for elements no array has
+auto array_element(SlotType type) noexcept -> std::optional<TypeIndex>
+{
+    auto element = util::slot::element(type);
+    if (!element.has_value() || !util::type::is_element(element.value())) {
+        return {};
+    }
+    return element;
+}
+
+// type `util::vm::binary` produces for `opcode` on these operands, empty where it is undefined
+auto binary_result(Opcode opcode, SlotType lhs, SlotType rhs) noexcept -> std::optional<SlotType>
+{
+    using enum SlotType;
+    if (lhs >= FUNCTION || rhs >= FUNCTION) {
+        return {};   // functions only get called, instances only have properties, boxes only hold variables
+    }
+    if (opcode == Opcode::ADD && (lhs == STRING || rhs == STRING)) {
+        return STRING;
+    }
+    if (lhs != rhs) {
+        return {};
+    }
+    switch (opcode) {
+        using enum Opcode;
+        case CMP: return INT;
+        case CMPE: return BOOL;
+        case ADD:
+        case SUB:
+        case MUL:
+        case DIV:
+        case MOD:
+            if (lhs == STRING) {
+                return {};
+            }
+            return lhs == BOOL ? INT : lhs;   // bools promote to int like in C++
+        default: return {};
+    }
+}
+}
+
+Verifier::Verifier(ByteCode const& bc, StringTable const& pool)
+    : m_bc { bc }
+{
+    for (auto it = pool.begin(); it != pool.end(); it++) {
+        m_strings.insert(std::bit_cast<std::array<uint8_t, sizeof(StringPtr)>>(it));
+    }
+    m_class_error = m_check_classes();
+}
+
+auto Verifier::verify(std::span<SlotType const> parameters) const -> std::expected<std::size_t, BytecodeError>
+{
+    if (m_class_error.has_value()) {
+        return std::unexpected(m_class_error.value());
+    }
+    auto const& code = m_bc.code();
+    // jumps may only land where a linear walk over the code starts an instruction
+    std::vector<bool> starts(code.size());
+    for (std::size_t offset {}; offset < code.size();) {
+        auto opcode = static_cast<Opcode>(code[offset]);
+        if (code[offset] >= util::opcode::count
+            || (util::opcode::has_constant(opcode) && (offset + 1 >= code.size() || code[offset + 1] > std::to_underlying(TypeIndex::FUNCTION)))) {
+            break;   // whatever follows is garbage, `step` reports it if control ever gets there
+        }
+        starts[offset] = true;
+        offset += util::opcode::length(m_bc, offset);
+    }
+
+    std::vector<std::optional<TypeState>> states(code.size());
+    std::vector<std::size_t> worklist;
+    std::vector<std::optional<SlotType>> global_types(m_bc.globals());
+    if (parameters.size() > global_types.size()) {
+        return std::unexpected(BytecodeError { 0, std::format("{} parameters but only {} globals", parameters.size(), global_types.size()) });
+    }
+    std::ranges::copy(parameters, global_types.begin());
+    std::size_t max_depth {};
+    // hands `state` on to `target`, queueing it again when that is news to it
+    auto flow = [&](std::size_t from, std::size_t target, TypeState const& state) -> std::expected<void, BytecodeError> {
+        if (target >= code.size()) {
+            return std::unexpected(BytecodeError { code.size(), "control runs off the end of the code" });
+        }
+        auto changed = m_join(states[target], state);
+        if (!changed.has_value()) {
+            return std::unexpected(BytecodeError { from, std::format("{} at offset {}", changed.error(), target) });
+        }
+        if (changed.value()) {
+            worklist.push_back(target);
+        }
+        return {};
+    };
+
+    // a function only runs once it was loaded and something of its signature is called, so a global is set in its
+    // body when every load of it or every call of the signature comes after setting the global, as in recursion
+    std::vector<std::optional<TypeState>> loaded(m_bc.functions().size());
+    std::vector<std::optional<TypeState>> called(m_bc.signatures().size());
+    auto enter = [&](std::size_t from, std::size_t index) -> std::expected<void, BytecodeError> {
+        auto const& function = m_bc.functions()[index];
+        auto const& calls    = called[function.signature];
+        if (!loaded[index].has_value() || !calls.has_value()) {
+            return {};
+        }
+        if (!starts[function.entry]) {
+            return std::unexpected(BytecodeError { from, std::format("function {} starts inside the instruction at offset {}", function.name, function.entry) });
+        }
+        auto entry = loaded[index].value();
+        for (std::size_t global {}; global < entry.globals.size(); global++) {
+            if (!entry.globals[global].has_value()) {
+                entry.globals[global] = calls->globals[global];
+            }
+        }
+        return flow(from, function.entry, entry);
+    };
+
+    if (auto entry = flow(0, 0, TypeState { .stack = {}, .globals = global_types }); !entry.has_value()) {
+        return std::unexpected(std::move(entry.error()));
+    }
+    while (!worklist.empty()) {
+        auto offset = worklist.back();
+        worklist.pop_back();
+        auto state  = states[offset].value();
+        auto opcode = static_cast<Opcode>(code[offset]);
+        // the callee sits below the arguments, which the call replaces, as does the instance a method is invoked for
+        std::optional<SlotType> callee;
+        if ((opcode == Opcode::CALL || opcode == Opcode::TAIL_CALL) && offset + 1 < code.size() && state.stack.size() > code[offset + 1]) {
+            callee = state.stack[state.stack.size() - code[offset + 1] - 1];
+        }
+        std::optional<std::size_t> receiver;
+        if (opcode == Opcode::INVOKE && offset + 3 < code.size() && state.stack.size() > code[offset + 3]) {
+            receiver = util::slot::class_of(state.stack[state.stack.size() - code[offset + 3] - 1]);
+            max_depth = std::max(max_depth, state.stack.size() + 1);   // the method goes below the instance
+        }
+        auto next = step(offset, state);
+        if (!next.has_value()) {
+            return std::unexpected(std::move(next.error()));
+        }
+        max_depth = std::max(max_depth, state.stack.size());
+
+        if (opcode == Opcode::SET_GLOBAL) {
+            // frames only see the globals set before they start, so a global's type has to agree across all of them
+            auto& type = global_types[m_bc.read_value<uint16_t>(offset + 1)];
+            if (type.has_value() && type.value() != state.stack.back()) {
+                return std::unexpected(BytecodeError { offset, std::format("SET_GLOBAL assigns {} to a global holding {} elsewhere", to_string(state.stack.back()), to_string(type.value())) });
+            }
+            type = state.stack.back();
+        }
+        // either edge into a function, its frame starts out as the parameters
+        bool is_made = opcode == Opcode::LOAD || opcode == Opcode::CLOSURE;
+        if (auto signature = util::slot::signature(is_made ? state.stack.back() : callee.value_or(SlotType::BOOL)); signature.has_value()) {
+            std::optional<std::size_t> loaded_index;
+            if (is_made) {
+                loaded_index = m_bc.read_value<uint16_t>(offset + (opcode == Opcode::LOAD ? 2 : 1));
+            }
+            TypeState entry { .stack = m_bc.signatures()[signature.value()].parameters, .globals = state.globals, .function = loaded_index };
+            auto joined = m_join(loaded_index.has_value() ? loaded[loaded_index.value()] : called[signature.value()], entry);
+            if (!joined.has_value()) {
+                return std::unexpected(BytecodeError { offset, std::format("{} entering a function", joined.error()) });
+            }
+            for (std::size_t index {}; joined.value() && index < loaded.size(); index++) {
+                // a load enters its function, a call every function of the signature
+                bool is_entered = loaded_index.has_value() ? index == loaded_index.value() : m_bc.functions()[index].signature == signature.value();
+                if (!is_entered) {
+                    continue;
+                }
+                if (auto entered = enter(offset, index); !entered.has_value()) {
+                    return std::unexpected(std::move(entered.error()));
+                }
+            }
+        }
+        // the instance may be of any subclass, each of which may override the method
+        if (receiver.has_value()) {
+            auto name = m_bc.read_value<uint16_t>(offset + 1);
+            std::set<uint16_t> methods;
+            for (std::size_t klass {}; klass < m_bc.classes().size(); klass++) {
+                if (m_is_assignable(util::slot::instance(klass), util::slot::instance(receiver.value()))) {
+                    methods.insert(m_method(klass, name).value());
+                }
+            }
+            for (auto method : methods) {
+                auto const& function = m_bc.functions()[method];
+                TypeState entry { .stack = m_bc.signatures()[function.signature].parameters, .globals = state.globals, .function = method };
+                auto joined = m_join(loaded[method], entry);
+                entry.function.reset();
+                auto called_joined = joined.has_value() ? m_join(called[function.signature], entry) : joined;
+                if (!called_joined.has_value()) {
+                    return std::unexpected(BytecodeError { offset, std::format("{} entering a method", called_joined.error()) });
+                }
+                // invoking is loading the method and calling its signature at once
+                for (std::size_t index {}; index < loaded.size(); index++) {
+                    bool is_entered = index == method ? joined.value() || called_joined.value()
+                                                      : called_joined.value() && m_bc.functions()[index].signature == function.signature;
+                    if (!is_entered) {
+                        continue;
+                    }
+                    if (auto entered = enter(offset, index); !entered.has_value()) {
+                        return std::unexpected(std::move(entered.error()));
+                    }
+                }
+            }
+        }
+        if (opcode == Opcode::RETURN || opcode == Opcode::TAIL_CALL) {
+            continue;
+        }
+        if (util::opcode::is_jump(opcode)) {
+            auto target = static_cast<std::size_t>(util::opcode::jump_target(m_bc, offset));
+            if (!starts[target]) {
+                return std::unexpected(BytecodeError { offset, std::format("{} lands inside the instruction at offset {}", util::opcode::to_string(opcode), target) });
+            }
+            if (opcode != Opcode::JUMP) {
+                // the taken edge, where `and`, `or` keep the condition they popped on the fall through
+                auto taken = state;
+                if (opcode == Opcode::JUMP_IF_FALSE_OR_POP || opcode == Opcode::JUMP_IF_TRUE_OR_POP) {
+                    taken.stack.push_back(SlotType::BOOL);
+                    max_depth = std::max(max_depth, taken.stack.size());
+                }
+                if (auto flowed = flow(offset, target, taken); !flowed.has_value()) {
+                    return std::unexpected(std::move(flowed.error()));
+                }
+            }
+        }
+        if (auto flowed = flow(offset, next.value(), state); !flowed.has_value()) {
+            return std::unexpected(std::move(flowed.error()));
+        }
+    }
+    return max_depth;
+}
+
+auto Verifier::m_join(std::optional<TypeState>& target, TypeState const& state) const -> std::expected<bool, std::string>
+{
+    if (!target.has_value()) {
+        target = state;
+        return true;
+    }
+    if (target->function != state.function) {
+        return std::unexpected(std::string { "code is shared by different functions" });
+    }
+    if (target->stack != state.stack) {
+        return std::unexpected(std::string { "stack types differ where control flow joins" });
+    }
+    bool changed {};
+    for (std::size_t index {}; index < state.globals.size(); index++) {
+        auto& global = target->globals[index];
+        if (global == state.globals[index] || !global.has_value()) {
+            continue;
+        }
+        if (state.globals[index].has_value()) {
+            return std::unexpected(std::format("global {} holds {} and {} where control flow joins", index, to_string(global.value()), to_string(state.globals[index].value())));
+        }
+        global.reset();   // only set on some of the paths into the join
+        changed = true;
+    }
+    return changed;
+}
+
+auto Verifier::step(std::size_t offset, TypeState& state) const -> std::expected<std::size_t, BytecodeError>
+{
+    auto error = [offset](std::string message) {
+        return std::unexpected(BytecodeError { offset, std::move(message) });
+    };
+    if (m_class_error.has_value()) {
+        return std::unexpected(m_class_error.value());
+    }
+    auto const& code = m_bc.code();
+    auto& stack      = state.stack;
+
+    if (code[offset] >= util::opcode::count) {
+        return error(std::format("invalid opcode {}", code[offset]));
+    }
+    auto opcode = static_cast<Opcode>(code[offset]);
+    auto name   = util::opcode::to_string(opcode);
+    // the type byte decides the length of the instruction, check it before asking for the length
+    if (util::opcode::has_constant(opcode)
+        && (offset + 1 >= code.size() || code[offset + 1] > std::to_underlying(TypeIndex::FUNCTION))) {
+        return error(std::format("{} has no valid constant type", name));
+    }
+    auto next = offset + util::opcode::length(m_bc, offset);
+    if (next > code.size()) {
+        return error(std::format("{} is cut off by the end of the code", name));
+    }
+
+    std::optional<SlotType> constant;
+    if (util::opcode::has_constant(opcode)) {
+        auto type = m_constant(offset);
+        if (!type.has_value()) {
+            return error(std::format("{} {}", name, type.error()));
+        }
+        constant = type.value();
+    }
+    // values the opcode needs on the stack, a superinstruction's right operand is its constant and locals need every slot up to theirs
+    std::size_t popped {};
+    switch (util::opcode::unfused(opcode)) {
+        using enum Opcode;
+        case LOAD:
+        case GET_GLOBAL:
+        case GET_CALLEE:
+        case GET_CAPTURE:
+        case GET_BOXED_CAPTURE:
+        case JUMP:
+        case NEW:
+        case RETURN: break;
+        case CLOSURE: {
+            auto function = m_bc.read_value<uint16_t>(offset + 1);
+            popped        = function < m_bc.functions().size() ? m_bc.functions()[function].captures.size() : 0;
+        } break;
+        case PICK: popped = code[offset + 1] + std::size_t { 1 }; break;
+        case POP: popped = code[offset + 1]; break;
+        case CALL:
+        case TAIL_CALL: popped = code[offset + 1] + std::size_t { 1 }; break;   // the callee and its arguments
+        case INVOKE: popped = code[offset + 3] + std::size_t { 1 }; break;      // the instance and the arguments
+        case SET_PROP: popped = 2; break;                                      // the instance and the value
+        case NEW_ARRAY: popped = m_bc.read_value<uint16_t>(offset + 2); break;
+        case FILL_ARRAY:
+        case GET_INDEX:
+        case ELEMENTWISE: popped = 2; break;
+        case SET_INDEX: popped = 3; break;   // the array, the index and the value
+        case GET_LOCAL:
+        case GET_BOXED:
+        case BOX: popped = code[offset + 1] + std::size_t { 1 }; break;
+        case SET_LOCAL:
+        case SET_BOXED: popped = code[offset + 1] + std::size_t { 2 }; break;   // the slot and the value above it
+        case LOG: popped = constant.has_value() ? 0 : 1; break;
+        case ADD:
+        case SUB:
+        case MUL:
+        case DIV:
+        case MOD:
+        case CMP:
+        case CMPE: popped = constant.has_value() ? 1 : 2; break;
+        case JLT:
+        case JLE:
+        case JGT:
+        case JGE:
+        case JEQ:
+        case JNE: popped = 2; break;
+        default: popped = 1; break;
+    }
+    if (stack.size() < popped) {
+        return error(std::format("{} needs {} values but the stack holds {}", name, popped, stack.size()));
+    }
+
+    if (util::opcode::is_jump(opcode)) {
+        auto target = util::opcode::jump_target(m_bc, offset);
+        if (target < 0 || static_cast<std::size_t>(target) >= code.size()) {
+            return error(std::format("{} to offset {} leaves the code", name, target));
+        }
+        if (opcode == Opcode::JUMP) {
+            return static_cast<std::size_t>(target);
+        }
+    }
+
+    // a call only leaves a frame's worth of room above it, the top level code has the rest
+    auto limit = state.function.has_value() ? Stack::frame_size : Stack::max_size;
+    switch (util::opcode::unfused(opcode)) {
+        using enum Opcode;
+        case LOAD: stack.push_back(constant.value()); break;
+        case RETURN:
+            if (state.function.has_value()) {
+                auto result = m_signature(state).result;
+                if (stack.empty() || !m_is_assignable(stack.back(), result)) {
+                    return error(std::format("RETURN needs a {} result", to_string(result)));
+                }
+            }
+            return code.size();
+        case CALL:
+        case TAIL_CALL: {
+            auto callee    = stack[stack.size() - popped];
+            auto signature = util::slot::signature(callee);
+            if (!signature.has_value() || !m_is_signature(signature.value())) {
+                return error(std::format("{} calls a {}", name, to_string(callee)));
+            }
+            auto const& called = m_bc.signatures()[signature.value()];
+            if (called.parameters.size() != popped - 1) {
+                return error(std::format("{} passes {} arguments to a function taking {}", name, popped - 1, called.parameters.size()));
+            }
+            for (std::size_t index {}; index < called.parameters.size(); index++) {
+                auto argument = stack[stack.size() - popped + 1 + index];
+                if (!m_is_assignable(argument, called.parameters[index])) {
+                    return error(std::format("{} passes {} as argument {} of type {}", name, to_string(argument), index, to_string(called.parameters[index])));
+                }
+            }
+            if (opcode == TAIL_CALL) {
+                if (!state.function.has_value()) {
+                    return error(std::string { "TAIL_CALL in the top level code" });
+                }
+                if (!m_is_assignable(called.result, m_signature(state).result)) {
+                    return error(std::format("TAIL_CALL returns {} from a function returning {}", to_string(called.result), to_string(m_signature(state).result)));
+                }
+                return code.size();
+            }
+            stack.resize(stack.size() - popped);
+            stack.push_back(called.result);
+        } break;
+        case NEW: {
+            auto klass = m_bc.read_value<uint16_t>(offset + 1);
+            if (klass >= m_bc.classes().size()) {
+                return error(std::format("NEW {} is beyond the {} classes", klass, m_bc.classes().size()));
+            }
+            stack.push_back(util::slot::instance(klass));
+        } break;
+        case GET_PROP:
+        case SET_PROP:
+        case INVOKE: {
+            auto object   = stack[stack.size() - popped];
+            auto klass    = util::slot::class_of(object);
+            auto property = m_bc.read_value<uint16_t>(offset + 1);
+            auto cache    = m_bc.read_value<uint16_t>(offset + (opcode == INVOKE ? 4 : 3));
+            if (!klass.has_value() || klass.value() >= m_bc.classes().size()) {
+                return error(std::format("{} is not defined for {}", name, to_string(object)));
+            }
+            if (property >= m_bc.names().size() || cache >= m_bc.caches()) {
+                return error(std::format("{} has property {} and cache {} beyond the {} names and {} caches", name, property, cache, m_bc.names().size(), m_bc.caches()));
+            }
+            auto const& property_name = m_bc.names()[property];
+            if (opcode == INVOKE) {
+                auto method = m_method(klass.value(), property);
+                if (!method.has_value()) {
+                    return error(std::format("INVOKE calls {} which class#{} has no method of", property_name, klass.value()));
+                }
+                // the method takes the instance's slot, which moves up one
+                if (stack.size() + 1 > limit) {
+                    return error(std::format("the stack grows beyond {} values", limit));
+                }
+                auto const& called = m_bc.signatures()[m_bc.functions()[method.value()].signature];
+                if (called.parameters.size() != popped) {
+                    return error(std::format("INVOKE passes {} arguments to {} taking {}", popped - 1, property_name, called.parameters.size() - 1));
+                }
+                for (std::size_t index {}; index < popped; index++) {
+                    auto argument = stack[stack.size() - popped + index];
+                    if (!m_is_assignable(argument, called.parameters[index])) {
+                        return error(std::format("INVOKE passes {} as argument {} of type {}", to_string(argument), index, to_string(called.parameters[index])));
+                    }
+                }
+                stack.resize(stack.size() - popped);
+                stack.push_back(called.result);
+                break;
+            }
+            auto field = m_field(klass.value(), property);
+            if (!field.has_value()) {
+                return error(std::format("{} accesses {} which class#{} has no field of", name, property_name, klass.value()));
+            }
+            if (opcode == GET_PROP) {
+                stack.back() = field.value();
+            } else if (!m_is_assignable(stack.back(), field.value())) {
+                return error(std::format("SET_PROP assigns {} to field {} holding {}", to_string(stack.back()), property_name, to_string(field.value())));
+            } else {
+                stack.erase(stack.end() - 2);   // the value takes the instance's place
+            }
+        } break;
+        case CLOSURE: {
+            auto index = m_bc.read_value<uint16_t>(offset + 1);
+            if (index >= m_bc.functions().size()) {
+                return error(std::format("CLOSURE {} is beyond the {} functions", index, m_bc.functions().size()));
+            }
+            auto const& function = m_bc.functions()[index];
+            if (function.entry >= code.size() || !m_is_signature(function.signature) || function.captures.empty()) {
+                return error(std::format("CLOSURE {} has no valid entry, signature or captures", index));
+            }
+            for (std::size_t capture {}; capture < popped; capture++) {
+                auto type = stack[stack.size() - popped + capture];
+                if (type != function.captures[capture]) {
+                    return error(std::format("CLOSURE captures {} as capture {} of type {}", to_string(type), capture, to_string(function.captures[capture])));
+                }
+            }
+            stack.resize(stack.size() - popped);
+            stack.push_back(util::slot::function(function.signature));
+        } break;
+        case GET_CALLEE:
+            if (!state.function.has_value()) {
+                return error(std::string { "GET_CALLEE in the top level code" });
+            }
+            stack.push_back(util::slot::function(m_bc.functions()[state.function.value()].signature));
+            break;
+        case GET_CAPTURE:
+        case GET_BOXED_CAPTURE:
+        case SET_BOXED_CAPTURE: {
+            // only closures have captures, and only `CLOSURE` makes values of functions that have them
+            auto capture = code[offset + 1];
+            if (!state.function.has_value() || capture >= m_bc.functions()[state.function.value()].captures.size()) {
+                return error(std::format("{} {} is beyond the running function's captures", name, capture));
+            }
+            auto type  = m_bc.functions()[state.function.value()].captures[capture];
+            auto value = util::slot::unboxed(type);
+            if (opcode == GET_CAPTURE) {
+                stack.push_back(type);
+            } else if (!value.has_value()) {
+                return error(std::format("{} {} is no box but {}", name, capture, to_string(type)));
+            } else if (opcode == GET_BOXED_CAPTURE) {
+                stack.push_back(value.value());
+            } else if (value.value() != stack.back()) {
+                return error(std::format("SET_BOXED_CAPTURE assigns {} to capture {} holding {}", to_string(stack.back()), capture, to_string(value.value())));
+            }
+        } break;
+        case LOG:
+            if (constant.value_or(stack.back()) >= SlotType::FUNCTION) {
+                return error(std::format("LOG is not defined for {}", to_string(constant.value_or(stack.back()))));
+            }
+            if (!constant.has_value()) {
+                stack.pop_back();
+            }
+            break;
+        case ADD:
+        case SUB:
+        case MUL:
+        case DIV:
+        case MOD:
+        case CMP:
+        case CMPE: {
+            auto rhs = constant.value_or(stack.back());
+            if (!constant.has_value()) {
+                stack.pop_back();
+            }
+            auto lhs    = stack.back();
+            auto result = binary_result(util::opcode::unfused(opcode), lhs, rhs);
+            if (!result.has_value()) {
+                return error(std::format("{} is not defined for {} and {}", name, to_string(lhs), to_string(rhs)));
+            }
+            stack.back() = result.value();
+        } break;
+        case NEGATE:
+            if (stack.back() == SlotType::BOOL || stack.back() == SlotType::STRING || stack.back() >= SlotType::FUNCTION) {
+                return error(std::format("NEGATE is not defined for {}", to_string(stack.back())));
+            }
+            break;
+        case NOT:
+            if (stack.back() >= SlotType::FUNCTION) {
+                return error(std::format("NOT is not defined for {}", to_string(stack.back())));
+            }
+            stack.back() = SlotType::BOOL;
+            break;
+        case NEW_ARRAY:
+        case FILL_ARRAY: {
+            if (code[offset + 1] > std::to_underlying(TypeIndex::FLOAT64)) {
+                return error(std::format("{} has no valid element type", name));
+            }
+            auto element = static_cast<TypeIndex>(code[offset + 1]);
+            auto value   = element_slot(element);
+            if (opcode == NEW_ARRAY) {
+                // dispatch loops caching the top of stack rely on it consuming a value
+                if (popped == 0) {
+                    return error(std::format("NEW_ARRAY makes an empty [{}], only FILL_ARRAY does", util::type::to_string(element)));
+                }
+                for (std::size_t index {}; index < popped; index++) {
+                    if (auto type = stack[stack.size() - popped + index]; type != value) {
+                        return error(std::format("NEW_ARRAY makes a [{}] of a {}", util::type::to_string(element), to_string(type)));
+                    }
+                }
+            } else if (stack[stack.size() - 2] != value || !is_integer(stack.back())) {
+                return error(std::format("FILL_ARRAY fills a [{}] with {} {} times", util::type::to_string(element), to_string(stack[stack.size() - 2]), to_string(stack.back())));
+            }
+            stack.resize(stack.size() - popped);
+            stack.push_back(util::slot::array(element));
+        } break;
+        case GET_INDEX:
+        case SET_INDEX: {
+            auto array   = stack[stack.size() - popped];
+            auto index   = stack[stack.size() - popped + 1];
+            auto element = array_element(array);
+            if (!element.has_value() || !is_integer(index)) {
+                return error(std::format("{} indexes {} with {}", name, to_string(array), to_string(index)));
+            }
+            auto value = element_slot(element.value());
+            if (opcode == SET_INDEX && stack.back() != value) {
+                return error(std::format("SET_INDEX stores {} into {}", to_string(stack.back()), to_string(array)));
+            }
+            stack.resize(stack.size() - popped);
+            stack.push_back(value);
+        } break;
+        case ELEMENTWISE: {
+            auto op = code[offset + 1];
+            if (op > std::to_underlying(ArrayOp::NE)) {
+                return error(std::format("ELEMENTWISE {} is no element-wise operation", op));
+            }
+            auto rhs = stack.back();
+            stack.pop_back();
+            auto lhs     = stack.back();
+            auto element = array_element(lhs);
+            // bools neither compute nor compare element by element
+            if (lhs != rhs || !element.has_value() || element.value() == TypeIndex::BOOL) {
+                return error(std::format("ELEMENTWISE {} is not defined for {} and {}", util::type::to_string(static_cast<ArrayOp>(op)), to_string(lhs), to_string(rhs)));
+            }
+            if (op >= std::to_underlying(ArrayOp::LT)) {
+                stack.back() = util::slot::array(TypeIndex::BOOL);
+            }
+        } break;
+        case REDUCE: {
+            auto op      = code[offset + 1];
+            auto element = array_element(stack.back());
+            if (op < std::to_underlying(ArrayOp::SUM) || op > std::to_underlying(ArrayOp::MAX)) {
+                return error(std::format("REDUCE {} is no reduction", op));
+            }
+            if (!element.has_value() || element.value() == TypeIndex::BOOL) {
+                return error(std::format("REDUCE {} is not defined for {}", util::type::to_string(static_cast<ArrayOp>(op)), to_string(stack.back())));
+            }
+            stack.back() = element_slot(element.value());
+        } break;
+        case LENGTH:
+            if (!array_element(stack.back()).has_value()) {
+                return error(std::format("LENGTH is not defined for {}", to_string(stack.back())));
+            }
+            stack.back() = SlotType::INT;
+            break;
+        case PICK: stack.push_back(stack[stack.size() - popped]); break;
+        case POP: stack.resize(stack.size() - popped); break;
+        case GET_LOCAL: stack.push_back(stack[code[offset + 1]]); break;
+        case SET_LOCAL:
+            if (stack[code[offset + 1]] != stack.back()) {
+                return error(std::format("SET_LOCAL assigns {} to slot {} holding {}", to_string(stack.back()), code[offset + 1], to_string(stack[code[offset + 1]])));
+            }
+            break;
+        case BOX: {
+            auto& slot = stack[code[offset + 1]];
+            if (util::slot::unboxed(slot).has_value()) {
+                return error(std::format("BOX boxes slot {} twice", code[offset + 1]));
+            }
+            slot = util::slot::boxed(slot);
+        } break;
+        case GET_BOXED:
+        case SET_BOXED: {
+            auto slot  = stack[code[offset + 1]];
+            auto value = util::slot::unboxed(slot);
+            if (!value.has_value()) {
+                return error(std::format("{} reads slot {} holding {}", name, code[offset + 1], to_string(slot)));
+            }
+            if (opcode == GET_BOXED) {
+                stack.push_back(value.value());
+            } else if (value.value() != stack.back()) {
+                return error(std::format("SET_BOXED assigns {} to slot {} holding {}", to_string(stack.back()), code[offset + 1], to_string(slot)));
+            }
+        } break;
+        case GET_GLOBAL:
+        case SET_GLOBAL: {
+            auto index = m_bc.read_value<uint16_t>(offset + 1);
+            if (index >= state.globals.size()) {
+                return error(std::format("{} {} is beyond the {} globals", name, index, state.globals.size()));
+            }
+            auto& global = state.globals[index];
+            if (opcode == GET_GLOBAL) {
+                if (!global.has_value()) {
+                    return error(std::format("GET_GLOBAL {} reads the global before it is set", index));
+                }
+                stack.push_back(global.value());
+            } else if (global.has_value() && global.value() != stack.back()) {
+                return error(std::format("SET_GLOBAL assigns {} to global {} holding {}", to_string(stack.back()), index, to_string(global.value())));
+            } else {
+                global = stack.back();
+            }
+        } break;
+        case SHL:
+            if (code[offset + 1] >= 64) {
+                return error(std::format("SHL by {} bits", code[offset + 1]));
+            }
+            [[fallthrough]];
+        case DIVP2:
+        case MODP2:
+        case DIVM:
+        case MODM:
+            if (!is_integer(stack.back())) {
+                return error(std::format("{} is not defined for {}", name, to_string(stack.back())));
+            }
+            break;
+        case JUMP_IF_FALSE:
+        case JUMP_IF_FALSE_OR_POP:
+        case JUMP_IF_TRUE_OR_POP:
+            if (stack.back() != SlotType::BOOL) {
+                return error(std::format("{} tests a {} condition", name, to_string(stack.back())));
+            }
+            stack.pop_back();
+            break;
+        case JLT:
+        case JLE:
+        case JGT:
+        case JGE:
+        case JEQ:
+        case JNE: {
+            auto rhs = stack.back();
+            stack.pop_back();
+            auto lhs = stack.back();
+            stack.pop_back();
+            auto relation = opcode == JEQ || opcode == JNE ? CMPE : CMP;
+            if (!binary_result(relation, lhs, rhs).has_value()) {
+                return error(std::format("{} is not defined for {} and {}", name, to_string(lhs), to_string(rhs)));
+            }
+        } break;
+        default: return error(std::format("{} is not a stack vm opcode", name));
+    }
+
+    if (stack.size() > limit) {
+        return error(std::format("the stack grows beyond {} values", limit));
+    }
+    return next;
+}
+
+auto Verifier::m_constant(std::size_t offset) const -> std::expected<SlotType, std::string>
+{
+    switch (util::type::get_type(m_bc.code()[offset + 1])) {
+        using enum TypeIndex;
+        case BOOL:
+            // any other byte is not a valid object representation of `bool`
+            if (m_bc.code()[offset + 2] > 1) {
+                return std::unexpected(std::format("bool constant holds byte {}", m_bc.code()[offset + 2]));
+            }
+            return SlotType::BOOL;
+        case INT8:
+        case INT16:
+        case INT32:
+        case INT64: return SlotType::INT;
+        case UINT8:
+        case UINT16:
+        case UINT32:
+        case UINT64: return SlotType::UINT;
+        case FLOAT32:
+        case FLOAT64: return SlotType::FLOAT;
+        case STRING:
+            if (!m_strings.contains(m_bc.read_value<std::array<uint8_t, sizeof(StringPtr)>>(offset + 2))) {
+                return std::unexpected(std::string { "string constant does not point into the string pool" });
+            }
+            return SlotType::STRING;
+        case FUNCTION: {
+            auto index = m_bc.read_value<uint16_t>(offset + 2);
+            if (index >= m_bc.functions().size()) {
+                return std::unexpected(std::format("function constant {} is beyond the {} functions", index, m_bc.functions().size()));
+            }
+            auto const& function = m_bc.functions()[index];
+            if (function.entry >= m_bc.code().size() || !m_is_signature(function.signature)) {
+                return std::unexpected(std::format("function {} has no valid entry or signature", index));
+            }
+            if (!function.captures.empty()) {
+                return std::unexpected(std::format("function {} has captures, only CLOSURE makes it", index));
+            }
+            return util::slot::function(function.signature);
+        }
+        case INSTANCE:
+        case ARRAY: break;
+    }
+    return std::unexpected(std::string { "constant has no valid type" });
+}
+
+auto Verifier::m_is_signature(std::size_t signature) const -> bool
+{
+    auto const& signatures = m_bc.signatures();
+    if (signature >= signatures.size()) {
+        return false;
+    }
+    auto is_type = [&](SlotType type) {
+        auto value  = util::slot::unboxed(type).value_or(type);
+        auto nested = util::slot::signature(value);
+        auto klass  = util::slot::class_of(value);
+        return (!nested.has_value() || nested.value() < signatures.size()) && (!klass.has_value() || klass.value() < m_bc.classes().size())
+            && (!util::slot::element(value).has_value() || array_element(value).has_value());
+    };
+    return std::ranges::all_of(signatures[signature].parameters, is_type) && is_type(signatures[signature].result);
+}
+
+auto Verifier::m_signature(TypeState const& state) const -> Signature const&
+{
+    return m_bc.signatures()[m_bc.functions()[state.function.value()].signature];
+}
+
+auto Verifier::m_check_classes() const -> std::optional<BytecodeError>
+{
+    auto const& classes = m_bc.classes();
+    auto error          = [](std::string message) { return BytecodeError { 0, std::move(message) }; };
+    for (std::size_t klass {}; klass < classes.size(); klass++) {
+        auto const& info = classes[klass];
+        // the chain ends, and every lookup below walks only checked classes
+        if (info.superclass.has_value() && info.superclass.value() >= klass) {
+            return error(std::format("class {} extends class#{}, which is not declared before it", info.name, info.superclass.value()));
+        }
+        for (auto [name, type] : info.fields) {
+            auto value = util::slot::class_of(type);
+            if (name >= m_bc.names().size() || (util::slot::signature(type).has_value() && !m_is_signature(util::slot::signature(type).value()))
+                || (value.has_value() && value.value() >= classes.size()) || util::slot::unboxed(type).has_value()
+                || (util::slot::element(type).has_value() && !array_element(type).has_value())) {
+                return error(std::format("class {} has a field without a valid name or type", info.name));
+            }
+            if (info.superclass.has_value() && (m_field(info.superclass.value(), name).has_value() || m_method(info.superclass.value(), name).has_value())) {
+                return error(std::format("class {} redeclares {}", info.name, m_bc.names()[name]));
+            }
+        }
+        for (auto [name, function] : info.methods) {
+            if (name >= m_bc.names().size() || function >= m_bc.functions().size()) {
+                return error(std::format("class {} has a method without a valid name or function", info.name));
+            }
+            auto const& method = m_bc.functions()[function];
+            if (!method.captures.empty() || !m_is_signature(method.signature)) {
+                return error(std::format("method {} of class {} has captures or no valid signature", m_bc.names()[name], info.name));
+            }
+            // `INVOKE` passes the instance first
+            auto const& signature = m_bc.signatures()[method.signature];
+            if (signature.parameters.empty() || signature.parameters.front() != util::slot::instance(klass)) {
+                return error(std::format("method {} of class {} does not take its instance first", m_bc.names()[name], info.name));
+            }
+            if (std::ranges::any_of(info.fields, [name](auto field) { return field.first == name; })
+                || (info.superclass.has_value() && m_field(info.superclass.value(), name).has_value())) {
+                return error(std::format("class {} has a field and a method {}", info.name, m_bc.names()[name]));
+            }
+            // an override runs wherever the method it overrides would, taking the same arguments and returning one of its result
+            auto overridden = info.superclass.has_value() ? m_method(info.superclass.value(), name) : std::nullopt;
+            if (!overridden.has_value()) {
+                continue;
+            }
+            auto const& base = m_bc.signatures()[m_bc.functions()[overridden.value()].signature];
+            if (base.parameters.size() != signature.parameters.size()
+                || !std::ranges::equal(base.parameters | std::views::drop(1), signature.parameters | std::views::drop(1))
+                || !m_is_assignable(signature.result, base.result)) {
+                return error(std::format("method {} of class {} overrides one with an incompatible signature", m_bc.names()[name], info.name));
+            }
+        }
+    }
+    return {};
+}
+
+auto Verifier::m_is_assignable(SlotType from, SlotType to) const -> bool
+{
+    if (from == to) {
+        return true;
+    }
+    auto klass = util::slot::class_of(from);
+    auto other = util::slot::class_of(to);
+    if (!klass.has_value() || !other.has_value()) {
+        return false;
+    }
+    for (std::optional<std::size_t> ancestor = klass; ancestor.has_value() && ancestor.value() < m_bc.classes().size();
+         ancestor = m_bc.classes()[ancestor.value()].superclass) {
+        if (ancestor == other) {
+            return true;
+        }
+    }
+    return false;
+}
+
+auto Verifier::m_field(std::size_t klass, uint16_t name) const -> std::optional<SlotType>
+{
+    for (std::optional<std::size_t> ancestor = klass; ancestor.has_value(); ancestor = m_bc.classes()[ancestor.value()].superclass) {
+        for (auto [field, type] : m_bc.classes()[ancestor.value()].fields) {
+            if (field == name) {
+                return type;
+            }
+        }
+    }
+    return {};
+}
+
+auto Verifier::m_method(std::size_t klass, uint16_t name) const -> std::optional<uint16_t>
+{
+    for (std::optional<std::size_t> ancestor = klass; ancestor.has_value(); ancestor = m_bc.classes()[ancestor.value()].superclass) {
+        for (auto [method, function] : m_bc.classes()[ancestor.value()].methods) {
+            if (method == name) {
+                return function;
+            }
+        }
+    }
+    return {};
+}
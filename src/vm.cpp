@@ -1,266 +1,1151 @@
-#include <cmath>
-#include <print>
-#ifndef NDEBUG
-#include <iostream>
-#else
+#include <algorithm>
+#include <concepts>
+#include <format>
+#include <limits>
 #include <utility>
-#endif
 
 #include "vm.hpp"
-#include "common.hpp"
+#include "vm_ops.hpp"
 #include "instr.hpp"
+#include "simd.hpp"
 #include "types.hpp"
+#ifdef CPPLOX_INSTRUMENT_VM
+#include "opcode_profile.hpp"
+#endif
 
-template <typename T>
-concept Arithmetic = std::integral<T> || std::floating_point<T>;
+#ifdef CPPLOX_INSTRUMENT_VM
+namespace {
+// aggregates every vm run of the process and reports when the process exits
+OpcodeProfile opcode_profile;
+}
+#endif
 
 void VM::execute()
 {
+#ifdef CPPLOX_INSTRUMENT_VM
+    // the profiler probes sit in `execute_next`, keep every opcode going through it
+    opcode_profile.start();
     for (; !m_is_end();) {
         execute_next();
     }
+#else
+    m_run<false>(nullptr);
+#endif
 }
 
-void VM::execute_next()
+void VM::execute(Stats& stats)
 {
-    auto offset = std::next(m_bc.code().begin(), m_iptr);
-    switch (static_cast<Opcode>(*offset)) {
-        case Opcode::LOG: {
-            auto val1 = m_stack.pop();
-            std::visit(util::Visitor {
-                           []<typename T>(T val) {
-                               std::println("{}", val);
-                           },
-                           [](std::unordered_set<std::string>::const_iterator val) {
-                               std::println("{}", *val);
-                           },
-                       },
-                       val1);
-            m_iptr++;
-        } break;
-        case Opcode::RETURN:
-            std::exit(0);
-            break;
-        case Opcode::LOAD: {
-            auto load_func = [this, &offset]<typename T>(T) {
-                T value = *std::bit_cast<T*>(&offset[2]);
-                if constexpr (std::is_unsigned_v<T>) {
-                    m_stack.push(static_cast<uint64_t>(value));
+#ifdef CPPLOX_INSTRUMENT_VM
+    opcode_profile.start();
+    for (; !m_is_end();) {
+        execute_next();
+        stats.instructions++;
+        stats.peak_stack_depth = std::max(stats.peak_stack_depth, m_stack.size());
+    }
+#else
+    m_run<true>(&stats);
+#endif
+    stats.minor_collections = m_heap.minor_collections();
+    stats.major_collections = m_heap.major_collections();
+    stats.gc_pauses         = m_heap.pauses().count();
+    stats.gc_pause_p99      = m_heap.pauses().percentile(0.99);
+    stats.gc_pause_max      = m_heap.pauses().max();
+}
+
+/**
+ * Dispatch loop caching the top of stack in a local.
+ *
+ * The loop is a two state machine: in `empty` every value lives in
+ * `m_stack`, in `cached` the top of stack lives in `tos`, which the
+ * compiler keeps in registers. Loads and operators move between the
+ * states, so a binary opcode in the cached state only reads its left
+ * operand from memory and writes nothing back.
+ *
+ * Neither loop checks for the end of the code, verified code always
+ * reaches `RETURN` in the top level code first. A call that would
+ * overflow the stack or an integer division that would trap halts
+ * instead, leaving the reason in `error()`.
+ */
+template <bool counted>
+void VM::m_run([[maybe_unused]] Stats* stats)
+{
+    util::vm::Value tos {};
+    auto target = [this] { return static_cast<std::size_t>(util::opcode::jump_target(m_bc, m_iptr)); };
+    auto count  = [stats]([[maybe_unused]] std::size_t depth) {
+        if constexpr (counted) {
+            stats->instructions++;
+            stats->peak_stack_depth = std::max(stats->peak_stack_depth, depth);
+        }
+    };
+
+empty:
+    for (;;) {
+        m_sampled_iptr.store(m_iptr, std::memory_order_relaxed);
+        switch (static_cast<Opcode>(m_bc.code()[m_iptr])) {
+            case Opcode::LOAD:
+                tos = m_load();
+                count(m_stack.size() + 1);
+                goto cached;
+            case Opcode::RETURN:
+                if (m_frame_count > 0) {
+                    tos = m_stack.pop();   // the result
+                    goto cached;
+                }
+                count(m_stack.size());
+                m_iptr = m_bc.code().size();
+                return;
+            case Opcode::LOGK:
+                util::vm::log(m_load());
+                count(m_stack.size());
+                break;
+            case Opcode::GET_LOCAL:
+                tos = m_stack.get(m_base + m_bc.code()[m_iptr + 1]);
+                m_iptr += 2;
+                count(m_stack.size() + 1);
+                goto cached;
+            case Opcode::GET_GLOBAL:
+                tos = m_globals[m_bc.read_value<uint16_t>(m_iptr + 1)];
+                m_iptr += 3;
+                count(m_stack.size() + 1);
+                goto cached;
+            case Opcode::POP:
+                m_stack.drop(m_bc.code()[m_iptr + 1]);
+                m_iptr += 2;
+                count(m_stack.size());
+                break;
+            case Opcode::JUMP:
+                m_iptr = target();
+                count(m_stack.size());
+                break;
+            case Opcode::NEW:
+                tos = m_new(m_bc.read_value<uint16_t>(m_iptr + 1));
+                m_safepoint({ &tos, 1 });
+                m_iptr += 3;
+                count(m_stack.size() + 1);
+                goto cached;
+            default:
+                // every other opcode consumes the top of stack or pushes above the running frame's callee, which
+                // leaves something to cache either way, cache it and dispatch the same instruction again
+                tos = m_stack.pop();
+                goto cached;
+        }
+    }
+
+cached:
+    for (;;) {
+        m_sampled_iptr.store(m_iptr, std::memory_order_relaxed);
+        auto opcode = static_cast<Opcode>(m_bc.code()[m_iptr]);
+        switch (opcode) {
+            case Opcode::LOG:
+                util::vm::log(tos);
+                m_iptr++;
+                count(m_stack.size());
+                goto empty;
+            case Opcode::RETURN:
+                if (m_frame_count > 0) {
+                    m_return();   // `tos` is the result, which takes the place of the callee
+                    count(m_stack.size() + 1);
+                    break;
+                }
+                m_stack.push(tos);
+                count(m_stack.size());
+                m_iptr = m_bc.code().size();   // halt, handing control back to whoever called `execute`
+                return;
+            case Opcode::CALL:
+                m_stack.push(tos);
+                if (!m_call(m_bc.code()[m_iptr + 1], m_iptr + 2)) {
+                    return;
+                }
+                count(m_stack.size());
+                goto empty;
+            case Opcode::INVOKE:
+                m_stack.push(tos);
+                if (!m_invoke()) {
+                    return;
+                }
+                count(m_stack.size());
+                goto empty;
+            case Opcode::TAIL_CALL:
+                m_stack.push(tos);
+                m_tail_call(m_bc.code()[m_iptr + 1]);
+                count(m_stack.size());
+                goto empty;
+            case Opcode::GET_CALLEE:
+                // pushed first, the callee below the frame may be the value `tos` held
+                m_stack.push(tos);
+                tos = m_stack.get(m_base - 1);
+                m_iptr++;
+                count(m_stack.size() + 1);
+                break;
+            case Opcode::CLOSURE:
+                m_stack.push(tos);
+                tos = m_make_closure(m_bc.read_value<uint16_t>(m_iptr + 1));
+                m_safepoint({ &tos, 1 });
+                m_iptr += 3;
+                count(m_stack.size() + 1);
+                break;
+            case Opcode::GET_CAPTURE:
+                m_stack.push(tos);
+                tos = m_closure().captures[m_bc.code()[m_iptr + 1]];
+                m_iptr += 2;
+                count(m_stack.size() + 1);
+                break;
+            case Opcode::GET_BOXED_CAPTURE:
+                m_stack.push(tos);
+                tos = std::get<Box*>(m_closure().captures[m_bc.code()[m_iptr + 1]])->value;
+                m_iptr += 2;
+                count(m_stack.size() + 1);
+                break;
+            case Opcode::SET_BOXED_CAPTURE: {
+                auto* box  = std::get<Box*>(m_closure().captures[m_bc.code()[m_iptr + 1]]);
+                box->value = tos;
+                m_heap.write(*box);
+                m_iptr += 2;
+                count(m_stack.size() + 1);
+            } break;
+            case Opcode::BOX: {
+                // the local may be `tos` itself, right after its initializer
+                std::size_t slot = m_base + m_bc.code()[m_iptr + 1];
+                if (slot == m_stack.size()) {
+                    tos = m_box(tos);
                 } else {
-                    m_stack.push(value);
+                    m_stack.set(slot, m_box(m_stack.get(slot)));
+                }
+                m_safepoint({ &tos, 1 });
+                m_iptr += 2;
+                count(m_stack.size() + 1);
+            } break;
+            case Opcode::GET_BOXED: {
+                std::size_t slot = m_base + m_bc.code()[m_iptr + 1];
+                auto value       = std::get<Box*>(slot == m_stack.size() ? tos : m_stack.get(slot))->value;
+                m_stack.push(tos);
+                tos = value;
+                m_iptr += 2;
+                count(m_stack.size() + 1);
+            } break;
+            case Opcode::SET_BOXED: {
+                // the assigned value sits above the slot, which is never `tos`
+                auto* box  = std::get<Box*>(m_stack.get(m_base + m_bc.code()[m_iptr + 1]));
+                box->value = tos;
+                m_heap.write(*box);
+                m_iptr += 2;
+                count(m_stack.size() + 1);
+            } break;
+            case Opcode::LOAD:
+                m_stack.push(tos);
+                tos = m_load();
+                count(m_stack.size() + 1);
+                break;
+            case Opcode::NEW:
+                m_stack.push(tos);
+                tos = m_new(m_bc.read_value<uint16_t>(m_iptr + 1));
+                m_safepoint({ &tos, 1 });
+                m_iptr += 3;
+                count(m_stack.size() + 1);
+                break;
+            case Opcode::GET_PROP: {
+                auto value = m_get_property(*std::get<Instance*>(tos));
+                if (!value.has_value()) {
+                    return;
+                }
+                tos = value.value();
+                m_iptr += 5;
+                count(m_stack.size() + 1);
+            } break;
+            case Opcode::SET_PROP:
+                // the instance is replaced by the assigned value, which stays in `tos`
+                m_set_property(*std::get<Instance*>(m_stack.pop()), tos);
+                m_iptr += 5;
+                count(m_stack.size() + 1);
+                break;
+            case Opcode::NEW_ARRAY: {
+                auto elements = m_bc.read_value<uint16_t>(m_iptr + 2);
+                m_stack.push(tos);
+                tos = m_new_array(static_cast<TypeIndex>(m_bc.code()[m_iptr + 1]), elements);
+                m_safepoint({ &tos, 1 });
+                m_iptr += 4;
+                count(m_stack.size() + 1);
+            } break;
+            case Opcode::FILL_ARRAY: {
+                auto array = m_fill_array(static_cast<TypeIndex>(m_bc.code()[m_iptr + 1]), m_stack.pop(), tos);
+                if (!array.has_value()) {
+                    return;
+                }
+                tos = array.value();
+                m_safepoint({ &tos, 1 });
+                m_iptr += 2;
+                count(m_stack.size() + 1);
+            } break;
+            case Opcode::GET_INDEX: {
+                auto& array   = *std::get<Array*>(m_stack.pop());
+                auto* element = m_element(array, tos);
+                if (element == nullptr) {
+                    return;
+                }
+                tos = util::vm::load_element(array.element, element);
+                m_iptr++;
+                count(m_stack.size() + 1);
+            } break;
+            case Opcode::SET_INDEX: {
+                // the array and the index are replaced by the assigned value, which stays in `tos`
+                auto index    = m_stack.pop();
+                auto& array   = *std::get<Array*>(m_stack.pop());
+                auto* element = m_element(array, index);
+                if (element == nullptr) {
+                    return;
                 }
-                m_iptr += 2 + sizeof(T);
-            };
-            switch (static_cast<TypeIndex>(offset[1])) {
-                using enum TypeIndex;
-                case BOOL: load_func(bool {}); break;
-                case INT8: load_func(int8_t {}); break;
-                case INT16: load_func(int16_t {}); break;
-                case INT32: load_func(int32_t {}); break;
-                case INT64: load_func(int64_t {}); break;
-                case UINT8: load_func(uint8_t {}); break;
-                case UINT16: load_func(uint16_t {}); break;
-                case UINT32: load_func(uint32_t {}); break;
-                case UINT64: load_func(uint64_t {}); break;
-                case FLOAT32: load_func(float {}); break;
-                case FLOAT64: load_func(double {}); break;
-                case STRING: load_func(std::unordered_set<std::string>::const_iterator {}); break;
+                util::vm::store_element(array.element, element, tos);
+                m_iptr++;
+                count(m_stack.size() + 1);
+            } break;
+            case Opcode::ELEMENTWISE: {
+                auto result = m_elementwise(static_cast<ArrayOp>(m_bc.code()[m_iptr + 1]), *std::get<Array*>(m_stack.pop()), *std::get<Array*>(tos));
+                if (!result.has_value()) {
+                    return;
+                }
+                tos = result.value();
+                m_safepoint({ &tos, 1 });
+                m_iptr += 2;
+                count(m_stack.size() + 1);
+            } break;
+            case Opcode::REDUCE: {
+                auto result = m_reduce(static_cast<ArrayOp>(m_bc.code()[m_iptr + 1]), *std::get<Array*>(tos));
+                if (!result.has_value()) {
+                    return;
+                }
+                tos = result.value();
+                m_iptr += 2;
+                count(m_stack.size() + 1);
+            } break;
+            case Opcode::LENGTH:
+                tos = static_cast<int64_t>(std::get<Array*>(tos)->length);
+                m_iptr++;
+                count(m_stack.size() + 1);
+                break;
+            case Opcode::ADD:
+            case Opcode::SUB:
+            case Opcode::MUL:
+            case Opcode::CMP:
+            case Opcode::CMPE:
+                tos = m_binary(opcode, m_stack.pop(), tos);
+                m_safepoint({ &tos, 1 });
+                m_iptr++;
+                count(m_stack.size() + 1);
+                break;
+            case Opcode::DIV:
+            case Opcode::MOD: {
+                auto result = m_divide(opcode, m_stack.pop(), tos);
+                if (!result.has_value()) {
+                    return;
+                }
+                tos = result.value();
+                m_iptr++;
+                count(m_stack.size() + 1);
+            } break;
+            case Opcode::NEGATE:
+                tos = util::vm::negate(tos);
+                m_iptr++;
+                count(m_stack.size() + 1);
+                break;
+            case Opcode::NOT:
+                tos = util::vm::logical_not(tos);
+                m_iptr++;
+                count(m_stack.size() + 1);
+                break;
+            case Opcode::SHL:
+            case Opcode::DIVP2:
+            case Opcode::MODP2:
+            case Opcode::DIVM:
+            case Opcode::MODM:
+                tos = util::vm::strength_reduced(opcode, tos, m_bc, m_iptr);
+                m_iptr += util::opcode::length(m_bc, m_iptr);
+                count(m_stack.size() + 1);
+                break;
+            case Opcode::PICK: {
+                // depth counts `tos` as slot 0
+                auto depth = m_bc.code()[m_iptr + 1];
+                auto value = depth == 0 ? tos : m_stack.peek(depth - 1);
+                m_stack.push(tos);
+                tos = value;
+                m_iptr += 2;
+                count(m_stack.size() + 1);
+            } break;
+            case Opcode::POP: {
+                // `tos` is the first value dropped
+                auto dropped = m_bc.code()[m_iptr + 1];
+                m_iptr += 2;
+                if (dropped == 0) {
+                    count(m_stack.size() + 1);
+                    break;
+                }
+                m_stack.drop(dropped - 1);
+                count(m_stack.size());
+                goto empty;
             }
-        } break;
-        case Opcode::ADD: {
-            auto val2 = m_stack.pop();
-            auto val1 = m_stack.pop();
-            std::visit(util::Visitor {
-                           [this]<Arithmetic T>(T v1, T v2) {
-                               m_stack.push(v1 + v2);
-                           },
-                           [this](std::unordered_set<std::string>::const_iterator v1, std::unordered_set<std::string>::const_iterator v2) {
-                               m_stack.push(m_pool.emplace(*v1 + *v2).first);
-                           },
-                           [this]<typename T>(std::unordered_set<std::string>::const_iterator v1, T v2) {
-                               m_stack.push(m_pool.emplace(*v1 + std::format("{}", v2)).first);
-                           },
-                           [this]<typename T>(T v1, std::unordered_set<std::string>::const_iterator v2) {
-                               m_stack.push(m_pool.emplace(std::format("{}", v1) + *v2).first);
-                           },
-                           [this]<typename T1, typename T2>(T1, T2) {
+            case Opcode::GET_LOCAL: {
+                // the topmost slot is `tos` itself
+                std::size_t slot = m_base + m_bc.code()[m_iptr + 1];
+                auto value       = slot == m_stack.size() ? tos : m_stack.get(slot);
+                m_stack.push(tos);
+                tos = value;
+                m_iptr += 2;
+                count(m_stack.size() + 1);
+            } break;
+            case Opcode::SET_LOCAL:
+                // the assigned value sits above the slot, which is never `tos`
+                m_stack.set(m_base + m_bc.code()[m_iptr + 1], tos);
+                m_iptr += 2;
+                count(m_stack.size() + 1);
+                break;
+            case Opcode::GET_GLOBAL:
+                m_stack.push(tos);
+                tos = m_globals[m_bc.read_value<uint16_t>(m_iptr + 1)];
+                m_iptr += 3;
+                count(m_stack.size() + 1);
+                break;
+            case Opcode::SET_GLOBAL:
+                m_globals[m_bc.read_value<uint16_t>(m_iptr + 1)] = tos;
+                m_iptr += 3;
+                count(m_stack.size() + 1);
+                break;
+            case Opcode::JUMP:
+                m_iptr = target();
+                count(m_stack.size() + 1);
+                break;
+            case Opcode::JUMP_IF_FALSE:
+                m_iptr = std::get<bool>(tos) ? m_iptr + 3 : target();
+                count(m_stack.size());
+                goto empty;
+            case Opcode::JUMP_IF_FALSE_OR_POP:
+            case Opcode::JUMP_IF_TRUE_OR_POP:
+                // a condition which decides the result stays on the stack as the result
+                if (std::get<bool>(tos) == (opcode == Opcode::JUMP_IF_TRUE_OR_POP)) {
+                    m_iptr = target();
+                    count(m_stack.size() + 1);
+                    break;
+                }
+                m_iptr += 3;
+                count(m_stack.size());
+                goto empty;
+            case Opcode::JLT:
+            case Opcode::JLE:
+            case Opcode::JGT:
+            case Opcode::JGE:
+            case Opcode::JEQ:
+            case Opcode::JNE:
+                m_iptr = util::vm::compare_jump(opcode, m_stack.pop(), tos) ? target() : m_iptr + 3;
+                count(m_stack.size());
+                goto empty;
+            case Opcode::ADDK:
+            case Opcode::SUBK:
+            case Opcode::MULK:
+            case Opcode::CMPK:
+            case Opcode::CMPEK:
+                tos = m_binary(util::opcode::unfused(opcode), tos, m_load());
+                m_safepoint({ &tos, 1 });
+                count(m_stack.size() + 1);
+                break;
+            case Opcode::DIVK:
+            case Opcode::MODK: {
+                // a failing division halts at its own offset, not at the next instruction `m_load` steps to
+                auto start   = m_iptr;
+                auto divisor = m_load();
+                auto next    = std::exchange(m_iptr, start);
+                auto result  = m_divide(util::opcode::unfused(opcode), tos, divisor);
+                if (!result.has_value()) {
+                    return;
+                }
+                tos    = result.value();
+                m_iptr = next;
+                count(m_stack.size() + 1);
+            } break;
+            case Opcode::LOGK:
+                util::vm::log(m_load());
+                count(m_stack.size() + 1);
+                break;
+        }
+    }
+}
+
+auto VM::m_load() -> Stack::value_type
+{
+    auto load_func = [this]<typename T>(T) {
+        auto value = util::vm::widen(m_bc.read_value<T>(m_iptr + 2));
+        m_iptr += 2 + sizeof(T);
+        return value;
+    };
+    switch (util::type::get_type(m_bc.code()[m_iptr + 1])) {
+        using enum TypeIndex;
+        case BOOL: return load_func(bool {});
+        case INT8: return load_func(int8_t {});
+        case INT16: return load_func(int16_t {});
+        case INT32: return load_func(int32_t {});
+        case INT64: return load_func(int64_t {});
+        case UINT8: return load_func(uint8_t {});
+        case UINT16: return load_func(uint16_t {});
+        case UINT32: return load_func(uint32_t {});
+        case UINT64: return load_func(uint64_t {});
+        case FLOAT32: return load_func(float {});
+        case FLOAT64: return load_func(double {});
+        case STRING: return load_func(StringPtr {});
+        case FUNCTION: return load_func(FunctionRef {});
+        case INSTANCE: break;   // only `NEW` makes instances
+        case ARRAY: break;      // and only `NEW_ARRAY` and `FILL_ARRAY` arrays
+    }
+    std::unreachable();
+}
+
+auto VM::m_call(uint8_t arguments, std::size_t return_address) -> bool
+{
+    if (m_stack.size() + Stack::frame_size > Stack::max_size) {
+        m_error = BytecodeError { m_iptr, "stack overflow" };
+        m_iptr  = m_bc.code().size();
+        return false;
+    }
+    auto callee               = m_function(m_stack.peek(arguments));
+    m_frames[m_frame_count++] = Frame { .return_address = return_address, .base = m_base };
+    m_base                    = m_stack.size() - arguments;
+    m_iptr                    = m_bc.functions()[callee].entry;
+    return true;
+}
+
+auto VM::m_invoke() -> bool
+{
+    auto arguments = m_bc.code()[m_iptr + 3];
+    auto first     = m_stack.size() - arguments - 1;   // the instance
+    auto method    = m_method(*std::get<Instance*>(m_stack.get(first)));
+    // the method takes the instance's slot like the callee of a `CALL`, the instance and arguments move up one
+    m_stack.push(m_stack.top());
+    for (auto slot = m_stack.size() - 2; slot > first; slot--) {
+        m_stack.set(slot, m_stack.get(slot - 1));
+    }
+    m_stack.set(first, FunctionRef { method });
+    return m_call(arguments + 1, m_iptr + util::opcode::length(m_bc, m_iptr));
+}
+
+auto VM::m_method(Instance const& instance) -> uint16_t
+{
+    auto& cache = m_caches[m_bc.read_value<uint16_t>(m_iptr + 4)];
+    if (auto const* hit = cache.find(instance.shape); hit != nullptr) {
+        return hit->index;
+    }
+    // the closest class up the chain defining the method, the compiler only emits calls of methods there are
+    auto name = m_bc.read_value<uint16_t>(m_iptr + 1);
+    for (std::optional<uint16_t> klass = instance.shape->klass; klass.has_value(); klass = m_bc.classes()[*klass].superclass) {
+        for (auto [method, function] : m_bc.classes()[*klass].methods) {
+            if (method == name) {
+                cache.fill({ .shape = instance.shape, .next = nullptr, .index = function });
+                return function;
+            }
+        }
+    }
 #ifndef NDEBUG
-                               std::println(std::cerr, "[DEBUG] Reached ADD instruction with two different types");
+    std::println(std::cerr, "[DEBUG] Invoked a method the class does not have");
+    return 0;
 #else
-                               std::unreachable();
+    std::unreachable();
 #endif
-                           } },
-                       val1, val2);
-            m_iptr++;
-        } break;
-        case Opcode::SUB: {
-            auto val2 = m_stack.pop();
-            auto val1 = m_stack.pop();
-            std::visit(util::Visitor {
-                           [this]<Arithmetic T>(T v1, T v2) {
-                               m_stack.push(v1 - v2);
-                           },
-                           []<typename T1, typename T2>(T1, T2) {
-#ifndef NDEBUG
-                               std::println(std::cerr, "[DEBUG] Reached SUB instruction with two different types");
-#else
-                               std::unreachable();
+}
+
+auto VM::m_get_property(Instance const& instance) -> std::optional<Stack::value_type>
+{
+    auto& cache = m_caches[m_bc.read_value<uint16_t>(m_iptr + 3)];
+    if (auto const* hit = cache.find(instance.shape); hit != nullptr) {
+        return instance.fields[hit->index];
+    }
+    auto name          = m_bc.read_value<uint16_t>(m_iptr + 1);
+    auto const& fields = instance.shape->fields;
+    auto found         = std::ranges::find(fields, name);
+    // declared but never assigned, which no type tells apart
+    if (found == fields.end()) {
+        m_error = BytecodeError { m_iptr, std::format("undefined property '{}'", m_bc.names()[name]) };
+        m_iptr  = m_bc.code().size();
+        return {};
+    }
+    auto index = static_cast<uint16_t>(found - fields.begin());
+    cache.fill({ .shape = instance.shape, .next = nullptr, .index = index });
+    return instance.fields[index];
+}
+
+void VM::m_set_property(Instance& instance, Stack::value_type value)
+{
+    m_heap.write(instance);
+    auto& cache = m_caches[m_bc.read_value<uint16_t>(m_iptr + 3)];
+    if (auto const* hit = cache.find(instance.shape); hit != nullptr) {
+        if (hit->next != nullptr) {
+            instance.shape = hit->next;
+            instance.fields.push_back(value);
+        } else {
+            instance.fields[hit->index] = value;
+        }
+        return;
+    }
+    auto name          = m_bc.read_value<uint16_t>(m_iptr + 1);
+    auto const& fields = instance.shape->fields;
+    if (auto found = std::ranges::find(fields, name); found != fields.end()) {
+        auto index = static_cast<uint16_t>(found - fields.begin());
+        cache.fill({ .shape = instance.shape, .next = nullptr, .index = index });
+        instance.fields[index] = value;
+        return;
+    }
+    // the first assignment of the field, instances doing the same in the same order end up sharing the next shape
+    auto& transitions = instance.shape->transitions;
+    auto next         = std::ranges::find(transitions, name, &std::pair<uint16_t, Shape*>::first);
+    Shape* shape      = next != transitions.end() ? next->second : nullptr;
+    if (shape == nullptr) {
+        shape = &m_shapes.emplace_back(Shape { .klass = instance.shape->klass, .fields = fields });
+        shape->fields.push_back(name);
+        transitions.emplace_back(name, shape);
+    }
+    cache.fill({ .shape = instance.shape, .next = shape, .index = static_cast<uint16_t>(fields.size()) });
+    instance.shape = shape;
+    instance.fields.push_back(value);
+}
+
+void VM::m_tail_call(uint8_t arguments)
+{
+    // the callee lands where the running function sits, below its frame, which needs no more room than it had
+    auto first = m_stack.size() - arguments - 1;
+    for (std::size_t index {}; index <= arguments; index++) {
+        m_stack.set(m_base - 1 + index, m_stack.get(first + index));
+    }
+    m_stack.drop(first - (m_base - 1));
+    m_iptr = m_bc.functions()[m_function(m_stack.get(m_base - 1))].entry;
+}
+
+void VM::m_return()
+{
+    m_stack.drop(m_stack.size() - (m_base - 1));   // the frame and the callee below it
+    auto frame = m_frames[--m_frame_count];
+    m_iptr     = frame.return_address;
+    m_base     = frame.base;
+}
+
+auto VM::m_frame_types() const -> std::vector<SlotType>
+{
+    std::vector<SlotType> types;
+    for (auto slot = m_base; slot < m_stack.size(); slot++) {
+        types.push_back(m_type_of(m_stack.get(slot)));
+    }
+    return types;
+}
+
+auto VM::m_type_of(Stack::value_type const& value) const -> SlotType
+{
+    if (auto const* box = std::get_if<Box*>(&value)) {
+        return util::slot::boxed(m_type_of((*box)->value));
+    }
+    if (std::holds_alternative<FunctionRef>(value) || std::holds_alternative<Closure const*>(value)) {
+        return util::slot::function(m_bc.functions()[m_function(value)].signature);
+    }
+    if (auto const* instance = std::get_if<Instance*>(&value)) {
+        return util::slot::instance((*instance)->shape->klass);
+    }
+    if (auto const* array = std::get_if<Array*>(&value)) {
+        return util::slot::array((*array)->element);
+    }
+    return static_cast<SlotType>(value.index());
+}
+
+auto VM::m_function(Stack::value_type const& callee) noexcept -> uint16_t
+{
+    if (auto const* closure = std::get_if<Closure const*>(&callee)) {
+        return (*closure)->function;
+    }
+    return std::get<FunctionRef>(callee).index;
+}
+
+auto VM::m_make_closure(uint16_t function) -> Closure const*
+{
+    auto count = m_bc.functions()[function].captures.size();
+    std::vector<Stack::value_type> captures;
+    captures.reserve(count);
+    for (auto index = count; index > 0; index--) {
+        captures.push_back(m_stack.peek(index - 1));
+    }
+    m_stack.drop(count);
+    return m_heap.make_closure(function, std::move(captures));
+}
+
+auto VM::m_new_array(TypeIndex element, uint16_t count) -> Array*
+{
+    auto* array = m_heap.make_array(element, count);
+    auto size   = util::type::size_of(element);
+    for (std::size_t index {}; index < count; index++) {
+        util::vm::store_element(element, array->data.get() + index * size, m_stack.peek(count - 1 - index));
+    }
+    m_stack.drop(count);
+    return array;
+}
+
+auto VM::m_fill_array(TypeIndex element, Stack::value_type const& value, Stack::value_type const& length) -> std::optional<Stack::value_type>
+{
+    if (auto const* negative = std::get_if<int64_t>(&length); negative != nullptr && *negative < 0) {
+        m_halt(std::format("negative array length {}", *negative));
+        return {};
+    }
+    auto count = std::holds_alternative<int64_t>(length) ? static_cast<std::size_t>(std::get<int64_t>(length)) : std::get<uint64_t>(length);
+    auto size  = util::type::size_of(element);
+    if (count > Array::max_bytes / size) {
+        m_halt(std::format("array length {} is too large", count));
+        return {};
+    }
+    auto* array = m_heap.make_array(element, count);
+    for (std::size_t index {}; index < count; index++) {
+        util::vm::store_element(element, array->data.get() + index * size, value);
+    }
+    return array;
+}
+
+auto VM::m_element(Array& array, Stack::value_type const& index) -> std::byte*
+{
+    // a negative index wraps around to one no array reaches
+    bool is_signed = std::holds_alternative<int64_t>(index);
+    auto position  = is_signed ? static_cast<uint64_t>(std::get<int64_t>(index)) : std::get<uint64_t>(index);
+    if (position >= array.length) {
+        auto shown = is_signed ? std::format("{}", std::get<int64_t>(index)) : std::format("{}", position);
+        m_halt(std::format("index {} is out of bounds of an array of length {}", shown, array.length));
+        return nullptr;
+    }
+    return array.data.get() + position * util::type::size_of(array.element);
+}
+
+auto VM::m_elementwise(ArrayOp op, Array const& lhs, Array const& rhs) -> std::optional<Stack::value_type>
+{
+    if (lhs.length != rhs.length) {
+        m_halt(std::format("element-wise '{}' of arrays of length {} and {}", util::type::to_string(op), lhs.length, rhs.length));
+        return {};
+    }
+    // the kernels divide integers as they are, the checks a scalar division makes happen up front for every element
+    if (op == ArrayOp::DIV && lhs.element < TypeIndex::FLOAT32) {
+        auto size      = util::type::size_of(lhs.element);
+        auto zero      = util::type::with_element(lhs.element, []<typename T>(T) { return util::vm::widen(T {}); });
+        auto least     = util::type::with_element(lhs.element, []<typename T>(T) { return util::vm::widen(std::numeric_limits<T>::min()); });
+        auto minus_one = Stack::value_type { int64_t { -1 } };
+        for (std::size_t index {}; index < lhs.length; index++) {
+            auto dividend = util::vm::load_element(lhs.element, lhs.data.get() + index * size);
+            auto divisor  = util::vm::load_element(rhs.element, rhs.data.get() + index * size);
+            if (divisor == zero) {
+                m_halt("integer division by zero");
+                return {};
+            }
+            // the least signed element divided by -1 is one past the greatest
+            if (dividend == least && divisor == minus_one) {
+                m_halt("integer division overflows");
+                return {};
+            }
+        }
+    }
+    auto* result = m_heap.make_array(op >= ArrayOp::LT ? TypeIndex::BOOL : lhs.element, lhs.length);
+    util::simd::elementwise(op, lhs.element, lhs.data.get(), rhs.data.get(), result->data.get(), lhs.length);
+    return result;
+}
+
+auto VM::m_reduce(ArrayOp op, Array const& array) -> std::optional<Stack::value_type>
+{
+    if (op != ArrayOp::SUM && array.length == 0) {
+        m_halt(std::format("{} of an empty array", util::type::to_string(op)));
+        return {};
+    }
+    alignas(std::max_align_t) std::array<std::byte, sizeof(uint64_t)> result {};
+    util::simd::reduce(op, array.element, array.data.get(), array.length, result.data());
+    return util::vm::load_element(array.element, result.data());
+}
+
+void VM::reset()
+{
+    m_heap.clear();
+    m_stack.drop(m_stack.size());
+    std::ranges::fill(m_globals, Stack::value_type {});
+    m_shapes.clear();
+    m_make_shapes();
+    std::ranges::fill(m_caches, InlineCache {});
+    m_iptr        = 0;
+    m_frame_count = 0;
+    m_base        = 0;
+    m_parameters  = 0;
+    m_error.reset();
+}
+
+void VM::bind(std::span<Stack::value_type const> parameters)
+{
+    std::ranges::copy(parameters, m_globals.begin());
+    m_parameters = parameters.size();
+}
+
+auto VM::intern(std::string_view value) -> StringPtr
+{
+    auto [string, is_new] = m_pool.emplace(value);
+    if (is_new) {
+        m_heap.track(string);
+    }
+    return string;
+}
+
+void VM::m_make_shapes()
+{
+    // shape `klass` is the empty one every instance of the class starts out with
+    for (std::size_t klass {}; klass < m_bc.classes().size(); klass++) {
+        m_shapes.push_back(Shape { .klass = static_cast<uint16_t>(klass) });
+    }
+}
+
+void VM::m_halt(std::string message)
+{
+    m_error = BytecodeError { m_iptr, std::move(message) };
+    m_iptr  = m_bc.code().size();
+}
+
+auto VM::m_binary(Opcode opcode, Stack::value_type const& lhs, Stack::value_type const& rhs) -> Stack::value_type
+{
+    // only a concatenation can add to the pool, and only when the result is not there yet
+    auto strings = m_pool.size();
+    auto result  = util::vm::binary(opcode, lhs, rhs, m_pool);
+    if (m_pool.size() != strings) {
+        m_heap.track(std::get<StringPtr>(result));
+    }
+    return result;
+}
+
+auto VM::execute_checked() -> std::optional<BytecodeError>
+{
+    Verifier verifier { m_bc, m_code->second };
+    // mirrors the running frame, the verifier derives result types exactly as the vm computes the values,
+    // globals count as unset until the code sets them, apart from the parameters the host bound
+    TypeState types { .stack = m_frame_types(), .globals = std::vector<std::optional<SlotType>>(m_globals.size()) };
+    for (std::size_t global {}; global < m_parameters; global++) {
+        types.globals[global] = m_type_of(m_globals[global]);
+    }
+    auto function = [this]() -> std::optional<std::size_t> {
+        if (m_frame_count == 0) {
+            return {};
+        }
+        return m_function(m_stack.get(m_base - 1));
+    };
+    types.function = function();
+    // the state of each caller past its call, as `step` left it with the callee's result pushed
+    std::vector<TypeState> callers;
+#ifdef CPPLOX_INSTRUMENT_VM
+    opcode_profile.start();
 #endif
-                           },
-                       },
-                       val1, val2);
+
+    while (!m_is_end()) {
+        auto next = verifier.step(m_iptr, types);
+        if (!next.has_value()) {
+            return std::move(next.error());
+        }
+        if (auto error = m_division_error(); error.has_value()) {
+            return BytecodeError { m_iptr, std::string { error.value() } };
+        }
+        auto opcode = static_cast<Opcode>(m_bc.code()[m_iptr]);
+        execute_next();
+        if (m_error.has_value()) {
+            return m_error;
+        }
+        // `step` follows the fall through, where these pop their condition, a taken jump keeps it
+        if ((opcode == Opcode::JUMP_IF_FALSE_OR_POP || opcode == Opcode::JUMP_IF_TRUE_OR_POP) && m_iptr != next.value()) {
+            types.stack.push_back(SlotType::BOOL);
+        }
+        // `step` stays in the frame it started in, a callee starts out with the parameters its signature names, which an
+        // argument of a subclass only matches as a parameter, and a caller continues where `step` left it
+        if (opcode == Opcode::CALL || opcode == Opcode::INVOKE) {
+            callers.push_back(types);
+        }
+        if (opcode == Opcode::CALL || opcode == Opcode::INVOKE || opcode == Opcode::TAIL_CALL) {
+            types.function = function();
+            types.stack    = m_bc.signatures()[m_bc.functions()[types.function.value()].signature].parameters;
+        } else if (opcode == Opcode::RETURN && !callers.empty()) {
+            auto globals  = std::move(types.globals);
+            types         = std::move(callers.back());
+            types.globals = std::move(globals);
+            callers.pop_back();
+        } else if (opcode == Opcode::RETURN) {
+            types.stack    = m_frame_types();
+            types.function = function();
+        }
+    }
+    return {};
+}
+
+auto VM::m_division_error() -> std::optional<std::string_view>
+{
+    auto opcode = util::opcode::unfused(static_cast<Opcode>(m_bc.code()[m_iptr]));
+    if (opcode != Opcode::DIV && opcode != Opcode::MOD) {
+        return {};
+    }
+    auto lhs = m_stack.top();
+    auto rhs = lhs;
+    if (util::opcode::has_constant(static_cast<Opcode>(m_bc.code()[m_iptr]))) {
+        auto start = m_iptr;
+        rhs        = m_load();
+        m_iptr     = start;
+    } else {
+        lhs = m_stack.peek(1);
+    }
+    return util::vm::division_error(lhs, rhs);
+}
+
+auto VM::m_divide(Opcode opcode, Stack::value_type const& lhs, Stack::value_type const& rhs) -> std::optional<Stack::value_type>
+{
+    if (auto error = util::vm::division_error(lhs, rhs); error.has_value()) [[unlikely]] {
+        m_halt(std::string { error.value() });
+        return {};
+    }
+    return m_binary(opcode, lhs, rhs);
+}
+
+void VM::execute_next()
+{
+    m_sampled_iptr.store(m_iptr, std::memory_order_relaxed);
+    auto opcode = static_cast<Opcode>(m_bc.code()[m_iptr]);
+#ifdef CPPLOX_INSTRUMENT_VM
+    auto probe = opcode_profile.probe(opcode);
+#endif
+    switch (opcode) {
+        case Opcode::LOG:
+            util::vm::log(m_stack.pop());
             m_iptr++;
+            break;
+        case Opcode::RETURN: {
+            if (m_frame_count == 0) {
+                m_iptr = m_bc.code().size();   // halt, handing control back to whoever called `execute`
+                break;
+            }
+            auto result = m_stack.pop();
+            m_return();
+            m_stack.push(result);
         } break;
-        case Opcode::MUL: {
-            auto val2 = m_stack.pop();
-            auto val1 = m_stack.pop();
-            std::visit(util::Visitor {
-                           [this]<Arithmetic T>(T v1, T v2) {
-                               m_stack.push(v1 * v2);
-                           },
-                           []<typename T1, typename T2>(T1, T2) {
-#ifndef NDEBUG
-                               std::println(std::cerr, "[DEBUG] Reached MUL instruction with two different types");
-#else
-                               std::unreachable();
-#endif
-                           },
-                       },
-                       val1, val2);
+        case Opcode::CALL:
+            (void)m_call(m_bc.code()[m_iptr + 1], m_iptr + 2);
+            break;
+        case Opcode::INVOKE:
+            (void)m_invoke();
+            break;
+        case Opcode::NEW:
+            m_stack.push(m_new(m_bc.read_value<uint16_t>(m_iptr + 1)));
+            m_safepoint();
+            m_iptr += 3;
+            break;
+        case Opcode::GET_PROP:
+            if (auto value = m_get_property(*std::get<Instance*>(m_stack.top())); value.has_value()) {
+                m_stack.set(m_stack.size() - 1, value.value());
+                m_iptr += 5;
+            }
+            break;
+        case Opcode::SET_PROP: {
+            auto value = m_stack.pop();
+            m_set_property(*std::get<Instance*>(m_stack.pop()), value);
+            m_stack.push(value);
+            m_iptr += 5;
+        } break;
+        case Opcode::TAIL_CALL:
+            m_tail_call(m_bc.code()[m_iptr + 1]);
+            break;
+        case Opcode::GET_CALLEE:
+            m_stack.push(m_stack.get(m_base - 1));
             m_iptr++;
+            break;
+        case Opcode::CLOSURE: {
+            auto closure = m_make_closure(m_bc.read_value<uint16_t>(m_iptr + 1));
+            m_stack.push(closure);
+            m_safepoint();
+            m_iptr += 3;
+        } break;
+        case Opcode::GET_CAPTURE:
+            m_stack.push(m_closure().captures[m_bc.code()[m_iptr + 1]]);
+            m_iptr += 2;
+            break;
+        case Opcode::GET_BOXED_CAPTURE:
+            m_stack.push(std::get<Box*>(m_closure().captures[m_bc.code()[m_iptr + 1]])->value);
+            m_iptr += 2;
+            break;
+        case Opcode::SET_BOXED_CAPTURE: {
+            auto* box  = std::get<Box*>(m_closure().captures[m_bc.code()[m_iptr + 1]]);
+            box->value = m_stack.top();
+            m_heap.write(*box);
+            m_iptr += 2;
+        } break;
+        case Opcode::BOX: {
+            std::size_t slot = m_base + m_bc.code()[m_iptr + 1];
+            m_stack.set(slot, m_box(m_stack.get(slot)));
+            m_safepoint();
+            m_iptr += 2;
+        } break;
+        case Opcode::GET_BOXED:
+            m_stack.push(std::get<Box*>(m_stack.get(m_base + m_bc.code()[m_iptr + 1]))->value);
+            m_iptr += 2;
+            break;
+        case Opcode::SET_BOXED: {
+            auto* box  = std::get<Box*>(m_stack.get(m_base + m_bc.code()[m_iptr + 1]));
+            box->value = m_stack.top();
+            m_heap.write(*box);
+            m_iptr += 2;
+        } break;
+        case Opcode::LOAD:
+            m_stack.push(m_load());
+            break;
+        case Opcode::NEW_ARRAY: {
+            auto* array = m_new_array(static_cast<TypeIndex>(m_bc.code()[m_iptr + 1]), m_bc.read_value<uint16_t>(m_iptr + 2));
+            m_stack.push(array);
+            m_safepoint();
+            m_iptr += 4;
+        } break;
+        case Opcode::FILL_ARRAY: {
+            auto length = m_stack.pop();
+            auto value  = m_stack.pop();
+            if (auto array = m_fill_array(static_cast<TypeIndex>(m_bc.code()[m_iptr + 1]), value, length); array.has_value()) {
+                m_stack.push(array.value());
+                m_safepoint();
+                m_iptr += 2;
+            }
+        } break;
+        case Opcode::GET_INDEX: {
+            auto index  = m_stack.pop();
+            auto& array = *std::get<Array*>(m_stack.pop());
+            if (auto* element = m_element(array, index); element != nullptr) {
+                m_stack.push(util::vm::load_element(array.element, element));
+                m_iptr++;
+            }
+        } break;
+        case Opcode::SET_INDEX: {
+            auto value  = m_stack.pop();
+            auto index  = m_stack.pop();
+            auto& array = *std::get<Array*>(m_stack.pop());
+            if (auto* element = m_element(array, index); element != nullptr) {
+                util::vm::store_element(array.element, element, value);
+                m_stack.push(value);
+                m_iptr++;
+            }
+        } break;
+        case Opcode::ELEMENTWISE: {
+            auto* rhs = std::get<Array*>(m_stack.pop());
+            auto* lhs = std::get<Array*>(m_stack.pop());
+            if (auto result = m_elementwise(static_cast<ArrayOp>(m_bc.code()[m_iptr + 1]), *lhs, *rhs); result.has_value()) {
+                m_stack.push(result.value());
+                m_safepoint();
+                m_iptr += 2;
+            }
         } break;
-        case Opcode::DIV: {
+        case Opcode::REDUCE:
+            if (auto result = m_reduce(static_cast<ArrayOp>(m_bc.code()[m_iptr + 1]), *std::get<Array*>(m_stack.pop())); result.has_value()) {
+                m_stack.push(result.value());
+                m_iptr += 2;
+            }
+            break;
+        case Opcode::LENGTH:
+            m_stack.push(static_cast<int64_t>(std::get<Array*>(m_stack.pop())->length));
+            m_iptr++;
+            break;
+        case Opcode::ADD:
+        case Opcode::SUB:
+        case Opcode::MUL:
+        case Opcode::CMP:
+        case Opcode::CMPE: {
             auto val2 = m_stack.pop();
             auto val1 = m_stack.pop();
-            std::visit(util::Visitor {
-                           [this]<Arithmetic T>(T v1, T v2) {
-                               m_stack.push(v1 / v2);
-                           },
-                           []<typename T1, typename T2>(T1, T2) {
-#ifndef NDEBUG
-                               std::println(std::cerr, "[DEBUG] Reached DIV instruction with two different types");
-#else
-                               std::unreachable();
-#endif
-                           },
-                       },
-                       val1, val2);
+            m_stack.push(m_binary(opcode, val1, val2));
+            m_safepoint();
             m_iptr++;
         } break;
+        case Opcode::DIV:
         case Opcode::MOD: {
             auto val2 = m_stack.pop();
             auto val1 = m_stack.pop();
-            std::visit(util::Visitor {
-                           [this]<Arithmetic T>(T v1, T v2) {
-                               if constexpr (std::is_integral_v<T>) {
-                                   m_stack.push(v1 % v2);
-                               } else if constexpr (std::is_floating_point_v<T>) {
-                                   m_stack.push(std::fmod(v1, v2));
-                               }
-                           },
-                           []<typename T1, typename T2>(T1, T2) {
-#ifndef NDEBUG
-                               std::println(std::cerr, "[DEBUG] Reached MOD instruction with two different types");
-#else
-                               std::unreachable();
-#endif
-                           },
-                       },
-                       val1, val2);
-            m_iptr++;
+            if (auto result = m_divide(opcode, val1, val2); result.has_value()) {
+                m_stack.push(result.value());
+                m_iptr++;
+            }
         } break;
-        case Opcode::CMP: {
-            auto val2 = m_stack.pop();
-            auto val1 = m_stack.pop();
-            std::visit(util::Visitor {
-                           [this]<typename T>(T v1, T v2) {
-                               if constexpr (Arithmetic<T>) {
-                                   auto cmp = v1 <=> v2;
-                                   m_stack.push(static_cast<int64_t>(
-                                       cmp < 0
-                                           ? -1
-                                           : (cmp > 0
-                                                  ? 1
-                                                  : 0)));
-                               } else {
-                                   auto cmp = *v1 <=> *v2;
-                                   m_stack.push(static_cast<int64_t>(
-                                       cmp < 0
-                                           ? -1
-                                           : (cmp > 0
-                                                  ? 1
-                                                  : 0)));
-                               }
-                           },
-                           []<typename T1, typename T2>(T1, T2) {
-#ifndef NDEBUG
-                               std::println(std::cerr, "[DEBUG] Reached CMP instruction with two different types");
-#else
-                               std::unreachable();
-#endif
-                           },
-                       },
-                       val1, val2);
+        case Opcode::NEGATE:
+            m_stack.push(util::vm::negate(m_stack.pop()));
             m_iptr++;
-        } break;
-        case Opcode::CMPE: {
-            auto val2 = m_stack.pop();
-            auto val1 = m_stack.pop();
-            std::visit(util::Visitor {
-                           [this]<typename T>(T v1, T v2) {
-                               auto cmp = v1 == v2;
-                               m_stack.push(static_cast<bool>(
-                                   cmp));
-                           },
-                           []<typename T1, typename T2>(T1, T2) {
-#ifndef NDEBUG
-                               std::println(std::cerr, "[DEBUG] Reached CMPE instruction with two different types");
-#else
-                               std::unreachable();
-#endif
-                           },
-                       },
-                       val1, val2);
+            break;
+        case Opcode::NOT:
+            m_stack.push(util::vm::logical_not(m_stack.pop()));
             m_iptr++;
-        } break;
-        case Opcode::NEGATE: {
+            break;
+        case Opcode::PICK:
+            m_stack.push(m_stack.peek(m_bc.code()[m_iptr + 1]));
+            m_iptr += 2;
+            break;
+        case Opcode::POP:
+            m_stack.drop(m_bc.code()[m_iptr + 1]);
+            m_iptr += 2;
+            break;
+        case Opcode::GET_LOCAL:
+            m_stack.push(m_stack.get(m_base + m_bc.code()[m_iptr + 1]));
+            m_iptr += 2;
+            break;
+        case Opcode::SET_LOCAL:
+            m_stack.set(m_base + m_bc.code()[m_iptr + 1], m_stack.top());
+            m_iptr += 2;
+            break;
+        case Opcode::GET_GLOBAL:
+            m_stack.push(m_globals[m_bc.read_value<uint16_t>(m_iptr + 1)]);
+            m_iptr += 3;
+            break;
+        case Opcode::SET_GLOBAL:
+            m_globals[m_bc.read_value<uint16_t>(m_iptr + 1)] = m_stack.top();
+            m_iptr += 3;
+            break;
+        case Opcode::SHL:
+        case Opcode::DIVP2:
+        case Opcode::MODP2:
+        case Opcode::DIVM:
+        case Opcode::MODM:
+            m_stack.push(util::vm::strength_reduced(opcode, m_stack.pop(), m_bc, m_iptr));
+            m_iptr += util::opcode::length(m_bc, m_iptr);
+            break;
+        case Opcode::ADDK:
+        case Opcode::SUBK:
+        case Opcode::MULK:
+        case Opcode::CMPK:
+        case Opcode::CMPEK: {
+            auto val2 = m_load();
             auto val1 = m_stack.pop();
-            std::visit(util::Visitor {
-                           [this]<Arithmetic T>(T v1) {
-                               m_stack.push(-v1);
-                           },
-                           [this](bool) {
-#ifndef NDEBUG
-                               std::println(std::cerr, "[DEBUG] Reached NEGATE instruction with bool type");
-#else
-                               std::unreachable();
-#endif
-                           },
-                           [this](std::unordered_set<std::string>::const_iterator) {
-#ifndef NDEBUG
-                               std::println(std::cerr, "[DEBUG] Reached NEGATE instruction with str types");
-#else
-                               std::unreachable();
-#endif
-                           },
-                       },
-                       val1);
-            m_iptr++;
+            m_stack.push(m_binary(util::opcode::unfused(opcode), val1, val2));
+            m_safepoint();
+        } break;
+        case Opcode::DIVK:
+        case Opcode::MODK: {
+            auto start = m_iptr;
+            auto val2  = m_load();
+            auto val1  = m_stack.pop();
+            auto next  = std::exchange(m_iptr, start);
+            if (auto result = m_divide(util::opcode::unfused(opcode), val1, val2); result.has_value()) {
+                m_stack.push(result.value());
+                m_iptr = next;
+            }
         } break;
-        case Opcode::NOT: {
+        case Opcode::LOGK:
+            util::vm::log(m_load());
+            break;
+        case Opcode::JUMP:
+            m_iptr = static_cast<std::size_t>(util::opcode::jump_target(m_bc, m_iptr));
+            break;
+        case Opcode::JUMP_IF_FALSE:
+            m_iptr = std::get<bool>(m_stack.pop()) ? m_iptr + 3 : static_cast<std::size_t>(util::opcode::jump_target(m_bc, m_iptr));
+            break;
+        case Opcode::JUMP_IF_FALSE_OR_POP:
+        case Opcode::JUMP_IF_TRUE_OR_POP:
+            if (std::get<bool>(m_stack.top()) == (opcode == Opcode::JUMP_IF_TRUE_OR_POP)) {
+                m_iptr = static_cast<std::size_t>(util::opcode::jump_target(m_bc, m_iptr));
+                break;
+            }
+            m_stack.drop(1);
+            m_iptr += 3;
+            break;
+        case Opcode::JLT:
+        case Opcode::JLE:
+        case Opcode::JGT:
+        case Opcode::JGE:
+        case Opcode::JEQ:
+        case Opcode::JNE: {
+            auto val2 = m_stack.pop();
             auto val1 = m_stack.pop();
-            std::visit(util::Visitor {
-                           [this]<typename T>(T v1) {
-                               m_stack.push(!v1);
-                           },
-                           [this](std::unordered_set<std::string>::const_iterator iter_to_str) {
-                               m_stack.push(!iter_to_str->empty());
-                           },
-                       },
-                       val1);
-            m_iptr++;
+            m_iptr    = util::vm::compare_jump(opcode, val1, val2) ? static_cast<std::size_t>(util::opcode::jump_target(m_bc, m_iptr)) : m_iptr + 3;
         } break;
             // default:
             //     break;
     }
-}
\ No newline at end of file
+}
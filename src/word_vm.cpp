@@ -0,0 +1,185 @@
+#include <algorithm>
+
+#include "vm_ops.hpp"
+#include "word_vm.hpp"
+
+void WordVM::execute()
+{
+    for (; !m_is_end();) {
+        execute_next();
+    }
+}
+
+void WordVM::execute(Stats& stats)
+{
+    for (; !m_is_end();) {
+        execute_next();
+        stats.instructions++;
+        stats.peak_stack_depth = std::max(stats.peak_stack_depth, m_stack.size());
+    }
+}
+
+void WordVM::reset()
+{
+    m_stack.drop(m_stack.size());
+    std::ranges::fill(m_globals, Stack::value_type {});
+    m_iptr = 0;
+    m_error.reset();
+}
+
+void WordVM::execute_next()
+{
+    auto word = m_wc.code()[m_iptr++];
+    switch (word.opcode()) {
+        case Opcode::LOG:
+            util::vm::log(m_stack.pop());
+            break;
+        case Opcode::RETURN:
+            m_iptr = m_wc.code().size();   // halt, handing control back to whoever called `execute`
+            break;
+        case Opcode::LOAD:
+            m_stack.push(m_constant(word));
+            break;
+        case Opcode::DIV:
+        case Opcode::MOD: {
+            auto val2 = m_stack.pop();
+            auto val1 = m_stack.pop();
+            if (m_divides(val1, val2)) [[likely]] {
+                m_stack.push(util::vm::binary(word.opcode(), val1, val2, m_pool));
+            }
+        } break;
+        case Opcode::ADD:
+        case Opcode::SUB:
+        case Opcode::MUL:
+        case Opcode::CMP:
+        case Opcode::CMPE: {
+            auto val2 = m_stack.pop();
+            auto val1 = m_stack.pop();
+            m_stack.push(util::vm::binary(word.opcode(), val1, val2, m_pool));
+        } break;
+        case Opcode::NEGATE:
+            m_stack.push(util::vm::negate(m_stack.pop()));
+            break;
+        case Opcode::NOT:
+            m_stack.push(util::vm::logical_not(m_stack.pop()));
+            break;
+        case Opcode::PICK:
+            m_stack.push(m_stack.peek(word.a()));
+            break;
+        case Opcode::POP:
+            m_stack.drop(word.a());
+            break;
+        case Opcode::GET_LOCAL:
+            m_stack.push(m_stack.get(word.a()));
+            break;
+        case Opcode::SET_LOCAL:
+            m_stack.set(word.a(), m_stack.top());
+            break;
+        case Opcode::GET_GLOBAL:
+            m_stack.push(m_globals[word.b()]);
+            break;
+        case Opcode::SET_GLOBAL:
+            m_globals[word.b()] = m_stack.top();
+            break;
+        case Opcode::SHL:
+            m_stack.push(util::vm::shl(m_stack.pop(), word.a()));
+            break;
+        case Opcode::DIVP2:
+            m_stack.push(util::vm::div_const(m_stack.pop(), { 0, word.a() }));
+            break;
+        case Opcode::MODP2: {
+            uint8_t shift = word.a() & util::divide::shift_mask;
+            m_stack.push(util::vm::mod_const(m_stack.pop(), { 0, shift }, uint64_t { 1 } << shift));
+        } break;
+        case Opcode::DIVM:
+            m_stack.push(util::vm::div_const(m_stack.pop(), { m_wc.constants()[word.b()], word.a() }));
+            break;
+        case Opcode::MODM:
+            m_stack.push(util::vm::mod_const(m_stack.pop(), { m_wc.constants()[word.b()], word.a() }, m_wc.constants()[word.b() + 1]));
+            break;
+        case Opcode::DIVK:
+        case Opcode::MODK: {
+            auto val1 = m_stack.pop();
+            auto val2 = m_constant(word);
+            if (m_divides(val1, val2)) [[likely]] {
+                m_stack.push(util::vm::binary(util::opcode::unfused(word.opcode()), val1, val2, m_pool));
+            }
+        } break;
+        case Opcode::ADDK:
+        case Opcode::SUBK:
+        case Opcode::MULK:
+        case Opcode::CMPK:
+        case Opcode::CMPEK: {
+            auto val1 = m_stack.pop();
+            m_stack.push(util::vm::binary(util::opcode::unfused(word.opcode()), val1, m_constant(word), m_pool));
+        } break;
+        case Opcode::LOGK:
+            util::vm::log(m_constant(word));
+            break;
+        case Opcode::JUMP:
+            m_iptr = word.b();
+            break;
+        case Opcode::JUMP_IF_FALSE:
+            if (!std::get<bool>(m_stack.pop())) {
+                m_iptr = word.b();
+            }
+            break;
+        case Opcode::JUMP_IF_FALSE_OR_POP:
+        case Opcode::JUMP_IF_TRUE_OR_POP:
+            if (std::get<bool>(m_stack.top()) == (word.opcode() == Opcode::JUMP_IF_TRUE_OR_POP)) {
+                m_iptr = word.b();
+            } else {
+                m_stack.drop(1);
+            }
+            break;
+        case Opcode::JLT:
+        case Opcode::JLE:
+        case Opcode::JGT:
+        case Opcode::JGE:
+        case Opcode::JEQ:
+        case Opcode::JNE: {
+            auto val2 = m_stack.pop();
+            auto val1 = m_stack.pop();
+            if (util::vm::compare_jump(word.opcode(), val1, val2)) {
+                m_iptr = word.b();
+            }
+        } break;
+        default:
+#ifndef NDEBUG
+            std::println(std::cerr, "[DEBUG] Word has an opcode which `encode` declines");
+            m_iptr = m_wc.code().size();
+#else
+            std::unreachable();
+#endif
+            break;
+    }
+}
+
+auto WordVM::m_constant(Word word) const -> Stack::value_type
+{
+    switch (util::type::get_type(word.a())) {
+        using enum TypeIndex;
+        case BOOL: return util::wordcode::constant<bool>(m_wc, word.b());
+        case INT64: return util::wordcode::constant<int64_t>(m_wc, word.b());
+        case UINT64: return util::wordcode::constant<uint64_t>(m_wc, word.b());
+        case FLOAT64: return util::wordcode::constant<double>(m_wc, word.b());
+        case STRING: return util::wordcode::constant<StringPtr>(m_wc, word.b());
+        default: break;
+    }
+#ifndef NDEBUG
+    std::println(std::cerr, "[DEBUG] Word names a constant type which is never pushed");
+    return {};
+#else
+    std::unreachable();
+#endif
+}
+
+auto WordVM::m_divides(Stack::value_type const& lhs, Stack::value_type const& rhs) -> bool
+{
+    if (auto error = util::vm::division_error(lhs, rhs); error.has_value()) [[unlikely]] {
+        m_error = BytecodeError { m_iptr - 1, std::string { error.value() } };
+        m_iptr  = m_wc.code().size();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,91 @@
+#include <vector>
+
+#include "wordcode.hpp"
+
+namespace util::wordcode {
+auto encode(ByteCode const& bc) -> std::optional<WordCode>
+{
+    if (!bc.functions().empty()) {
+        return {};
+    }
+    WordCode wc;
+    wc.set_globals(bc.globals());
+    // every instruction becomes one word, so a jump target's index is the number of instructions before it
+    std::vector<std::size_t> indices(bc.code().size());
+    for (std::size_t offset {}, index {}; offset < bc.code().size(); offset += util::opcode::length(bc, offset), index++) {
+        indices[offset] = index;
+    }
+
+    for (std::size_t offset {}; offset < bc.code().size(); offset += util::opcode::length(bc, offset)) {
+        auto opcode   = static_cast<Opcode>(bc.code()[offset]);
+        auto location = bc.read_location(offset);
+
+        switch (opcode) {
+            case Opcode::PICK:
+            case Opcode::POP:
+            case Opcode::GET_LOCAL:
+            case Opcode::SET_LOCAL:
+            case Opcode::SHL:
+            case Opcode::DIVP2:
+            case Opcode::MODP2:
+                wc.write_word(Word { opcode, bc.code()[offset + 1] }, location);
+                continue;
+            case Opcode::GET_GLOBAL:
+            case Opcode::SET_GLOBAL:
+                wc.write_word(Word { opcode, 0, bc.read_value<uint16_t>(offset + 1) }, location);
+                continue;
+            case Opcode::JUMP:
+            case Opcode::JUMP_IF_FALSE:
+            case Opcode::JUMP_IF_FALSE_OR_POP:
+            case Opcode::JUMP_IF_TRUE_OR_POP:
+            case Opcode::JLT:
+            case Opcode::JLE:
+            case Opcode::JGT:
+            case Opcode::JGE:
+            case Opcode::JEQ:
+            case Opcode::JNE: {
+                auto target = indices[static_cast<std::size_t>(util::opcode::jump_target(bc, offset))];
+                if (target > WordCode::max_jump_target) {
+                    return {};
+                }
+                wc.write_word(Word { opcode, 0, static_cast<uint16_t>(target) }, location);
+                continue;
+            }
+            case Opcode::DIVM:
+            case Opcode::MODM: {
+                // magic and, for `MODM`, the divisor go to consecutive constants
+                auto index = wc.add_constant(bc.read_value<uint64_t>(offset + 2));
+                if (opcode == Opcode::MODM) {
+                    (void)wc.add_constant(bc.read_value<uint64_t>(offset + 2 + sizeof(uint64_t)));
+                }
+                if (wc.constants().size() > WordCode::max_constants) {
+                    return {};
+                }
+                wc.write_word(Word { opcode, bc.code()[offset + 1], static_cast<uint16_t>(index) }, location);
+                continue;
+            }
+            case Opcode::NEW_ARRAY:
+            case Opcode::FILL_ARRAY:
+            case Opcode::GET_INDEX:
+            case Opcode::SET_INDEX:
+            case Opcode::ELEMENTWISE:
+            case Opcode::REDUCE:
+            case Opcode::LENGTH: return {};   // arrays live on a heap the word vm doesn't have
+            default: break;
+        }
+        if (!util::opcode::has_constant(opcode)) {
+            wc.write_word(Word { opcode }, location);
+            continue;
+        }
+
+        // widen to the pushed representation so the vm needs no per width decoding
+        auto constant = decode_constant(bc, offset);
+        auto index    = wc.add_constant(constant.second);
+        if (index >= WordCode::max_constants) {
+            return {};
+        }
+        wc.write_word(Word { opcode, std::to_underlying(constant.first), static_cast<uint16_t>(index) }, location);
+    }
+    return wc;
+}
+}
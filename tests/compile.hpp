@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "compiler.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "gtest/gtest.h"
+
+// helpers the tests share for turning source into something to run
+
+inline auto parse(std::string_view source) -> StmtType
+{
+    auto ast = Parser { Lexer { source }.scan() }.parse();
+    EXPECT_TRUE(ast.has_value()) << source;
+    return std::move(ast.value());
+}
+
+inline auto compile(std::string_view source, Fusions fusions = Fusions::all()) -> CodeSegment
+{
+    return Compiler { parse(source), fusions }.compile();
+}
+
+// runs `run` and returns everything it logged
+template <typename Func>
+auto capture(Func&& run) -> std::string
+{
+    testing::internal::CaptureStdout();
+    run();
+    std::fflush(stdout);
+    return testing::internal::GetCapturedStdout();
+}
@@ -0,0 +1,159 @@
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "heap.hpp"
+#include "simd.hpp"
+#include "vm.hpp"
+#include "gtest/gtest.h"
+
+#include "compile.hpp"
+
+namespace {
+// everything `source` logs, run checked and unchecked, which have to agree
+auto run(std::string_view source) -> std::string
+{
+    testing::internal::CaptureStdout();
+    VM { compile(source) }.execute();
+    std::fflush(stdout);
+    auto output = testing::internal::GetCapturedStdout();
+
+    testing::internal::CaptureStdout();
+    auto error = VM { compile(source) }.execute_checked();
+    std::fflush(stdout);
+    EXPECT_FALSE(error.has_value()) << source << ": " << error->message;
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), output) << source;
+    return output;
+}
+
+// not a multiple of any vector, so every kernel also finishes elements one at a time
+constexpr std::size_t length = 1'000 + 7;
+
+// elements of `element` from the whole range of the type, no divisor is zero and no dividend the least signed value
+auto random_elements(TypeIndex element, std::mt19937_64& engine) -> std::vector<std::byte>
+{
+    std::vector<std::byte> bytes(length * util::type::size_of(element));
+    util::type::with_element(element, [&]<typename T>(T) {
+        for (std::size_t index {}; index < length; index++) {
+            T value {};
+            if constexpr (std::is_floating_point_v<T>) {
+                value = std::uniform_real_distribution<T> { -1'000, 1'000 }(engine);
+            } else {
+                using Wide = std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>;
+                value      = static_cast<T>(std::uniform_int_distribution<Wide> { std::numeric_limits<T>::min() + 1, std::numeric_limits<T>::max() }(engine));
+                value      = value == T {} ? T { 1 } : value;
+            }
+            std::memcpy(bytes.data() + index * sizeof(T), &value, sizeof(T));
+        }
+    });
+    return bytes;
+}
+}
+
+TEST(ArrayTest, EveryInstructionSetMatchesScalar)
+{
+    using enum ArrayOp;
+    std::mt19937_64 engine { 42 };
+    for (auto element : { TypeIndex::INT8, TypeIndex::INT16, TypeIndex::INT32, TypeIndex::INT64, TypeIndex::UINT8, TypeIndex::UINT16,
+                          TypeIndex::UINT32, TypeIndex::UINT64, TypeIndex::FLOAT32, TypeIndex::FLOAT64 }) {
+        auto lhs  = random_elements(element, engine);
+        auto rhs  = random_elements(element, engine);
+        auto size = util::type::size_of(element);
+        for (auto target = std::to_underlying(util::simd::Isa::SSE2); target <= std::to_underlying(util::simd::isa()); target++) {
+            auto isa = static_cast<util::simd::Isa>(target);
+            for (auto op : { ADD, SUB, MUL, DIV, LT, LE, GT, GE, EQ, NE }) {
+                std::vector<std::byte> expected(lhs.size());
+                std::vector<std::byte> actual(lhs.size());
+                util::simd::elementwise(op, element, lhs.data(), rhs.data(), expected.data(), length, util::simd::Isa::SCALAR);
+                util::simd::elementwise(op, element, lhs.data(), rhs.data(), actual.data(), length, isa);
+                auto compared = op >= LT ? length : lhs.size();
+                EXPECT_EQ(std::memcmp(expected.data(), actual.data(), compared), 0) << util::type::to_string(element) << " " << util::type::to_string(op) << " isa " << +target;
+            }
+            for (auto op : { SUM, MIN, MAX }) {
+                alignas(8) std::array<std::byte, 8> expected {};
+                alignas(8) std::array<std::byte, 8> actual {};
+                util::simd::reduce(op, element, lhs.data(), length, expected.data(), util::simd::Isa::SCALAR);
+                util::simd::reduce(op, element, lhs.data(), length, actual.data(), isa);
+                // the lanes of a float sum add up separately, which rounds differently
+                if (op == SUM && element == TypeIndex::FLOAT32) {
+                    float scalar {}, vector {};
+                    std::memcpy(&scalar, expected.data(), sizeof(float));
+                    std::memcpy(&vector, actual.data(), sizeof(float));
+                    EXPECT_NEAR(scalar, vector, 1.0) << "isa " << +target;
+                } else if (op == SUM && element == TypeIndex::FLOAT64) {
+                    double scalar {}, vector {};
+                    std::memcpy(&scalar, expected.data(), sizeof(double));
+                    std::memcpy(&vector, actual.data(), sizeof(double));
+                    EXPECT_NEAR(scalar, vector, 1e-6) << "isa " << +target;
+                } else {
+                    EXPECT_EQ(std::memcmp(expected.data(), actual.data(), size), 0) << util::type::to_string(element) << " " << util::type::to_string(op) << " isa " << +target;
+                }
+            }
+        }
+    }
+}
+
+TEST(ArrayTest, ElementsWrapAtTheirWidth)
+{
+    EXPECT_EQ(run("let a: [i8] = [100, 27, 125]; let b = a + a; log(b[0]); log(b.sum()); log(b.min()); log(b.max());"), "-56\n-8\n-56\n54\n");
+    EXPECT_EQ(run("let a: [u8] = [200, 100]; log((a + a)[0]); log(a[1] = a[0]); log(a[0] + a[1]);"), "144\n200\n400\n");
+    EXPECT_EQ(run("let a: [f32] = [0.1; 3]; log(a[0]); log(a.sum());"), "0.10000000149011612\n0.30000001192092896\n");
+}
+
+TEST(ArrayTest, ElementwiseOperationsCoverEveryElement)
+{
+    auto source = "let a = [0; 1000]; let i = 0; while (i < 1000) { a[i] = i; i = i + 1; }"
+                  "log(a.sum()); log((a + a).max()); log((a * a)[999]); log((a - [1; 1000]).min()); log((a / [3; 1000])[998]);"
+                  "let c = a > [500; 1000]; log(c[501]); log(c[500]); log((a == a)[999]); log(a.len());";
+    EXPECT_EQ(run(source), "499500\n1998\n998001\n-1\n332\ntrue\nfalse\ntrue\n1000\n");
+    EXPECT_EQ(run("fun mk(n: i32): [i32] { return [n; n]; } log(mk(5).sum()); let e: [u16] = [0; 0]; log(e.sum()); log(e.len());"), "25\n0\n0\n");
+}
+
+TEST(ArrayTest, MisuseStopsTheProgram)
+{
+    std::pair<std::string_view, std::string_view> const programs[] {
+        { "let a = [1, 2]; log(a[2]);", "index 2 is out of bounds of an array of length 2" },
+        { "let a = [1, 2]; log(a[-1]);", "index -1 is out of bounds of an array of length 2" },
+        { "let a = [1, 2]; a[5] = 3;", "index 5 is out of bounds of an array of length 2" },
+        { "let a = [1, 2]; log((a + [1, 2, 3]).sum());", "element-wise '+' of arrays of length 2 and 3" },
+        { "let a = [1, 2]; log((a / [1, 0]).sum());", "integer division by zero" },
+        { "let a: [i8] = [64]; let one: [i8] = [1]; let zero: [i8] = [0]; log(((a + a) / (zero - one)).sum());", "integer division overflows" },
+        { "let a = [1; 0]; log(a.min());", "min of an empty array" },
+        { "let n = -1; let a = [1; n];", "negative array length -1" },
+        // 2^61 + 1 elements of 8 bytes, whose bytes wrap around to 8
+        { "let a: i64 = 65536; let k: i64 = 8192; let one: i64 = 1; let n = (a * a * a * k) + one; let z: i64 = 0; let b = [z; n];", "array length 2305843009213693953 is too large" },
+        { "let m: i64 = 1000000; let b = [1; m * m];", "array length 1000000000000 is too large" },
+    };
+    for (auto [source, message] : programs) {
+        testing::internal::CaptureStdout();
+        VM vm { compile(source) };
+        vm.execute();
+        auto checked = VM { compile(source) }.execute_checked();
+        std::fflush(stdout);
+        EXPECT_EQ(testing::internal::GetCapturedStdout(), "") << source;
+        ASSERT_TRUE(vm.error().has_value()) << source;
+        EXPECT_EQ(vm.error()->message, message);
+        ASSERT_TRUE(checked.has_value()) << source;
+        EXPECT_EQ(checked->message, message);
+    }
+}
+
+TEST(ArrayTest, BuffersAreCollected)
+{
+    // every iteration makes two arrays of 4 KB which die right away, far more than any collection threshold in total
+    auto source = "let keep = [1; 1000]; let t = 0; let i = 0;"
+                  "while (i < 20000) { let a = [i; 1000]; t = t + (a + keep).max(); i = i + 1; } log(t); log(keep.sum());";
+    testing::internal::CaptureStdout();
+    VM vm { compile(source) };
+    vm.execute();
+    std::fflush(stdout);
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "200010000\n1000\n");
+    EXPECT_GT(vm.heap().minor_collections(), 0);
+    EXPECT_LE(vm.heap().array_bytes(), Heap::nursery_bytes + Heap::major_bytes);
+}
@@ -0,0 +1,135 @@
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "batch_vm.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "register_compiler.hpp"
+#include "register_vm.hpp"
+#include "gtest/gtest.h"
+
+namespace {
+// `x` and `y` are integer parameters, `f` a float one and `s` a string one
+std::vector<Parser::Input> const inputs {
+    { "x", Type { TypeIndex::INT32 } },
+    { "y", Type { TypeIndex::INT32 } },
+    { "f", Type { TypeIndex::FLOAT64 } },
+    { "s", Type { TypeIndex::STRING } },
+};
+
+auto compile(std::string_view source) -> std::optional<RegisterSegment>
+{
+    auto ast = Parser { Lexer { source }.scan(), inputs }.parse();
+    EXPECT_TRUE(ast.has_value()) << source;
+    return RegisterCompiler { ast.value() }.compile();
+}
+
+auto batch(std::string_view source) -> BatchVM
+{
+    auto seg = compile(source);
+    EXPECT_TRUE(seg.has_value()) << source;
+    auto vm = BatchVM::compile(std::move(seg.value()));
+    EXPECT_TRUE(vm.has_value()) << source;
+    return std::move(vm.value());
+}
+
+// more rows than a batch holds and not a multiple of it, so the last batch is a partial one
+constexpr std::size_t rows = BatchVM::batch_size * 2 + 123;
+}
+
+TEST(BatchTest, MatchesTheRegisterVmRowByRow)
+{
+    std::vector<int64_t> x(rows), y(rows);
+    std::vector<double> f(rows);
+    for (std::size_t row {}; row < rows; row++) {
+        x[row] = static_cast<int64_t>(row) - 1'000;
+        y[row] = static_cast<int64_t>(row % 17) + 1;
+        f[row] = static_cast<double>(row) / 8;
+    }
+    BatchVM::Column const columns[] { std::span<int64_t const> { x }, std::span<int64_t const> { y }, std::span<double const> { f } };
+
+    for (auto source : { "x * y - x / y + x % y;", "-x * 3 < y;", "f * 2.5 - f / 3.0;", "!(x == y) == (f > 100.0);" }) {
+        auto vm     = batch(source);
+        auto result = vm.evaluate(columns, rows);
+        ASSERT_TRUE(result.has_value()) << source << ": " << result.error().message;
+        ASSERT_EQ(result->size(), rows);
+        for (std::size_t row {}; row < rows; row++) {
+            RegisterVM scalar { compile(source).value(), { Register { .i = x[row] }, Register { .i = y[row] }, Register { .f = f[row] } } };
+            scalar.execute();
+            auto expected = scalar.result();
+            switch (vm.result_type()) {
+                case TypeIndex::BOOL: EXPECT_EQ((*result)[row].b, expected.b) << source << " row " << row; break;
+                case TypeIndex::FLOAT64: EXPECT_EQ((*result)[row].f, expected.f) << source << " row " << row; break;
+                default: EXPECT_EQ((*result)[row].i, expected.i) << source << " row " << row; break;
+            }
+        }
+    }
+}
+
+TEST(BatchTest, StringColumnsHoldInternedIds)
+{
+    auto vm = batch("s + \"!\";");
+    std::vector<std::string const*> s;
+    for (std::size_t row {}; row < rows; row++) {
+        s.push_back(vm.intern(row % 3 == 1 ? "b" : "a"));
+    }
+    BatchVM::Column const columns[] { std::span<int64_t const> {}, std::span<int64_t const> {}, std::span<double const> {},
+                                      std::span<std::string const* const> { s } };
+    auto result = vm.evaluate(columns, rows);
+    ASSERT_TRUE(result.has_value()) << result.error().message;
+    EXPECT_EQ(vm.result_type(), TypeIndex::STRING);
+    // results are ids of the same table, equal strings are the same pointer
+    auto a = vm.intern("a!");
+    auto b = vm.intern("b!");
+    for (std::size_t row {}; row < rows; row++) {
+        EXPECT_EQ((*result)[row].s, row % 3 == 1 ? b : a) << "row " << row;
+    }
+}
+
+TEST(BatchTest, DivisionErrorsReportTheirRow)
+{
+    std::vector<int64_t> x(rows, 10), y(rows, 2);
+    y[BatchVM::batch_size + 5] = 0;
+    BatchVM::Column const columns[] { std::span<int64_t const> { x }, std::span<int64_t const> { y } };
+    auto vm     = batch("x / y;");
+    auto result = vm.evaluate(columns, rows);
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error().row, BatchVM::batch_size + 5);
+    EXPECT_EQ(result.error().message, "integer division by zero");
+
+    x[rows - 1] = std::numeric_limits<int64_t>::min();
+    y[rows - 1] = -1;
+    y[BatchVM::batch_size + 5] = 2;
+    auto overflow = vm.evaluate(columns, rows);
+    ASSERT_FALSE(overflow.has_value());
+    EXPECT_EQ(overflow.error().row, rows - 1);
+    EXPECT_EQ(overflow.error().message, "integer division overflows");
+}
+
+TEST(BatchTest, InputsHaveToFitTheParameters)
+{
+    auto vm = batch("x + y;");
+    std::vector<int64_t> x(10);
+    std::vector<double> y(10);
+    BatchVM::Column const missing[] { std::span<int64_t const> { x } };
+    EXPECT_EQ(vm.evaluate(missing, 10).error().message, "missing input 1");
+    BatchVM::Column const mistyped[] { std::span<int64_t const> { x }, std::span<double const> { y } };
+    EXPECT_EQ(vm.evaluate(mistyped, 10).error().message, "input 1 is not a column of i32");
+    BatchVM::Column const short_column[] { std::span<int64_t const> { x }, std::span<int64_t const> { x }.first(4) };
+    auto error = vm.evaluate(short_column, 10).error();
+    EXPECT_EQ(error.row, 4);
+    EXPECT_EQ(error.message, "input 1 has only 4 rows");
+}
+
+TEST(BatchTest, DeclinesCodeThatLogsOrHasNoResult)
+{
+    EXPECT_FALSE(BatchVM::compile(compile("log(x);").value()).has_value());
+    EXPECT_FALSE(BatchVM::compile(compile("x + 1; log(y);").value()).has_value());
+    EXPECT_FALSE(BatchVM::compile(compile("log(y); x + 1;").value()).has_value());
+    EXPECT_TRUE(BatchVM::compile(compile("{ x + 1; }").value()).has_value());
+    EXPECT_FALSE(compile("let z = x; z;").has_value());
+}
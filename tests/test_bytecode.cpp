@@ -1,4 +1,9 @@
+#include <array>
+#include <bit>
+#include <utility>
+
 #include "bytecode.hpp"
+#include "wordcode.hpp"
 #include "gtest/gtest.h"
 
 struct ByteCodeTest : ::testing::Test {
@@ -21,4 +26,93 @@ TEST_F(ByteCodeTest, ReadLineNumberAtByteOffset)
     EXPECT_EQ(bcode.read_line_number(2), 2);
     EXPECT_EQ(bcode.read_line_number(3), 2);
     EXPECT_EQ(bcode.read_line_number(4), 2);
-}
\ No newline at end of file
+}
+
+struct WordCodeTest : ::testing::Test {
+protected:
+    WordCodeTest()
+    {
+        load(int8_t { -3 }, TypeIndex::INT8, 1);
+        load(3.5F, TypeIndex::FLOAT32, 1);
+        bcode.write_byte(std::to_underlying(Opcode::ADD), 2);
+        bcode.write_byte(std::to_underlying(Opcode::LOG), 2);
+        bcode.write_byte(std::to_underlying(Opcode::RETURN), 3);
+    }
+
+    template <typename T>
+    void load(T value, TypeIndex type, std::size_t line_nr)
+    {
+        bcode.write_byte(std::to_underlying(Opcode::LOAD), line_nr);
+        bcode.write_byte(std::to_underlying(type), line_nr);
+        for (auto byte : std::bit_cast<std::array<uint8_t, sizeof(T)>>(value)) {
+            bcode.write_byte(byte, line_nr);
+        }
+    }
+    ByteCode bcode;
+};
+
+TEST_F(WordCodeTest, ReadsMisalignedOperands)
+{
+    EXPECT_EQ(bcode.read_value<int8_t>(2), -3);
+    EXPECT_EQ(bcode.read_value<float>(5), 3.5F);
+}
+
+TEST_F(WordCodeTest, InstructionLength)
+{
+    EXPECT_EQ(util::opcode::length(bcode, 0), 3);
+    EXPECT_EQ(util::opcode::length(bcode, 3), 6);
+    EXPECT_EQ(util::opcode::length(bcode, 9), 1);
+}
+
+TEST_F(WordCodeTest, EncodesOneWordPerInstruction)
+{
+    auto wc = util::wordcode::encode(bcode);
+    ASSERT_TRUE(wc.has_value());
+    ASSERT_EQ(wc->code().size(), 5);
+    EXPECT_EQ(wc->constants().size(), 2);
+
+    EXPECT_EQ(wc->code()[0].opcode(), Opcode::LOAD);
+    EXPECT_EQ(util::type::get_type(wc->code()[0].a()), TypeIndex::INT64);
+    EXPECT_EQ(util::wordcode::constant<int64_t>(*wc, wc->code()[0].b()), -3);
+
+    EXPECT_EQ(util::type::get_type(wc->code()[1].a()), TypeIndex::FLOAT64);
+    EXPECT_EQ(util::wordcode::constant<double>(*wc, wc->code()[1].b()), 3.5);
+
+    EXPECT_EQ(wc->code()[2].opcode(), Opcode::ADD);
+    EXPECT_EQ(wc->code()[4].opcode(), Opcode::RETURN);
+}
+
+TEST_F(WordCodeTest, ReadLineNumberAtInstructionIndex)
+{
+    auto wc = util::wordcode::encode(bcode).value();
+    EXPECT_EQ(wc.read_line_number(0), 1);
+    EXPECT_EQ(wc.read_line_number(1), 1);
+    EXPECT_EQ(wc.read_line_number(2), 2);
+    EXPECT_EQ(wc.read_line_number(3), 2);
+    EXPECT_EQ(wc.read_line_number(4), 3);
+}
+
+TEST(WordCodeJumpTest, JumpTargetsBecomeInstructionIndices)
+{
+    ByteCode bc;
+    bc.write_byte(std::to_underlying(Opcode::LOAD), 1);
+    bc.write_byte(std::to_underlying(TypeIndex::BOOL), 1);
+    bc.write_byte(1, 1);
+    // over the `LOGK` to the `RETURN`
+    bc.write_byte(std::to_underlying(Opcode::JUMP_IF_FALSE), 1);
+    for (auto byte : std::bit_cast<std::array<uint8_t, sizeof(int16_t)>>(int16_t { 4 })) {
+        bc.write_byte(byte, 1);
+    }
+    bc.write_byte(std::to_underlying(Opcode::LOGK), 1);
+    bc.write_byte(std::to_underlying(TypeIndex::INT16), 1);
+    bc.write_byte(7, 1);
+    bc.write_byte(0, 1);
+    bc.write_byte(std::to_underlying(Opcode::RETURN), 1);
+    EXPECT_EQ(util::opcode::jump_target(bc, 3), 10);
+
+    auto wc = util::wordcode::encode(bc);
+    ASSERT_TRUE(wc.has_value());
+    ASSERT_EQ(wc->code().size(), 4);
+    EXPECT_EQ(wc->code()[1].opcode(), Opcode::JUMP_IF_FALSE);
+    EXPECT_EQ(wc->code()[1].b(), 3);
+}
@@ -0,0 +1,117 @@
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <functional>
+#include <memory>
+#include <string_view>
+
+#include "c_backend.hpp"
+#include "compiler.hpp"
+#include "vm.hpp"
+#include "gtest/gtest.h"
+
+#include "compile.hpp"
+
+namespace {
+// everything the interpreter logs for `source`
+auto interpret(std::string_view source) -> std::string
+{
+    auto segment = Compiler { parse(source) }.compile();
+    testing::internal::CaptureStdout();
+    VM { segment }.execute();
+    std::fflush(stdout);
+    return testing::internal::GetCapturedStdout();
+}
+
+// everything the native executable at `path` writes to stdout
+auto run(std::filesystem::path const& path) -> std::string
+{
+    std::unique_ptr<FILE, decltype(&pclose)> pipe { popen(path.c_str(), "r"), &pclose };
+    std::string output;
+    std::array<char, 256> buffer {};
+    while (pipe != nullptr && std::fgets(buffer.data(), buffer.size(), pipe.get()) != nullptr) {
+        output += buffer.data();
+    }
+    return output;
+}
+}
+
+// Every program built ahead of time has to log exactly what the interpreter logs, up to where it halts
+struct CBackendTest : ::testing::TestWithParam<std::string_view> {
+    static void SetUpTestSuite()
+    {
+        if (std::system("cc --version > /dev/null 2>&1") != 0) {
+            s_no_compiler = true;
+        }
+    }
+
+    static inline bool s_no_compiler {};
+};
+
+TEST_P(CBackendTest, MatchesInterpreter)
+{
+    if (s_no_compiler) {
+        GTEST_SKIP() << "no C compiler available";
+    }
+    auto ast    = parse(GetParam());
+    auto binary = std::filesystem::temp_directory_path() / std::format("cpplox_c_backend_{}", std::hash<std::string_view> {}(GetParam()));
+
+    ASSERT_TRUE(CBackend { ast }.build(binary)) << GetParam();
+    EXPECT_EQ(run(binary), interpret(GetParam())) << GetParam();
+
+    std::filesystem::remove(binary);
+    std::filesystem::remove(std::filesystem::path { binary }.concat(".c"));
+}
+
+INSTANTIATE_TEST_SUITE_P(Programs, CBackendTest,
+                         ::testing::Values(
+                             "log(1 + 2 * 3 - 4);",
+                             "log(7 / 2);",
+                             "log(0.1 + 0.2);",
+                             "log(1.0 / 3.0);",
+                             "log(100000000000000000000.0);",
+                             "log(2.5 / 0.5 + 1.0);",
+                             "log(1 < 2);",
+                             "log(2.5 <= 1.0);",
+                             "log(3 == 3);",
+                             "log(!(1 < 2) == false);",
+                             R"(log("a" + "b");)",
+                             R"(log(!"");)",
+                             "let a = 6; let b = a * 7; log(b - a);",
+                             "let a = 1; { let b = a + 1; a = b * 10; } log(a);",
+                             R"(let s = "a"; { let t = s + "b"; s = t + t; } log(s);)",
+                             "let s = 0; for (let i = 1; i <= 100; i = i + 1) { if (i % 3 == 0 or i % 5 == 0) s = s + i; } log(s);",
+                             "let x = 1.5; while (x < 100.0 and x > 0.0) x = x * 2.0; if (x == 192.0) log(x); else log(false);",
+                             "fun fib(n: i32): i32 { if (n < 2) return n; return fib(n - 1) + fib(n - 2); } log(fib(20));",
+                             "let g = 10; fun add(x: i32): i32 { g = g + x; return g; } log(add(1)); log(add(2)); log(g);",
+                             "fun twice(f: fun(i32): i32, x: i32): i32 { return f(f(x)); } fun inc(x: i32): i32 { return x + 1; } { let t = twice; log(t(inc, 5)); }",
+                             "fun make(): fun(i32): i32 { fun double(x: i32): i32 { return x * 2; } return double; } log(make()(21));",
+                             "fun make(n: i32): fun(i32): i32 { fun add(x: i32): i32 { return x + n; } return add; } let a = make(1); let b = make(10); log(a(1) + b(1));",
+                             "fun counter(): fun(): i32 { let c = 0; fun next(): i32 { c = c + 1; return c; } return next; } let c = counter(); c(); log(c()); log(counter()());",
+                             "fun outer(s: string): fun(): string { fun mid(): fun(): string { fun in(): string { s = s + \"!\"; return s; } return in; } return mid(); } let f = outer(\"a\"); f(); log(f());",
+                             "{ let n = 0; fun add(k: i32): i32 { if (k < 1) return n; n = n + k; return add(k - 1); } log(add(4)); log(n); }",
+                             "class P { x: i32; y: i32; init(x: i32, y: i32) { this.x = x; this.y = y; } sum(): i32 { return this.x + this.y; } } let p = P(3, 4); p.x = 10; log(p.sum());",
+                             "class A { f(): i32 { return 1; } g(): i32 { return this.f() * 10; } } class B < A { f(): i32 { return super.f() + 1; } } fun call(a: A): i32 { return a.g(); } log(call(A())); log(call(B()));",
+                             "class A { s: string; init(s: string) { this.s = s; } } class B < A { twice(): string { return this.s + this.s; } } log(B(\"ab\").twice());",
+                             "class N { v: i32; next: N; init(v: i32) { this.v = v; } } let a = N(1); a.next = N(2); a.next.next = a; log(a.next.next.next.v);",
+                             "let a: [i8] = [100, 27, 125]; let b = a + a; log(b[0]); log(b.sum()); log(b.min()); a[1] = a[2]; log(a[1]); log(a.len());",
+                             "let a = [0; 100]; let i = 0; while (i < 100) { a[i] = i * i; i = i + 1; } log((a / [7; 100]).sum()); log((a > [2000; 100])[45]);",
+                             "let a = [1.5, -2.5, 4.0]; log((a * a).max()); log((a <= [1.5; 3])[1]); let f: [f32] = [0.1; 3]; log(f.sum());",
+                             "let a: i64 = 65536; let k: i64 = 8192; let one: i64 = 1; let n = (a * a * a * k) + one; let z: i64 = 0; log(1); log([z; n].len());",
+                             "let m: i64 = 1000000; log(1); log([1; m * m].len());",
+                             "log(1); log(1 / 0); log(2);",
+                             "let z = 0; log(1); log(7 % z); log(2);",
+                             "let u: u64 = 7; let z: u64 = 0; log(u % z); log(2);",
+                             // -2^63 built without overflowing, divided by -1
+                             "let a: i64 = 65536; let b: i64 = 32768; let one: i64 = 1; log(1); log((-b * a * a * a) / -one); log(2);",
+                             "let a: i64 = 65536; let b: i64 = 32768; let one: i64 = 1; log((-b * a * a * a) % -one); log(2);"));
+
+TEST(CBackendSourceTest, ExportsEntryPoint)
+{
+    auto ast    = parse("log(1);");
+    auto source = CBackend { ast }.translate();
+    EXPECT_NE(source.find("void cpplox_run(void)"), std::string::npos);
+    EXPECT_NE(source.find("#ifndef CPPLOX_NO_MAIN"), std::string::npos);
+}
@@ -0,0 +1,78 @@
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "divide.hpp"
+#include "gtest/gtest.h"
+
+namespace {
+auto dividends() -> std::vector<uint64_t>
+{
+    std::vector<uint64_t> values { 0, 1, 2, 3, 7, 100, 12345, 0x7FFF'FFFF, 0x8000'0000, 0xFFFF'FFFF,
+                                   std::numeric_limits<uint64_t>::max(), std::numeric_limits<uint64_t>::max() - 1 };
+    for (uint64_t bit = 1; bit != 0; bit <<= 1) {
+        values.insert(values.end(), { bit - 1, bit, bit + 1 });
+    }
+    return values;
+}
+
+auto divisors() -> std::vector<uint64_t>
+{
+    std::vector<uint64_t> values { 3, 5, 6, 7, 10, 11, 13, 25, 100, 641, 1000, 6700417, 0x8000'0001, std::numeric_limits<uint64_t>::max() };
+    for (uint64_t bit = 1; bit != 0; bit <<= 1) {
+        values.push_back(bit);
+        if (bit > 2) {
+            values.insert(values.end(), { bit - 1, bit + 1 });
+        }
+    }
+    return values;
+}
+}
+
+TEST(DivideTest, PowersOfTwoOnlyShift)
+{
+    EXPECT_TRUE(util::divide::unsigned_divider(64).is_power_of_two());
+    EXPECT_EQ(util::divide::unsigned_divider(64).shift(), 6);
+    EXPECT_TRUE(util::divide::signed_divider(-8).is_power_of_two());
+    EXPECT_EQ(util::divide::signed_divider(-8).more, 3 | util::divide::negative_marker);
+    EXPECT_FALSE(util::divide::unsigned_divider(7).is_power_of_two());
+}
+
+TEST(DivideTest, UnsignedMatchesDivision)
+{
+    for (auto divisor : divisors()) {
+        auto divider = util::divide::unsigned_divider(divisor);
+        for (auto dividend : dividends()) {
+            ASSERT_EQ(util::divide::divide(dividend, divider), dividend / divisor) << dividend << " / " << divisor;
+            ASSERT_EQ(util::divide::remainder(dividend, divider, divisor), dividend % divisor) << dividend << " % " << divisor;
+        }
+    }
+}
+
+TEST(DivideTest, SignedMatchesDivision)
+{
+    for (auto magnitude : divisors()) {
+        for (auto divisor : { static_cast<int64_t>(magnitude), static_cast<int64_t>(0 - magnitude) }) {
+            if (divisor == 0) {
+                continue;
+            }
+            auto divider = util::divide::signed_divider(divisor);
+            for (auto bits : dividends()) {
+                auto dividend = static_cast<int64_t>(bits);
+                // overflows, which strength reduction leaves to `DIV`
+                if (dividend == std::numeric_limits<int64_t>::min() && divisor == -1) {
+                    continue;
+                }
+                ASSERT_EQ(util::divide::divide(dividend, divider), dividend / divisor) << dividend << " / " << divisor;
+                ASSERT_EQ(util::divide::remainder(dividend, divider, divisor), dividend % divisor) << dividend << " % " << divisor;
+            }
+        }
+    }
+}
+
+TEST(DivideTest, DividersAreConstantExpressions)
+{
+    static_assert(util::divide::divide(uint64_t { 1000 }, util::divide::unsigned_divider(7)) == 142);
+    static_assert(util::divide::divide(int64_t { -1000 }, util::divide::signed_divider(7)) == -142);
+    static_assert(util::divide::remainder(int64_t { -1000 }, util::divide::signed_divider(-7), -7) == -6);
+}
@@ -0,0 +1,38 @@
+#include <sstream>
+
+#include "fusion.hpp"
+#include "gtest/gtest.h"
+
+TEST(FusionTest, FixedListFusesEveryOpcodeWithASuperinstruction)
+{
+    auto fusions = Fusions::all();
+    EXPECT_TRUE(fusions.fuses(Opcode::ADD));
+    EXPECT_TRUE(fusions.fuses(Opcode::CMPE));
+    EXPECT_TRUE(fusions.fuses(Opcode::LOG));
+    EXPECT_FALSE(fusions.fuses(Opcode::NEGATE));
+    EXPECT_FALSE(fusions.fuses(Opcode::RETURN));
+    EXPECT_FALSE(Fusions::none().fuses(Opcode::ADD));
+}
+
+TEST(FusionTest, ProfileEnablesFrequentPairsAfterLoad)
+{
+    std::istringstream profile { "LOAD ADD 600\n"
+                                 "LOAD LOAD 300\n"
+                                 "LOAD MUL 5\n"
+                                 "ADD LOG 95\n" };
+    auto fusions = Fusions::from_profile(profile, 0.01);
+    ASSERT_TRUE(fusions.has_value());
+    EXPECT_TRUE(fusions->fuses(Opcode::ADD));
+    EXPECT_FALSE(fusions->fuses(Opcode::MUL));   // 5 out of 1000 pairs
+    EXPECT_FALSE(fusions->fuses(Opcode::LOG));   // frequent but never after a `LOAD`
+    EXPECT_FALSE(fusions->fuses(Opcode::LOAD));  // has no superinstruction
+}
+
+TEST(FusionTest, MalformedProfileIsRejected)
+{
+    std::istringstream unknown_opcode { "LOAD JUMP 10\n" };
+    EXPECT_FALSE(Fusions::from_profile(unknown_opcode).has_value());
+
+    std::istringstream missing_count { "LOAD ADD ten\n" };
+    EXPECT_FALSE(Fusions::from_profile(missing_count).has_value());
+}
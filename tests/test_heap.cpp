@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "heap.hpp"
+#include "vm.hpp"
+#include "gtest/gtest.h"
+
+#include "compile.hpp"
+
+namespace {
+// collects until no major collection runs anymore
+void finish(Heap& heap, std::vector<Stack::value_type>& roots)
+{
+    do {
+        heap.collect({ roots });
+    } while (heap.phase() != Heap::Phase::IDLE);
+}
+
+// longest pause of growing a list of `length` instances, which all stay alive, collecting whenever one is due
+auto longest_pause(std::size_t length) -> std::chrono::nanoseconds
+{
+    StringTable pool;
+    Heap heap { pool };
+    Shape shape { .klass = 0 };
+    std::vector<Stack::value_type> roots { heap.make_instance(&shape) };
+    for (std::size_t node {}; node < length; node++) {
+        auto* instance = heap.make_instance(&shape);
+        instance->fields.push_back(roots[0]);
+        roots[0] = instance;
+        if (heap.is_collection_due()) {
+            heap.collect({ roots });
+        }
+    }
+    while (heap.phase() != Heap::Phase::IDLE) {
+        heap.make_box(int64_t {});
+        heap.collect({ roots });
+    }
+    EXPECT_GT(heap.major_collections(), 0);
+    return heap.pauses().max();
+}
+}
+
+TEST(HeapTest, MinorCollectionsPromoteWhatTheRootsReach)
+{
+    StringTable pool { "constant" };
+    Heap heap { pool };
+    auto constant = pool.find("constant");
+    auto kept     = pool.emplace("kept").first;
+    auto dead     = pool.emplace("dead").first;
+    heap.track(kept);
+    heap.track(dead);
+
+    auto* box = heap.make_box(kept);
+    heap.make_box(dead);
+    std::array<Stack::value_type, 2> roots { box, constant };
+    heap.collect({ roots });
+
+    auto* promoted = std::get<Box*>(roots[0]);
+    EXPECT_NE(promoted, box);
+    EXPECT_TRUE(promoted->is_old);
+    EXPECT_EQ(std::get<StringPtr>(promoted->value), kept);
+    EXPECT_TRUE(pool.contains("constant"));
+    EXPECT_TRUE(pool.contains("kept"));
+    EXPECT_FALSE(pool.contains("dead"));
+    EXPECT_EQ(heap.minor_collections(), 1);
+    EXPECT_EQ(heap.size(), 2);   // the box and its string
+}
+
+TEST(HeapTest, WriteBarrierKeepsWhatOldObjectsReach)
+{
+    StringTable pool;
+    Heap heap { pool };
+    Shape shape { .klass = 0 };
+    std::array<Stack::value_type, 1> roots { heap.make_instance(&shape) };
+    heap.collect({ roots });
+
+    // only the old instance points to the new box, the next collection finds it through the barrier alone
+    auto* instance = std::get<Instance*>(roots[0]);
+    instance->fields.push_back(heap.make_box(int64_t { 42 }));
+    heap.write(*instance);
+    heap.collect({ roots });
+
+    EXPECT_EQ(std::get<Instance*>(roots[0]), instance);
+    auto* box = std::get<Box*>(instance->fields[0]);
+    EXPECT_TRUE(box->is_old);
+    EXPECT_EQ(std::get<int64_t>(box->value), 42);
+}
+
+TEST(HeapTest, MajorCollectionsFreeOldGarbage)
+{
+    StringTable pool;
+    Heap heap { pool };
+    std::vector<Stack::value_type> roots;
+    // more than the nursery holds, the rest start out old
+    for (std::size_t round {}; round < 3; round++) {
+        roots.clear();
+        for (std::size_t box {}; box < Heap::major_threshold; box++) {
+            roots.push_back(heap.make_box(static_cast<int64_t>(box)));
+        }
+        finish(heap, roots);
+    }
+
+    EXPECT_EQ(heap.major_collections(), 3);
+    EXPECT_EQ(heap.size(), Heap::major_threshold);
+    EXPECT_EQ(std::get<int64_t>(std::get<Box*>(roots.back())->value), Heap::major_threshold - 1);
+}
+
+TEST(HeapTest, IncrementalMarkingKeepsWhatTheProgramMovesAround)
+{
+    StringTable pool;
+    Heap heap { pool };
+    Shape shape { .klass = 0 };
+    std::vector<Stack::value_type> roots;
+    for (std::size_t holder {}; holder < Heap::major_threshold; holder++) {
+        auto* instance = heap.make_instance(&shape);
+        instance->fields.push_back(heap.make_box(static_cast<int64_t>(holder)));
+        roots.push_back(instance);
+    }
+    heap.collect({ roots });
+    ASSERT_EQ(heap.phase(), Heap::Phase::MARKING);
+
+    // swapping boxes between holders moves them out of holders marking has yet to scan into ones it already did
+    std::size_t steps {};
+    for (; heap.phase() != Heap::Phase::IDLE; steps++) {
+        auto* lhs = std::get<Instance*>(roots[steps * 7'919 % roots.size()]);
+        auto* rhs = std::get<Instance*>(roots[steps * 104'729 % roots.size()]);
+        std::swap(lhs->fields[0], rhs->fields[0]);
+        heap.write(*lhs);
+        heap.write(*rhs);
+        heap.collect({ roots });
+    }
+
+    EXPECT_GT(steps, 1);
+    EXPECT_EQ(heap.size(), 2 * Heap::major_threshold);
+    int64_t sum {};
+    for (auto const& root : roots) {
+        sum += std::get<int64_t>(std::get<Box*>(std::get<Instance*>(root)->fields[0])->value);
+    }
+    EXPECT_EQ(sum, static_cast<int64_t>(Heap::major_threshold * (Heap::major_threshold - 1) / 2));
+}
+
+TEST(HeapTest, PausePercentilesStayWithinTheirBucket)
+{
+    PauseHistogram pauses;
+    EXPECT_EQ(pauses.percentile(0.99), std::chrono::nanoseconds {});
+    for (int64_t pause = 1; pause <= 100; pause++) {
+        pauses.record(std::chrono::microseconds { pause });
+    }
+
+    EXPECT_EQ(pauses.count(), 100);
+    EXPECT_EQ(pauses.max(), std::chrono::microseconds { 100 });
+    EXPECT_EQ(pauses.total(), std::chrono::microseconds { 5'050 });
+    auto median = pauses.percentile(0.5);
+    EXPECT_GE(median, std::chrono::microseconds { 50 });
+    EXPECT_LT(median, std::chrono::microseconds { 100 });
+    EXPECT_GE(pauses.percentile(0.99), std::chrono::microseconds { 99 });
+    EXPECT_LE(pauses.percentile(0.99), pauses.max());
+}
+
+TEST(HeapTest, PausesStayFlatAsTheOldSpaceGrows)
+{
+    // the shortest of a few runs, so a preempted collection doesn't count as a long one
+    auto shortest = [](std::size_t length) {
+        auto pause = longest_pause(length);
+        for (std::size_t run {}; run < 2; run++) {
+            pause = std::min(pause, longest_pause(length));
+        }
+        return pause;
+    };
+    auto small = shortest(2 * Heap::major_threshold);
+    auto large = shortest(32 * Heap::major_threshold);
+
+    // marking the whole list in one pause would take 16 times as long
+    EXPECT_LT(large, 8 * small) << small.count() << "ns with " << 2 * Heap::major_threshold << " objects";
+}
+
+TEST(HeapTest, LongRunningProgramsStayFlat)
+{
+    // every iteration makes an instance, a closure over a box and a string, which all die young but a few instances
+    auto source = "class N { v: i32; next: N; } fun counter(): fun(): i32 { let c = 0; fun inc(): i32 { c = c + 1; return c; } return inc; }"
+                  R"(let head = N(); head.v = 0; let s = ""; let t = 0;)"
+                  R"(for (let i = 1; i < 50000; i = i + 1) { let n = N(); n.v = i; n.next = head; if (i % 1000 == 0) head = n;)"
+                  R"(t = t + counter()(); s = s + "x"; if (i % 100 == 0) s = ""; })"
+                  "log(head.v); log(head.next.v); log(t); log(s);";
+    auto expected = "49000\n48000\n49999\n" + std::string(99, 'x') + "\n";
+
+    testing::internal::CaptureStdout();
+    VM vm { compile(source) };
+    vm.execute();
+    std::fflush(stdout);
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), expected);
+    EXPECT_GT(vm.heap().minor_collections(), 0);
+    EXPECT_LT(vm.heap().size(), Heap::major_threshold);
+    EXPECT_EQ(vm.heap().pauses().count(), vm.heap().minor_collections());
+
+    testing::internal::CaptureStdout();
+    VM checked { compile(source) };
+    auto error = checked.execute_checked();
+    std::fflush(stdout);
+    EXPECT_FALSE(error.has_value());
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), expected);
+    EXPECT_LT(checked.heap().size(), Heap::major_threshold);
+}
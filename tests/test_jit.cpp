@@ -0,0 +1,75 @@
+#include <cstdio>
+#include <string_view>
+
+#include "jit.hpp"
+#include "vm.hpp"
+#include "gtest/gtest.h"
+
+#include "compile.hpp"
+
+// Every program has to log exactly what the interpreter logs and stop where it stops
+struct JitTest : ::testing::TestWithParam<std::string_view> { };
+
+TEST_P(JitTest, MatchesInterpreter)
+{
+    auto segment = compile(GetParam());
+
+    auto jit = Jit::compile(segment.first);
+    ASSERT_TRUE(jit.has_value()) << GetParam();
+
+    VM vm { segment };
+    auto expected = capture([&] { vm.execute(); });
+    auto actual   = capture([&] { jit->execute(); });
+    EXPECT_EQ(actual, expected) << GetParam();
+    ASSERT_EQ(jit->error().has_value(), vm.error().has_value()) << GetParam();
+    if (vm.error().has_value()) {
+        EXPECT_EQ(jit->error()->offset, vm.error()->offset) << GetParam();
+        EXPECT_EQ(jit->error()->message, vm.error()->message) << GetParam();
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Programs, JitTest,
+                         ::testing::Values(
+                             "log(1 + 2 * 3 - 4);",
+                             "log((1 + 2) * 3);",
+                             "log(7 / 2);",
+                             "log(1.5 * 2.0 - 0.25);",
+                             "log(2.5 / 0.5 + 1.0);",
+                             "log(1 < 2);",
+                             "log(3 > 4);",
+                             "log(2.5 <= 1.0);",
+                             "log(2.5 >= 1.0);",
+                             "log(3 == 3);",
+                             "log(1.0 != 2.0);",
+                             "log(!true);",
+                             "log(!(1 < 2) == false);",
+                             "let a = 6; let b = a * 7; log(b - a);",
+                             "let a = 1; { let b = a + 1; a = b * 10; } log(a);",
+                             "{ let a = 2.5; let b = a; b = b * a; log(b); }",
+                             "{ let a = 1; let b = 2; let c = 3; a = c; c = b; b = a; log(a * 100 + b * 10 + c); }",
+                             "if (1 < 2) log(1); else log(2);",
+                             "let i = 0; while (i < 5) { log(i); i = i + 1; }",
+                             "let s = 0; for (let i = 1; i <= 100; i = i + 1) { if (i % 3 == 0 or i % 5 == 0) s = s + i; } log(s);",
+                             "{ let x = 2.5; while (x < 100.0) x = x * 2.0; log(x); }",
+                             "let x = 0.0 / 0.0; if (x < 1.0) log(1); if (x >= 1.0) log(2); if (x == x) log(3); if (x != x) log(4);",
+                             "let u: u64 = 3; let z: u64 = 0; let one: u64 = 1; let k = 0; while (u > z) { u = u - one; k = k + 1; } log(k);",
+                             "log(true and false); log(false or true); let a = 0; let b = false and (a = 1) == 1; log(a);",
+                             "for (let i = 0; i < 3; i = i + 1) for (let j = 0; j < 2; j = j + 1) log(i * 10 + j);",
+                             "log(1); log(1 / 0); log(2);",
+                             "let z = 0; log(1); log(7 % z); log(2);",
+                             "let u: u64 = 7; let z: u64 = 0; log(u % z); log(2);",
+                             // -2^63 built without overflowing, divided by -1
+                             "let a: i64 = 65536; let b: i64 = 32768; let one: i64 = 1; log(1); log((-b * a * a * a) / -one); log(2);",
+                             "let a: i64 = 65536; let b: i64 = 32768; let one: i64 = 1; log((-b * a * a * a) % -one); log(2);"));
+
+TEST(JitFallbackTest, StringsAreLeftToTheInterpreter)
+{
+    auto segment = compile(R"(log("a" + "b");)");
+    EXPECT_FALSE(Jit::compile(segment.first).has_value());
+}
+
+TEST(JitFallbackTest, FunctionsAreLeftToTheInterpreter)
+{
+    auto segment = compile("fun f(n: i32): i32 { return n * 2; } log(f(21));");
+    EXPECT_FALSE(Jit::compile(segment.first).has_value());
+}
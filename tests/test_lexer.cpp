@@ -357,6 +357,16 @@ TEST_F(LexerTest, NoEndQuoteInterPolatedStringTest)
     EXPECT_EQ(tokens.at(4).type, result.type);
 }
 
+TEST(LexerStringTest, StringSpansLines)
+{
+    auto tokens = Lexer { "\"two\nlines\" 1" }.scan();
+
+    ASSERT_EQ(tokens.size(), 3);
+    EXPECT_EQ(tokens.at(0).type, TokenType::STRING);
+    EXPECT_EQ(tokens.at(0).word, "two\nlines");
+    EXPECT_EQ(tokens.at(1).line, 2);
+}
+
 TEST_F(LexerTest, CommentTest)
 {
     using enum TokenType;
@@ -448,4 +458,35 @@ TEST_F(LexerTest, CommentWithThreeSlashTest)
     result.type = END;
     result.word = "";
     EXPECT_EQ(tokens.at(5), result);
-}
\ No newline at end of file
+}
+
+TEST(LexerColumnTest, TokensKnowTheirColumn)
+{
+    auto tokens = Lexer { "log(1 +\n\t 22);" }.scan();
+
+    std::vector<std::pair<std::size_t, std::size_t>> locations;
+    for (auto const& token : tokens) {
+        locations.emplace_back(token.line, token.column);
+    }
+    std::vector<std::pair<std::size_t, std::size_t>> expected { { 1, 1 }, { 1, 4 }, { 1, 5 }, { 1, 7 }, { 2, 3 }, { 2, 5 }, { 2, 6 }, { 2, 7 } };
+    EXPECT_EQ(locations, expected);
+}
+
+TEST(LexerTypeTest, TypeNamesAreKeywords)
+{
+    using enum TokenType;
+    auto tokens = Lexer { "bool i8 i16 i32 i64 u8 u16 u32 u64 f32 f64 f3 float" }.scan();
+    std::vector<TokenType> types;
+    for (auto const& token : tokens) {
+        types.push_back(token.type);
+    }
+    std::vector<TokenType> expected { BOOL, INT8, INT16, INT32, INT64, UINT8, UINT16, UINT32, UINT64, FLOAT32, FLOAT64, IDENTIFIER, IDENTIFIER, END };
+    EXPECT_EQ(types, expected);
+}
+
+TEST(LexerTypeTest, EmptySourceIsJustTheEnd)
+{
+    auto tokens = Lexer { "" }.scan();
+    ASSERT_EQ(tokens.size(), 1);
+    EXPECT_EQ(tokens.front().type, TokenType::END);
+}
@@ -0,0 +1,71 @@
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <sstream>
+#include <string>
+
+#include "instr.hpp"
+#include "opcode_profile.hpp"
+#include "gtest/gtest.h"
+
+namespace {
+// probes `opcodes` in order as one run would
+void run(OpcodeProfile& profile, std::initializer_list<Opcode> opcodes)
+{
+    profile.start();
+    for (auto opcode : opcodes) {
+        auto probe = profile.probe(opcode);
+    }
+}
+}
+
+TEST(OpcodeProfileTest, CountsOpcodesAndThePairsOfEachRun)
+{
+    using enum Opcode;
+
+    testing::internal::CaptureStderr();
+    {
+        OpcodeProfile profile;
+        run(profile, { LOAD, LOAD, ADD, LOG, RETURN });
+        run(profile, { LOAD, LOG, RETURN });
+
+        EXPECT_EQ(profile.count(LOAD), 3);
+        EXPECT_EQ(profile.count(ADD), 1);
+        EXPECT_EQ(profile.count(LOG), 2);
+        EXPECT_EQ(profile.count(RETURN), 2);
+        EXPECT_EQ(profile.count(MUL), 0);
+
+        EXPECT_EQ(profile.pairs(LOAD, LOAD), 1);
+        EXPECT_EQ(profile.pairs(LOAD, ADD), 1);
+        EXPECT_EQ(profile.pairs(ADD, LOG), 1);
+        EXPECT_EQ(profile.pairs(LOAD, LOG), 1);
+        EXPECT_EQ(profile.pairs(LOG, RETURN), 2);
+        // the second run starts over instead of following the first one's `RETURN`
+        EXPECT_EQ(profile.pairs(RETURN, LOAD), 0);
+        EXPECT_EQ(profile.pairs(ADD, LOAD), 0);
+    }
+    // the profile reports what it counted when it goes away
+    EXPECT_NE(testing::internal::GetCapturedStderr().find("LOAD"), std::string::npos);
+}
+
+TEST(OpcodeProfileTest, DumpsEveryExecutedPairOnce)
+{
+    using enum Opcode;
+
+    auto path = std::filesystem::temp_directory_path() / "cpplox_opcode_profile_test";
+    testing::internal::CaptureStderr();
+    {
+        OpcodeProfile profile;
+        run(profile, { LOAD, ADD, LOAD, ADD, RETURN });
+        profile.dump_pairs(path.c_str());
+    }
+    testing::internal::GetCapturedStderr();
+
+    std::ifstream file { path };
+    std::stringstream pairs;
+    pairs << file.rdbuf();
+    EXPECT_EQ(pairs.str(), "ADD LOAD 1\n"
+                           "ADD RETURN 1\n"
+                           "LOAD ADD 2\n");
+    std::filesystem::remove(path);
+}
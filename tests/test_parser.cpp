@@ -0,0 +1,264 @@
+#include <string_view>
+
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "gtest/gtest.h"
+
+namespace {
+auto parse(std::string_view source) -> std::optional<StmtType>
+{
+    return Parser { Lexer { source }.scan() }.parse();
+}
+
+// statements of the program block
+auto statements(StmtType const& program) -> std::vector<StmtType> const&
+{
+    return std::get<std::unique_ptr<Block>>(program)->stmts;
+}
+
+auto binding(StmtType const& stmt) -> Binding
+{
+    return std::get<std::unique_ptr<Let>>(stmt)->binding;
+}
+
+// expression the first statement of the program logs
+auto logged(StmtType const& program) -> ExprType const&
+{
+    return std::get<std::unique_ptr<Log>>(statements(program).at(0))->expr;
+}
+}
+
+TEST(ParserTest, ModulusIsNotFollowedByAComparison)
+{
+    auto ast = parse("log(7 % 3);");
+    ASSERT_TRUE(ast.has_value());
+    EXPECT_TRUE(std::holds_alternative<std::unique_ptr<Modulus>>(logged(ast.value())));
+    EXPECT_EQ(util::type::get_type(logged(ast.value())), TypeIndex::INT32);
+}
+
+TEST(ParserTest, NegationIsNotFollowedByANot)
+{
+    auto ast = parse("log(-5);");
+    ASSERT_TRUE(ast.has_value());
+    EXPECT_TRUE(std::holds_alternative<std::unique_ptr<Negate>>(logged(ast.value())));
+    EXPECT_EQ(util::type::get_type(logged(ast.value())), TypeIndex::INT32);
+}
+
+TEST(ParserTest, TopLevelVariablesAreGlobals)
+{
+    auto ast = parse("let a = 1; let b = true; let a = 2.5;");
+    ASSERT_TRUE(ast.has_value());
+    auto const& stmts = statements(ast.value());
+    ASSERT_EQ(stmts.size(), 3);
+    for (std::size_t index {}; index < stmts.size(); index++) {
+        EXPECT_EQ(binding(stmts[index]).scope, Binding::Scope::GLOBAL);
+        EXPECT_EQ(binding(stmts[index]).index, index);   // redeclaring a global makes a new one
+    }
+}
+
+TEST(ParserTest, BlockVariablesAreStackSlots)
+{
+    auto ast = parse("{ let a = 1; { let b = a; } let c = a; }");
+    ASSERT_TRUE(ast.has_value());
+    auto const& outer = std::get<std::unique_ptr<Block>>(statements(ast.value()).at(0));
+    EXPECT_EQ(outer->locals, 2);
+    EXPECT_EQ(binding(outer->stmts.at(0)).index, 0);
+    EXPECT_EQ(binding(outer->stmts.at(2)).index, 1);   // `b` was popped with its block
+
+    auto const& inner = std::get<std::unique_ptr<Block>>(outer->stmts.at(1));
+    EXPECT_EQ(inner->locals, 1);
+    EXPECT_EQ(binding(inner->stmts.at(0)).scope, Binding::Scope::LOCAL);
+    EXPECT_EQ(binding(inner->stmts.at(0)).index, 1);
+}
+
+TEST(ParserTest, AnnotationsRetypeLiterals)
+{
+    auto ast = parse("let a: u8 = 200; let b: f64 = 1;");
+    ASSERT_TRUE(ast.has_value());
+    auto const& stmts = statements(ast.value());
+    EXPECT_EQ(util::type::get_type(std::get<std::unique_ptr<Let>>(stmts.at(0))->initializer), TypeIndex::UINT8);
+    EXPECT_EQ(util::type::get_type(std::get<std::unique_ptr<Let>>(stmts.at(1))->initializer), TypeIndex::FLOAT64);
+}
+
+TEST(ParserTest, AcceptsValidPrograms)
+{
+    for (auto source : { "", "{ }", "let a = 1; { let a = a + 1; log(a); } log(a);", "let a = 1; let b = 2; a = b = a + b;", "let a = 1; a;",
+                         "if (1 < 2) log(1); else if (true) log(2); else { log(3); }", "let i = 0; while (i < 3) i = i + 1;",
+                         "for (let i = 0; i < 3; i = i + 1) log(i);", "for (;;) { }", "log(true and !false or 1 == 2);" }) {
+        EXPECT_TRUE(parse(source).has_value()) << source;
+    }
+}
+
+TEST(ParserTest, RejectsInvalidPrograms)
+{
+    for (auto source : { "log(x);",
+                         "let a = 1; a = true;",
+                         "let a: i8 = 300;",
+                         "let a: bool = 1;",
+                         "1 = 2;",
+                         "let a = 1; let b = 2; a + b = 3;",
+                         "{ let a = 1; let a = 2; }",
+                         "{ let a = 1; } log(a);",
+                         "let = 5;",
+                         "let a 5;",
+                         "let a = 1",
+                         "{ let a = 1;",
+                         "if (1) log(1);",
+                         "while (\"a\") { }",
+                         "if 1 < 2 log(1);",
+                         "for (let i = 0; i; i = i + 1) { }",
+                         "for (let i = 0; i < 3; i = i + 1) { } log(i);",
+                         "if (true) let a = 1;",
+                         "log(1 and true);",
+                         "log(true or 2.5);" }) {
+        EXPECT_FALSE(parse(source).has_value()) << source;
+    }
+}
+
+TEST(ParserTest, ForLoopsAreDesugaredIntoWhile)
+{
+    auto ast = parse("for (let i = 0; i < 3; i = i + 1) log(i);");
+    ASSERT_TRUE(ast.has_value());
+    // the initializer's block, holding the loop variable as its only local
+    auto const& scope = std::get<std::unique_ptr<Block>>(statements(ast.value()).at(0));
+    EXPECT_EQ(scope->locals, 1);
+    ASSERT_EQ(scope->stmts.size(), 2);
+    EXPECT_EQ(binding(scope->stmts.at(0)).scope, Binding::Scope::LOCAL);
+
+    // the body runs before the increment
+    auto const& loop = std::get<std::unique_ptr<While>>(scope->stmts.at(1));
+    auto const& body = std::get<std::unique_ptr<Block>>(loop->body);
+    ASSERT_EQ(body->stmts.size(), 2);
+    EXPECT_TRUE(std::holds_alternative<std::unique_ptr<Log>>(body->stmts.at(0)));
+    EXPECT_TRUE(std::holds_alternative<std::unique_ptr<Expression>>(body->stmts.at(1)));
+}
+
+TEST(ParserTest, FunctionsAreTypeChecked)
+{
+    for (auto source : { "fun f(a: i32, b: i32): i32 { return a + b; } log(f(1, 2));",
+                         "fun f(n: i32): i32 { if (n < 2) return n; return f(n - 1) + f(n - 2); }",
+                         "fun f(): i32 { if (true) return 1; else return 2; }",
+                         "fun f(): i32 { { return 1; } }",
+                         "fun twice(g: fun(i32): i32, x: i32): i32 { return g(g(x)); }",
+                         "fun make(): fun(): bool { fun t(): bool { return true; } return t; } log(make()());",
+                         "let n = 1; fun f(): i32 { return n; } { let g = f; log(g()); }",
+                         "{ let a = 1; fun f(): i32 { return a; } }" }) {
+        EXPECT_TRUE(parse(source).has_value()) << source;
+    }
+    for (auto source : { "fun f(a: i32): i32 { return a; } log(f());",
+                         "fun f(a: i32): i32 { return a; } log(f(true));",
+                         "fun f(): i32 { return true; }",
+                         "fun f(): i32 { log(1); }",
+                         "fun f(): i32 { if (true) return 1; }",
+                         "fun f(): i32 { while (true) return 1; }",
+                         "return 1;",
+                         "let a = 1; a();",
+                         "fun f(): i32 { return 1; } log(f);",
+                         "fun f(): i32 { return 1; } log(f == f);",
+                         "fun f(): i32 { return 1; } let g: fun(): bool = f;",
+                         "fun f(): i32 { return 1; } f = f;" }) {
+        EXPECT_FALSE(parse(source).has_value()) << source;
+    }
+}
+
+TEST(ParserTest, ParametersAreTheFirstLocalsOfTheFrame)
+{
+    auto ast = parse("{ let a = 1; fun f(x: i32, y: i32): i32 { let z = x; return z; } }");
+    ASSERT_TRUE(ast.has_value());
+    auto const& block = std::get<std::unique_ptr<Block>>(statements(ast.value()).at(0));
+    auto const& fun   = std::get<std::unique_ptr<Fun>>(block->stmts.at(1));
+    // the function itself is the enclosing block's second local, its body counts from its own frame
+    EXPECT_EQ(fun->binding.scope, Binding::Scope::LOCAL);
+    EXPECT_EQ(fun->binding.index, 1);
+    EXPECT_EQ(fun->parameters.size(), 2);
+    EXPECT_EQ(binding(fun->body.at(0)).index, 2);
+}
+
+TEST(ParserTest, ClosuresBoxOnlyVariablesChangedAfterCapturing)
+{
+    auto ast = parse("fun make(n: i32): fun(): i32 { let c = 0; fun next(): i32 { c = c + n; return c; } fun peek(): i32 { return next(); } return peek; }");
+    ASSERT_TRUE(ast.has_value());
+    auto const& make = std::get<std::unique_ptr<Fun>>(statements(ast.value()).at(0));
+    auto const& next = std::get<std::unique_ptr<Fun>>(make->body.at(1));
+    auto const& peek = std::get<std::unique_ptr<Fun>>(make->body.at(2));
+
+    // `c` is assigned in the closure, `n` never changes once captured
+    EXPECT_TRUE(binding(make->body.at(0)).boxed);
+    EXPECT_FALSE(make->parameters.at(0).binding.boxed);
+    ASSERT_EQ(next->captures.size(), 2);
+    EXPECT_EQ(next->captures.at(0).name, "c");
+    EXPECT_EQ(next->captures.at(0).source.scope, Binding::Scope::LOCAL);
+    EXPECT_TRUE(next->captures.at(0).source.boxed);
+    EXPECT_FALSE(next->captures.at(1).source.boxed);
+
+    // `peek` calls `next` through a capture, which needs `next` as a value, and `peek` itself is returned
+    ASSERT_EQ(peek->captures.size(), 1);
+    EXPECT_EQ(peek->captures.at(0).name, "next");
+    EXPECT_TRUE(next->escapes);
+    EXPECT_TRUE(peek->escapes);
+}
+
+TEST(ParserTest, FunctionsCalledWhereDeclaredDoNotEscape)
+{
+    auto ast = parse("{ let a = 1; fun f(k: i32): i32 { if (k < 1) return a; return f(k - 1); } log(f(3)); a = 2; }");
+    ASSERT_TRUE(ast.has_value());
+    auto const& block = std::get<std::unique_ptr<Block>>(statements(ast.value()).at(0));
+    auto const& fun   = std::get<std::unique_ptr<Fun>>(block->stmts.at(1));
+    EXPECT_FALSE(fun->escapes);
+    // assigned after the capture, so the closure and the block share a box
+    EXPECT_TRUE(binding(block->stmts.at(0)).boxed);
+    ASSERT_EQ(fun->captures.size(), 1);
+    EXPECT_TRUE(fun->captures.at(0).source.boxed);
+}
+
+TEST(ParserTest, ClassesAreTypeChecked)
+{
+    for (auto source : { "class P { x: i32; init(x: i32) { this.x = x; } get(): i32 { return this.x; } } log(P(1).get());",
+                         "class P { x: i32; } let p = P(); p.x = 2; log(p.x);",
+                         "class N { next: N; } let n = N(); n.next = n;",
+                         "class A { f(): i32 { return 1; } } class B < A { f(): i32 { return super.f() + 1; } }",
+                         "class A { } class B < A { } fun f(a: A): A { return a; } let a = f(B());",
+                         "class A { } class B < A { } class H { a: A; } let h = H(); h.a = B();" }) {
+        EXPECT_TRUE(parse(source).has_value()) << source;
+    }
+    for (auto source : { "class P { x: i32; } let p = P(); p.x = true;",
+                         "class P { x: i32; } let p = P(); log(p.y);",
+                         "class P { x: i32; } log(P());",
+                         "class P { f(): i32 { return 1; } } let p = P(); log(p.f);",
+                         "class P { init() { } } let p = P(); p.init();",
+                         "class P { init() { return this; } }",
+                         "class P { f(): i32 { } }",
+                         "class P { x: i32; x(): i32 { return 1; } }",
+                         "class A { f(): i32 { return 1; } } class B < A { f(): bool { return true; } }",
+                         "class B < A { }",
+                         "class A { } class B < A { } fun f(b: B): i32 { return 1; } log(f(A()));",
+                         "class A { } class B < A { } let b = B(); b = A();",
+                         "log(this);",
+                         "fun f(): i32 { return super.f(); }",
+                         "class A { f(): i32 { return super.f(); } }",
+                         "{ class A { } }",
+                         "let a = 1; log(a.x);" }) {
+        EXPECT_FALSE(parse(source).has_value()) << source;
+    }
+}
+
+TEST(ParserTest, MethodsTakeTheInstanceFirst)
+{
+    auto ast = parse("class P { x: i32; init(x: i32) { this.x = x; } get(y: i32): i32 { return this.x + y; } }");
+    ASSERT_TRUE(ast.has_value());
+    auto const& klass = std::get<std::unique_ptr<Class>>(statements(ast.value()).at(0));
+    EXPECT_EQ(klass->binding.scope, Binding::Scope::GLOBAL);
+    ASSERT_EQ(klass->methods.size(), 2);
+
+    // calling the class takes what `init` does after `this`, and `init` hands `this` back
+    auto const& init = klass->methods.at(0);
+    ASSERT_EQ(klass->constructor->parameters.size(), 1);
+    EXPECT_EQ(init->parameters.size(), 2);
+    EXPECT_EQ(init->signature->parameters.at(0).klass, klass->type.get());
+    EXPECT_EQ(init->signature->result.klass, klass->type.get());
+    EXPECT_TRUE(std::holds_alternative<std::unique_ptr<Return>>(init->body.back()));
+
+    auto const& get = klass->methods.at(1);
+    EXPECT_EQ(get->parameters.at(0).binding.index, 0);
+    EXPECT_EQ(get->parameters.at(1).binding.index, 1);
+}
@@ -0,0 +1,62 @@
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "perf_counters.hpp"
+#include "gtest/gtest.h"
+
+namespace {
+// whitespace separated fields of the row `report` prints
+auto fields(PerfCounters::Reading const& reading, std::size_t bytecode_instructions) -> std::vector<std::string>
+{
+    std::ostringstream os;
+    PerfCounters::report(os, "execute", reading, bytecode_instructions);
+    std::istringstream row { os.str() };
+    std::vector<std::string> fields;
+    for (std::string field; row >> field;) {
+        fields.push_back(field);
+    }
+    return fields;
+}
+}
+
+// Without a single counter, off Linux or with a strict `perf_event_paranoid`, a run reads nothing instead of failing
+TEST(PerfCountersTest, UnavailableCountersReadNothing)
+{
+    PerfCounters perf;
+    if (perf.available()) {
+        GTEST_SKIP() << "perf counters are available on this machine";
+    }
+    perf.start();
+    auto reading = perf.stop();
+    EXPECT_TRUE(std::ranges::none_of(reading, [](auto const& value) { return value.has_value(); }));
+}
+
+TEST(PerfCountersTest, EmptyReadingReportsEveryColumnAsMissing)
+{
+    auto row = fields({}, 1'000);
+    ASSERT_EQ(row.size(), 11U);
+    EXPECT_EQ(row[0], "execute");
+    EXPECT_TRUE(std::all_of(row.begin() + 1, row.end(), [](auto const& field) { return field == "-"; }));
+}
+
+TEST(PerfCountersTest, MissingEventsOnlyBlankTheirOwnColumns)
+{
+    PerfCounters::Reading reading {};
+    reading[std::to_underlying(PerfCounters::Event::CYCLES)]       = 2'000;
+    reading[std::to_underlying(PerfCounters::Event::INSTRUCTIONS)] = 3'000;
+
+    auto row = fields(reading, 1'000);
+    ASSERT_EQ(row.size(), 11U);
+    EXPECT_EQ(row[1], "2000");
+    EXPECT_EQ(row[2], "3000");
+    EXPECT_EQ(row[3], "1.500");   // instructions per cycle
+    EXPECT_EQ(row[4], "-");
+    EXPECT_EQ(row[7], "2.000");   // cycles per bytecode instruction
+    EXPECT_EQ(row[8], "-");
+
+    // without an instruction count there are no per bytecode figures at all
+    EXPECT_EQ(fields(reading, 0)[7], "-");
+}
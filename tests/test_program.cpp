@@ -0,0 +1,115 @@
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "program.hpp"
+#include "gtest/gtest.h"
+
+namespace {
+std::vector<Parser::Input> const parameters {
+    { "x", Type { TypeIndex::INT32 } },
+    { "y", Type { TypeIndex::INT32 } },
+    { "name", Type { TypeIndex::STRING } },
+};
+
+auto compile(std::string_view source) -> Program
+{
+    auto program = Program::compile(source, parameters);
+    EXPECT_TRUE(program.has_value()) << source;
+    return std::move(program.value());
+}
+
+auto arguments(int64_t x, int64_t y, std::string name = "") -> std::vector<Program::Value>
+{
+    return { x, y, std::move(name) };
+}
+}
+
+TEST(ProgramTest, RunsAgainForEveryBindingOfTheParameters)
+{
+    auto program = compile("let z = x * y; z + 1;");
+    auto session = program.session();
+    for (int64_t x {}; x < 100; x++) {
+        auto result = session.run(arguments(x, 3));
+        ASSERT_TRUE(result.has_value()) << result.error().message;
+        EXPECT_EQ(result->value(), Program::Value { x * 3 + 1 });
+    }
+    EXPECT_EQ(program.run(arguments(-4, 5)).value(), Program::Value { int64_t { -19 } });
+}
+
+TEST(ProgramTest, StringsComeAndGoByValue)
+{
+    auto program = compile(R"(fun greet(who: str): str { return "hello " + who; } greet(name);)");
+    auto session = program.session();
+    for (auto name : { "a", "b", "a" }) {
+        auto result = session.run(arguments(0, 0, name));
+        ASSERT_TRUE(result.has_value()) << result.error().message;
+        EXPECT_EQ(result->value(), Program::Value { std::string { "hello " } + name });
+    }
+}
+
+TEST(ProgramTest, OnlyAnExpressionStatementLastHasAResult)
+{
+    auto program = compile("log(x + y);");
+    testing::internal::CaptureStdout();
+    auto result = program.run(arguments(3, 4));
+    std::fflush(stdout);
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "7\n");
+    ASSERT_TRUE(result.has_value()) << result.error().message;
+    EXPECT_FALSE(result->has_value());
+}
+
+TEST(ProgramTest, ErrorsEndTheRunNotTheHost)
+{
+    auto program = compile("x / y;");
+    auto session = program.session();
+    auto error   = session.run(arguments(1, 0)).error();
+    EXPECT_EQ(error.line, 1);
+    EXPECT_EQ(error.message, "integer division by zero");
+    EXPECT_EQ(session.run(arguments(6, 3)).value(), Program::Value { int64_t { 2 } });
+
+    EXPECT_EQ(session.run(arguments(1, 2)).value(), Program::Value { int64_t { 0 } });
+    EXPECT_EQ(session.run({}).error().message, "expected 3 arguments but got 0");
+    EXPECT_EQ(session.run(std::vector<Program::Value> { 1.5, int64_t { 1 }, std::string {} }).error().message, "argument 0 is not a i32");
+    EXPECT_EQ(session.run(arguments(int64_t { 1 } << 40, 1)).error().message, "argument 0 is not a i32");
+    EXPECT_FALSE(Program::compile("log(z);", parameters).has_value());
+}
+
+TEST(ProgramTest, CodeFailingVerificationIsNotRun)
+{
+    // a body too long to jump over leaves a jump into itself, which the verifier rejects
+    std::string source = "let n = y; if (x > 0) {";
+    for (int statement {}; statement < 10'000; statement++) {
+        source += " n = n + 1;";
+    }
+    source += " } n;";
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(Program::compile(source, parameters).has_value());
+    EXPECT_NE(testing::internal::GetCapturedStderr().find("failed verification"), std::string::npos);
+}
+
+TEST(ProgramTest, ThreadsShareAProgram)
+{
+    auto program = compile("fun sum(n: i32): i32 { let t = 0; let i = 0; while (i < n) { t = t + i; i = i + 1; } return t; } sum(x) + y;");
+    std::atomic<int> failures {};
+    std::vector<std::thread> threads;
+    for (int64_t thread {}; thread < 4; thread++) {
+        threads.emplace_back([&program, &failures, thread] {
+            auto session = program.session();
+            for (int64_t x {}; x < 200; x++) {
+                auto result = session.run(arguments(x, thread));
+                if (!result.has_value() || result->value() != Program::Value { x * (x - 1) / 2 + thread }) {
+                    failures++;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(failures, 0);
+}
@@ -0,0 +1,65 @@
+#include <cstdio>
+#include <string_view>
+
+#include "compiler.hpp"
+#include "register_compiler.hpp"
+#include "register_vm.hpp"
+#include "vm.hpp"
+#include "gtest/gtest.h"
+
+#include "compile.hpp"
+
+// Every program has to log exactly what the stack vm logs and stop on the same line for the same reason
+struct RegisterTest : ::testing::TestWithParam<std::string_view> { };
+
+TEST_P(RegisterTest, MatchesInterpreter)
+{
+    auto ast  = parse(GetParam());
+    auto code = RegisterCompiler { ast }.compile();
+    ASSERT_TRUE(code.has_value()) << GetParam();
+
+    VM vm { Compiler { std::move(ast) }.compile() };
+    RegisterVM registers { std::move(code.value()) };
+    auto expected = capture([&] { vm.execute(); });
+    auto actual   = capture([&] { registers.execute(); });
+    EXPECT_EQ(actual, expected) << GetParam();
+    ASSERT_EQ(registers.error().has_value(), vm.error().has_value()) << GetParam();
+    if (vm.error().has_value()) {
+        EXPECT_EQ(registers.code().read_line_number(registers.error()->offset), vm.bytecode().read_line_number(vm.error()->offset)) << GetParam();
+        EXPECT_EQ(registers.error()->message, vm.error()->message) << GetParam();
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Programs, RegisterTest,
+                         ::testing::Values(
+                             "log(1 + 2 * 3 - 4);",
+                             "log((1 + 2) * 3);",
+                             "log(7 / 2); log(7 % 2); log(-7 / 2); log(-7 % 2);",
+                             "log(1.5 * 2.0 - 0.25); log(1.0 / 3.0); log(7.5 % 2.0);",
+                             "log(4294967296 * 2);",
+                             "log(1 < 2); log(3 > 4); log(2 <= 2); log(2 >= 3);",
+                             "log(2.5 <= 1.0); log(1.0 != 2.0); log(0.0 / 0.0 == 0.0 / 0.0);",
+                             "log(3 == 3); log(true == false); log(3 != 4);",
+                             R"(log(!true); log(!0); log(!1.5); log(!"");)",
+                             "log(-(3)); log(-2.5); log(--4);",
+                             R"(log("a" + "b"); log("" + "");)",
+                             "log(1);\nlog(1 / 0);\nlog(2);",
+                             "log(1);\n\nlog(1 % 0);",
+                             "log(1.0 / 0.0); log(1.0 % 0.0);"));
+
+TEST(RegisterResultTest, LastExpressionStatementIsTheResult)
+{
+    auto ast  = parse("log(1); 6 * 7;");
+    auto code = RegisterCompiler { ast }.compile();
+    ASSERT_TRUE(code.has_value());
+
+    RegisterVM registers { std::move(code.value()) };
+    capture([&] { registers.execute(); });
+    EXPECT_EQ(registers.result().i, 42);
+}
+
+TEST(RegisterFallbackTest, VariablesAreLeftToTheStackEngine)
+{
+    auto ast = parse("let a = 1; log(a);");
+    EXPECT_FALSE(RegisterCompiler { ast }.compile().has_value());
+}
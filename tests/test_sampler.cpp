@@ -0,0 +1,113 @@
+#include <csignal>
+#include <cstddef>
+#include <format>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include "sampler.hpp"
+#include "vm.hpp"
+#include "gtest/gtest.h"
+
+#include "compile.hpp"
+
+namespace {
+// the loop sits on lines 4 to 7 inside `count`, which spans lines 1 to 9
+constexpr std::string_view source { "fun count(n: i32): i32 {\n"
+                                    "    let t = 0;\n"
+                                    "    let i = 0;\n"
+                                    "    while (i < n) {\n"
+                                    "        t = t + 1;\n"
+                                    "        i = i + 1;\n"
+                                    "    }\n"
+                                    "    return t;\n"
+                                    "}\n"
+                                    "count(1000000);\n" };
+constexpr std::size_t lines { 10 };
+
+// runs `source` under `sampler` until it took enough samples to report on
+void sample(Sampler& sampler)
+{
+    VM vm { compile(source) };
+    ASSERT_TRUE(sampler.start(vm.bytecode(), vm.sampled_instruction_pointer()));
+    for (int run {}; run < 1000 && sampler.samples() < 20; run++) {
+        vm.reset();
+        vm.execute();
+    }
+    sampler.stop();
+    ASSERT_GE(sampler.samples(), 20U);
+}
+}
+
+TEST(SamplerTest, FlatReportNamesTheLinesOfTheLoop)
+{
+    Sampler sampler;
+    sample(sampler);
+    std::stringstream report;
+    sampler.report_flat(report);
+
+    std::string row;
+    std::getline(report, row);
+    EXPECT_TRUE(std::regex_match(row, std::regex { R"( +LINE +SAMPLES +%)" })) << row;
+
+    std::regex const line_row { R"( +(\d+) +(\d+) +(\d+\.\d\d))" };
+    std::size_t total {};
+    std::smatch match;
+    while (std::getline(report, row) && std::regex_match(row, match, line_row)) {
+        auto line = std::stoul(match[1]);
+        EXPECT_GE(line, 1U);
+        EXPECT_LE(line, lines);
+        total += std::stoul(match[2]);
+    }
+    EXPECT_EQ(row, std::format("{} samples at {} Hz", sampler.samples(), Sampler::default_frequency));
+    EXPECT_EQ(total, sampler.samples());
+    EXPECT_FALSE(std::getline(report, row));
+}
+
+TEST(SamplerTest, CollapsedStacksNameTheLinesOfTheLoop)
+{
+    Sampler sampler;
+    sample(sampler);
+    std::stringstream report;
+    sampler.report_collapsed(report);
+
+    std::regex const stack { R"(script(;fun count)?;line (\d+);([A-Z0-9_]+) (\d+))" };
+    std::size_t total {};
+    std::size_t in_loop {};
+    std::smatch match;
+    for (std::string row; std::getline(report, row);) {
+        ASSERT_TRUE(std::regex_match(row, match, stack)) << row;
+        auto line = std::stoul(match[2]);
+        EXPECT_GE(line, 1U);
+        EXPECT_LE(line, lines);
+        // the body is inside the function, the call is not
+        if (line >= 2 && line <= 8) {
+            EXPECT_TRUE(match[1].matched) << row;
+        } else if (line == lines) {
+            EXPECT_FALSE(match[1].matched) << row;
+        }
+        auto hits = std::stoul(match[4]);
+        total += hits;
+        in_loop += line >= 4 && line <= 7 ? hits : 0;
+    }
+    EXPECT_EQ(total, sampler.samples());
+    EXPECT_GT(in_loop, 0);
+}
+
+TEST(SamplerTest, StoppingPutsBackTheSignalActionItReplaced)
+{
+    struct sigaction previous {};
+    previous.sa_handler = [](int) {};
+    sigemptyset(&previous.sa_mask);
+    struct sigaction original {};
+    sigaction(SIGPROF, &previous, &original);
+
+    Sampler sampler;
+    sample(sampler);
+    struct sigaction restored {};
+    sigaction(SIGPROF, nullptr, &restored);
+    EXPECT_EQ(restored.sa_handler, previous.sa_handler);
+
+    sigaction(SIGPROF, &original, nullptr);
+}
@@ -0,0 +1,214 @@
+#include <cstdio>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+#include "compiler.hpp"
+#include "instr.hpp"
+#include "ssa.hpp"
+#include "vm.hpp"
+#include "gtest/gtest.h"
+
+#include "compile.hpp"
+
+namespace {
+auto count(SsaProgram const& program, SsaOp op) -> std::size_t
+{
+    return static_cast<std::size_t>(std::ranges::count(program.instructions(), op, &SsaInstr::op));
+}
+
+// runs `segment` and returns everything it logged
+auto run(CodeSegment segment) -> std::string
+{
+    testing::internal::CaptureStdout();
+    VM { std::move(segment) }.execute();
+    std::fflush(stdout);
+    return testing::internal::GetCapturedStdout();
+}
+}
+
+TEST(SsaTest, RepeatedSubexpressionIsComputedOnce)
+{
+    auto program = util::ssa::build(parse("log((1 + 2) * (1 + 2));"));
+    EXPECT_EQ(count(program, SsaOp::ADD), 2);
+
+    util::ssa::optimize(program);
+    EXPECT_EQ(count(program, SsaOp::ADD), 1);
+    EXPECT_EQ(count(program, SsaOp::CONST), 2);
+    EXPECT_EQ(count(program, SsaOp::COPY), 0);
+}
+
+TEST(SsaTest, CommutedOperandsShareAValueNumber)
+{
+    auto program = util::ssa::build(parse("log((3 * 5) == (5 * 3));"));
+    util::ssa::optimize(program);
+    EXPECT_EQ(count(program, SsaOp::MUL), 1);
+}
+
+TEST(SsaTest, ConcatenationIsNotCommuted)
+{
+    auto program = util::ssa::build(parse(R"(log(("a" + "b") + ("b" + "a"));)"));
+    util::ssa::optimize(program);
+    EXPECT_EQ(count(program, SsaOp::ADD), 3);
+}
+
+TEST(SsaTest, SignedZerosAreDistinctConstants)
+{
+    SsaProgram program;
+    auto zero          = program.append({ SsaOp::CONST, TypeIndex::FLOAT64, 1, {}, 0.0 });
+    auto negative_zero = program.append({ SsaOp::CONST, TypeIndex::FLOAT64, 1, {}, -0.0 });
+    auto equal         = program.append({ SsaOp::CMPE, TypeIndex::BOOL, 1, { zero, negative_zero } });
+    program.append({ SsaOp::LOG, TypeIndex::BOOL, 1, { equal } });
+
+    util::ssa::optimize(program);
+    EXPECT_EQ(count(program, SsaOp::CONST), 2);
+}
+
+TEST(SsaTest, DeadValuesAreDropped)
+{
+    SsaProgram program;
+    auto one    = program.append({ SsaOp::CONST, TypeIndex::INT64, 1, {}, int64_t { 1 } });
+    auto two    = program.append({ SsaOp::CONST, TypeIndex::INT64, 1, {}, int64_t { 2 } });
+    auto unused = program.append({ SsaOp::ADD, TypeIndex::INT64, 1, { one, two } });
+    auto copy   = program.append({ SsaOp::COPY, TypeIndex::INT64, 1, { two } });
+    program.append({ SsaOp::LOG, TypeIndex::INT64, 1, { copy } });
+    (void)unused;
+
+    util::ssa::copy_propagation(program);
+    util::ssa::dead_code_elimination(program);
+    ASSERT_EQ(program.instructions().size(), 2);
+    EXPECT_EQ(program.instructions()[0].op, SsaOp::CONST);
+    EXPECT_EQ(program.instructions()[1].op, SsaOp::LOG);
+    EXPECT_EQ(program.instructions()[1].operands[0], 0);
+}
+
+TEST(SsaTest, DivisionsThatMayHaltAreKept)
+{
+    auto program = util::ssa::build(parse("let x = 7; let a = x / 0; let b = x % -1; let c = x / 3; log(2);"));
+    util::ssa::optimize(program);
+    // dividing by 3 never halts, nothing reads its quotient
+    EXPECT_EQ(count(program, SsaOp::DIV), 1);
+    EXPECT_EQ(count(program, SsaOp::MOD), 1);
+    EXPECT_EQ(count(program, SsaOp::DIVM), 0);
+}
+
+TEST(SsaTest, SignedDivisionByMinusOneStillOverflows)
+{
+    for (auto op : { SsaOp::DIV, SsaOp::MOD }) {
+        SsaProgram program;
+        auto least     = program.append({ SsaOp::CONST, TypeIndex::INT64, 1, {}, std::numeric_limits<int64_t>::min() });
+        auto minus_one = program.append({ SsaOp::CONST, TypeIndex::INT64, 1, {}, int64_t { -1 } });
+        auto result    = program.append({ op, TypeIndex::INT64, 1, { least, minus_one } });
+        program.append({ SsaOp::LOG, TypeIndex::INT64, 1, { result } });
+        util::ssa::optimize(program);
+        EXPECT_EQ(count(program, op), 1) << util::ssa::to_string(op);
+
+        auto segment = util::ssa::lower(std::move(program));
+        ASSERT_TRUE(segment.has_value());
+        VM vm { std::move(segment.value()) };
+        EXPECT_EQ(capture([&] { vm.execute(); }), "");
+        ASSERT_TRUE(vm.error().has_value());
+        EXPECT_EQ(vm.error()->message, "integer division overflows");
+    }
+}
+
+TEST(SsaTest, SharedValuesArePickedInsteadOfRecomputed)
+{
+    auto segment = util::ssa::compile(parse("log((1 + 2) * (1 + 2));"));
+    ASSERT_TRUE(segment.has_value());
+
+    std::vector<Opcode> opcodes;
+    auto const& bc = segment->first;
+    for (std::size_t offset {}; offset < bc.code().size(); offset += util::opcode::length(bc, offset)) {
+        opcodes.push_back(util::opcode::unfused(static_cast<Opcode>(bc.code()[offset])));
+    }
+    EXPECT_EQ(std::ranges::count(opcodes, Opcode::ADD), 1);
+    EXPECT_EQ(std::ranges::count(opcodes, Opcode::PICK), 1);
+}
+
+TEST(SsaTest, IntegerArithmeticByConstantsIsStrengthReduced)
+{
+    auto program = util::ssa::build(parse("log(7 * 8);"));
+    util::ssa::optimize(program);
+    EXPECT_EQ(count(program, SsaOp::MUL), 0);
+    EXPECT_EQ(count(program, SsaOp::SHL), 1);
+
+    program = util::ssa::build(parse("log((100 / 8) + (100 % 8));"));
+    util::ssa::optimize(program);
+    EXPECT_EQ(count(program, SsaOp::DIVP2), 1);
+    EXPECT_EQ(count(program, SsaOp::MODP2), 1);
+
+    program = util::ssa::build(parse("log((100 / 7) + (100 % 7));"));
+    util::ssa::optimize(program);
+    EXPECT_EQ(count(program, SsaOp::DIV), 0);
+    EXPECT_EQ(count(program, SsaOp::DIVM), 1);
+    EXPECT_EQ(count(program, SsaOp::MODM), 1);
+}
+
+TEST(SsaTest, FloatingAndZeroDivisorsAreKept)
+{
+    auto program = util::ssa::build(parse("log(1.5 / 2.0);"));
+    util::ssa::optimize(program);
+    EXPECT_EQ(count(program, SsaOp::DIV), 1);
+
+    program = util::ssa::build(parse("log(3 / 0);"));
+    util::ssa::optimize(program);
+    EXPECT_EQ(count(program, SsaOp::DIV), 1);
+}
+
+TEST(SsaTest, UnsignedDivisorsUseUnsignedMagic)
+{
+    SsaProgram program;
+    auto dividend = program.append({ SsaOp::CONST, TypeIndex::UINT64, 1, {}, uint64_t { 0xFFFF'FFFF'FFFF'FFFF } });
+    auto divisor  = program.append({ SsaOp::CONST, TypeIndex::UINT64, 1, {}, uint64_t { 7 } });
+    auto quotient = program.append({ SsaOp::DIV, TypeIndex::UINT64, 1, { dividend, divisor } });
+    program.append({ SsaOp::LOG, TypeIndex::UINT64, 1, { quotient } });
+
+    util::ssa::optimize(program);
+    ASSERT_EQ(count(program, SsaOp::DIVM), 1);
+    auto segment = util::ssa::lower(std::move(program));
+    ASSERT_TRUE(segment.has_value());
+    EXPECT_EQ(run(std::move(segment.value())), "2635249153387078802\n");
+}
+
+TEST(SsaTest, ControlFlowIsLeftToTheDirectCompiler)
+{
+    for (auto source : { "if (1 < 2) log(1);", "let i = 0; while (i < 3) i = i + 1;", "log(true and false);", "fun f(): i32 { return 1; } log(f());" }) {
+        EXPECT_FALSE(util::ssa::compile(parse(source)).has_value()) << source;
+    }
+}
+
+// Every program has to log exactly what the direct compiler's bytecode logs
+struct SsaLoweringTest : ::testing::TestWithParam<std::string_view> { };
+
+TEST_P(SsaLoweringTest, MatchesDirectCompiler)
+{
+    auto optimized = util::ssa::compile(parse(GetParam()));
+    ASSERT_TRUE(optimized.has_value()) << GetParam();
+
+    EXPECT_EQ(run(std::move(optimized.value())), run(Compiler { parse(GetParam()) }.compile())) << GetParam();
+}
+
+INSTANTIATE_TEST_SUITE_P(Programs, SsaLoweringTest,
+                         ::testing::Values(
+                             "log(1 + 2 * 3 - 4);",
+                             "log((1 + 2) * (1 + 2));",
+                             "log(5 * ((2 - 7) + (2 - 7)));",
+                             "log((3 < 4) == (3 > 4));",
+                             "log((1 < 2) == (1 < 2));",
+                             "log(!(2.5 <= 1.0));",
+                             "log(1.5 * 2.0 - 0.25);",
+                             R"(log("ab" + "ab");)",
+                             R"(log(("a" + "b") + ("b" + "a"));)",
+                             "log(-7 * 16);",
+                             "log((-100 / 8) + (100 / -8) + (-100 % 8) + (100 % -8));",
+                             "log((-100 / 7) + (100 / -7) + (-100 % 7) + (100 % -7));",
+                             "log((2147483647 / 3) * (2147483647 % 1000));",
+                             "log(-2147483647 / 1 + 5 % 1 + 9 * 1);",
+                             "let a = 6; let b = a * 7; log(b - a);",
+                             "let a = 1; { let b = a + 1; a = b * 10; } log(a);",
+                             "{ let a = 2.5; let b = a; b = b * a; log(b); }",
+                             "let a = 1; let b = 2; a = b = a + b; log(a * 10 + b);",
+                             // nothing reads the quotients, but the divisions still halt
+                             "let a = 1 / 0; log(2);",
+                             "let z = 0; let a = 7 % z; log(2);"));
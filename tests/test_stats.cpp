@@ -0,0 +1,60 @@
+#include <chrono>
+#include <regex>
+#include <string>
+
+#include "stats.hpp"
+#include "gtest/gtest.h"
+
+namespace {
+// everything `stats` writes as json
+auto json(Stats const& stats) -> std::string
+{
+    testing::internal::CaptureStderr();
+    stats.print_json();
+    return testing::internal::GetCapturedStderr();
+}
+}
+
+TEST(StatsTest, JsonIsOneObjectWithEveryPhaseAndCounter)
+{
+    using namespace std::chrono_literals;
+
+    Stats stats { .enabled = true };
+    for (std::size_t phase {}; phase < stats.timings.size(); phase++) {
+        stats.timings[phase] = { .wall = std::chrono::nanoseconds { 100 + phase }, .cpu = std::chrono::nanoseconds { 200 + phase } };
+    }
+    stats.tokens            = 1;
+    stats.ast_nodes         = 2;
+    stats.bytecode_bytes    = 3;
+    stats.line_entries      = 4;
+    stats.line_bytes        = 5;
+    stats.strings           = 6;
+    stats.string_bytes      = 7;
+    stats.peak_stack_depth  = 8;
+    stats.instructions      = 9;
+    stats.minor_collections = 10;
+    stats.major_collections = 11;
+    stats.gc_pauses         = 12;
+    stats.gc_pause_p99      = 13ns;
+    stats.gc_pause_max      = 14ns;
+
+    // the peak resident set size depends on the process, every other value is the one set above
+    std::regex const shape {
+        R"(\{"phases":\{"lex":\{"wall_ns":100,"cpu_ns":200\},"parse":\{"wall_ns":101,"cpu_ns":201\},)"
+        R"("compile":\{"wall_ns":102,"cpu_ns":202\},"verify":\{"wall_ns":103,"cpu_ns":203\},"execute":\{"wall_ns":104,"cpu_ns":204\}\},)"
+        R"("tokens":1,"ast_nodes":2,"bytecode_bytes":3,"line_entries":4,"line_bytes":5,"strings":6,"string_bytes":7,)"
+        R"("peak_stack_depth":8,"instructions":9,"minor_collections":10,"major_collections":11,)"
+        R"("gc_pauses":12,"gc_pause_p99_ns":13,"gc_pause_max_ns":14,"peak_rss_kib":\d+\}\n)"
+    };
+    auto output = json(stats);
+    EXPECT_TRUE(std::regex_match(output, shape)) << output;
+}
+
+TEST(StatsTest, JsonOfNothingMeasuredHasZeroes)
+{
+    auto output = json(Stats {});
+    EXPECT_EQ(output.find('\n'), output.size() - 1) << output;
+    EXPECT_TRUE(output.starts_with(R"({"phases":{"lex":{"wall_ns":0,"cpu_ns":0},)")) << output;
+    EXPECT_NE(output.find(R"("instructions":0,)"), std::string::npos) << output;
+    EXPECT_NE(output.find(R"("gc_pause_max_ns":0,)"), std::string::npos) << output;
+}
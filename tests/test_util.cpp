@@ -3,39 +3,74 @@
 
 using namespace std::string_literals;
 
-struct UtilRLETest : testing::Test {
+struct UtilLineTableTest : testing::Test {
 protected:
-    UtilRLETest()
+    UtilLineTableTest()
     {
-        rle.write_line_number(0, 1);
-        rle.write_line_number(3, 1);
-        rle.write_line_number(7, 2);
-        rle.write_line_number(10, 3);
-        rle.write_line_number(14, 5);
-        rle.write_line_number(18, 10);
+        table.write(0, 1);
+        table.write(3, 1);
+        table.write(7, 2);
+        table.write(10, 3);
+        table.write(14, 5);
+        table.write(18, 10);
     }
-    util::RLE rle;
+    util::LineTable table;
 };
 
-TEST_F(UtilRLETest, ReadLineNumberInRLE)
+TEST_F(UtilLineTableTest, ReadLineNumberInLineTable)
 {
-    EXPECT_EQ(rle.read_line_number(1), 1);
-    EXPECT_EQ(rle.read_line_number(2), 1);
-    EXPECT_EQ(rle.read_line_number(3), 1);
-    EXPECT_EQ(rle.read_line_number(4), 1);
-    EXPECT_EQ(rle.read_line_number(5), 1);
-    EXPECT_EQ(rle.read_line_number(6), 1);
-    EXPECT_EQ(rle.read_line_number(7), 2);
-    EXPECT_EQ(rle.read_line_number(8), 2);
-    EXPECT_EQ(rle.read_line_number(9), 2);
-    EXPECT_EQ(rle.read_line_number(10), 3);
-    EXPECT_EQ(rle.read_line_number(11), 3);
-    EXPECT_EQ(rle.read_line_number(12), 3);
-    EXPECT_EQ(rle.read_line_number(13), 3);
-    EXPECT_EQ(rle.read_line_number(14), 5);
-    EXPECT_EQ(rle.read_line_number(15), 5);
-    EXPECT_EQ(rle.read_line_number(16), 5);
-    EXPECT_EQ(rle.read_line_number(17), 5);
-    EXPECT_EQ(rle.read_line_number(18), 10);
-    EXPECT_EQ(rle.read_line_number(120), 10);
+    EXPECT_EQ(table.read_line_number(1), 1);
+    EXPECT_EQ(table.read_line_number(2), 1);
+    EXPECT_EQ(table.read_line_number(3), 1);
+    EXPECT_EQ(table.read_line_number(4), 1);
+    EXPECT_EQ(table.read_line_number(5), 1);
+    EXPECT_EQ(table.read_line_number(6), 1);
+    EXPECT_EQ(table.read_line_number(7), 2);
+    EXPECT_EQ(table.read_line_number(8), 2);
+    EXPECT_EQ(table.read_line_number(9), 2);
+    EXPECT_EQ(table.read_line_number(10), 3);
+    EXPECT_EQ(table.read_line_number(11), 3);
+    EXPECT_EQ(table.read_line_number(12), 3);
+    EXPECT_EQ(table.read_line_number(13), 3);
+    EXPECT_EQ(table.read_line_number(14), 5);
+    EXPECT_EQ(table.read_line_number(15), 5);
+    EXPECT_EQ(table.read_line_number(16), 5);
+    EXPECT_EQ(table.read_line_number(17), 5);
+    EXPECT_EQ(table.read_line_number(18), 10);
+    EXPECT_EQ(table.read_line_number(120), 10);
+}
+
+TEST_F(UtilLineTableTest, RepeatedLocationsShareAnEntry)
+{
+    EXPECT_EQ(table.entries(), 5);
+    EXPECT_EQ(table.last(), Location { 10 });
+}
+
+TEST(UtilLineTableBlockTest, ReadsLocationsAcrossBlocks)
+{
+    util::LineTable table;
+    // lines and columns move in both directions, offsets jump by more than a varint byte holds
+    for (std::size_t entry {}; entry < 5 * util::LineTable::block_size + 3; entry++) {
+        table.write(entry * 200, { entry % 7 + 1, (entry * 13) % 90 + 1 });
+    }
+
+    for (std::size_t entry {}; entry < table.entries(); entry++) {
+        Location expected { entry % 7 + 1, (entry * 13) % 90 + 1 };
+        EXPECT_EQ(table.read(entry * 200), expected);
+        EXPECT_EQ(table.read(entry * 200 + 199), expected);
+    }
+
+    auto entries = table.decode();
+    ASSERT_EQ(entries.size(), table.entries());
+    EXPECT_EQ(entries[37].offset, 37 * 200);
+    EXPECT_EQ(entries[37].location, (Location { 37 % 7 + 1, (37 * 13) % 90 + 1 }));
+}
+
+TEST(UtilLineTableBlockTest, SmallerThanOffsetLinePairs)
+{
+    util::LineTable table;
+    for (std::size_t line { 1 }; line <= 1'000; line++) {
+        table.write(line * 5, { line, 3 });
+    }
+    EXPECT_LT(table.bytes(), table.entries() * sizeof(std::pair<std::size_t, std::size_t>) / 3);
 }
\ No newline at end of file
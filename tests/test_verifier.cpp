@@ -0,0 +1,488 @@
+#include <array>
+#include <bit>
+#include <cstdio>
+#include <string_view>
+#include <tuple>
+#include <utility>
+
+#include "emitter.hpp"
+#include "ssa.hpp"
+#include "verifier.hpp"
+#include "vm.hpp"
+#include "gtest/gtest.h"
+
+#include "compile.hpp"
+
+namespace {
+auto verify(CodeSegment const& segment) -> std::expected<std::size_t, BytecodeError>
+{
+    return Verifier { segment.first, segment.second }.verify();
+}
+
+// writes `bytes` as they are, without any of the emitter's help
+auto raw(std::initializer_list<uint8_t> bytes, std::size_t globals = 0) -> CodeSegment
+{
+    ByteCode bc;
+    for (auto byte : bytes) {
+        bc.write_byte(byte, 1);
+    }
+    bc.set_globals(globals);
+    return { std::move(bc), {} };
+}
+
+// `raw` with one function of `signature` whose body starts at `entry`, a closure when it has `captures`
+auto with_function(std::initializer_list<uint8_t> bytes, std::size_t entry, Signature signature, std::vector<SlotType> captures = {}) -> CodeSegment
+{
+    auto segment = raw(bytes);
+    segment.first.add_function(Function { .entry = entry, .signature = static_cast<uint16_t>(segment.first.add_signature(std::move(signature))), .name = "f", .captures = std::move(captures) });
+    return segment;
+}
+
+// `raw` with a class `A` of one int field `x`, the names `x` and `y` and one inline cache
+auto with_class(std::initializer_list<uint8_t> bytes, std::optional<uint16_t> superclass = {}) -> CodeSegment
+{
+    auto segment = raw(bytes);
+    auto x       = static_cast<uint16_t>(segment.first.add_name("x"));
+    segment.first.add_name("y");
+    segment.first.add_cache();
+    segment.first.add_class(ClassInfo { .name = "A", .superclass = superclass, .fields = { { x, SlotType::INT } } });
+    return segment;
+}
+
+constexpr auto op(Opcode opcode) -> uint8_t
+{
+    return std::to_underlying(opcode);
+}
+
+constexpr auto type(TypeIndex index) -> uint8_t
+{
+    return std::to_underlying(index);
+}
+}
+
+TEST(VerifierTest, AcceptsCompiledPrograms)
+{
+    for (auto fusions : { Fusions::all(), Fusions::none() }) {
+        for (auto source : { "log(1 + 2 * 3);", R"(log("a" + "b" + "c");)", "log(!(2.5 < 1.0) == true);", "log(-(7 / 2) % 3);",
+                             "let a = 1; { let b = a + 1; a = b * 10; } log(a);",
+                             "let s = 0; for (let i = 0; i < 10; i = i + 1) { if (i % 2 == 0 and i != 4) s = s + i; else s = s - 1; } log(s);",
+                             R"(let b = true; { let t = "x"; while (b) { t = t + t; b = !b; } log(t); })" }) {
+            auto segment = compile(source, fusions);
+            auto verified = verify(segment);
+            EXPECT_TRUE(verified.has_value()) << source << ": " << verified.error().message;
+        }
+    }
+}
+
+TEST(VerifierTest, AcceptsOptimizedPrograms)
+{
+    auto segment = util::ssa::compile(parse("log((100 / 7) * (100 / 7) + 100 % 8);"));
+    ASSERT_TRUE(segment.has_value());
+    EXPECT_TRUE(verify(segment.value()).has_value());
+}
+
+TEST(VerifierTest, ReportsMaximumStackDepth)
+{
+    // right associative, every operand is loaded before the first addition
+    auto verified = verify(compile("log(1 + 2 + 3 + 4);", Fusions::none()));
+    ASSERT_TRUE(verified.has_value());
+    EXPECT_EQ(verified.value(), 4);
+}
+
+TEST(VerifierTest, RejectsMalformedCode)
+{
+    // clang-format off
+    auto cases = {
+        raw({}),
+        raw({ 0xFF, op(Opcode::RETURN) }),
+        raw({ op(Opcode::LOAD), type(TypeIndex::INT32), 1, 0 }),
+        raw({ op(Opcode::LOAD), 0x20, 1, op(Opcode::RETURN) }),
+        raw({ op(Opcode::LOAD), type(TypeIndex::BOOL), 2, op(Opcode::LOG), op(Opcode::RETURN) }),
+        raw({ op(Opcode::LOAD), type(TypeIndex::INT8), 1, op(Opcode::LOG) }),
+        raw({ op(Opcode::PICK) }),
+    };
+    // clang-format on
+    for (auto const& segment : cases) {
+        EXPECT_FALSE(verify(segment).has_value());
+    }
+}
+
+TEST(VerifierTest, RejectsStringsOutsideThePool)
+{
+    StringTable other;
+    Emitter emitter { Fusions::none() };
+    emitter.load(TypeIndex::STRING, other.emplace("foreign").first, 1);
+    emitter.opcode(Opcode::LOG, 1);
+    CodeSegment segment { std::move(emitter).finish(), {} };
+
+    auto verified = verify(segment);
+    ASSERT_FALSE(verified.has_value());
+    EXPECT_EQ(verified.error().offset, 0);
+}
+
+TEST(VerifierTest, RejectsStackUnderflow)
+{
+    auto verified = verify(raw({ op(Opcode::LOAD), type(TypeIndex::INT8), 1, op(Opcode::ADD), op(Opcode::RETURN) }));
+    ASSERT_FALSE(verified.has_value());
+    EXPECT_EQ(verified.error().offset, 3);
+}
+
+TEST(VerifierTest, RejectsMismatchedOperandTypes)
+{
+    auto cases = {
+        raw({ op(Opcode::LOAD), type(TypeIndex::INT8), 1, op(Opcode::LOAD), type(TypeIndex::UINT8), 1, op(Opcode::SUB), op(Opcode::RETURN) }),
+        raw({ op(Opcode::LOAD), type(TypeIndex::BOOL), 1, op(Opcode::NEGATE), op(Opcode::RETURN) }),
+        raw({ op(Opcode::LOAD), type(TypeIndex::INT8), 1, op(Opcode::CMPEK), type(TypeIndex::BOOL), 1, op(Opcode::RETURN) }),
+        raw({ op(Opcode::LOAD), type(TypeIndex::UINT8), 1, op(Opcode::SHL), 64, op(Opcode::RETURN) }),
+        raw({ op(Opcode::LOAD), type(TypeIndex::BOOL), 1, op(Opcode::DIVP2), 1, op(Opcode::RETURN) }),
+    };
+    for (auto const& segment : cases) {
+        EXPECT_FALSE(verify(segment).has_value());
+    }
+}
+
+TEST(VerifierTest, PickedValuesKeepTheirType)
+{
+    auto segment = raw({ op(Opcode::LOAD), type(TypeIndex::INT8), 1, op(Opcode::LOAD), type(TypeIndex::BOOL), 1,
+                         op(Opcode::PICK), 1, op(Opcode::ADD), op(Opcode::RETURN) });
+    auto verified = verify(segment);
+    ASSERT_FALSE(verified.has_value());
+    EXPECT_EQ(verified.error().offset, 8);
+}
+
+TEST(VerifierTest, RejectsMisusedVariables)
+{
+    // clang-format off
+    auto cases = {
+        raw({ op(Opcode::GET_GLOBAL), 0, 0, op(Opcode::RETURN) }, 1),
+        raw({ op(Opcode::LOAD), type(TypeIndex::INT8), 1, op(Opcode::SET_GLOBAL), 1, 0, op(Opcode::RETURN) }, 1),
+        raw({ op(Opcode::LOAD), type(TypeIndex::INT8), 1, op(Opcode::SET_GLOBAL), 0, 0,
+              op(Opcode::LOAD), type(TypeIndex::BOOL), 1, op(Opcode::SET_GLOBAL), 0, 0, op(Opcode::RETURN) }, 1),
+        raw({ op(Opcode::LOAD), type(TypeIndex::INT8), 1, op(Opcode::GET_LOCAL), 1, op(Opcode::RETURN) }),
+        raw({ op(Opcode::LOAD), type(TypeIndex::INT8), 1, op(Opcode::SET_LOCAL), 0, op(Opcode::RETURN) }),
+        raw({ op(Opcode::LOAD), type(TypeIndex::INT8), 1, op(Opcode::LOAD), type(TypeIndex::BOOL), 1, op(Opcode::SET_LOCAL), 0, op(Opcode::RETURN) }),
+        raw({ op(Opcode::LOAD), type(TypeIndex::INT8), 1, op(Opcode::POP), 2, op(Opcode::RETURN) }),
+    };
+    // clang-format on
+    for (auto const& segment : cases) {
+        EXPECT_FALSE(verify(segment).has_value());
+    }
+}
+
+TEST(VerifierTest, RejectsMisplacedJumps)
+{
+    auto jump = [](int16_t offset) { return std::bit_cast<std::array<uint8_t, 2>>(offset); };
+    auto [back_into_load, outside, into_itself] = std::tuple { jump(-5), jump(100), jump(-2) };
+    // clang-format off
+    auto cases = {
+        raw({ op(Opcode::LOAD), type(TypeIndex::INT8), 1, op(Opcode::JUMP), back_into_load[0], back_into_load[1], op(Opcode::RETURN) }),
+        raw({ op(Opcode::JUMP), outside[0], outside[1], op(Opcode::RETURN) }),
+        raw({ op(Opcode::JUMP), into_itself[0], into_itself[1], op(Opcode::RETURN) }),
+        raw({ op(Opcode::LOAD), type(TypeIndex::INT8), 1, op(Opcode::JUMP_IF_FALSE), 0, 0, op(Opcode::RETURN) }),
+        raw({ op(Opcode::LOAD), type(TypeIndex::INT8), 1, op(Opcode::LOAD), type(TypeIndex::BOOL), 1, op(Opcode::JLT), 0, 0, op(Opcode::RETURN) }),
+    };
+    // clang-format on
+    for (auto const& segment : cases) {
+        EXPECT_FALSE(verify(segment).has_value());
+    }
+}
+
+TEST(VerifierTest, PathsHaveToAgreeWhereTheyJoin)
+{
+    auto back = std::bit_cast<std::array<uint8_t, 2>>(int16_t { -6 });
+    // clang-format off
+    auto cases = {
+        // a loop pushing a value every iteration
+        raw({ op(Opcode::LOAD), type(TypeIndex::INT8), 1, op(Opcode::JUMP), back[0], back[1], op(Opcode::RETURN) }),
+        // an int on one path and a bool on the other
+        raw({ op(Opcode::LOAD), type(TypeIndex::BOOL), 1, op(Opcode::JUMP_IF_FALSE), 6, 0,
+              op(Opcode::LOAD), type(TypeIndex::INT8), 1, op(Opcode::JUMP), 3, 0,
+              op(Opcode::LOAD), type(TypeIndex::BOOL), 0, op(Opcode::RETURN) }),
+        // a global only set on one path
+        raw({ op(Opcode::LOAD), type(TypeIndex::BOOL), 1, op(Opcode::JUMP_IF_FALSE), 8, 0,
+              op(Opcode::LOAD), type(TypeIndex::INT8), 1, op(Opcode::SET_GLOBAL), 0, 0, op(Opcode::POP), 1,
+              op(Opcode::GET_GLOBAL), 0, 0, op(Opcode::RETURN) }, 1),
+    };
+    // clang-format on
+    for (auto const& segment : cases) {
+        EXPECT_FALSE(verify(segment).has_value());
+    }
+}
+
+TEST(VerifierTest, CheckedModeStopsAtTheFirstError)
+{
+    auto segment = raw({ op(Opcode::LOGK), type(TypeIndex::INT8), 5, op(Opcode::LOAD), type(TypeIndex::BOOL), 1, op(Opcode::NEGATE) });
+
+    testing::internal::CaptureStdout();
+    auto error = VM { std::move(segment) }.execute_checked();
+    std::fflush(stdout);
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "5\n");
+    ASSERT_TRUE(error.has_value());
+    EXPECT_EQ(error->offset, 6);
+}
+
+TEST(VerifierTest, CheckedModeCatchesIntegerDivisionByZero)
+{
+    auto segment = compile("log(7 / (3 - 3));");
+    ASSERT_TRUE(verify(segment).has_value());   // the divisor is only known at runtime
+
+    auto error = VM { std::move(segment) }.execute_checked();
+    ASSERT_TRUE(error.has_value());
+    EXPECT_EQ(error->message, "integer division by zero");
+}
+
+TEST(VerifierTest, CheckedModeRunsValidPrograms)
+{
+    auto segment = compile("log((7 % 4) * 2);");
+
+    testing::internal::CaptureStdout();
+    auto error = VM { std::move(segment) }.execute_checked();
+    std::fflush(stdout);
+    EXPECT_FALSE(error.has_value());
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "6\n");
+}
+
+TEST(VerifierTest, CheckedModeFollowsJumps)
+{
+    auto segment = compile("let n = 0; for (let i = 0; i < 4; i = i + 1) { if (i == 1 or i == 3) n = n + i; } log(n > 3 and n < 5);");
+
+    testing::internal::CaptureStdout();
+    auto error = VM { std::move(segment) }.execute_checked();
+    std::fflush(stdout);
+    EXPECT_FALSE(error.has_value());
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "true\n");
+}
+
+TEST(VerifierTest, AcceptsFunctions)
+{
+    for (auto fusions : { Fusions::all(), Fusions::none() }) {
+        for (auto source : { "fun f(n: i32): i32 { if (n < 2) return n; return f(n - 1) + f(n - 2); } log(f(10));",
+                             "fun twice(g: fun(i32): i32, x: i32): i32 { return g(g(x)); } fun inc(x: i32): i32 { return x + 1; } log(twice(inc, 1));",
+                             "fun a(): i32 { return 1; } log(a()); let x = 5; fun b(): i32 { return x; } log(b());",
+                             "{ let s = \"x\"; fun f(t: string): string { let u = t + t; return u; } log(f(s)); }" }) {
+            auto segment  = compile(source, fusions);
+            auto verified = verify(segment);
+            EXPECT_TRUE(verified.has_value()) << source << ": " << verified.error().message;
+        }
+    }
+}
+
+TEST(VerifierTest, RejectsMisusedFunctions)
+{
+    Signature int_to_int { .parameters = { SlotType::INT }, .result = SlotType::INT };
+    auto function = type(TypeIndex::FUNCTION);
+    // clang-format off
+    auto cases = {
+        // too few arguments
+        with_function({ op(Opcode::LOAD), function, 0, 0, op(Opcode::CALL), 0, op(Opcode::RETURN),
+                        op(Opcode::GET_LOCAL), 0, op(Opcode::RETURN) }, 7, int_to_int),
+        // a bool argument for an int parameter
+        with_function({ op(Opcode::LOAD), function, 0, 0, op(Opcode::LOAD), type(TypeIndex::BOOL), 1, op(Opcode::CALL), 1, op(Opcode::RETURN),
+                        op(Opcode::GET_LOCAL), 0, op(Opcode::RETURN) }, 10, int_to_int),
+        // returning a bool from a function returning int
+        with_function({ op(Opcode::LOAD), function, 0, 0, op(Opcode::LOAD), type(TypeIndex::INT8), 1, op(Opcode::CALL), 1, op(Opcode::RETURN),
+                        op(Opcode::LOAD), type(TypeIndex::BOOL), 1, op(Opcode::RETURN) }, 10, int_to_int),
+        // a tail call without a frame to reuse
+        with_function({ op(Opcode::LOAD), function, 0, 0, op(Opcode::LOAD), type(TypeIndex::INT8), 1, op(Opcode::TAIL_CALL), 1, op(Opcode::RETURN),
+                        op(Opcode::GET_LOCAL), 0, op(Opcode::RETURN) }, 10, int_to_int),
+        // calling an int
+        with_function({ op(Opcode::LOAD), type(TypeIndex::INT8), 1, op(Opcode::LOAD), type(TypeIndex::INT8), 1, op(Opcode::CALL), 1, op(Opcode::RETURN) }, 0, int_to_int),
+        // a function that does not exist
+        with_function({ op(Opcode::LOAD), function, 5, 0, op(Opcode::POP), 1, op(Opcode::RETURN) }, 0, int_to_int),
+        // a body starting inside an instruction
+        with_function({ op(Opcode::LOAD), function, 0, 0, op(Opcode::LOAD), type(TypeIndex::INT8), 1, op(Opcode::CALL), 1, op(Opcode::RETURN),
+                        op(Opcode::GET_LOCAL), 0, op(Opcode::RETURN) }, 11, int_to_int),
+        // logging a function
+        with_function({ op(Opcode::LOAD), function, 0, 0, op(Opcode::LOG), op(Opcode::RETURN) }, 0, int_to_int),
+    };
+    // clang-format on
+    for (auto const& segment : cases) {
+        EXPECT_FALSE(verify(segment).has_value());
+    }
+}
+
+TEST(VerifierTest, CheckedModeRunsFunctions)
+{
+    auto segment = compile("fun f(n: i32): i32 { if (n < 2) return n; return f(n - 1) + f(n - 2); } log(f(15));");
+
+    testing::internal::CaptureStdout();
+    auto error = VM { std::move(segment) }.execute_checked();
+    std::fflush(stdout);
+    EXPECT_FALSE(error.has_value());
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "610\n");
+}
+
+TEST(VerifierTest, TailCallsRunInConstantStack)
+{
+    // far deeper than `Stack` could hold frames for
+    auto segment = compile("let one: i64 = 1; fun sum(n: i64, acc: i64): i64 { if (n < one) return acc; return sum(n - one, acc + n); } log(sum(100000, 0));");
+    ASSERT_TRUE(verify(segment).has_value());
+
+    VM vm { std::move(segment) };
+    testing::internal::CaptureStdout();
+    vm.execute();
+    std::fflush(stdout);
+    EXPECT_FALSE(vm.error().has_value());
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "5000050000\n");
+}
+
+TEST(VerifierTest, BothModesReportStackOverflow)
+{
+    auto source = "fun f(n: i32): i32 { return f(n + 1) + 1; } log(f(0));";
+    auto segment = compile(source);
+    ASSERT_TRUE(verify(segment).has_value());   // how deep calls go is only known at runtime
+
+    VM vm { std::move(segment) };
+    vm.execute();
+    ASSERT_TRUE(vm.error().has_value());
+    EXPECT_EQ(vm.error()->message, "stack overflow");
+
+    auto error = VM { compile(source) }.execute_checked();
+    ASSERT_TRUE(error.has_value());
+    EXPECT_EQ(error->message, "stack overflow");
+}
+
+TEST(VerifierTest, AcceptsClosures)
+{
+    for (auto fusions : { Fusions::all(), Fusions::none() }) {
+        for (auto source : { "fun make(n: i32): fun(i32): i32 { fun add(x: i32): i32 { return x + n; } return add; } log(make(1)(2));",
+                             "fun counter(): fun(): i32 { let c = 0; fun next(): i32 { c = c + 1; return c; } return next; } let c = counter(); c(); log(c());",
+                             "{ let s = \"a\"; fun f(k: i32): string { if (k < 1) return s; return f(k - 1); } s = s + s; log(f(3)); }",
+                             "fun outer(n: i32): i32 { fun mid(): fun(): i32 { fun in(): i32 { return n; } return in; } return mid()(); } log(outer(4));" }) {
+            auto segment  = compile(source, fusions);
+            auto verified = verify(segment);
+            EXPECT_TRUE(verified.has_value()) << source << ": " << verified.error().message;
+        }
+    }
+}
+
+TEST(VerifierTest, RejectsMisusedCaptures)
+{
+    Signature to_int { .parameters = {}, .result = SlotType::INT };
+    auto function = type(TypeIndex::FUNCTION);
+    auto int8     = type(TypeIndex::INT8);
+    // clang-format off
+    auto cases = {
+        // loading a function that needs a closure
+        with_function({ op(Opcode::LOAD), function, 0, 0, op(Opcode::CALL), 0, op(Opcode::LOG), op(Opcode::RETURN),
+                        op(Opcode::GET_CAPTURE), 0, op(Opcode::RETURN) }, 8, to_int, { SlotType::INT }),
+        // capturing a bool as an int
+        with_function({ op(Opcode::LOAD), type(TypeIndex::BOOL), 1, op(Opcode::CLOSURE), 0, 0, op(Opcode::CALL), 0, op(Opcode::LOG), op(Opcode::RETURN),
+                        op(Opcode::GET_CAPTURE), 0, op(Opcode::RETURN) }, 10, to_int, { SlotType::INT }),
+        // reading a capture the closure does not have
+        with_function({ op(Opcode::LOAD), int8, 1, op(Opcode::CLOSURE), 0, 0, op(Opcode::CALL), 0, op(Opcode::LOG), op(Opcode::RETURN),
+                        op(Opcode::GET_CAPTURE), 1, op(Opcode::RETURN) }, 10, to_int, { SlotType::INT }),
+        // assigning through a capture which is no box
+        with_function({ op(Opcode::LOAD), int8, 1, op(Opcode::CLOSURE), 0, 0, op(Opcode::CALL), 0, op(Opcode::LOG), op(Opcode::RETURN),
+                        op(Opcode::LOAD), int8, 2, op(Opcode::SET_BOXED_CAPTURE), 0, op(Opcode::RETURN) }, 10, to_int, { SlotType::INT }),
+        // captures in the top level code
+        with_function({ op(Opcode::GET_CAPTURE), 0, op(Opcode::POP), 1, op(Opcode::RETURN) }, 0, to_int, { SlotType::INT }),
+        // unboxing a plain local
+        with_function({ op(Opcode::LOAD), int8, 1, op(Opcode::GET_BOXED), 0, op(Opcode::POP), 2, op(Opcode::RETURN) }, 0, to_int),
+        // boxing a local twice
+        with_function({ op(Opcode::LOAD), int8, 1, op(Opcode::BOX), 0, op(Opcode::BOX), 0, op(Opcode::POP), 1, op(Opcode::RETURN) }, 0, to_int),
+        // a boxed local is no plain value
+        with_function({ op(Opcode::LOAD), int8, 1, op(Opcode::BOX), 0, op(Opcode::LOG), op(Opcode::RETURN) }, 0, to_int),
+    };
+    // clang-format on
+    for (auto const& segment : cases) {
+        EXPECT_FALSE(verify(segment).has_value());
+    }
+}
+
+TEST(VerifierTest, BothModesRunClosures)
+{
+    auto source = "fun counter(): fun(): i32 { let c = 0; fun next(): i32 { c = c + 1; return c; } return next; }"
+                  "let a = counter(); let b = counter(); a(); log(a()); log(b());"
+                  "{ let n = 0; fun add(k: i32): i32 { n = n + k; return n; } add(3); add(4); log(n); }";
+
+    testing::internal::CaptureStdout();
+    VM { compile(source) }.execute();
+    std::fflush(stdout);
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "2\n1\n7\n");
+
+    testing::internal::CaptureStdout();
+    auto error = VM { compile(source) }.execute_checked();
+    std::fflush(stdout);
+    EXPECT_FALSE(error.has_value());
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "2\n1\n7\n");
+}
+
+TEST(VerifierTest, AcceptsClasses)
+{
+    for (auto fusions : { Fusions::all(), Fusions::none() }) {
+        for (auto source : { "class P { x: i32; init(x: i32) { this.x = x; } get(): i32 { return this.x; } } let p = P(1); p.x = p.get() + 1; log(p.x);",
+                             "class A { f(): i32 { return 1; } } class B < A { f(): i32 { return super.f() + 1; } } fun call(a: A): i32 { return a.f(); } log(call(B()));",
+                             "class A { n: i32; init(n: i32) { this.n = n; } } class B < A { } log(B(2).n);",
+                             "class N { next: N; } let a = N(); a.next = N(); a.next.next = a;" }) {
+            auto segment  = compile(source, fusions);
+            auto verified = verify(segment);
+            EXPECT_TRUE(verified.has_value()) << source << ": " << verified.error().message;
+        }
+    }
+}
+
+TEST(VerifierTest, RejectsMisusedProperties)
+{
+    auto int8 = type(TypeIndex::INT8);
+    // clang-format off
+    auto cases = {
+        // a property of an int
+        with_class({ op(Opcode::LOAD), int8, 1, op(Opcode::GET_PROP), 0, 0, 0, 0, op(Opcode::LOG), op(Opcode::RETURN) }),
+        // a field the class does not have
+        with_class({ op(Opcode::NEW), 0, 0, op(Opcode::GET_PROP), 1, 0, 0, 0, op(Opcode::LOG), op(Opcode::RETURN) }),
+        // a name beyond the table
+        with_class({ op(Opcode::NEW), 0, 0, op(Opcode::GET_PROP), 2, 0, 0, 0, op(Opcode::LOG), op(Opcode::RETURN) }),
+        // a cache beyond the table
+        with_class({ op(Opcode::NEW), 0, 0, op(Opcode::GET_PROP), 0, 0, 1, 0, op(Opcode::LOG), op(Opcode::RETURN) }),
+        // assigning a bool to an int field
+        with_class({ op(Opcode::NEW), 0, 0, op(Opcode::LOAD), type(TypeIndex::BOOL), 1, op(Opcode::SET_PROP), 0, 0, 0, 0, op(Opcode::POP), 1, op(Opcode::RETURN) }),
+        // a class beyond the table
+        with_class({ op(Opcode::NEW), 1, 0, op(Opcode::POP), 1, op(Opcode::RETURN) }),
+        // invoking a field
+        with_class({ op(Opcode::NEW), 0, 0, op(Opcode::INVOKE), 0, 0, 0, 0, 0, op(Opcode::POP), 1, op(Opcode::RETURN) }),
+        // a class extending itself, which would make lookups loop
+        with_class({ op(Opcode::RETURN) }, 0),
+    };
+    // clang-format on
+    for (auto const& segment : cases) {
+        EXPECT_FALSE(verify(segment).has_value());
+    }
+}
+
+TEST(VerifierTest, BothModesRunClasses)
+{
+    // one call site sees more classes than its inline cache has ways
+    auto source = "class A { f(): i32 { return 1; } } class B < A { f(): i32 { return 2; } } class C < A { f(): i32 { return 3; } }"
+                  "class D < A { f(): i32 { return 4; } } class E < A { f(): i32 { return 5; } }"
+                  "fun call(a: A): i32 { return a.f(); } let sum = 0;"
+                  "for (let i = 0; i < 3; i = i + 1) sum = sum + call(A()) + call(B()) + call(C()) + call(D()) + call(E()); log(sum);"
+                  "class P { x: i32; y: i32; } let p = P(); p.x = 1; p.y = 2; let q = P(); q.y = 3; q.x = 4; log(p.x + q.y);";
+
+    testing::internal::CaptureStdout();
+    VM { compile(source) }.execute();
+    std::fflush(stdout);
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "45\n4\n");
+
+    testing::internal::CaptureStdout();
+    auto error = VM { compile(source) }.execute_checked();
+    std::fflush(stdout);
+    EXPECT_FALSE(error.has_value());
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "45\n4\n");
+}
+
+TEST(VerifierTest, BothModesReportUndefinedFields)
+{
+    auto source  = "class P { x: i32; } let p = P(); log(p.x);";
+    auto segment = compile(source);
+    ASSERT_TRUE(verify(segment).has_value());   // whether a field was assigned is only known at runtime
+
+    VM vm { std::move(segment) };
+    vm.execute();
+    ASSERT_TRUE(vm.error().has_value());
+    EXPECT_EQ(vm.error()->message, "undefined property 'x'");
+
+    auto error = VM { compile(source) }.execute_checked();
+    ASSERT_TRUE(error.has_value());
+    EXPECT_EQ(error->message, "undefined property 'x'");
+}